@@ -0,0 +1,655 @@
+/*
+ * Farstream - Shared socket reactor
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-socket-reactor.c - A process-wide pool of epoll threads feeding
+ *                       the sockets of the UDP transmitters
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * A udpsrc has its own streaming thread, so every socket opened by a
+ * transmitter costs one thread that spends its life blocked in poll().
+ * The FsSocketReactorSrc element replaces the udpsrc: it has no thread of
+ * its own, instead its socket is registered with one of a small pool of
+ * epoll threads shared by the whole process. That thread reads the
+ * datagrams and pushes them out of the element's src pad, so they flow
+ * into the transmitter's funnel exactly as they would from a udpsrc.
+ *
+ * The number of threads in the pool defaults to the number of online
+ * processors and can be overridden with the FS_SOCKET_REACTOR_THREADS
+ * environment variable. Threads are started when the first socket is
+ * assigned to them and stopped when their last socket goes away.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-socket-reactor.h"
+#include "fs-private.h"
+
+#include <gst/net/gstnetaddressmeta.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define GST_CAT_DEFAULT _fs_conference_debug
+
+/* Biggest possible UDP payload, read into a per-thread scratch buffer */
+#define MAX_PACKET_SIZE (65536)
+
+/* Maximum number of datagrams read from one socket before moving on to the
+ * next ready one, so one busy socket can not starve the others */
+#define DISPATCH_BUDGET (16)
+
+#define MAX_EVENTS (64)
+#define MAX_THREADS (64)
+
+typedef struct _ReactorThread ReactorThread;
+
+struct _ReactorThread
+{
+  GThread *thread;
+  gint epfd;
+  gint wakefd;
+
+  /* Held while reading, so that the socket of a source is never read once
+   * it has been unregistered. The packets are pushed without it. */
+  GMutex lock;
+  /* Protected by the lock */
+  GHashTable *sources;
+  gboolean quit;
+
+  /* Protected by the global reactor mutex */
+  guint n_sources;
+
+  /* Only touched from the reactor thread */
+  guint8 *scratch;
+};
+
+struct _FsSocketReactorSrcPrivate
+{
+  GstPad *srcpad;
+
+  /* Set at construction time */
+  GSocket *socket;
+  gboolean do_timestamp;
+
+  /* Protected by the global reactor mutex */
+  ReactorThread *thread;
+
+  /* Only touched from the reactor thread while registered */
+  gboolean need_segment;
+};
+
+static GMutex reactor_mutex;
+static ReactorThread **reactor_threads = NULL;
+static guint reactor_n_threads = 0;
+
+static GstStaticPadTemplate _fs_socket_reactor_src_template =
+    GST_STATIC_PAD_TEMPLATE ("src",
+        GST_PAD_SRC,
+        GST_PAD_ALWAYS,
+        GST_STATIC_CAPS_ANY);
+
+G_DEFINE_TYPE (FsSocketReactorSrc, _fs_socket_reactor_src, GST_TYPE_ELEMENT);
+
+static void _fs_socket_reactor_src_finalize (GObject *object);
+static GstStateChangeReturn _fs_socket_reactor_src_change_state (
+    GstElement *element, GstStateChange transition);
+
+static void
+_fs_socket_reactor_src_class_init (FsSocketReactorSrcClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  _fs_conference_init_debug ();
+
+  gobject_class->finalize = _fs_socket_reactor_src_finalize;
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Farstream shared reactor UDP source",
+      "Source/Network",
+      "Receives UDP packets from a process-wide pool of epoll threads",
+      "agent <agent@local>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&_fs_socket_reactor_src_template));
+
+  gstelement_class->change_state = _fs_socket_reactor_src_change_state;
+
+  g_type_class_add_private (klass, sizeof (FsSocketReactorSrcPrivate));
+}
+
+static void
+_fs_socket_reactor_src_init (FsSocketReactorSrc *self)
+{
+  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, FS_TYPE_SOCKET_REACTOR_SRC,
+      FsSocketReactorSrcPrivate);
+
+  self->priv->srcpad = gst_pad_new_from_static_template (
+      &_fs_socket_reactor_src_template, "src");
+  gst_pad_use_fixed_caps (self->priv->srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->priv->srcpad);
+
+  GST_OBJECT_FLAG_SET (self, GST_ELEMENT_FLAG_SOURCE);
+}
+
+static void
+_fs_socket_reactor_src_finalize (GObject *object)
+{
+  FsSocketReactorSrc *self = FS_SOCKET_REACTOR_SRC (object);
+
+  g_assert (self->priv->thread == NULL);
+
+  g_clear_object (&self->priv->socket);
+
+  G_OBJECT_CLASS (_fs_socket_reactor_src_parent_class)->finalize (object);
+}
+
+/**
+ * _fs_socket_reactor_src_new:
+ * @socket: The bound #GSocket to read from, the caller keeps ownership of the
+ *   file descriptor
+ * @do_timestamp: Whether to timestamp the buffers with the running time
+ *
+ * Creates a source element whose socket is serviced by the shared reactor
+ * threads instead of a streaming thread of its own.
+ *
+ * Returns: a new #GstElement
+ */
+
+GstElement *
+_fs_socket_reactor_src_new (GSocket *socket, gboolean do_timestamp)
+{
+  FsSocketReactorSrc *self;
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), NULL);
+
+  self = g_object_new (FS_TYPE_SOCKET_REACTOR_SRC, NULL);
+
+  self->priv->socket = g_object_ref (socket);
+  self->priv->do_timestamp = do_timestamp;
+
+  return GST_ELEMENT (self);
+}
+
+static guint
+reactor_get_pool_size (void)
+{
+  const gchar *env = g_getenv ("FS_SOCKET_REACTOR_THREADS");
+  glong n = 0;
+
+  if (env)
+    n = strtol (env, NULL, 10);
+
+  if (n <= 0)
+  {
+#ifdef _SC_NPROCESSORS_ONLN
+    n = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+    if (n <= 0)
+      n = 1;
+  }
+
+  return CLAMP (n, 1, MAX_THREADS);
+}
+
+static GstClockTime
+_fs_socket_reactor_src_get_running_time (FsSocketReactorSrc *self)
+{
+  GstClock *clock;
+  GstClockTime now = GST_CLOCK_TIME_NONE;
+
+  if (!self->priv->do_timestamp)
+    return GST_CLOCK_TIME_NONE;
+
+  GST_OBJECT_LOCK (self);
+  clock = GST_ELEMENT_CLOCK (self);
+  if (clock)
+  {
+    GstClockTime base_time = GST_ELEMENT_CAST (self)->base_time;
+
+    gst_object_ref (clock);
+    GST_OBJECT_UNLOCK (self);
+    now = gst_clock_get_time (clock);
+    gst_object_unref (clock);
+
+    if (now >= base_time)
+      now -= base_time;
+    else
+      now = 0;
+  }
+  else
+  {
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  return now;
+}
+
+static void
+_fs_socket_reactor_src_push_segment (FsSocketReactorSrc *self)
+{
+  GstSegment segment;
+  gchar *stream_id;
+
+  stream_id = gst_pad_create_stream_id (self->priv->srcpad,
+      GST_ELEMENT (self), NULL);
+  gst_pad_push_event (self->priv->srcpad,
+      gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (self->priv->srcpad, gst_event_new_segment (&segment));
+
+  self->priv->need_segment = FALSE;
+}
+
+/* What was read from one source, pushed after releasing the thread's lock */
+typedef struct
+{
+  FsSocketReactorSrc *self;
+  gboolean need_segment;
+  GstBuffer *buffers[DISPATCH_BUDGET];
+  guint n_buffers;
+} ReactorBatch;
+
+static void
+reactor_thread_read_locked (ReactorThread *t, FsSocketReactorSrc *self,
+    ReactorBatch *batch)
+{
+  gint fd = g_socket_get_fd (self->priv->socket);
+  GstClockTime timestamp = GST_CLOCK_TIME_NONE;
+  gboolean have_timestamp = FALSE;
+
+  batch->self = gst_object_ref (self);
+  batch->need_segment = self->priv->need_segment;
+  self->priv->need_segment = FALSE;
+  batch->n_buffers = 0;
+
+  while (batch->n_buffers < DISPATCH_BUDGET)
+  {
+    struct sockaddr_storage addr;
+    socklen_t addrlen = sizeof (addr);
+    GSocketAddress *gaddr;
+    GstBuffer *buffer;
+    gssize len;
+
+    len = recvfrom (fd, t->scratch, MAX_PACKET_SIZE, MSG_DONTWAIT,
+        (struct sockaddr *) &addr, &addrlen);
+
+    if (len < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      /* ICMP errors from previous sends are reported here, ignore them */
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNREFUSED)
+        GST_WARNING_OBJECT (self, "recvfrom failed: %s", g_strerror (errno));
+      break;
+    }
+
+    if (!have_timestamp)
+    {
+      timestamp = _fs_socket_reactor_src_get_running_time (self);
+      have_timestamp = TRUE;
+    }
+
+    buffer = gst_buffer_new_allocate (NULL, len, NULL);
+    gst_buffer_fill (buffer, 0, t->scratch, len);
+    GST_BUFFER_PTS (buffer) = timestamp;
+    GST_BUFFER_DTS (buffer) = timestamp;
+
+    gaddr = g_socket_address_new_from_native (&addr, addrlen);
+    if (gaddr)
+    {
+      gst_buffer_add_net_address_meta (buffer, gaddr);
+      g_object_unref (gaddr);
+    }
+
+    batch->buffers[batch->n_buffers++] = buffer;
+  }
+}
+
+static void
+reactor_batch_push (ReactorBatch *batch)
+{
+  FsSocketReactorSrc *self = batch->self;
+  guint i;
+
+  if (batch->need_segment)
+    _fs_socket_reactor_src_push_segment (self);
+
+  for (i = 0; i < batch->n_buffers; i++)
+  {
+    GstFlowReturn ret = gst_pad_push (self->priv->srcpad, batch->buffers[i]);
+
+    if (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED)
+    {
+      GST_DEBUG_OBJECT (self, "Push returned %s, dropping the rest for now",
+          gst_flow_get_name (ret));
+      for (i++; i < batch->n_buffers; i++)
+        gst_buffer_unref (batch->buffers[i]);
+      break;
+    }
+  }
+
+  gst_object_unref (self);
+}
+
+static gpointer
+reactor_thread_func (gpointer data)
+{
+  ReactorThread *t = data;
+  struct epoll_event events[MAX_EVENTS];
+  ReactorBatch batches[MAX_EVENTS];
+
+  for (;;)
+  {
+    gint n, i;
+    gint n_batches = 0;
+    gboolean quit;
+
+    n = epoll_wait (t->epfd, events, MAX_EVENTS, -1);
+
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      GST_ERROR ("epoll_wait failed: %s", g_strerror (errno));
+      break;
+    }
+
+    /* Only read under the lock, pushing downstream can block and the
+     * sources are unregistered from streaming and state change threads */
+    g_mutex_lock (&t->lock);
+    for (i = 0; i < n; i++)
+    {
+      FsSocketReactorSrc *self = events[i].data.ptr;
+
+      if (self == NULL)
+      {
+        guint64 dummy;
+
+        if (read (t->wakefd, &dummy, sizeof (dummy)) < 0 && errno != EAGAIN)
+          GST_WARNING ("Could not read the reactor eventfd: %s",
+              g_strerror (errno));
+        continue;
+      }
+
+      /* It may have been unregistered after epoll_wait() returned */
+      if (g_hash_table_contains (t->sources, self))
+        reactor_thread_read_locked (t, self, &batches[n_batches++]);
+    }
+    quit = t->quit;
+    g_mutex_unlock (&t->lock);
+
+    for (i = 0; i < n_batches; i++)
+      reactor_batch_push (&batches[i]);
+
+    if (quit)
+      break;
+  }
+
+  return NULL;
+}
+
+static void
+reactor_thread_free (ReactorThread *t)
+{
+  if (t->thread)
+  {
+    guint64 one = 1;
+
+    g_mutex_lock (&t->lock);
+    t->quit = TRUE;
+    g_mutex_unlock (&t->lock);
+
+    if (write (t->wakefd, &one, sizeof (one)) < 0)
+      GST_WARNING ("Could not wake up the reactor thread: %s",
+          g_strerror (errno));
+    g_thread_join (t->thread);
+  }
+
+  if (t->epfd >= 0)
+    close (t->epfd);
+  if (t->wakefd >= 0)
+    close (t->wakefd);
+
+  g_hash_table_unref (t->sources);
+  g_mutex_clear (&t->lock);
+  g_free (t->scratch);
+  g_slice_free (ReactorThread, t);
+}
+
+static ReactorThread *
+reactor_thread_new (GError **error)
+{
+  ReactorThread *t = g_slice_new0 (ReactorThread);
+  struct epoll_event ev;
+
+  t->epfd = -1;
+  t->wakefd = -1;
+  g_mutex_init (&t->lock);
+  t->sources = g_hash_table_new (NULL, NULL);
+  t->scratch = g_malloc (MAX_PACKET_SIZE);
+
+  t->epfd = epoll_create1 (EPOLL_CLOEXEC);
+  if (t->epfd < 0)
+  {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+        "Could not create epoll instance: %s", g_strerror (errno));
+    goto error;
+  }
+
+  t->wakefd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (t->wakefd < 0)
+  {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+        "Could not create eventfd: %s", g_strerror (errno));
+    goto error;
+  }
+
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  if (epoll_ctl (t->epfd, EPOLL_CTL_ADD, t->wakefd, &ev) < 0)
+  {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+        "Could not add the eventfd to the epoll set: %s", g_strerror (errno));
+    goto error;
+  }
+
+  t->thread = g_thread_try_new ("fs-socket-reactor", reactor_thread_func, t,
+      error);
+  if (!t->thread)
+    goto error;
+
+  return t;
+
+ error:
+  reactor_thread_free (t);
+  return NULL;
+}
+
+static gboolean
+_fs_socket_reactor_src_register (FsSocketReactorSrc *self, GError **error)
+{
+  ReactorThread *t = NULL;
+  struct epoll_event ev;
+  guint i;
+
+  g_mutex_lock (&reactor_mutex);
+  if (!reactor_threads)
+  {
+    reactor_n_threads = reactor_get_pool_size ();
+    reactor_threads = g_new0 (ReactorThread *, reactor_n_threads);
+    GST_DEBUG ("Using up to %u socket reactor threads", reactor_n_threads);
+  }
+
+  /* Pick the least loaded thread, starting a new one if it is idle */
+  for (i = 0; i < reactor_n_threads; i++)
+  {
+    if (!reactor_threads[i])
+    {
+      reactor_threads[i] = reactor_thread_new (error);
+      if (!reactor_threads[i])
+      {
+        g_mutex_unlock (&reactor_mutex);
+        return FALSE;
+      }
+      t = reactor_threads[i];
+      break;
+    }
+
+    if (!t || reactor_threads[i]->n_sources < t->n_sources)
+      t = reactor_threads[i];
+  }
+
+  t->n_sources++;
+  self->priv->thread = t;
+  g_mutex_unlock (&reactor_mutex);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = self;
+
+  g_mutex_lock (&t->lock);
+  g_hash_table_add (t->sources, self);
+  if (epoll_ctl (t->epfd, EPOLL_CTL_ADD, g_socket_get_fd (self->priv->socket),
+          &ev) < 0)
+  {
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+        "Could not add the socket to the epoll set: %s", g_strerror (errno));
+    g_hash_table_remove (t->sources, self);
+    g_mutex_unlock (&t->lock);
+
+    g_mutex_lock (&reactor_mutex);
+    t->n_sources--;
+    self->priv->thread = NULL;
+    g_mutex_unlock (&reactor_mutex);
+    return FALSE;
+  }
+  g_mutex_unlock (&t->lock);
+
+  GST_DEBUG_OBJECT (self, "Registered socket %d with reactor thread %p",
+      g_socket_get_fd (self->priv->socket), t);
+
+  return TRUE;
+}
+
+static void
+_fs_socket_reactor_src_unregister (FsSocketReactorSrc *self)
+{
+  ReactorThread *t;
+  guint i;
+
+  g_mutex_lock (&reactor_mutex);
+  t = self->priv->thread;
+  g_mutex_unlock (&reactor_mutex);
+
+  if (!t)
+    return;
+
+  /* Once we hold the lock, our socket is not being read and the reactor
+   * will ignore any stale event still pending for us. Packets that were
+   * already read may still be pushed, the pad is deactivated after this. */
+  g_mutex_lock (&t->lock);
+  g_hash_table_remove (t->sources, self);
+  if (epoll_ctl (t->epfd, EPOLL_CTL_DEL, g_socket_get_fd (self->priv->socket),
+          NULL) < 0)
+    GST_WARNING_OBJECT (self, "Could not remove socket from epoll set: %s",
+        g_strerror (errno));
+  g_mutex_unlock (&t->lock);
+
+  g_mutex_lock (&reactor_mutex);
+  self->priv->thread = NULL;
+  t->n_sources--;
+
+  /* A thread can not join itself, it will just stay idle */
+  if (t->n_sources > 0 || g_thread_self () == t->thread)
+  {
+    g_mutex_unlock (&reactor_mutex);
+    return;
+  }
+
+  for (i = 0; i < reactor_n_threads; i++)
+    if (reactor_threads[i] == t)
+      reactor_threads[i] = NULL;
+  g_mutex_unlock (&reactor_mutex);
+
+  GST_DEBUG ("Stopping idle socket reactor thread %p", t);
+  reactor_thread_free (t);
+}
+
+static GstStateChangeReturn
+_fs_socket_reactor_src_change_state (GstElement *element,
+    GstStateChange transition)
+{
+  FsSocketReactorSrc *self = FS_SOCKET_REACTOR_SRC (element);
+  GstStateChangeReturn ret;
+  GError *error = NULL;
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      self->priv->need_segment = TRUE;
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+      if (!_fs_socket_reactor_src_register (self, &error))
+      {
+        GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ, (NULL),
+            ("Could not register with the socket reactor: %s",
+                error->message));
+        g_clear_error (&error);
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      break;
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      _fs_socket_reactor_src_unregister (self);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (_fs_socket_reactor_src_parent_class)->change_state (
+      element, transition);
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+      /* We are a live source */
+      if (ret != GST_STATE_CHANGE_FAILURE)
+        ret = GST_STATE_CHANGE_NO_PREROLL;
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
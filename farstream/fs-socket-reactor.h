@@ -0,0 +1,75 @@
+/*
+ * Farstream - Shared socket reactor
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-socket-reactor.h - A process-wide pool of epoll threads feeding
+ *                       the sockets of the UDP transmitters
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_SOCKET_REACTOR_H__
+#define __FS_SOCKET_REACTOR_H__
+
+#include <gst/gst.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define FS_TYPE_SOCKET_REACTOR_SRC \
+  (_fs_socket_reactor_src_get_type ())
+#define FS_SOCKET_REACTOR_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_SOCKET_REACTOR_SRC, \
+      FsSocketReactorSrc))
+#define FS_SOCKET_REACTOR_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_SOCKET_REACTOR_SRC, \
+      FsSocketReactorSrcClass))
+#define FS_IS_SOCKET_REACTOR_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_SOCKET_REACTOR_SRC))
+#define FS_IS_SOCKET_REACTOR_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_SOCKET_REACTOR_SRC))
+
+typedef struct _FsSocketReactorSrc FsSocketReactorSrc;
+typedef struct _FsSocketReactorSrcClass FsSocketReactorSrcClass;
+typedef struct _FsSocketReactorSrcPrivate FsSocketReactorSrcPrivate;
+
+/**
+ * FsSocketReactorSrc:
+ *
+ * All members are private
+ */
+struct _FsSocketReactorSrc
+{
+  GstElement parent;
+
+  /*< private >*/
+  FsSocketReactorSrcPrivate *priv;
+};
+
+struct _FsSocketReactorSrcClass
+{
+  GstElementClass parent_class;
+};
+
+GType _fs_socket_reactor_src_get_type (void);
+
+GstElement *_fs_socket_reactor_src_new (GSocket *socket,
+    gboolean do_timestamp);
+
+G_END_DECLS
+
+#endif /* __FS_SOCKET_REACTOR_H__ */
@@ -226,7 +226,10 @@ fs_stream_transmitter_class_init (FsStreamTransmitterClass *klass)
    * @buffer: the #GstBuffer coming from the known source
    *
    * This signal is emitted when a buffer coming from a confirmed known source
-   * is received.
+   * is received. It is meant to associate the sources with the stream, so
+   * transmitters may coalesce it: once a packet with a given SSRC has been
+   * reported, the following packets with the same SSRC may only be reported
+   * periodically. A packet with a new SSRC is always reported.
    */
   signals[KNOWN_SOURCE_PACKET_RECEIVED] = g_signal_new
     ("known-source-packet-received",
@@ -0,0 +1,308 @@
+/*
+ * Farstream - Shared timer service
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-timer.c - One-shot timers served by a single process-wide thread
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Objects that need a timeout used to start a thread that blocked in
+ * gst_clock_id_wait(), so every substream waiting for RTCP and every
+ * component doing STUN cost one thread. Instead, all timers are kept in a
+ * single queue sorted by deadline, served by one dispatcher thread. When a
+ * timer expires, its callback is handed to a small pool of worker threads,
+ * so a slow callback does not delay the other timers.
+ *
+ * A timer is never run twice concurrently: if it expires again while its
+ * callback is still running, the callback is run again once it returns.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-timer.h"
+
+/* Maximum number of callbacks running at the same time */
+#define MAX_WORKERS (4)
+
+struct _FsTimer
+{
+  FsTimerFunc func;
+  gpointer user_data;
+
+  /* Everything below is protected by the service mutex */
+
+  /* Set while the timer is in the queue */
+  GSequenceIter *iter;
+  gint64 deadline;
+
+  /* Set from the moment the timer is handed to the pool until the
+   * callback has returned */
+  gboolean running;
+  /* The timer expired again while running */
+  gboolean refire;
+  /* Freed from inside its own callback, the worker frees it on return */
+  gboolean destroyed;
+  GThread *runner;
+};
+
+static GMutex timer_mutex;
+/* Wakes up the dispatcher when the first deadline changes */
+static GCond timer_cond;
+/* Signalled each time a callback returns */
+static GCond timer_done_cond;
+static GSequence *timer_queue = NULL;
+static GThread *timer_thread = NULL;
+static GThreadPool *timer_pool = NULL;
+
+static gint
+_fs_timer_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const FsTimer *timer_a = a;
+  const FsTimer *timer_b = b;
+
+  if (timer_a->deadline < timer_b->deadline)
+    return -1;
+  else if (timer_a->deadline > timer_b->deadline)
+    return 1;
+  else
+    return 0;
+}
+
+static void
+_fs_timer_run (gpointer data, gpointer user_data)
+{
+  FsTimer *timer = data;
+
+  g_mutex_lock (&timer_mutex);
+  timer->runner = g_thread_self ();
+  g_mutex_unlock (&timer_mutex);
+
+  timer->func (timer->user_data);
+
+  g_mutex_lock (&timer_mutex);
+  timer->runner = NULL;
+  if (timer->destroyed)
+  {
+    g_mutex_unlock (&timer_mutex);
+    g_slice_free (FsTimer, timer);
+    return;
+  }
+
+  if (timer->refire)
+  {
+    timer->refire = FALSE;
+    g_thread_pool_push (timer_pool, timer, NULL);
+  }
+  else
+  {
+    timer->running = FALSE;
+    g_cond_broadcast (&timer_done_cond);
+  }
+  g_mutex_unlock (&timer_mutex);
+}
+
+static gpointer
+_fs_timer_dispatch (gpointer data)
+{
+  g_mutex_lock (&timer_mutex);
+
+  for (;;)
+  {
+    GSequenceIter *first = g_sequence_get_begin_iter (timer_queue);
+    FsTimer *timer;
+
+    if (g_sequence_iter_is_end (first))
+    {
+      g_cond_wait (&timer_cond, &timer_mutex);
+      continue;
+    }
+
+    timer = g_sequence_get (first);
+
+    if (timer->deadline > g_get_monotonic_time ())
+    {
+      g_cond_wait_until (&timer_cond, &timer_mutex, timer->deadline);
+      continue;
+    }
+
+    g_sequence_remove (first);
+    timer->iter = NULL;
+
+    if (timer->running)
+    {
+      timer->refire = TRUE;
+    }
+    else
+    {
+      timer->running = TRUE;
+      g_thread_pool_push (timer_pool, timer, NULL);
+    }
+  }
+
+  g_mutex_unlock (&timer_mutex);
+
+  return NULL;
+}
+
+static void
+_fs_timer_unschedule_locked (FsTimer *timer)
+{
+  if (timer->iter)
+  {
+    g_sequence_remove (timer->iter);
+    timer->iter = NULL;
+  }
+  timer->refire = FALSE;
+}
+
+/**
+ * _fs_timer_new:
+ * @func: the function to call when the timer expires
+ * @user_data: the data to pass to @func
+ *
+ * Creates a new one-shot timer, it does nothing until it is scheduled with
+ * _fs_timer_schedule().
+ *
+ * Returns: a new #FsTimer, free it with _fs_timer_free()
+ */
+
+FsTimer *
+_fs_timer_new (FsTimerFunc func, gpointer user_data)
+{
+  FsTimer *timer;
+
+  g_return_val_if_fail (func != NULL, NULL);
+
+  timer = g_slice_new0 (FsTimer);
+  timer->func = func;
+  timer->user_data = user_data;
+
+  return timer;
+}
+
+/**
+ * _fs_timer_schedule:
+ * @timer: a #FsTimer
+ * @delay: the time from now after which the timer expires
+ *
+ * Schedules @timer to expire after @delay, replacing any previous deadline.
+ * This never blocks, so it can be called with locks held that the callback
+ * also takes.
+ */
+
+void
+_fs_timer_schedule (FsTimer *timer, GstClockTime delay)
+{
+  g_return_if_fail (timer != NULL);
+  g_return_if_fail (GST_CLOCK_TIME_IS_VALID (delay));
+
+  g_mutex_lock (&timer_mutex);
+
+  if (timer_thread == NULL)
+  {
+    timer_queue = g_sequence_new (NULL);
+    timer_pool = g_thread_pool_new (_fs_timer_run, NULL, MAX_WORKERS, FALSE,
+        NULL);
+    timer_thread = g_thread_new ("fs-timer", _fs_timer_dispatch, NULL);
+  }
+
+  _fs_timer_unschedule_locked (timer);
+
+  timer->deadline = g_get_monotonic_time () + GST_TIME_AS_USECONDS (delay);
+  timer->iter = g_sequence_insert_sorted (timer_queue, timer,
+      _fs_timer_compare, NULL);
+
+  if (g_sequence_iter_is_begin (timer->iter))
+    g_cond_signal (&timer_cond);
+
+  g_mutex_unlock (&timer_mutex);
+}
+
+/**
+ * _fs_timer_unschedule:
+ * @timer: a #FsTimer
+ *
+ * Removes @timer from the queue if it was scheduled. The callback may still
+ * be running when this returns, so like _fs_timer_schedule(), this can be
+ * called with locks held that the callback also takes.
+ */
+
+void
+_fs_timer_unschedule (FsTimer *timer)
+{
+  g_return_if_fail (timer != NULL);
+
+  g_mutex_lock (&timer_mutex);
+  _fs_timer_unschedule_locked (timer);
+  g_mutex_unlock (&timer_mutex);
+}
+
+/**
+ * _fs_timer_cancel:
+ * @timer: a #FsTimer
+ *
+ * Removes @timer from the queue and waits for its callback to return if it
+ * is running, unless it is called from that callback. After this returns,
+ * the callback will not be called again until the timer is re-scheduled.
+ * This must not be called with a lock held that the callback takes.
+ */
+
+void
+_fs_timer_cancel (FsTimer *timer)
+{
+  g_return_if_fail (timer != NULL);
+
+  g_mutex_lock (&timer_mutex);
+  _fs_timer_unschedule_locked (timer);
+  while (timer->running && timer->runner != g_thread_self ())
+    g_cond_wait (&timer_done_cond, &timer_mutex);
+  /* The callback may have re-scheduled the timer while we waited */
+  _fs_timer_unschedule_locked (timer);
+  g_mutex_unlock (&timer_mutex);
+}
+
+/**
+ * _fs_timer_free:
+ * @timer: a #FsTimer
+ *
+ * Cancels @timer like _fs_timer_cancel() and frees it. It is safe to call this
+ * from the timer's own callback.
+ */
+
+void
+_fs_timer_free (FsTimer *timer)
+{
+  g_return_if_fail (timer != NULL);
+
+  _fs_timer_cancel (timer);
+
+  g_mutex_lock (&timer_mutex);
+  if (timer->running)
+  {
+    /* We are inside the callback, the worker frees it on return */
+    timer->destroyed = TRUE;
+    g_mutex_unlock (&timer_mutex);
+    return;
+  }
+  g_mutex_unlock (&timer_mutex);
+
+  g_slice_free (FsTimer, timer);
+}
@@ -0,0 +1,54 @@
+/*
+ * Farstream - Shared timer service
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-timer.h - One-shot timers served by a single process-wide thread
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_TIMER_H__
+#define __FS_TIMER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _FsTimer FsTimer;
+
+/**
+ * FsTimerFunc:
+ * @user_data: the data passed to _fs_timer_new()
+ *
+ * Called from one of the timer service's worker threads when a timer
+ * expires.
+ */
+typedef void (*FsTimerFunc) (gpointer user_data);
+
+FsTimer *_fs_timer_new (FsTimerFunc func, gpointer user_data);
+
+void _fs_timer_schedule (FsTimer *timer, GstClockTime delay);
+
+void _fs_timer_unschedule (FsTimer *timer);
+
+void _fs_timer_cancel (FsTimer *timer);
+
+void _fs_timer_free (FsTimer *timer);
+
+G_END_DECLS
+
+#endif /* __FS_TIMER_H__ */
@@ -0,0 +1,164 @@
+/*
+ * Farstream - Ahead of time RTP codec discovery
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * farstream-discover-codecs.c - Writes the codecs cache offline
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Runs the codec discovery for every media type and writes the result
+ * where the RTP conference looks for it, so that no process has to run the
+ * discovery when it creates its first session. By default, it preseeds the
+ * system-wide cache, which must be re-generated whenever the installed
+ * GStreamer plugins change, the stale cache is ignored until then.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+
+#include <farstream/fs-conference.h>
+
+#include "fs-rtp-codec-cache.h"
+#include "fs-rtp-conference.h"
+#include "fs-rtp-discover-codecs.h"
+
+static const FsMediaType media_types[] = {
+  FS_MEDIA_TYPE_AUDIO,
+  FS_MEDIA_TYPE_VIDEO,
+  FS_MEDIA_TYPE_APPLICATION
+};
+
+#define NUM_MEDIA_TYPES G_N_ELEMENTS (media_types)
+
+static gchar *output_dir = NULL;
+static gboolean user_cache = FALSE;
+
+static GOptionEntry entries[] = {
+  { "output-dir", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir,
+    "Directory to write the cache in (default: " FS_SYSTEM_CODECS_CACHE_DIR
+    ")", "DIR" },
+  { "user", 'u', 0, G_OPTION_ARG_NONE, &user_cache,
+    "Write the current user's cache instead", NULL },
+  { NULL }
+};
+
+typedef struct {
+  FsMediaType media_type;
+  gboolean ok;
+} DiscoverData;
+
+static gpointer
+discover_thread (gpointer user_data)
+{
+  DiscoverData *data = user_data;
+  const gchar *media_name = fs_media_type_to_string (data->media_type);
+  GError *error = NULL;
+  GList *blueprints;
+
+  blueprints = fs_rtp_blueprints_get_uncached (data->media_type, &error);
+
+  if (!blueprints)
+  {
+    /* Not an error, there is just nothing to cache for this media type */
+    g_printerr ("No %s codecs found: %s\n", media_name,
+        error ? error->message : "unknown error");
+    g_clear_error (&error);
+    data->ok = TRUE;
+  }
+  else
+  {
+    if (user_cache)
+      data->ok = save_codecs_cache (data->media_type, blueprints);
+    else
+      data->ok = save_codecs_cache_in_dir (data->media_type, output_dir,
+          blueprints);
+
+    if (data->ok)
+      g_print ("Wrote %u %s codecs\n", g_list_length (blueprints),
+          media_name);
+    else
+      g_printerr ("Could not write the %s codecs cache\n", media_name);
+  }
+
+  fs_rtp_blueprints_unref (data->media_type);
+
+  return NULL;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  DiscoverData data[NUM_MEDIA_TYPES];
+  GThread *threads[NUM_MEDIA_TYPES];
+  gboolean ok = TRUE;
+  guint i;
+
+  context = g_option_context_new ("- discover the RTP codecs ahead of time");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gst_init_get_option_group ());
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+  {
+    g_printerr ("%s\n", error->message);
+    g_clear_error (&error);
+    g_option_context_free (context);
+    return 2;
+  }
+  g_option_context_free (context);
+
+  if (user_cache && output_dir)
+  {
+    g_printerr ("--user and --output-dir can not be used together\n");
+    return 2;
+  }
+
+  if (!output_dir)
+    output_dir = g_strdup (FS_SYSTEM_CODECS_CACHE_DIR);
+
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_disco, "fsrtpconference_disco",
+      0, "Farstream RTP Codec Discovery");
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_nego, "fsrtpconference_nego",
+      0, "Farstream RTP Codec Negotiation");
+
+  /* Each media type has its own lock, so they can be discovered in
+   * parallel */
+  for (i = 0; i < NUM_MEDIA_TYPES; i++)
+  {
+    data[i].media_type = media_types[i];
+    data[i].ok = FALSE;
+    threads[i] = g_thread_new ("discover", discover_thread, &data[i]);
+  }
+
+  for (i = 0; i < NUM_MEDIA_TYPES; i++)
+  {
+    g_thread_join (threads[i]);
+    ok &= data[i].ok;
+  }
+
+  g_free (output_dir);
+
+  return ok ? 0 : 1;
+}
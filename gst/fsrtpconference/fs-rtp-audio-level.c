@@ -0,0 +1,579 @@
+/*
+ * Farstream - Farstream RTP Audio Level
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-rtp-audio-level.c - Client-to-mixer audio level (RFC 6464) handling
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-audio-level.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include <farstream/fs-rtp.h>
+
+#include "fs-rtp-conference.h"
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+
+/* All times are in microseconds, from g_get_monotonic_time() */
+
+/* How often the loudest speakers are chosen again */
+#define SELECTION_INTERVAL (100 * 1000)
+
+/* Speakers that have not sent anything in that time are forgotten */
+#define SPEAKER_TIMEOUT (2 * G_USEC_PER_SEC)
+
+/* The current speakers are kept until someone is louder by that many dB */
+#define SELECTION_HYSTERESIS (6.0)
+
+/* Weight of the last packet in the average loudness of a speaker */
+#define LOUDNESS_SMOOTHING (0.2)
+
+/* A SSRC has to be silent for that long before its decoding is paused */
+#define SILENCE_HOLD (500 * 1000)
+
+/* How often the level of a SSRC that is not paused is reported */
+#define LEVEL_REPORT_INTERVAL (200 * 1000)
+
+typedef struct {
+  guint32 ssrc;
+
+  /* Average of 127 - level, so louder is bigger */
+  gdouble loudness;
+  gint64 last_seen;
+
+  gboolean selected;
+} Speaker;
+
+typedef struct {
+  gint64 last_seen;
+  gint64 last_loud;
+  gint64 last_report;
+
+  /* Loudest level since the last report, if any packet had one */
+  gboolean has_level;
+  guint8 level;
+  gboolean voice;
+
+  gboolean paused;
+} Level;
+
+struct _FsRtpLevelTracker {
+  GMutex mutex;
+
+  guint8 threshold;
+  guint ext_id;
+
+  /* ssrc -> Level */
+  GHashTable *levels;
+  gint64 last_cleanup;
+};
+
+struct _FsRtpSpeakerSelector {
+  GMutex mutex;
+
+  guint max_speakers;
+  guint ext_id;
+
+  /* ssrc -> Speaker */
+  GHashTable *speakers;
+  guint n_selected;
+  gint64 last_selection;
+};
+
+/**
+ * fs_rtp_audio_level_find_extension_id:
+ * @header_extensions: a #GList of #FsRtpHeaderExtension
+ *
+ * Returns: The id of the received audio level extension, or 0 if it has not
+ *  been negotiated
+ */
+
+guint
+fs_rtp_audio_level_find_extension_id (GList *header_extensions)
+{
+  GList *item;
+
+  for (item = header_extensions; item; item = item->next)
+  {
+    FsRtpHeaderExtension *hdrext = item->data;
+
+    if (!strcmp (hdrext->uri, FS_RTP_AUDIO_LEVEL_URI) &&
+        (hdrext->direction & FS_DIRECTION_RECV) &&
+        hdrext->id > 0 && hdrext->id < 256)
+      return hdrext->id;
+  }
+
+  return 0;
+}
+
+/**
+ * fs_rtp_audio_level_parse:
+ * @buffer: a RTP packet
+ * @ext_id: the id of the audio level extension
+ * @ssrc: location for the SSRC of the packet
+ * @has_level: location for whether the packet carries the extension
+ * @level: location for the level in -dBov
+ * @voice: location for the voice activity flag
+ *
+ * If the packet does not carry the extension, nothing is known about its
+ * level, @has_level is %FALSE and @level and @voice are not set.
+ *
+ * Returns: %FALSE if @buffer is not a RTP packet
+ */
+
+gboolean
+fs_rtp_audio_level_parse (GstBuffer *buffer, guint ext_id, guint32 *ssrc,
+    gboolean *has_level, guint8 *level, gboolean *voice)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  gpointer data = NULL;
+  guint size = 0;
+  gboolean found = FALSE;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
+    return FALSE;
+
+  *ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
+
+  if (ext_id > 0 && ext_id < 15)
+  {
+    found = gst_rtp_buffer_get_extension_onebyte_header (&rtpbuffer, ext_id,
+        0, &data, &size);
+  }
+  else if (ext_id >= 15)
+  {
+    guint8 appbits;
+
+    found = gst_rtp_buffer_get_extension_twobytes_header (&rtpbuffer,
+        &appbits, ext_id, 0, &data, &size);
+  }
+
+  *has_level = (found && size >= 1);
+  if (*has_level)
+  {
+    guint8 byte = *(guint8 *) data;
+
+    *voice = (byte & 0x80) != 0;
+    *level = byte & 0x7f;
+  }
+
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  return TRUE;
+}
+
+static void
+speaker_free (gpointer data)
+{
+  g_slice_free (Speaker, data);
+}
+
+/*
+ * The speaker selector keeps the K loudest speakers based on the audio level
+ * they announce in their packets, so that only those have to be decoded
+ */
+
+FsRtpSpeakerSelector *
+fs_rtp_speaker_selector_new (guint max_speakers)
+{
+  FsRtpSpeakerSelector *self = g_slice_new0 (FsRtpSpeakerSelector);
+
+  g_mutex_init (&self->mutex);
+  self->max_speakers = max_speakers;
+  self->speakers = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, speaker_free);
+
+  return self;
+}
+
+void
+fs_rtp_speaker_selector_free (FsRtpSpeakerSelector *self)
+{
+  g_hash_table_destroy (self->speakers);
+  g_mutex_clear (&self->mutex);
+  g_slice_free (FsRtpSpeakerSelector, self);
+}
+
+/* 0 means that every speaker is selected */
+
+void
+fs_rtp_speaker_selector_set_max_speakers (FsRtpSpeakerSelector *self,
+    guint max_speakers)
+{
+  g_mutex_lock (&self->mutex);
+  self->max_speakers = max_speakers;
+  /* Select again with the next packet */
+  self->last_selection = 0;
+  g_mutex_unlock (&self->mutex);
+}
+
+/* 0 means that the extension has not been negotiated */
+
+void
+fs_rtp_speaker_selector_set_extension_id (FsRtpSpeakerSelector *self,
+    guint ext_id)
+{
+  g_mutex_lock (&self->mutex);
+  self->ext_id = ext_id;
+  g_mutex_unlock (&self->mutex);
+}
+
+static gint
+compare_speakers (gconstpointer a, gconstpointer b)
+{
+  const Speaker *sa = *(const Speaker **) a;
+  const Speaker *sb = *(const Speaker **) b;
+  gdouble score_a = sa->loudness + (sa->selected ? SELECTION_HYSTERESIS : 0);
+  gdouble score_b = sb->loudness + (sb->selected ? SELECTION_HYSTERESIS : 0);
+
+  if (score_a > score_b)
+    return -1;
+  else if (score_a < score_b)
+    return 1;
+  else if (sa->ssrc < sb->ssrc)
+    return -1;
+  else if (sa->ssrc > sb->ssrc)
+    return 1;
+  else
+    return 0;
+}
+
+static void
+fs_rtp_speaker_selector_select_locked (FsRtpSpeakerSelector *self,
+    gint64 now)
+{
+  GHashTableIter iter;
+  gpointer value;
+  Speaker **sorted;
+  guint n = 0;
+  guint i;
+
+  self->last_selection = now;
+
+  sorted = g_new (Speaker *, g_hash_table_size (self->speakers));
+
+  g_hash_table_iter_init (&iter, self->speakers);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+  {
+    Speaker *speaker = value;
+
+    if (now - speaker->last_seen > SPEAKER_TIMEOUT)
+      g_hash_table_iter_remove (&iter);
+    else
+      sorted[n++] = speaker;
+  }
+
+  qsort (sorted, n, sizeof (Speaker *), compare_speakers);
+
+  for (i = 0; i < n; i++)
+    sorted[i]->selected = (i < self->max_speakers);
+  self->n_selected = MIN (n, self->max_speakers);
+
+  g_free (sorted);
+}
+
+/**
+ * fs_rtp_speaker_selector_process:
+ * @self: a #FsRtpSpeakerSelector
+ * @buffer: a received RTP packet
+ *
+ * Updates the loudness of the sender of @buffer and tells if it is
+ * one of the loudest speakers. New speakers are selected right away as long
+ * as there are less than the maximum. The senders that do not announce
+ * their level can not be compared, so they are always decoded and they do
+ * not take the place of a speaker.
+ *
+ * Returns: %TRUE if the packet should be decoded
+ */
+
+gboolean
+fs_rtp_speaker_selector_process (FsRtpSpeakerSelector *self,
+    GstBuffer *buffer)
+{
+  Speaker *speaker;
+  guint32 ssrc;
+  gboolean has_level;
+  guint8 level;
+  gboolean voice;
+  gint64 now;
+  gboolean selected = TRUE;
+
+  g_mutex_lock (&self->mutex);
+
+  /* Without the levels, there is nothing to choose from */
+  if (self->max_speakers == 0 || self->ext_id == 0)
+    goto out;
+
+  if (!fs_rtp_audio_level_parse (buffer, self->ext_id, &ssrc, &has_level,
+          &level, &voice))
+    goto out;
+
+  if (!has_level)
+  {
+    speaker = g_hash_table_lookup (self->speakers, GUINT_TO_POINTER (ssrc));
+    if (speaker)
+    {
+      GST_DEBUG ("SSRC %X stopped announcing its level, always decoding it",
+          ssrc);
+      if (speaker->selected)
+        self->n_selected--;
+      g_hash_table_remove (self->speakers, GUINT_TO_POINTER (ssrc));
+    }
+    goto out;
+  }
+
+  now = g_get_monotonic_time ();
+
+  speaker = g_hash_table_lookup (self->speakers, GUINT_TO_POINTER (ssrc));
+  if (!speaker)
+  {
+    speaker = g_slice_new0 (Speaker);
+    speaker->ssrc = ssrc;
+    if (self->n_selected < self->max_speakers)
+    {
+      speaker->selected = TRUE;
+      self->n_selected++;
+    }
+    g_hash_table_insert (self->speakers, GUINT_TO_POINTER (ssrc), speaker);
+  }
+
+  speaker->loudness += ((FS_RTP_AUDIO_LEVEL_SILENT - level) -
+      speaker->loudness) * LOUDNESS_SMOOTHING;
+  speaker->last_seen = now;
+
+  if (now - self->last_selection >= SELECTION_INTERVAL)
+  {
+    fs_rtp_speaker_selector_select_locked (self, now);
+    if (speaker->selected)
+      GST_LOG ("SSRC %X is one of the %u loudest speakers", ssrc,
+          self->max_speakers);
+  }
+
+  selected = speaker->selected;
+
+ out:
+  g_mutex_unlock (&self->mutex);
+
+  return selected;
+}
+
+static void
+level_free (gpointer data)
+{
+  g_slice_free (Level, data);
+}
+
+/*
+ * The level tracker follows the audio level announced by every SSRC and
+ * pauses the decoding of those that have been silent for a while
+ */
+
+FsRtpLevelTracker *
+fs_rtp_level_tracker_new (guint8 threshold)
+{
+  FsRtpLevelTracker *self = g_slice_new0 (FsRtpLevelTracker);
+
+  g_mutex_init (&self->mutex);
+  self->threshold = threshold;
+  self->levels = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, level_free);
+
+  return self;
+}
+
+void
+fs_rtp_level_tracker_free (FsRtpLevelTracker *self)
+{
+  g_hash_table_destroy (self->levels);
+  g_mutex_clear (&self->mutex);
+  g_slice_free (FsRtpLevelTracker, self);
+}
+
+/* SSRCs quieter than the threshold are silent,
+ * %FS_RTP_AUDIO_LEVEL_SILENT means that nothing is ever paused */
+
+void
+fs_rtp_level_tracker_set_threshold (FsRtpLevelTracker *self, guint8 threshold)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  g_mutex_lock (&self->mutex);
+  self->threshold = threshold;
+  /* Everyone starts again from scratch */
+  g_hash_table_iter_init (&iter, self->levels);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+  {
+    Level *level = value;
+
+    level->paused = FALSE;
+    level->last_loud = level->last_seen;
+  }
+  g_mutex_unlock (&self->mutex);
+}
+
+/* 0 means that the extension has not been negotiated */
+
+void
+fs_rtp_level_tracker_set_extension_id (FsRtpLevelTracker *self, guint ext_id)
+{
+  g_mutex_lock (&self->mutex);
+  self->ext_id = ext_id;
+  if (ext_id == 0)
+    g_hash_table_remove_all (self->levels);
+  g_mutex_unlock (&self->mutex);
+}
+
+/**
+ * fs_rtp_level_tracker_process:
+ * @self: a #FsRtpLevelTracker
+ * @buffer: a received RTP packet, before the jitterbuffer
+ * @ssrc: location for the SSRC of the packet
+ * @has_level: location for whether any packet announced a level since the
+ *  last report, @level and @voice are only set if it did
+ * @level: location for the loudest level since the last report
+ * @voice: location for the voice activity since the last report
+ * @paused: location for whether the decoding of @ssrc is paused
+ *
+ * Updates the level of the sender of @buffer. It is paused once it has been
+ * quieter than the threshold without voice activity for a while and resumed
+ * as soon as it is louder. A packet without the extension says nothing about
+ * the level, so it counts as loud: the senders that do not announce their
+ * level are never paused.
+ *
+ * Returns: %TRUE if the level should be reported, that is when @ssrc is
+ *  paused or resumed and regularly while it is not paused
+ */
+
+gboolean
+fs_rtp_level_tracker_process (FsRtpLevelTracker *self, GstBuffer *buffer,
+    guint32 *ssrc, gboolean *has_level, guint8 *level, gboolean *voice,
+    gboolean *paused)
+{
+  Level *l;
+  gboolean pkt_has_level;
+  guint8 pkt_level = FS_RTP_AUDIO_LEVEL_SILENT;
+  gboolean pkt_voice = FALSE;
+  gboolean was_paused;
+  gboolean report = FALSE;
+  gint64 now;
+
+  g_mutex_lock (&self->mutex);
+
+  if (self->ext_id == 0)
+    goto out;
+
+  if (!fs_rtp_audio_level_parse (buffer, self->ext_id, ssrc, &pkt_has_level,
+          &pkt_level, &pkt_voice))
+    goto out;
+
+  now = g_get_monotonic_time ();
+
+  if (now - self->last_cleanup > SPEAKER_TIMEOUT)
+  {
+    GHashTableIter iter;
+    gpointer value;
+
+    self->last_cleanup = now;
+    g_hash_table_iter_init (&iter, self->levels);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+      if (now - ((Level *) value)->last_seen > SPEAKER_TIMEOUT)
+        g_hash_table_iter_remove (&iter);
+  }
+
+  l = g_hash_table_lookup (self->levels, GUINT_TO_POINTER (*ssrc));
+  if (!l)
+  {
+    l = g_slice_new0 (Level);
+    l->level = FS_RTP_AUDIO_LEVEL_SILENT;
+    l->last_loud = now;
+    g_hash_table_insert (self->levels, GUINT_TO_POINTER (*ssrc), l);
+  }
+
+  l->last_seen = now;
+  if (pkt_has_level)
+  {
+    l->has_level = TRUE;
+    l->level = MIN (l->level, pkt_level);
+    l->voice |= pkt_voice;
+  }
+
+  if (!pkt_has_level || pkt_voice || pkt_level <= self->threshold)
+    l->last_loud = now;
+
+  was_paused = l->paused;
+  l->paused = (now - l->last_loud > SILENCE_HOLD);
+
+  /* Without any level, only the resumes are worth reporting */
+  if (l->paused != was_paused ||
+      (!l->paused && l->has_level &&
+          now - l->last_report >= LEVEL_REPORT_INTERVAL))
+  {
+    report = TRUE;
+    *has_level = l->has_level;
+    *level = l->level;
+    *voice = l->voice;
+    *paused = l->paused;
+
+    l->last_report = now;
+    l->has_level = FALSE;
+    l->level = FS_RTP_AUDIO_LEVEL_SILENT;
+    l->voice = FALSE;
+
+    if (l->paused != was_paused)
+      GST_DEBUG ("Decoding of SSRC %X %s", *ssrc,
+          l->paused ? "paused" : "resumed");
+  }
+
+ out:
+  g_mutex_unlock (&self->mutex);
+
+  return report;
+}
+
+/**
+ * fs_rtp_level_tracker_is_paused:
+ * @self: a #FsRtpLevelTracker
+ * @ssrc: a SSRC
+ *
+ * Returns: %TRUE if the packets from @ssrc do not need to be decoded
+ */
+
+gboolean
+fs_rtp_level_tracker_is_paused (FsRtpLevelTracker *self, guint32 ssrc)
+{
+  Level *l;
+  gboolean paused = FALSE;
+
+  g_mutex_lock (&self->mutex);
+  l = g_hash_table_lookup (self->levels, GUINT_TO_POINTER (ssrc));
+  if (l)
+    paused = l->paused;
+  g_mutex_unlock (&self->mutex);
+
+  return paused;
+}
@@ -0,0 +1,72 @@
+/*
+ * Farstream - Farstream RTP Audio Level
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-rtp-audio-level.h - Client-to-mixer audio level (RFC 6464) handling
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_AUDIO_LEVEL_H__
+#define __FS_RTP_AUDIO_LEVEL_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define FS_RTP_AUDIO_LEVEL_URI "urn:ietf:params:rtp-hdrext:ssrc-audio-level"
+
+/* The level is in -dBov, 127 is the quietest */
+#define FS_RTP_AUDIO_LEVEL_SILENT (127)
+
+guint fs_rtp_audio_level_find_extension_id (GList *header_extensions);
+
+gboolean fs_rtp_audio_level_parse (GstBuffer *buffer, guint ext_id,
+    guint32 *ssrc, gboolean *has_level, guint8 *level, gboolean *voice);
+
+typedef struct _FsRtpSpeakerSelector FsRtpSpeakerSelector;
+
+FsRtpSpeakerSelector *fs_rtp_speaker_selector_new (guint max_speakers);
+void fs_rtp_speaker_selector_free (FsRtpSpeakerSelector *self);
+
+void fs_rtp_speaker_selector_set_max_speakers (FsRtpSpeakerSelector *self,
+    guint max_speakers);
+void fs_rtp_speaker_selector_set_extension_id (FsRtpSpeakerSelector *self,
+    guint ext_id);
+
+gboolean fs_rtp_speaker_selector_process (FsRtpSpeakerSelector *self,
+    GstBuffer *buffer);
+
+typedef struct _FsRtpLevelTracker FsRtpLevelTracker;
+
+FsRtpLevelTracker *fs_rtp_level_tracker_new (guint8 threshold);
+void fs_rtp_level_tracker_free (FsRtpLevelTracker *self);
+
+void fs_rtp_level_tracker_set_threshold (FsRtpLevelTracker *self,
+    guint8 threshold);
+void fs_rtp_level_tracker_set_extension_id (FsRtpLevelTracker *self,
+    guint ext_id);
+
+gboolean fs_rtp_level_tracker_process (FsRtpLevelTracker *self,
+    GstBuffer *buffer, guint32 *ssrc, gboolean *has_level, guint8 *level,
+    gboolean *voice, gboolean *paused);
+gboolean fs_rtp_level_tracker_is_paused (FsRtpLevelTracker *self,
+    guint32 ssrc);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_AUDIO_LEVEL_H__ */
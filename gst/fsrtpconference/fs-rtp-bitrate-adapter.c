@@ -28,14 +28,35 @@
 #include "fs-rtp-bitrate-adapter.h"
 
 #include <math.h>
+#include <string.h>
 
 /* This is a magical value that smarter people discovered */
 /* This is H.264... other codecs (H.265 / VP9 ) will have different numbers */
 #define  H264_MAX_PIXELS_PER_BIT 25
 
+/* Bitrates are rounded to a multiple of this before generating the
+ * caps, so that close bitrates share the same caps
+ */
+#define BITRATE_QUANTUM (16 * 1000)
+
+/* Enough for the largest resolution of the tables at 20 fps, the caps are
+ * the same for any higher bitrate
+ */
+#define MAX_QUANTIZED_BITRATE \
+  ((1920 * 1200 * 20 / H264_MAX_PIXELS_PER_BIT / BITRATE_QUANTUM + 1) * \
+      BITRATE_QUANTUM)
+
 GST_DEBUG_CATEGORY_STATIC (fs_rtp_bitrate_adapter_debug);
 #define GST_CAT_DEFAULT fs_rtp_bitrate_adapter_debug
 
+/* Caps generated by caps_from_bitrate () for each media type and quantized
+ * bitrate, shared by all instances, they are never modified once cached */
+static GMutex rated_caps_mutex;
+static GHashTable *rated_caps_cache = NULL;
+
+/* Index in the per pad caps cache */
+#define PAD_INDEX(self, pad) ((pad) == (self)->sinkpad ? 0 : 1)
+
 static GstStaticPadTemplate fs_rtp_bitrate_adapter_sink_template =
     GST_STATIC_PAD_TEMPLATE ("sink",
         GST_PAD_SINK,
@@ -52,10 +73,19 @@ enum
   PROP_0,
   PROP_BITRATE,
   PROP_INTERVAL,
+  PROP_ESTIMATOR,
+  PROP_PERCENTILE,
+  PROP_EWMA_WEIGHT
 };
 
 #define PROP_INTERVAL_DEFAULT (10 * GST_SECOND)
 #define PROP_BITRATE_DEFAULT (G_MAXUINT)
+#define PROP_ESTIMATOR_DEFAULT (FS_RTP_BITRATE_ADAPTER_DEFAULT_ESTIMATOR)
+#define PROP_PERCENTILE_DEFAULT (FS_RTP_BITRATE_ADAPTER_DEFAULT_PERCENTILE)
+#define PROP_EWMA_WEIGHT_DEFAULT (FS_RTP_BITRATE_ADAPTER_DEFAULT_EWMA_WEIGHT)
+
+/* Initial size of the history ring buffer, it grows if needed */
+#define HISTORY_INITIAL_SIZE (64)
 
 static void fs_rtp_bitrate_adapter_finalize (GObject *object);
 static void fs_rtp_bitrate_adapter_set_property (GObject *object,
@@ -66,10 +96,39 @@ static void fs_rtp_bitrate_adapter_set_property (GObject *object,
 
 G_DEFINE_TYPE (FsRtpBitrateAdapter, fs_rtp_bitrate_adapter, GST_TYPE_ELEMENT);
 
+GType
+fs_rtp_bitrate_adapter_estimator_get_type (void)
+{
+  static gsize estimator_type = 0;
+  static const GEnumValue estimators[] = {
+    {FS_RTP_BITRATE_ADAPTER_ESTIMATOR_MEAN_STDDEV,
+     "Mean minus the standard deviation", "mean-stddev"},
+    {FS_RTP_BITRATE_ADAPTER_ESTIMATOR_PERCENTILE,
+     "Percentile", "percentile"},
+    {FS_RTP_BITRATE_ADAPTER_ESTIMATOR_EWMA,
+     "Exponentially weighted moving average", "ewma"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&estimator_type))
+  {
+    GType type = g_enum_register_static ("FsRtpBitrateAdapterEstimator",
+        estimators);
+    g_once_init_leave (&estimator_type, type);
+  }
+
+  return estimator_type;
+}
+
 static GstFlowReturn fs_rtp_bitrate_adapter_chain (GstPad *pad,
     GstObject *parent, GstBuffer *buffer);
 static gboolean fs_rtp_bitrate_adapter_query (GstPad *pad, GstObject *parent,
     GstQuery *query);
+static gboolean fs_rtp_bitrate_adapter_event (GstPad *pad, GstObject *parent,
+    GstEvent *event);
+static GstPadLinkReturn fs_rtp_bitrate_adapter_link (GstPad *pad,
+    GstObject *parent, GstPad *peer);
+static void fs_rtp_bitrate_adapter_unlink (GstPad *pad, GstObject *parent);
 
 static GstStateChangeReturn
 fs_rtp_bitrate_adapter_change_state (GstElement *element,
@@ -117,29 +176,93 @@ fs_rtp_bitrate_adapter_class_init (FsRtpBitrateAdapterClass *klass)
           "The minimum interval before adapting after a change",
           0, G_MAXUINT64, PROP_INTERVAL_DEFAULT,
           G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_ESTIMATOR,
+      g_param_spec_enum ("estimator",
+          "Bitrate estimator",
+          "How the bitrate to adapt for is computed from the received ones",
+          FS_TYPE_RTP_BITRATE_ADAPTER_ESTIMATOR, PROP_ESTIMATOR_DEFAULT,
+          G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_PERCENTILE,
+      g_param_spec_uint ("percentile",
+          "Percentile",
+          "The percentile of the received bitrates to adapt for with"
+          " the percentile estimator",
+          0, 100, PROP_PERCENTILE_DEFAULT,
+          G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_EWMA_WEIGHT,
+      g_param_spec_double ("ewma-weight",
+          "EWMA weight",
+          "The weight of each new bitrate with the ewma estimator",
+          0, 1, PROP_EWMA_WEIGHT_DEFAULT,
+          G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
 }
 
-struct BitratePoint
+static FsRtpBitratePoint *
+history_nth (FsRtpBitrateAdapter *self, guint n)
 {
-  GstClockTime timestamp;
-  guint bitrate;
-};
+  return &self->history[(self->history_head + n) % self->history_size];
+}
 
-static struct BitratePoint *
-bitrate_point_new (GstClockTime timestamp, guint bitrate)
+static void
+history_push (FsRtpBitrateAdapter *self, GstClockTime timestamp,
+    guint bitrate)
 {
-  struct BitratePoint *bp = g_slice_new (struct BitratePoint);
+  FsRtpBitratePoint *bp;
 
+  if (self->history_len == self->history_size)
+  {
+    guint old_size = self->history_size;
+
+    /* Move the wrapped part after the end so the points stay in order */
+    self->history_size *= 2;
+    self->history = g_renew (FsRtpBitratePoint, self->history,
+        self->history_size);
+    memcpy (self->history + old_size, self->history,
+        self->history_head * sizeof (FsRtpBitratePoint));
+    self->history_scratch = g_renew (guint, self->history_scratch,
+        self->history_size);
+  }
+
+  bp = history_nth (self, self->history_len);
   bp->timestamp = timestamp;
   bp->bitrate = bitrate;
+  self->history_len++;
+
+  self->history_sum += bitrate;
+  self->history_sum_sq += (gdouble) bitrate * bitrate;
+}
+
+static void
+history_pop (FsRtpBitrateAdapter *self)
+{
+  FsRtpBitratePoint *bp = history_nth (self, 0);
+
+  self->history_sum -= bp->bitrate;
+  self->history_sum_sq -= (gdouble) bp->bitrate * bp->bitrate;
 
-  return bp;
+  self->history_head = (self->history_head + 1) % self->history_size;
+  self->history_len--;
+
+  /* Don't let rounding errors accumulate */
+  if (self->history_len == 0)
+    self->history_sum_sq = 0;
 }
 
 static void
-bitrate_point_free (struct BitratePoint *bp)
+history_clear (FsRtpBitrateAdapter *self)
 {
-  g_slice_free (struct BitratePoint, bp);
+  self->history_head = 0;
+  self->history_len = 0;
+  self->history_sum = 0;
+  self->history_sum_sq = 0;
+  self->ewma = 0;
+  self->have_ewma = FALSE;
 }
 
 
@@ -150,15 +273,27 @@ fs_rtp_bitrate_adapter_init (FsRtpBitrateAdapter *self)
     &fs_rtp_bitrate_adapter_sink_template, "sink");
   gst_pad_set_chain_function (self->sinkpad, fs_rtp_bitrate_adapter_chain);
   gst_pad_set_query_function (self->sinkpad, fs_rtp_bitrate_adapter_query);
+  gst_pad_set_event_function (self->sinkpad, fs_rtp_bitrate_adapter_event);
+  gst_pad_set_link_function (self->sinkpad, fs_rtp_bitrate_adapter_link);
+  gst_pad_set_unlink_function (self->sinkpad, fs_rtp_bitrate_adapter_unlink);
   GST_PAD_SET_PROXY_CAPS (self->sinkpad);
   gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
 
   self->srcpad = gst_pad_new_from_static_template (
     &fs_rtp_bitrate_adapter_src_template, "src");
   gst_pad_set_query_function (self->sinkpad, fs_rtp_bitrate_adapter_query);
+  gst_pad_set_event_function (self->srcpad, fs_rtp_bitrate_adapter_event);
+  gst_pad_set_link_function (self->srcpad, fs_rtp_bitrate_adapter_link);
+  gst_pad_set_unlink_function (self->srcpad, fs_rtp_bitrate_adapter_unlink);
   gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
 
-  g_queue_init (&self->bitrate_history);
+  self->history_size = HISTORY_INITIAL_SIZE;
+  self->history = g_new (FsRtpBitratePoint, self->history_size);
+  self->history_scratch = g_new (guint, self->history_size);
+  self->estimator = PROP_ESTIMATOR_DEFAULT;
+  self->percentile = PROP_PERCENTILE_DEFAULT;
+  self->ewma_weight = PROP_EWMA_WEIGHT_DEFAULT;
+
   self->system_clock = gst_system_clock_obtain ();
   self->interval = PROP_INTERVAL_DEFAULT;
 
@@ -170,12 +305,19 @@ static void
 fs_rtp_bitrate_adapter_finalize (GObject *object)
 {
   FsRtpBitrateAdapter *self = FS_RTP_BITRATE_ADAPTER (object);
+  guint i;
 
   if (self->system_clock)
     gst_object_unref (self->system_clock);
 
-  g_queue_foreach (&self->bitrate_history, (GFunc) bitrate_point_free, NULL);
-  g_queue_clear(&self->bitrate_history);
+  g_free (self->history);
+  g_free (self->history_scratch);
+
+  for (i = 0; i < G_N_ELEMENTS (self->cached_caps); i++)
+  {
+    gst_caps_replace (&self->cached_filter[i], NULL);
+    gst_caps_replace (&self->cached_caps[i], NULL);
+  }
 
   G_OBJECT_CLASS (fs_rtp_bitrate_adapter_parent_class)->finalize (object);
 }
@@ -302,9 +444,9 @@ caps_from_bitrate (const gchar *media_type, guint bitrate)
 
   for (i = 0; twelve_on_eleven_resolutions[i].width > 1; i++)
     add_one_resolution (media_type, caps, lower_caps, extra_low_caps,
+        max_pixels_per_second,
         twelve_on_eleven_resolutions[i].width,
-        twelve_on_eleven_resolutions[i].height,
-        max_pixels_per_second, 12, 11);
+        twelve_on_eleven_resolutions[i].height, 12, 11);
 
   gst_caps_append (caps, lower_caps);
   if (gst_caps_is_empty (caps))
@@ -315,6 +457,64 @@ caps_from_bitrate (const gchar *media_type, guint bitrate)
   return caps;
 }
 
+/*
+ * Rounds to the nearest quantum, but never to 0, which would give the
+ * smallest caps to any low bitrate instead of the ones closest to it.
+ */
+
+static guint
+quantize_bitrate (guint bitrate)
+{
+  bitrate = MIN (bitrate, MAX_QUANTIZED_BITRATE);
+  bitrate += BITRATE_QUANTUM / 2;
+
+  return MAX (bitrate - (bitrate % BITRATE_QUANTUM), BITRATE_QUANTUM);
+}
+
+/*
+ * Returns the caps from caps_from_bitrate () for an already quantized
+ * bitrate, from the cache if possible. The returned caps must not be
+ * modified without making them writable.
+ */
+
+static GstCaps *
+get_rated_caps (GQuark media_type, guint bitrate)
+{
+  gint64 key = ((gint64) media_type << 32) | bitrate;
+  GstCaps *caps;
+  GstCaps *cached;
+
+  g_mutex_lock (&rated_caps_mutex);
+  if (!rated_caps_cache)
+    rated_caps_cache = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+        g_free, (GDestroyNotify) gst_caps_unref);
+  caps = g_hash_table_lookup (rated_caps_cache, &key);
+  if (caps)
+    gst_caps_ref (caps);
+  g_mutex_unlock (&rated_caps_mutex);
+
+  if (caps)
+    return caps;
+
+  caps = caps_from_bitrate (g_quark_to_string (media_type), bitrate);
+
+  g_mutex_lock (&rated_caps_mutex);
+  cached = g_hash_table_lookup (rated_caps_cache, &key);
+  if (cached)
+  {
+    /* Someone else was faster */
+    gst_caps_unref (caps);
+    caps = gst_caps_ref (cached);
+  }
+  else
+  {
+    g_hash_table_insert (rated_caps_cache, g_memdup (&key, sizeof (key)),
+        gst_caps_ref (caps));
+  }
+  g_mutex_unlock (&rated_caps_mutex);
+
+  return caps;
+}
 
 static GstCaps *
 fs_rtp_bitrate_adapter_getcaps (FsRtpBitrateAdapter *self, GstPad *pad,
@@ -324,6 +524,8 @@ fs_rtp_bitrate_adapter_getcaps (FsRtpBitrateAdapter *self, GstPad *pad,
   GstCaps *peer_caps;
   GstCaps *result;
   guint bitrate;
+  guint idx = PAD_INDEX (self, pad);
+  gint generation;
   guint i;
 
   if (pad == self->srcpad)
@@ -331,17 +533,40 @@ fs_rtp_bitrate_adapter_getcaps (FsRtpBitrateAdapter *self, GstPad *pad,
   else
     otherpad = self->srcpad;
 
-  peer_caps = gst_pad_peer_query_caps (otherpad, filter);
-
-  if (gst_caps_get_size (peer_caps) == 0)
-    return peer_caps;
-
   GST_OBJECT_LOCK (self);
   bitrate = self->bitrate;
   if (pad == self->sinkpad)
     self->last_bitrate = self->bitrate;
+
+  /* The peer caps rarely change, as long as they are known to be the same
+   * and the bitrate is in the same quantum, so is the result. This doesn't
+   * even query the peer. */
+  if (bitrate != G_MAXUINT)
+  {
+    bitrate = quantize_bitrate (bitrate);
+
+    if (self->cached_caps[idx] &&
+        self->cached_generation[idx] ==
+            g_atomic_int_get (&self->peer_caps_generation[idx]) &&
+        self->cached_bitrate[idx] == bitrate &&
+        (self->cached_filter[idx] == filter ||
+            (self->cached_filter[idx] && filter &&
+                gst_caps_is_strictly_equal (self->cached_filter[idx],
+                    filter))))
+    {
+      result = gst_caps_ref (self->cached_caps[idx]);
+      GST_OBJECT_UNLOCK (self);
+      return result;
+    }
+  }
+  generation = g_atomic_int_get (&self->peer_caps_generation[idx]);
   GST_OBJECT_UNLOCK (self);
 
+  peer_caps = gst_pad_peer_query_caps (otherpad, filter);
+
+  if (gst_caps_get_size (peer_caps) == 0)
+    return peer_caps;
+
   if (bitrate == G_MAXUINT)
     return peer_caps;
 
@@ -353,12 +578,19 @@ fs_rtp_bitrate_adapter_getcaps (FsRtpBitrateAdapter *self, GstPad *pad,
 
     if (g_str_has_prefix (gst_structure_get_name (s), "video/"))
     {
-      GstCaps *rated_caps = caps_from_bitrate (gst_structure_get_name (s),
+      GstCaps *rated_caps = get_rated_caps (gst_structure_get_name_id (s),
           bitrate);
       GstCaps *copy = gst_caps_copy_nth (peer_caps, i);
+      GstCapsFeatures *features = gst_caps_get_features (peer_caps, i);
 
-      gst_caps_set_features (rated_caps, 0,
-          gst_caps_features_copy (gst_caps_get_features (peer_caps, i)));
+      /* The cached caps are in system memory */
+      if (features && !gst_caps_features_is_equal (features,
+              GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY))
+      {
+        rated_caps = gst_caps_make_writable (rated_caps);
+        gst_caps_set_features (rated_caps, 0,
+            gst_caps_features_copy (features));
+      }
 
       gst_caps_append (result, gst_caps_intersect (rated_caps, copy));
       gst_caps_unref (copy);
@@ -370,6 +602,19 @@ fs_rtp_bitrate_adapter_getcaps (FsRtpBitrateAdapter *self, GstPad *pad,
     }
   }
 
+  /* Unless the peer caps changed while they were being queried */
+  GST_OBJECT_LOCK (self);
+  if (g_atomic_int_get (&self->peer_caps_generation[idx]) == generation)
+  {
+    gst_caps_replace (&self->cached_filter[idx], filter);
+    gst_caps_replace (&self->cached_caps[idx], result);
+    self->cached_bitrate[idx] = bitrate;
+    self->cached_generation[idx] = generation;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  gst_caps_unref (peer_caps);
+
   return result;
 }
 
@@ -399,6 +644,52 @@ fs_rtp_bitrate_adapter_query (GstPad *pad, GstObject *parent, GstQuery *query)
   return res;
 }
 
+/*
+ * The caps queries on one pad return what the peer of the other pad
+ * accepts, so anything that can change those peer caps invalidates the
+ * cached result of the other pad
+ */
+
+static void
+fs_rtp_bitrate_adapter_peer_caps_changed (FsRtpBitrateAdapter *self,
+    GstPad *pad)
+{
+  GstPad *otherpad = pad == self->srcpad ? self->sinkpad : self->srcpad;
+
+  /* Atomic because the unlink function is called with the pad locks held */
+  g_atomic_int_inc (&self->peer_caps_generation[PAD_INDEX (self, otherpad)]);
+}
+
+static gboolean
+fs_rtp_bitrate_adapter_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  FsRtpBitrateAdapter *self = FS_RTP_BITRATE_ADAPTER (parent);
+
+  /* Downstream asks for a renegotiation when what it accepts changed, and
+   * upstream sends new caps when it changed */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_RECONFIGURE ||
+      GST_EVENT_TYPE (event) == GST_EVENT_CAPS)
+    fs_rtp_bitrate_adapter_peer_caps_changed (self, pad);
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static GstPadLinkReturn
+fs_rtp_bitrate_adapter_link (GstPad *pad, GstObject *parent, GstPad *peer)
+{
+  fs_rtp_bitrate_adapter_peer_caps_changed (FS_RTP_BITRATE_ADAPTER (parent),
+      pad);
+
+  return GST_PAD_LINK_OK;
+}
+
+static void
+fs_rtp_bitrate_adapter_unlink (GstPad *pad, GstObject *parent)
+{
+  fs_rtp_bitrate_adapter_peer_caps_changed (FS_RTP_BITRATE_ADAPTER (parent),
+      pad);
+}
+
 static GstFlowReturn
 fs_rtp_bitrate_adapter_chain (GstPad *pad, GstObject *parent,
     GstBuffer *buffer)
@@ -415,30 +706,76 @@ fs_rtp_bitrate_adapter_chain (GstPad *pad, GstObject *parent,
 }
 
 
+/* Quickselect, partially reorders @values to return the @k-th smallest */
+
 static guint
-fs_rtp_bitrate_adapter_get_bitrate_locked (FsRtpBitrateAdapter *self)
+select_nth (guint *values, guint len, guint k)
 {
-  gdouble mean = 0;
-  guint count = 0;
-  gdouble S = 0;
-  GList *item;
-  gdouble stddev;
+  guint left = 0;
+  guint right = len - 1;
 
-  for (item = self->bitrate_history.head; item ;item = item->next) {
-    struct BitratePoint *bp = item->data;
-    gdouble delta;
+  while (left < right)
+  {
+    guint pivot = values[(left + right) / 2];
+    guint i = left;
+    guint j = right;
+
+    while (i <= j)
+    {
+      while (values[i] < pivot)
+        i++;
+      while (values[j] > pivot)
+        j--;
+      if (i <= j)
+      {
+        guint tmp = values[i];
+        values[i] = values[j];
+        values[j] = tmp;
+        i++;
+        if (j == 0)
+          break;
+        j--;
+      }
+    }
 
-    count++;
-    delta = bp->bitrate - mean;
-    mean = mean + delta/count;
-    S = S + delta * (bp->bitrate - mean);
+    if (k <= j)
+      right = j;
+    else if (k >= i)
+      left = i;
+    else
+      break;
   }
 
+  return values[k];
+}
+
+static guint
+fs_rtp_bitrate_adapter_get_bitrate_locked (FsRtpBitrateAdapter *self)
+{
+  guint count = self->history_len;
+  gdouble mean, variance, stddev;
+  guint i;
+
   if (count == 0)
     return G_MAXUINT;
 
-  g_assert (S >= 0);
-  stddev = sqrt (S/count);
+  switch (self->estimator)
+  {
+    case FS_RTP_BITRATE_ADAPTER_ESTIMATOR_PERCENTILE:
+      for (i = 0; i < count; i++)
+        self->history_scratch[i] = history_nth (self, i)->bitrate;
+      return select_nth (self->history_scratch, count,
+          (count - 1) * self->percentile / 100);
+    case FS_RTP_BITRATE_ADAPTER_ESTIMATOR_EWMA:
+      return (guint) self->ewma;
+    case FS_RTP_BITRATE_ADAPTER_ESTIMATOR_MEAN_STDDEV:
+    default:
+      break;
+  }
+
+  mean = (gdouble) self->history_sum / count;
+  variance = self->history_sum_sq / count - mean * mean;
+  stddev = sqrt (MAX (variance, 0));
 
   if (mean > stddev)
     return (guint) (mean - stddev);
@@ -471,21 +808,15 @@ static void
 fs_rtp_bitrate_adapter_cleanup_locked (FsRtpBitrateAdapter *self,
     GstClockTime now)
 {
-  for (;;)
+  while (self->history_len)
   {
-    struct BitratePoint *bp = g_queue_peek_head (&self->bitrate_history);
+    FsRtpBitratePoint *bp = history_nth (self, 0);
 
-    if (bp && (bp->timestamp < now - self->interval ||
-            (GST_STATE (self) != GST_STATE_PLAYING &&
-                g_queue_get_length (&self->bitrate_history) > 1)))
-    {
-      g_queue_pop_head (&self->bitrate_history);
-      bitrate_point_free (bp);
-    }
+    if (bp->timestamp < now - self->interval ||
+        (GST_STATE (self) != GST_STATE_PLAYING && self->history_len > 1))
+      history_pop (self);
     else
-    {
       break;
-    }
   }
 }
 
@@ -520,9 +851,17 @@ fs_rtp_bitrate_adapter_add_bitrate_locked (FsRtpBitrateAdapter *self,
   GstClockTime now = gst_clock_get_time (self->system_clock);
   gboolean first = FALSE;
 
-  g_queue_push_tail (&self->bitrate_history, bitrate_point_new (now, bitrate));
+  history_push (self, now, bitrate);
 
-  first = (g_queue_get_length (&self->bitrate_history) == 1);
+  first = (self->history_len == 1);
+
+  if (!self->have_ewma)
+  {
+    self->ewma = bitrate;
+    self->have_ewma = TRUE;
+  }
+  else
+    self->ewma += self->ewma_weight * ((gdouble) bitrate - self->ewma);
 
   fs_rtp_bitrate_adapter_cleanup_locked (self, now);
 
@@ -557,6 +896,15 @@ fs_rtp_bitrate_adapter_set_property (GObject *object,
     case PROP_INTERVAL:
       self->interval = g_value_get_uint64 (value);
       break;
+    case PROP_ESTIMATOR:
+      self->estimator = g_value_get_enum (value);
+      break;
+    case PROP_PERCENTILE:
+      self->percentile = g_value_get_uint (value);
+      break;
+    case PROP_EWMA_WEIGHT:
+      self->ewma_weight = g_value_get_double (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -590,7 +938,7 @@ fs_rtp_bitrate_adapter_change_state (GstElement *element,
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
       GST_OBJECT_LOCK (self);
-      if (g_queue_get_length (&self->bitrate_history))
+      if (self->history_len)
         fs_rtp_bitrate_adapter_updated_unlock (self);
       else
         GST_OBJECT_UNLOCK (self);
@@ -607,9 +955,7 @@ fs_rtp_bitrate_adapter_change_state (GstElement *element,
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       self->last_bitrate = G_MAXUINT;
-      g_queue_foreach (&self->bitrate_history, (GFunc) bitrate_point_free,
-          NULL);
-      g_queue_clear(&self->bitrate_history);
+      history_clear (self);
       break;
     default:
       break;
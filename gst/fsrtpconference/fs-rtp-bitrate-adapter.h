@@ -41,6 +41,36 @@ G_BEGIN_DECLS
 #define FS_IS_RTP_BITRATE_ADAPTER_CLASS(obj) \
   (G_TYPE_CHECK_CLASS_TYPE((klass),FS_TYPE_RTP_BITRATE_ADAPTER))
 
+#define FS_TYPE_RTP_BITRATE_ADAPTER_ESTIMATOR \
+  (fs_rtp_bitrate_adapter_estimator_get_type ())
+
+/**
+ * FsRtpBitrateAdapterEstimator:
+ * @FS_RTP_BITRATE_ADAPTER_ESTIMATOR_MEAN_STDDEV: The mean minus one standard
+ *  deviation of the bitrates received during the interval
+ * @FS_RTP_BITRATE_ADAPTER_ESTIMATOR_PERCENTILE: A percentile of the bitrates
+ *  received during the interval
+ * @FS_RTP_BITRATE_ADAPTER_ESTIMATOR_EWMA: An exponentially weighted moving
+ *  average of all the received bitrates
+ *
+ * How the bitrate to adapt for is computed from the received bitrates
+ */
+typedef enum {
+  FS_RTP_BITRATE_ADAPTER_ESTIMATOR_MEAN_STDDEV,
+  FS_RTP_BITRATE_ADAPTER_ESTIMATOR_PERCENTILE,
+  FS_RTP_BITRATE_ADAPTER_ESTIMATOR_EWMA
+} FsRtpBitrateAdapterEstimator;
+
+#define FS_RTP_BITRATE_ADAPTER_DEFAULT_ESTIMATOR \
+  (FS_RTP_BITRATE_ADAPTER_ESTIMATOR_MEAN_STDDEV)
+#define FS_RTP_BITRATE_ADAPTER_DEFAULT_PERCENTILE (10)
+#define FS_RTP_BITRATE_ADAPTER_DEFAULT_EWMA_WEIGHT (0.1)
+
+typedef struct {
+  GstClockTime timestamp;
+  guint bitrate;
+} FsRtpBitratePoint;
+
 typedef struct _FsRtpBitrateAdapter FsRtpBitrateAdapter;
 typedef struct _FsRtpBitrateAdapterClass FsRtpBitrateAdapterClass;
 typedef struct _FsRtpBitrateAdapterPrivate FsRtpBitrateAdapterPrivate;
@@ -54,10 +84,38 @@ struct _FsRtpBitrateAdapter
 
   GstClock *system_clock;
   GstClockTime interval;
-  GQueue bitrate_history;
   GstClockID clockid;
+
+  /* Ring buffer of the bitrates received during the last interval, with
+   * running sums so the mean and variance are computed in constant time */
+  FsRtpBitratePoint *history;
+  guint history_size;
+  guint history_head;
+  guint history_len;
+  guint64 history_sum;
+  gdouble history_sum_sq;
+  /* Scratch space for the percentile, as large as the ring buffer */
+  guint *history_scratch;
+
+  FsRtpBitrateAdapterEstimator estimator;
+  guint percentile;
+  gdouble ewma_weight;
+  gdouble ewma;
+  /* A bitrate of 0 is valid, so the average can't tell if it's been set */
+  gboolean have_ewma;
+
   guint bitrate;
   guint last_bitrate;
+
+  /* Result of the last caps query on the sink and src pads, it is valid
+   * as long as the generation of the peer caps it was computed from did not
+   * change, protected by the object lock, except the generations which are
+   * atomic */
+  gint peer_caps_generation[2];
+  gint cached_generation[2];
+  GstCaps *cached_filter[2];
+  guint cached_bitrate[2];
+  GstCaps *cached_caps[2];
 };
 
 struct _FsRtpBitrateAdapterClass
@@ -66,6 +124,7 @@ struct _FsRtpBitrateAdapterClass
 };
 
 GType fs_rtp_bitrate_adapter_get_type (void);
+GType fs_rtp_bitrate_adapter_estimator_get_type (void);
 
 GstElement *fs_rtp_bitrate_adapter_new (void);
 
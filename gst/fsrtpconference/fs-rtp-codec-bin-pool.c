@@ -0,0 +1,453 @@
+/*
+ * Farstream - Farstream RTP Codec Bin Pool
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-rtp-codec-bin-pool.c - A pool of pre-built codec bins
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Building a codec bin means instantiating and linking all the elements of
+ * a blueprint, which is slow enough to delay the first packets of every new
+ * substream. The pool keeps idle codec bins in the READY state, keyed by
+ * blueprint, direction and payload type, so they can be handed out again
+ * instead of being rebuilt. Only bins created by the pool are accepted back,
+ * they carry their key as qdata. The least recently recycled bins are evicted
+ * first when the pool is full, and bins idle for longer than the maximum idle
+ * time are dropped whenever the pool is used.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-codec-bin-pool.h"
+
+#include "fs-rtp-conference.h"
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+
+typedef struct {
+  CodecBlueprint *blueprint;
+  FsMediaType media_type;
+  FsStreamDirection direction;
+  gint pt;
+} PoolKey;
+
+typedef struct {
+  PoolKey *key;
+  GstElement *codecbin;
+  gint64 idle_since;
+} PoolEntry;
+
+struct _FsRtpCodecBinPool {
+  GMutex mutex;
+
+  guint max_size;
+  GstClockTime max_idle;
+
+  /* Idle PoolEntry, the most recently recycled first */
+  GQueue idle;
+};
+
+static GQuark
+pool_key_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("fs-rtp-codec-bin-pool-key");
+
+  return quark;
+}
+
+/* Each key holds a reference to the blueprints of its media type, so the
+ * blueprint pointer stays valid for as long as the bin is alive, even if the
+ * session that created it is gone
+ */
+
+static void
+pool_key_free (gpointer data)
+{
+  PoolKey *key = data;
+
+  fs_rtp_blueprints_unref (key->media_type);
+  g_slice_free (PoolKey, key);
+}
+
+static gboolean
+pool_key_set (GstElement *codecbin, const FsCodec *codec,
+    CodecBlueprint *blueprint, FsStreamDirection direction)
+{
+  PoolKey *key;
+
+  if (!fs_rtp_blueprints_get (codec->media_type, NULL))
+    return FALSE;
+
+  key = g_slice_new (PoolKey);
+  key->blueprint = blueprint;
+  key->media_type = codec->media_type;
+  key->direction = direction;
+  key->pt = codec->id;
+
+  g_object_set_qdata_full (G_OBJECT (codecbin), pool_key_quark (), key,
+      pool_key_free);
+
+  return TRUE;
+}
+
+static gboolean
+pool_key_matches (const PoolKey *key, const FsCodec *codec,
+    CodecBlueprint *blueprint, FsStreamDirection direction)
+{
+  return key->blueprint == blueprint && key->direction == direction &&
+    key->pt == codec->id && key->media_type == codec->media_type;
+}
+
+static void
+pool_entry_free (PoolEntry *entry)
+{
+  gst_element_set_state (entry->codecbin, GST_STATE_NULL);
+  gst_object_unref (entry->codecbin);
+  g_slice_free (PoolEntry, entry);
+}
+
+static void
+pool_entries_free (GList *entries)
+{
+  g_list_free_full (entries, (GDestroyNotify) pool_entry_free);
+}
+
+/*
+ * Removes the expired entries and the least recently used ones until there
+ * is room for @room more entries. They are returned so they can be freed
+ * without holding the lock.
+ */
+
+static GList *
+fs_rtp_codec_bin_pool_evict_locked (FsRtpCodecBinPool *pool, guint room)
+{
+  GList *evicted = NULL;
+  gint64 now = g_get_monotonic_time ();
+  PoolEntry *entry;
+
+  while ((entry = g_queue_peek_tail (&pool->idle)))
+  {
+    if (pool->idle.length + room <= pool->max_size &&
+        (pool->max_idle == 0 ||
+            now - entry->idle_since < GST_TIME_AS_USECONDS (pool->max_idle)))
+      break;
+
+    GST_DEBUG ("Evicting codec bin %s from the pool",
+        GST_OBJECT_NAME (entry->codecbin));
+    g_queue_pop_tail (&pool->idle);
+    evicted = g_list_prepend (evicted, entry);
+  }
+
+  return evicted;
+}
+
+static PoolEntry *
+fs_rtp_codec_bin_pool_find_locked (FsRtpCodecBinPool *pool,
+    const FsCodec *codec, CodecBlueprint *blueprint,
+    FsStreamDirection direction)
+{
+  GList *item;
+
+  for (item = pool->idle.head; item; item = item->next)
+  {
+    PoolEntry *entry = item->data;
+
+    if (pool_key_matches (entry->key, codec, blueprint, direction))
+      return entry;
+  }
+
+  return NULL;
+}
+
+/* Takes ownership of the @codecbin reference */
+
+static void
+fs_rtp_codec_bin_pool_add (FsRtpCodecBinPool *pool, GstElement *codecbin,
+    PoolKey *key)
+{
+  PoolEntry *entry;
+  GList *evicted;
+
+  if (gst_element_set_state (codecbin, GST_STATE_READY) ==
+      GST_STATE_CHANGE_FAILURE)
+  {
+    GST_WARNING ("Could not set codec bin %s to READY, not pooling it",
+        GST_OBJECT_NAME (codecbin));
+    gst_element_set_state (codecbin, GST_STATE_NULL);
+    gst_object_unref (codecbin);
+    return;
+  }
+
+  entry = g_slice_new (PoolEntry);
+  entry->key = key;
+  entry->codecbin = codecbin;
+  entry->idle_since = g_get_monotonic_time ();
+
+  g_mutex_lock (&pool->mutex);
+  if (pool->max_size == 0)
+  {
+    g_mutex_unlock (&pool->mutex);
+    pool_entry_free (entry);
+    return;
+  }
+  evicted = fs_rtp_codec_bin_pool_evict_locked (pool, 1);
+  g_queue_push_head (&pool->idle, entry);
+  g_mutex_unlock (&pool->mutex);
+
+  pool_entries_free (evicted);
+}
+
+FsRtpCodecBinPool *
+fs_rtp_codec_bin_pool_new (void)
+{
+  FsRtpCodecBinPool *pool = g_slice_new0 (FsRtpCodecBinPool);
+
+  g_mutex_init (&pool->mutex);
+  g_queue_init (&pool->idle);
+  pool->max_size = FS_RTP_CODEC_BIN_POOL_DEFAULT_SIZE;
+  pool->max_idle = FS_RTP_CODEC_BIN_POOL_DEFAULT_MAX_IDLE;
+
+  return pool;
+}
+
+void
+fs_rtp_codec_bin_pool_free (FsRtpCodecBinPool *pool)
+{
+  PoolEntry *entry;
+
+  while ((entry = g_queue_pop_head (&pool->idle)))
+    pool_entry_free (entry);
+
+  g_mutex_clear (&pool->mutex);
+  g_slice_free (FsRtpCodecBinPool, pool);
+}
+
+/**
+ * fs_rtp_codec_bin_pool_set_max_size:
+ * @pool: a #FsRtpCodecBinPool
+ * @max_size: The maximum number of idle codec bins, 0 disables the pool
+ *
+ * Sets the maximum number of idle codec bins kept, evicting the least
+ * recently used ones if there are too many.
+ */
+
+void
+fs_rtp_codec_bin_pool_set_max_size (FsRtpCodecBinPool *pool, guint max_size)
+{
+  GList *evicted;
+
+  g_mutex_lock (&pool->mutex);
+  pool->max_size = max_size;
+  evicted = fs_rtp_codec_bin_pool_evict_locked (pool, 0);
+  g_mutex_unlock (&pool->mutex);
+
+  pool_entries_free (evicted);
+}
+
+guint
+fs_rtp_codec_bin_pool_get_max_size (FsRtpCodecBinPool *pool)
+{
+  guint max_size;
+
+  g_mutex_lock (&pool->mutex);
+  max_size = pool->max_size;
+  g_mutex_unlock (&pool->mutex);
+
+  return max_size;
+}
+
+/**
+ * fs_rtp_codec_bin_pool_set_max_idle:
+ * @pool: a #FsRtpCodecBinPool
+ * @max_idle: How long an idle codec bin is kept, 0 means forever
+ *
+ * Sets how long a codec bin can stay idle in the pool before being dropped.
+ */
+
+void
+fs_rtp_codec_bin_pool_set_max_idle (FsRtpCodecBinPool *pool,
+    GstClockTime max_idle)
+{
+  GList *evicted;
+
+  g_mutex_lock (&pool->mutex);
+  pool->max_idle = max_idle;
+  evicted = fs_rtp_codec_bin_pool_evict_locked (pool, 0);
+  g_mutex_unlock (&pool->mutex);
+
+  pool_entries_free (evicted);
+}
+
+GstClockTime
+fs_rtp_codec_bin_pool_get_max_idle (FsRtpCodecBinPool *pool)
+{
+  GstClockTime max_idle;
+
+  g_mutex_lock (&pool->mutex);
+  max_idle = pool->max_idle;
+  g_mutex_unlock (&pool->mutex);
+
+  return max_idle;
+}
+
+/**
+ * fs_rtp_codec_bin_pool_checkout:
+ * @pool: a #FsRtpCodecBinPool
+ * @codec: The codec to build the bin for
+ * @blueprint: The blueprint to build the bin from
+ * @name: The name to give to the bin
+ * @direction: %FS_DIRECTION_SEND or %FS_DIRECTION_RECV
+ * @error: location of a #GError, or NULL
+ *
+ * Returns an idle codec bin from the pool if there is one matching, or
+ * builds a new one with create_codec_bin_from_blueprint(). Either way, the
+ * bin can be given back with fs_rtp_codec_bin_pool_recycle() once it is no
+ * longer used.
+ *
+ * Returns: a floating reference to the codec bin, or NULL on error
+ */
+
+GstElement *
+fs_rtp_codec_bin_pool_checkout (FsRtpCodecBinPool *pool,
+    const FsCodec *codec, CodecBlueprint *blueprint, const gchar *name,
+    FsStreamDirection direction, GError **error)
+{
+  GstElement *codecbin = NULL;
+  PoolEntry *entry;
+  GList *evicted;
+
+  g_mutex_lock (&pool->mutex);
+  evicted = fs_rtp_codec_bin_pool_evict_locked (pool, 0);
+  entry = fs_rtp_codec_bin_pool_find_locked (pool, codec, blueprint,
+      direction);
+  if (entry)
+    g_queue_remove (&pool->idle, entry);
+  g_mutex_unlock (&pool->mutex);
+
+  pool_entries_free (evicted);
+
+  if (entry)
+  {
+    codecbin = entry->codecbin;
+    g_slice_free (PoolEntry, entry);
+
+    GST_DEBUG ("Reusing pooled codec bin %s as %s for pt %d",
+        GST_OBJECT_NAME (codecbin), name, codec->id);
+
+    gst_element_set_name (codecbin, name);
+    /* Behave like a newly created element for gst_bin_add() */
+    g_object_force_floating (G_OBJECT (codecbin));
+    return codecbin;
+  }
+
+  codecbin = create_codec_bin_from_blueprint (codec, blueprint, name,
+      direction, error);
+
+  if (codecbin)
+    pool_key_set (codecbin, codec, blueprint, direction);
+
+  return codecbin;
+}
+
+/**
+ * fs_rtp_codec_bin_pool_recycle:
+ * @pool: a #FsRtpCodecBinPool
+ * @codecbin: a codec bin that has been removed from its parent
+ *
+ * Gives back a codec bin that is no longer used. This function takes
+ * ownership of the reference to @codecbin. Bins that do not come from
+ * fs_rtp_codec_bin_pool_checkout() are just unreferenced.
+ */
+
+void
+fs_rtp_codec_bin_pool_recycle (FsRtpCodecBinPool *pool, GstElement *codecbin)
+{
+  PoolKey *key;
+
+  g_return_if_fail (GST_OBJECT_PARENT (codecbin) == NULL);
+
+  key = g_object_get_qdata (G_OBJECT (codecbin), pool_key_quark ());
+
+  if (!key)
+  {
+    gst_object_unref (codecbin);
+    return;
+  }
+
+  /* It was locked when it was removed from the conference */
+  gst_element_set_locked_state (codecbin, FALSE);
+
+  fs_rtp_codec_bin_pool_add (pool, codecbin, key);
+}
+
+/**
+ * fs_rtp_codec_bin_pool_prewarm:
+ * @pool: a #FsRtpCodecBinPool
+ * @codec: The codec to build the bin for
+ * @blueprint: The blueprint to build the bin from
+ * @direction: %FS_DIRECTION_SEND or %FS_DIRECTION_RECV
+ *
+ * Builds a codec bin and brings it to READY ahead of time, unless there is
+ * already a matching idle one or the pool is full.
+ */
+
+void
+fs_rtp_codec_bin_pool_prewarm (FsRtpCodecBinPool *pool,
+    const FsCodec *codec, CodecBlueprint *blueprint,
+    FsStreamDirection direction)
+{
+  GstElement *codecbin;
+  gboolean needed;
+  gchar *name;
+
+  g_mutex_lock (&pool->mutex);
+  needed = pool->idle.length < pool->max_size &&
+    !fs_rtp_codec_bin_pool_find_locked (pool, codec, blueprint, direction);
+  g_mutex_unlock (&pool->mutex);
+
+  if (!needed)
+    return;
+
+  name = g_strdup_printf ("pooled_%s_%d",
+      direction == FS_DIRECTION_SEND ? "send" : "recv", codec->id);
+  codecbin = create_codec_bin_from_blueprint (codec, blueprint, name,
+      direction, NULL);
+  g_free (name);
+
+  if (!codecbin)
+    return;
+
+  gst_object_ref_sink (codecbin);
+
+  if (!pool_key_set (codecbin, codec, blueprint, direction))
+  {
+    gst_object_unref (codecbin);
+    return;
+  }
+
+  GST_DEBUG ("Prewarmed codec bin for pt %d", codec->id);
+
+  fs_rtp_codec_bin_pool_add (pool, codecbin,
+      g_object_get_qdata (G_OBJECT (codecbin), pool_key_quark ()));
+}
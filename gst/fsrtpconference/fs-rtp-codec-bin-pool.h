@@ -0,0 +1,61 @@
+/*
+ * Farstream - Farstream RTP Codec Bin Pool
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-rtp-codec-bin-pool.h - A pool of pre-built codec bins
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_CODEC_BIN_POOL_H__
+#define __FS_RTP_CODEC_BIN_POOL_H__
+
+#include <gst/gst.h>
+
+#include <farstream/fs-codec.h>
+
+#include "fs-rtp-discover-codecs.h"
+
+G_BEGIN_DECLS
+
+#define FS_RTP_CODEC_BIN_POOL_DEFAULT_SIZE (8)
+#define FS_RTP_CODEC_BIN_POOL_DEFAULT_MAX_IDLE (60 * GST_SECOND)
+
+typedef struct _FsRtpCodecBinPool FsRtpCodecBinPool;
+
+FsRtpCodecBinPool *fs_rtp_codec_bin_pool_new (void);
+void fs_rtp_codec_bin_pool_free (FsRtpCodecBinPool *pool);
+
+void fs_rtp_codec_bin_pool_set_max_size (FsRtpCodecBinPool *pool,
+    guint max_size);
+guint fs_rtp_codec_bin_pool_get_max_size (FsRtpCodecBinPool *pool);
+void fs_rtp_codec_bin_pool_set_max_idle (FsRtpCodecBinPool *pool,
+    GstClockTime max_idle);
+GstClockTime fs_rtp_codec_bin_pool_get_max_idle (FsRtpCodecBinPool *pool);
+
+GstElement *fs_rtp_codec_bin_pool_checkout (FsRtpCodecBinPool *pool,
+    const FsCodec *codec, CodecBlueprint *blueprint, const gchar *name,
+    FsStreamDirection direction, GError **error);
+void fs_rtp_codec_bin_pool_recycle (FsRtpCodecBinPool *pool,
+    GstElement *codecbin);
+void fs_rtp_codec_bin_pool_prewarm (FsRtpCodecBinPool *pool,
+    const FsCodec *codec, CodecBlueprint *blueprint,
+    FsStreamDirection direction);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_CODEC_BIN_POOL_H__ */
@@ -29,13 +29,15 @@
 
 #include "fs-rtp-codec-cache.h"
 
+#include <errno.h>
 #include <string.h>
+#include <sys/stat.h>
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
 #endif
 #include <stdio.h>
-#include <sys/types.h>
-#include <sys/stat.h>
+
+#include <glib/gstdio.h>
 
 #include <farstream/fs-conference.h>
 
@@ -45,123 +47,266 @@
 /* Because of annoying CRTs */
 #if defined (_MSC_VER) && _MSC_VER >= 1400
 # include <io.h>
-# define open _open
 # define close _close
-# define read _read
 # define write _write
-# define stat _stat
-# define STAT_TYPE struct _stat
-#else
-# define STAT_TYPE struct stat
 #endif
 
 #define GST_CAT_DEFAULT fsrtpconference_disco
 
-static gboolean codecs_cache_valid (gchar *cache_path) {
-  time_t cache_ts = 0;
-  time_t registry_ts = 0;
-  STAT_TYPE cache_stat;
-  STAT_TYPE registry_stat;
-  gchar *registry_xml_path;
-  gchar *registry_bin_path;
-
-  registry_xml_path = g_strdup (g_getenv ("GST_REGISTRY"));
-  if (registry_xml_path == NULL) {
-    registry_bin_path = g_build_filename (g_get_home_dir (),
-        ".gstreamer-" GST_API_VERSION, "registry." HOST_CPU ".bin", NULL);
-    registry_xml_path = g_build_filename (g_get_home_dir (),
-        ".gstreamer-" GST_API_VERSION, "registry." HOST_CPU ".xml", NULL);
-  } else {
-    registry_bin_path = g_strdup (registry_xml_path);
-  }
+/*
+ * The cache file is laid out so it can be used straight from the mapped
+ * file, without copying anything but what ends up in the blueprints:
+ *
+ *   CacheHeader
+ *   guint32 offsets[num_blueprints]   (into the records)
+ *   records                           (guint32 values)
+ *   strings                           (NUL terminated, de-duplicated)
+ *
+ * Strings are stored in the records as offsets into the strings section.
+ * Everything is in host byte order, the file name has the host CPU in it.
+ *
+ * The cache is valid if it was written for the same set of GStreamer
+ * plugins, and the checksum covers everything after the header.
+ */
 
-  if (stat (registry_xml_path, &registry_stat) == 0) {
-    registry_ts = registry_stat.st_mtime;
-  }
+/* Bump the last two characters when changing the format */
+#define CACHE_MAGIC "FS?C13"
 
-  if (stat (registry_bin_path, &registry_stat) == 0) {
-    if (registry_ts < registry_stat.st_mtime) {
-      registry_ts = registry_stat.st_mtime;
-    }
+/* Arbitrary, but protects against very corrupted files */
+#define MAX_BLUEPRINTS (50)
+
+typedef struct {
+  gchar magic[8];
+  guint32 num_blueprints;
+  guint32 records_size;
+  guint32 strings_size;
+  guint32 reserved;
+  guint64 plugins_hash;
+  guint64 checksum;
+} CacheHeader;
+
+#define FNV_OFFSET_BASIS G_GUINT64_CONSTANT (0xcbf29ce484222325)
+#define FNV_PRIME G_GUINT64_CONSTANT (0x100000001b3)
+
+static guint64
+fnv1a_hash (guint64 hash, gconstpointer data, gsize size)
+{
+  const guchar *p = data;
+  gsize i;
+
+  for (i = 0; i < size; i++)
+  {
+    hash ^= p[i];
+    hash *= FNV_PRIME;
   }
 
-  if (stat (cache_path, &cache_stat) == 0) {
-    cache_ts = cache_stat.st_mtime;
+  return hash;
+}
+
+static guint64
+fnv1a_hash_string (guint64 hash, const gchar *str)
+{
+  /* Include the terminator so "ab" "c" and "a" "bc" differ */
+  if (str)
+    return fnv1a_hash (hash, str, strlen (str) + 1);
+  else
+    return fnv1a_hash (hash, "", 1);
+}
+
+/*
+ * Identifies the set of installed plugins, the blueprints only depend on
+ * which elements exist and what their pad templates say, which can only
+ * change if a plugin is added, removed, upgraded or moved.
+ * The plugin list order is not stable, so the per-plugin hashes are summed.
+ */
+static guint64
+compute_plugins_hash (void)
+{
+  GList *plugins, *item;
+  guint64 hash = 0;
+  guint count = 0;
+
+  plugins = gst_registry_get_plugin_list (gst_registry_get ());
+
+  for (item = plugins; item; item = item->next)
+  {
+    GstPlugin *plugin = item->data;
+    guint64 plugin_hash = FNV_OFFSET_BASIS;
+
+    plugin_hash = fnv1a_hash_string (plugin_hash,
+        gst_plugin_get_name (plugin));
+    plugin_hash = fnv1a_hash_string (plugin_hash,
+        gst_plugin_get_version (plugin));
+    plugin_hash = fnv1a_hash_string (plugin_hash,
+        gst_plugin_get_filename (plugin));
+    plugin_hash = fnv1a_hash_string (plugin_hash,
+        gst_plugin_get_release_date_string (plugin));
+
+    hash += plugin_hash;
+    count++;
   }
 
-  g_free (registry_bin_path);
-  g_free (registry_xml_path);
+  gst_plugin_list_free (plugins);
+
+  return fnv1a_hash (hash, &count, sizeof (count));
+}
+
+static const gchar *
+get_codecs_cache_filename (FsMediaType media_type) {
+  if (media_type == FS_MEDIA_TYPE_AUDIO)
+    return "codecs.audio." HOST_CPU ".cache";
+  else if (media_type == FS_MEDIA_TYPE_VIDEO)
+    return "codecs.video." HOST_CPU ".cache";
+  else if (media_type == FS_MEDIA_TYPE_APPLICATION)
+    return "codecs.application." HOST_CPU ".cache";
 
-  return (registry_ts != 0 && cache_ts > registry_ts);
+  GST_ERROR ("Unknown media type %d for cache loading", media_type);
+  return NULL;
 }
 
+/* The path set in the environment for this media type, if any */
+static const gchar *
+get_codecs_cache_env_path (FsMediaType media_type) {
+  if (media_type == FS_MEDIA_TYPE_AUDIO)
+    return g_getenv ("FS_AUDIO_CODECS_CACHE");
+  else if (media_type == FS_MEDIA_TYPE_VIDEO)
+    return g_getenv ("FS_VIDEO_CODECS_CACHE");
+  else if (media_type == FS_MEDIA_TYPE_APPLICATION)
+    return g_getenv ("FS_APPLICATION_CODECS_CACHE");
+  else
+    return NULL;
+}
+
+/* The per-user cache, which is written after a discovery */
 static gchar *
 get_codecs_cache_path (FsMediaType media_type) {
-  gchar *cache_path;
+  const gchar *filename;
 
-  if (media_type == FS_MEDIA_TYPE_AUDIO) {
-    cache_path = g_strdup (g_getenv ("FS_AUDIO_CODECS_CACHE"));
-    if (cache_path == NULL) {
-      cache_path = g_build_filename (g_get_user_cache_dir (), "farstream",
-          "codecs.audio." HOST_CPU ".cache", NULL);
-    }
-  } else if (media_type == FS_MEDIA_TYPE_VIDEO) {
-    cache_path = g_strdup (g_getenv ("FS_VIDEO_CODECS_CACHE"));
-    if (cache_path == NULL) {
-      cache_path = g_build_filename (g_get_user_cache_dir (), "farstream",
-          "codecs.video." HOST_CPU ".cache", NULL);
-    }
-  } else if (media_type == FS_MEDIA_TYPE_APPLICATION) {
-    cache_path = g_strdup (g_getenv ("FS_APPLICATION_CODECS_CACHE"));
-    if (cache_path == NULL) {
-      cache_path = g_build_filename (g_get_user_cache_dir (), "farstream",
-          "codecs.application." HOST_CPU ".cache", NULL);
-    }
-  } else {
-    GST_ERROR ("Unknown media type %d for cache loading", media_type);
+  if (get_codecs_cache_env_path (media_type))
+    return g_strdup (get_codecs_cache_env_path (media_type));
+
+  filename = get_codecs_cache_filename (media_type);
+  if (!filename)
     return NULL;
-  }
 
-  return cache_path;
+  return g_build_filename (g_get_user_cache_dir (), "farstream", filename,
+      NULL);
+}
+
+/* The read-only cache preseeded by farstream-discover-codecs */
+static gchar *
+get_system_codecs_cache_path (FsMediaType media_type) {
+  const gchar *filename;
+  const gchar *dir;
+
+  filename = get_codecs_cache_filename (media_type);
+  if (!filename)
+    return NULL;
+
+  dir = g_getenv ("FS_SYSTEM_CODECS_CACHE_DIR");
+  if (dir == NULL)
+    dir = FS_SYSTEM_CODECS_CACHE_DIR;
+
+  return g_build_filename (dir, filename, NULL);
+}
+
+static gchar
+get_magic_media (FsMediaType media_type)
+{
+  if (media_type == FS_MEDIA_TYPE_AUDIO)
+    return 'A';
+  else if (media_type == FS_MEDIA_TYPE_VIDEO)
+    return 'V';
+  else if (media_type == FS_MEDIA_TYPE_APPLICATION)
+    return 'P';
+  else
+    return '?';
 }
 
+/* A cursor on one record, pointing into the mapped file */
+typedef struct {
+  const guint32 *in;
+  const guint32 *end;
+  const gchar *strings;
+  guint32 strings_size;
+} CacheReader;
 
 static gboolean
-read_codec_blueprint_uint (gchar **in, gsize *size, guint *val) {
-  if (*size < sizeof (guint))
+read_codec_blueprint_uint (CacheReader *reader, guint *val) {
+  if (reader->in >= reader->end)
     return FALSE;
 
-  memcpy (val, *in, sizeof(guint));
-  *in += sizeof (guint);
-  *size -= sizeof (guint);
+  *val = *reader->in;
+  reader->in++;
   return TRUE;
 }
 
 static gboolean
-read_codec_blueprint_int (gchar **in, gsize *size, gint *val) {
-  if (*size < sizeof (gint))
+read_codec_blueprint_int (CacheReader *reader, gint *val) {
+  guint tmp;
+
+  if (!read_codec_blueprint_uint (reader, &tmp))
+    return FALSE;
+
+  *val = (gint) tmp;
+  return TRUE;
+}
+
+/* The returned string points into the file, it must not be freed */
+static gboolean
+read_codec_blueprint_string (CacheReader *reader, const gchar **str) {
+  guint offset;
+
+  if (!read_codec_blueprint_uint (reader, &offset))
     return FALSE;
 
-  memcpy (val, *in, sizeof(gint));
-  *in += sizeof (gint);
-  *size -= sizeof (gint);
+  if (offset >= reader->strings_size ||
+      !memchr (reader->strings + offset, 0, reader->strings_size - offset))
+    return FALSE;
+
+  *str = reader->strings + offset;
   return TRUE;
 }
 
 static gboolean
-read_codec_blueprint_string (gchar **in, gsize *size, gchar **str) {
-  gint str_length;
+read_codec_blueprint_caps (CacheReader *reader, GstCaps **caps) {
+  const gchar *str;
 
-  if (!read_codec_blueprint_int (in, size, &str_length))
+  if (!read_codec_blueprint_string (reader, &str))
     return FALSE;
 
-  if (*size < str_length)
+  *caps = gst_caps_from_string (str);
+  return *caps != NULL;
+}
+
+static gboolean
+read_codec_blueprint_pipeline (CacheReader *reader, GList **pipeline) {
+  gint i, j, num_steps, num_factories;
+
+  if (!read_codec_blueprint_int (reader, &num_steps) || num_steps < 0)
     return FALSE;
 
-  *str = g_new0 (gchar, str_length +1);
-  memcpy (*str, *in, str_length);
-  *in += str_length;
-  *size -= str_length;
+  for (i = 0; i < num_steps; i++) {
+    GList *tmplist = NULL;
+
+    if (!read_codec_blueprint_int (reader, &num_factories) ||
+        num_factories < 0)
+      return FALSE;
+
+    for (j = 0; j < num_factories; j++) {
+      GstElementFactory *fact = NULL;
+      const gchar *factory_name;
+
+      if (read_codec_blueprint_string (reader, &factory_name))
+        fact = gst_element_factory_find (factory_name);
+      if (!fact) {
+        gst_plugin_feature_list_free (tmplist);
+        return FALSE;
+      }
+      tmplist = g_list_append (tmplist, fact);
+    }
+    *pipeline = g_list_append (*pipeline, tmplist);
+  }
 
   return TRUE;
 }
@@ -170,90 +315,43 @@ read_codec_blueprint_string (gchar **in, gsize *size, gchar **str) {
 #define READ_CHECK(x) if (!x) goto error;
 
 static CodecBlueprint *
-load_codec_blueprint (FsMediaType media_type, gchar **in, gsize *size) {
+load_codec_blueprint (FsMediaType media_type, CacheReader *reader) {
   CodecBlueprint *codec_blueprint = g_slice_new0 (CodecBlueprint);
-  gchar *tmp;
   gint tmp_size;
   int i;
   gint id;
-  gchar *encoding_name = NULL;
+  const gchar *encoding_name = NULL;
   guint clock_rate;
 
-  READ_CHECK (read_codec_blueprint_int
-      (in, size, &(id)));
-  READ_CHECK (read_codec_blueprint_string
-      (in, size, &(encoding_name)));
-  READ_CHECK (read_codec_blueprint_uint
-      (in, size, &(clock_rate)));
+  READ_CHECK (read_codec_blueprint_int (reader, &id));
+  READ_CHECK (read_codec_blueprint_string (reader, &encoding_name));
+  READ_CHECK (read_codec_blueprint_uint (reader, &clock_rate));
   codec_blueprint->codec = fs_codec_new (id, encoding_name, media_type,
       clock_rate);
-  g_free (encoding_name);
   READ_CHECK (read_codec_blueprint_uint
-      (in, size, &(codec_blueprint->codec->channels)));
+      (reader, &(codec_blueprint->codec->channels)));
 
-  READ_CHECK (read_codec_blueprint_int (in, size, &tmp_size));
+  READ_CHECK (read_codec_blueprint_int (reader, &tmp_size));
   for (i = 0; i < tmp_size; i++) {
-    gchar *name, *value;
-    READ_CHECK (read_codec_blueprint_string (in, size, &(name)));
-    READ_CHECK (read_codec_blueprint_string (in, size, &(value)));
+    const gchar *name, *value;
+    READ_CHECK (read_codec_blueprint_string (reader, &name));
+    READ_CHECK (read_codec_blueprint_string (reader, &value));
     fs_codec_add_optional_parameter (codec_blueprint->codec, name, value);
-    g_free (name);
-    g_free (value);
-  }
-
-  READ_CHECK (read_codec_blueprint_string (in, size, &tmp));
-  codec_blueprint->media_caps = gst_caps_from_string (tmp);
-  g_free (tmp);
-
-  READ_CHECK (read_codec_blueprint_string (in, size, &tmp));
-  codec_blueprint->rtp_caps = gst_caps_from_string (tmp);
-  g_free (tmp);
-
-  READ_CHECK (read_codec_blueprint_string (in, size, &tmp));
-  codec_blueprint->input_caps = gst_caps_from_string (tmp);
-  g_free (tmp);
-
-  READ_CHECK (read_codec_blueprint_string (in, size, &tmp));
-  codec_blueprint->output_caps = gst_caps_from_string (tmp);
-  g_free (tmp);
-
-  READ_CHECK (read_codec_blueprint_int (in, size, &tmp_size));
-  for (i = 0; i < tmp_size; i++) {
-    int j, tmp_size2;
-    GList *tmplist = NULL;
-
-    READ_CHECK (read_codec_blueprint_int (in, size, &tmp_size2));
-    for (j = 0; j < tmp_size2; j++) {
-      GstElementFactory *fact = NULL;
-      READ_CHECK (read_codec_blueprint_string (in, size, &(tmp)));
-      fact = gst_element_factory_find (tmp);
-      g_free (tmp);
-      if (!fact)
-        goto error;
-      tmplist = g_list_append (tmplist, fact);
-    }
-    codec_blueprint->send_pipeline_factory =
-      g_list_append (codec_blueprint->send_pipeline_factory, tmplist);
   }
 
-  READ_CHECK (read_codec_blueprint_int (in, size, &tmp_size));
-  for (i = 0; i < tmp_size; i++) {
-    int j, tmp_size2;
-    GList *tmplist = NULL;
+  READ_CHECK (read_codec_blueprint_caps (reader,
+          &codec_blueprint->media_caps));
+  READ_CHECK (read_codec_blueprint_caps (reader,
+          &codec_blueprint->rtp_caps));
+  READ_CHECK (read_codec_blueprint_caps (reader,
+          &codec_blueprint->input_caps));
+  READ_CHECK (read_codec_blueprint_caps (reader,
+          &codec_blueprint->output_caps));
 
-    READ_CHECK (read_codec_blueprint_int (in, size, &tmp_size2));
-    for (j = 0; j < tmp_size2; j++) {
-      GstElementFactory *fact = NULL;
-      READ_CHECK (read_codec_blueprint_string (in, size, &(tmp)));
-      fact = gst_element_factory_find (tmp);
-      g_free (tmp);
-      if (!fact)
-        goto error;
-      tmplist = g_list_append (tmplist, fact);
-    }
-    codec_blueprint->receive_pipeline_factory =
-      g_list_append (codec_blueprint->receive_pipeline_factory, tmplist);
-  }
+  READ_CHECK (read_codec_blueprint_pipeline (reader,
+          &codec_blueprint->send_pipeline_factory));
+  READ_CHECK (read_codec_blueprint_pipeline (reader,
+          &codec_blueprint->receive_pipeline_factory));
 
   GST_DEBUG ("adding codec %s with pt %d, send_pipeline %p, receive_pipeline %p",
       codec_blueprint->codec->encoding_name, codec_blueprint->codec->id,
@@ -269,54 +367,27 @@ load_codec_blueprint (FsMediaType media_type, gchar **in, gsize *size) {
 }
 
 
-/**
- * load_codecs_cache
- * @media_type: a #FsMediaType
- *
- * Will load the codecs blueprints from the cache.
- *
- * Returns: TRUE if successful, FALSE if error, or cache outdated
- *
- */
-GList *
-load_codecs_cache (FsMediaType media_type)
+static GList *
+load_codecs_cache_file (FsMediaType media_type, const gchar *cache_path)
 {
   GMappedFile *mapped = NULL;
-  gchar *contents = NULL;
-  gchar *in = NULL;
+  const gchar *contents;
   gsize size;
   GError *err = NULL;
   GList *blueprints = NULL;
-
-  gchar magic[8] = {0};
-  gchar magic_media = '?';
-  gint num_blueprints;
-  gchar *cache_path;
-  int i;
-
-
-  if (media_type == FS_MEDIA_TYPE_AUDIO) {
-    magic_media = 'A';
-  } else if (media_type == FS_MEDIA_TYPE_VIDEO) {
-    magic_media = 'V';
-  } else if (media_type == FS_MEDIA_TYPE_APPLICATION) {
-    magic_media = 'P';
-  } else {
+  CacheHeader header;
+  const guint32 *offsets;
+  const gchar *records;
+  CacheReader reader;
+  gchar magic[8] = CACHE_MAGIC;
+  guint i;
+
+  magic[2] = get_magic_media (media_type);
+  if (magic[2] == '?') {
     GST_ERROR ("Invalid media type %d", media_type);
     return NULL;
   }
 
-  cache_path = get_codecs_cache_path (media_type);
-
-  if (!cache_path)
-    return NULL;
-
-  if (!codecs_cache_valid (cache_path)) {
-    GST_DEBUG ("Codecs cache %s is outdated or does not exist", cache_path);
-    g_free (cache_path);
-    return NULL;
-  }
-
   GST_DEBUG ("Loading codecs cache %s", cache_path);
 
   mapped = g_mapped_file_new (cache_path, FALSE, &err);
@@ -324,60 +395,65 @@ load_codecs_cache (FsMediaType media_type)
     GST_DEBUG ("Unable to mmap file %s : %s", cache_path,
       err ? err->message: "unknown error");
     g_clear_error (&err);
-
-    if (!g_file_get_contents (cache_path, &contents, &size, NULL))
-      goto error;
-  } else {
-    if ((contents = g_mapped_file_get_contents (mapped)) == NULL) {
-      GST_WARNING ("Can't load file %s : %s", cache_path, g_strerror (errno));
-      goto error;
-    }
-    /* check length for header */
-    size = g_mapped_file_get_length (mapped);
+    goto error;
   }
 
-  /* in is a cursor pointer on the file contents */
+  contents = g_mapped_file_get_contents (mapped);
+  size = g_mapped_file_get_length (mapped);
 
-  in = contents;
-
-  if (size < sizeof (magic)) {
+  if (contents == NULL || size < sizeof (header)) {
     GST_WARNING ("Cache file corrupt");
     goto error;
   }
 
-  memcpy (magic, in, sizeof (magic));
-  in += sizeof (magic);
-  size -= sizeof (magic);
-
-  if (magic[0] != 'F' ||
-      magic[1] != 'S' ||
-      magic[2] != magic_media ||
-      magic[3] != 'C' ||
-      magic[4] != '1' ||   /* This is the version number */
-      magic[5] != '2') {
-    GST_WARNING ("Cache file has incorrect magic header. File corrupted");
+  memcpy (&header, contents, sizeof (header));
+
+  if (memcmp (header.magic, magic, sizeof (magic))) {
+    GST_DEBUG ("Cache file has an unknown version or a corrupted header");
+    goto error;
+  }
+
+  if (header.num_blueprints > MAX_BLUEPRINTS)
+  {
+    GST_WARNING ("Impossible number of blueprints in cache %u, ignoring",
+        header.num_blueprints);
     goto error;
   }
 
-  if (size < sizeof (gint)) {
-    GST_WARNING ("Cache file corrupt (size: %"G_GSIZE_FORMAT" < sizeof (int))",
-        size);
+  if (header.records_size % sizeof (guint32) ||
+      size - sizeof (header) != header.num_blueprints * sizeof (guint32) +
+      (guint64) header.records_size + header.strings_size) {
+    GST_WARNING ("Cache file corrupt (size: %" G_GSIZE_FORMAT ")", size);
     goto error;
   }
 
-  memcpy (&num_blueprints, in, sizeof(gint));
-  in += sizeof (gint);
-  size -= sizeof (gint);
+  if (header.plugins_hash != compute_plugins_hash ()) {
+    GST_DEBUG ("Codecs cache %s is outdated", cache_path);
+    goto error;
+  }
 
-  if (num_blueprints > 50)
-  {
-    GST_WARNING ("Impossible number of blueprints in cache %d, ignoring",
-        num_blueprints);
+  if (header.checksum != fnv1a_hash (FNV_OFFSET_BASIS,
+          contents + sizeof (header), size - sizeof (header))) {
+    GST_WARNING ("Cache file has an invalid checksum");
     goto error;
   }
 
-  for (i = 0; i < num_blueprints; i++) {
-    CodecBlueprint *blueprint = load_codec_blueprint (media_type, &in, &size);
+  offsets = (const guint32 *) (contents + sizeof (header));
+  records = (const gchar *) (offsets + header.num_blueprints);
+
+  reader.end = (const guint32 *) (records + header.records_size);
+  reader.strings = records + header.records_size;
+  reader.strings_size = header.strings_size;
+
+  for (i = 0; i < header.num_blueprints; i++) {
+    CodecBlueprint *blueprint = NULL;
+
+    if (offsets[i] < header.records_size &&
+        offsets[i] % sizeof (guint32) == 0) {
+      reader.in = (const guint32 *) (records + offsets[i]);
+      blueprint = load_codec_blueprint (media_type, &reader);
+    }
+
     if (!blueprint) {
       GST_WARNING ("Can not load all of the blueprints, cache corrupted");
 
@@ -389,135 +465,212 @@ load_codecs_cache (FsMediaType media_type)
 
       goto error;
     }
-    blueprints = g_list_append (blueprints, blueprint);
+    blueprints = g_list_prepend (blueprints, blueprint);
   }
 
+  blueprints = g_list_reverse (blueprints);
+
  error:
-  if (mapped) {
-#if GLIB_CHECK_VERSION(2,22,0)
+  if (mapped)
     g_mapped_file_unref (mapped);
-#else
-    g_mapped_file_free (mapped);
-#endif
-  } else {
-    g_free (contents);
+  return blueprints;
+}
+
+/**
+ * load_codecs_cache
+ * @media_type: a #FsMediaType
+ *
+ * Will load the codecs blueprints from the cache. Unless a cache file is set
+ * in the environment for this media type, the system-wide cache is tried
+ * first, then the user's.
+ *
+ * Returns: a #GList of #CodecBlueprint, or NULL if error, or cache outdated
+ *
+ */
+GList *
+load_codecs_cache (FsMediaType media_type)
+{
+  GList *blueprints = NULL;
+  gchar *cache_path;
+
+  if (!get_codecs_cache_env_path (media_type)) {
+    cache_path = get_system_codecs_cache_path (media_type);
+    if (cache_path)
+      blueprints = load_codecs_cache_file (media_type, cache_path);
+    g_free (cache_path);
+
+    if (blueprints)
+      return blueprints;
   }
+
+  cache_path = get_codecs_cache_path (media_type);
+  if (cache_path)
+    blueprints = load_codecs_cache_file (media_type, cache_path);
   g_free (cache_path);
+
   return blueprints;
 }
 
-#define WRITE_CHECK(x) if (!x) return FALSE;
+/* Builds the records and strings sections in memory */
+typedef struct {
+  GByteArray *records;
+  GByteArray *strings;
+  GHashTable *string_offsets;
+} CacheWriter;
 
-static gboolean
-write_codec_blueprint_int (int fd, gint val) {
-  return write (fd, &val, sizeof (gint)) == sizeof (gint);
-}
+static void
+write_codec_blueprint_uint (CacheWriter *writer, guint val) {
+  guint32 tmp = val;
 
-static gboolean
-write_codec_blueprint_string (int fd, const gchar *str) {
-  gint size;
+  g_byte_array_append (writer->records, (guint8 *) &tmp, sizeof (tmp));
+}
 
-  size = strlen (str);
-  WRITE_CHECK (write_codec_blueprint_int (fd, size));
-  return write (fd, str, size) == size;
+static void
+write_codec_blueprint_int (CacheWriter *writer, gint val) {
+  write_codec_blueprint_uint (writer, (guint) val);
 }
 
-static gboolean
-save_codec_blueprint (int fd, CodecBlueprint *codec_blueprint) {
-  gchar *caps;
-  const gchar *factory_name;
-  GList *walk;
-  gint size;
-
-  WRITE_CHECK (write_codec_blueprint_int
-      (fd, codec_blueprint->codec->id));
-  WRITE_CHECK (write_codec_blueprint_string
-      (fd, codec_blueprint->codec->encoding_name));
-  WRITE_CHECK (write_codec_blueprint_int
-      (fd, codec_blueprint->codec->clock_rate));
-  WRITE_CHECK (write_codec_blueprint_int
-      (fd, codec_blueprint->codec->channels));
-
-  size = g_list_length (codec_blueprint->codec->optional_params);
-  WRITE_CHECK (write_codec_blueprint_int (fd, size));
-  for (walk = codec_blueprint->codec->optional_params; walk;
-       walk = g_list_next (walk)) {
-    FsCodecParameter *param = walk->data;
-    WRITE_CHECK (write_codec_blueprint_string (fd, param->name));
-    WRITE_CHECK (write_codec_blueprint_string (fd, param->value));
+static void
+write_codec_blueprint_string (CacheWriter *writer, const gchar *str) {
+  gpointer offset;
+
+  if (!g_hash_table_lookup_extended (writer->string_offsets, str, NULL,
+          &offset)) {
+    offset = GUINT_TO_POINTER (writer->strings->len);
+    g_byte_array_append (writer->strings, (guint8 *) str, strlen (str) + 1);
+    g_hash_table_insert (writer->string_offsets, g_strdup (str), offset);
   }
 
-  caps = gst_caps_to_string (codec_blueprint->media_caps);
-  WRITE_CHECK (write_codec_blueprint_string (fd, caps));
-  g_free (caps);
+  write_codec_blueprint_uint (writer, GPOINTER_TO_UINT (offset));
+}
 
-  caps = gst_caps_to_string (codec_blueprint->rtp_caps);
-  WRITE_CHECK (write_codec_blueprint_string (fd, caps));
-  g_free (caps);
+static void
+write_codec_blueprint_caps (CacheWriter *writer, GstCaps *caps) {
+  gchar *str = gst_caps_to_string (caps);
 
-  caps = gst_caps_to_string (codec_blueprint->input_caps);
-  WRITE_CHECK (write_codec_blueprint_string (fd, caps));
-  g_free (caps);
+  write_codec_blueprint_string (writer, str);
+  g_free (str);
+}
 
-  caps = gst_caps_to_string (codec_blueprint->output_caps);
-  WRITE_CHECK (write_codec_blueprint_string (fd, caps));
-  g_free (caps);
+static void
+write_codec_blueprint_pipeline (CacheWriter *writer, GList *pipeline) {
+  GList *walk;
 
-  walk = codec_blueprint->send_pipeline_factory;
-  size = g_list_length (walk);
-  if (write (fd, &size, sizeof (gint)) != sizeof (gint))
-    return FALSE;
+  write_codec_blueprint_int (writer, g_list_length (pipeline));
 
-  for (; walk; walk = g_list_next (walk)) {
+  for (walk = pipeline; walk; walk = g_list_next (walk)) {
     GList *walk2 = walk->data;
-    size = g_list_length (walk2);
-    if (write (fd, &size, sizeof (gint)) != sizeof (gint))
-      return FALSE;
+
+    write_codec_blueprint_int (writer, g_list_length (walk2));
     for (; walk2; walk2 = g_list_next (walk2)) {
       GstElementFactory *fact = walk2->data;
-      factory_name = gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (fact));
-      WRITE_CHECK (write_codec_blueprint_string (fd, factory_name));
+
+      write_codec_blueprint_string (writer,
+          gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (fact)));
     }
   }
+}
 
-  walk = codec_blueprint->receive_pipeline_factory;
-  size = g_list_length (walk);
-  if (write (fd, &size, sizeof (gint)) != sizeof (gint))
-    return FALSE;
+static void
+save_codec_blueprint (CacheWriter *writer, CodecBlueprint *codec_blueprint) {
+  GList *walk;
 
-  for (; walk; walk = g_list_next (walk)) {
-    GList *walk2 = walk->data;
-    size = g_list_length (walk2);
-    if (write (fd, &size, sizeof (gint)) != sizeof (gint))
+  write_codec_blueprint_int (writer, codec_blueprint->codec->id);
+  write_codec_blueprint_string (writer,
+      codec_blueprint->codec->encoding_name);
+  write_codec_blueprint_uint (writer, codec_blueprint->codec->clock_rate);
+  write_codec_blueprint_uint (writer, codec_blueprint->codec->channels);
+
+  write_codec_blueprint_int (writer,
+      g_list_length (codec_blueprint->codec->optional_params));
+  for (walk = codec_blueprint->codec->optional_params; walk;
+       walk = g_list_next (walk)) {
+    FsCodecParameter *param = walk->data;
+    write_codec_blueprint_string (writer, param->name);
+    write_codec_blueprint_string (writer, param->value);
+  }
+
+  write_codec_blueprint_caps (writer, codec_blueprint->media_caps);
+  write_codec_blueprint_caps (writer, codec_blueprint->rtp_caps);
+  write_codec_blueprint_caps (writer, codec_blueprint->input_caps);
+  write_codec_blueprint_caps (writer, codec_blueprint->output_caps);
+
+  write_codec_blueprint_pipeline (writer,
+      codec_blueprint->send_pipeline_factory);
+  write_codec_blueprint_pipeline (writer,
+      codec_blueprint->receive_pipeline_factory);
+}
+
+static gboolean
+write_all (int fd, gconstpointer data, gsize size)
+{
+  const gchar *p = data;
+
+  while (size > 0) {
+    gssize written = write (fd, p, size);
+
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
       return FALSE;
-    for (; walk2; walk2 = g_list_next (walk2)) {
-      GstElementFactory *fact = walk2->data;
-      factory_name = gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (fact));
-      WRITE_CHECK (write_codec_blueprint_string (fd, factory_name));
     }
+    p += written;
+    size -= written;
   }
 
   return TRUE;
 }
 
-
-gboolean
-save_codecs_cache (FsMediaType media_type, GList *blueprints)
+static gboolean
+save_codecs_cache_file (FsMediaType media_type, const gchar *cache_path,
+    GList *blueprints)
 {
-  gchar *cache_path;
   GList *item;
   gchar *tmp_path;
   int fd;
-  int size;
-  gchar magic[8] = {0};
-
-  cache_path = get_codecs_cache_path (media_type);
-  if (!cache_path)
+  CacheHeader header;
+  gchar magic[8] = CACHE_MAGIC;
+  CacheWriter writer;
+  GArray *offsets;
+  guint64 checksum;
+  gboolean ret = FALSE;
+
+  if (g_list_length (blueprints) > MAX_BLUEPRINTS) {
+    GST_DEBUG ("Too many blueprints to cache");
     return FALSE;
-
+  }
 
   GST_DEBUG ("Saving codecs cache to %s", cache_path);
 
+  writer.records = g_byte_array_new ();
+  writer.strings = g_byte_array_new ();
+  writer.string_offsets = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, NULL);
+  offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  for (item = g_list_first (blueprints);
+       item;
+       item = g_list_next (item)) {
+    guint32 offset = writer.records->len;
+
+    g_array_append_val (offsets, offset);
+    save_codec_blueprint (&writer, item->data);
+  }
+
+  memset (&header, 0, sizeof (header));
+  magic[2] = get_magic_media (media_type);
+  memcpy (header.magic, magic, sizeof (magic));
+  header.num_blueprints = offsets->len;
+  header.records_size = writer.records->len;
+  header.strings_size = writer.strings->len;
+  header.plugins_hash = compute_plugins_hash ();
+
+  checksum = fnv1a_hash (FNV_OFFSET_BASIS, offsets->data,
+      offsets->len * sizeof (guint32));
+  checksum = fnv1a_hash (checksum, writer.records->data, writer.records->len);
+  checksum = fnv1a_hash (checksum, writer.strings->data, writer.strings->len);
+  header.checksum = checksum;
+
   tmp_path = g_strconcat (cache_path, ".tmpXXXXXX", NULL);
   fd = g_mkstemp (tmp_path);
   if (fd == -1) {
@@ -536,68 +689,106 @@ save_codecs_cache (FsMediaType media_type, GList *blueprints)
     if (fd == -1) {
       GST_DEBUG ("Unable to save codecs cache. g_mkstemp () failed: %s",
           g_strerror (errno));
-      g_free (tmp_path);
-      g_free (cache_path);
-      return FALSE;
+      goto out;
     }
   }
 
-  magic[0] = 'F';
-  magic[1] = 'S';
-  magic[2] = '?';
-  magic[3] = 'C';
-
-  if (media_type == FS_MEDIA_TYPE_AUDIO) {
-    magic[2] = 'A';
-  } else if (media_type == FS_MEDIA_TYPE_VIDEO) {
-    magic[2] = 'V';
-  } else if (media_type == FS_MEDIA_TYPE_APPLICATION) {
-    magic[2] = 'P';
-  }
-
-  /* version of the binary format */
-  magic[4] = '1';
-  magic[5] = '2';
-
-  if (write (fd, magic, 8) != 8)
-    return FALSE;
-
-
-  size = g_list_length (blueprints);
-  if (write (fd, &size, sizeof (gint)) != sizeof (gint))
-    return FALSE;
-
-
-  for (item = g_list_first (blueprints);
-       item;
-       item = g_list_next (item)) {
-    CodecBlueprint *codec_blueprint = item->data;
-    if (!save_codec_blueprint (fd, codec_blueprint)) {
-      GST_WARNING ("Unable to save codec cache");
-      close (fd);
-      g_free (tmp_path);
-      g_free (cache_path);
-      return FALSE;
-    }
+  if (!write_all (fd, &header, sizeof (header)) ||
+      !write_all (fd, offsets->data, offsets->len * sizeof (guint32)) ||
+      !write_all (fd, writer.records->data, writer.records->len) ||
+      !write_all (fd, writer.strings->data, writer.strings->len)) {
+    GST_WARNING ("Unable to save codec cache: %s", g_strerror (errno));
+    close (fd);
+    g_unlink (tmp_path);
+    goto out;
   }
 
+#ifndef WIN32
+  /* g_mkstemp () creates the file readable by its owner only, but the
+   * system-wide cache is written by root and read by everyone */
+  if (fchmod (fd, 0644) < 0)
+    GST_DEBUG ("Can't make codecs cache file readable : %s",
+        g_strerror (errno));
+#endif
 
   if (close (fd) < 0) {
     GST_DEBUG ("Can't close codecs cache file : %s", g_strerror (errno));
-      g_free (tmp_path);
-      g_free (cache_path);
-      return FALSE;
+    g_unlink (tmp_path);
+    goto out;
   }
 
-  if (g_file_test (tmp_path, G_FILE_TEST_EXISTS)) {
 #ifdef WIN32
-    remove (cache_path);
+  remove (cache_path);
 #endif
-    rename (tmp_path, cache_path);
+  if (g_rename (tmp_path, cache_path) < 0) {
+    GST_DEBUG ("Can't rename codecs cache file : %s", g_strerror (errno));
+    g_unlink (tmp_path);
+    goto out;
   }
 
+  GST_DEBUG ("Wrote binary codecs cache");
+  ret = TRUE;
+
+ out:
+  g_array_free (offsets, TRUE);
+  g_byte_array_free (writer.records, TRUE);
+  g_byte_array_free (writer.strings, TRUE);
+  g_hash_table_unref (writer.string_offsets);
   g_free (tmp_path);
+  return ret;
+}
+
+/**
+ * save_codecs_cache
+ * @media_type: a #FsMediaType
+ * @blueprints: a #GList of #CodecBlueprint
+ *
+ * Saves the blueprints to the user's cache.
+ *
+ * Returns: TRUE if the cache was written
+ */
+gboolean
+save_codecs_cache (FsMediaType media_type, GList *blueprints)
+{
+  gchar *cache_path;
+  gboolean ret;
+
+  cache_path = get_codecs_cache_path (media_type);
+  if (!cache_path)
+    return FALSE;
+
+  ret = save_codecs_cache_file (media_type, cache_path, blueprints);
   g_free (cache_path);
-  GST_DEBUG ("Wrote binary codecs cache");
-  return TRUE;
+
+  return ret;
+}
+
+/**
+ * save_codecs_cache_in_dir
+ * @media_type: a #FsMediaType
+ * @dir: the directory to write the cache file in
+ * @blueprints: a #GList of #CodecBlueprint
+ *
+ * Saves the blueprints under the name load_codecs_cache() looks for, used
+ * to preseed the system-wide cache.
+ *
+ * Returns: TRUE if the cache was written
+ */
+gboolean
+save_codecs_cache_in_dir (FsMediaType media_type, const gchar *dir,
+    GList *blueprints)
+{
+  const gchar *filename;
+  gchar *cache_path;
+  gboolean ret;
+
+  filename = get_codecs_cache_filename (media_type);
+  if (!filename)
+    return FALSE;
+
+  cache_path = g_build_filename (dir, filename, NULL);
+  ret = save_codecs_cache_file (media_type, cache_path, blueprints);
+  g_free (cache_path);
+
+  return ret;
 }
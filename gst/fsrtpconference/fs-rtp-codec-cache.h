@@ -33,6 +33,8 @@ G_BEGIN_DECLS
 
 GList *load_codecs_cache (FsMediaType media_type);
 gboolean save_codecs_cache (FsMediaType media_type, GList *codec_blueprints);
+gboolean save_codecs_cache_in_dir (FsMediaType media_type, const gchar *dir,
+    GList *codec_blueprints);
 
 
 G_END_DECLS
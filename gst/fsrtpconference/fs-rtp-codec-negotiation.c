@@ -420,18 +420,45 @@ _find_matching_blueprint (FsCodec *codec, GList *blueprints)
     return NULL;
 }
 
+/* Fills by_pt with the first association of each payload type, like
+ * lookup_codec_association_by_pt_list() would find it */
+
+static void
+index_codec_associations_by_pt (GList *codec_associations,
+    gboolean want_disabled, CodecAssociation **by_pt)
+{
+  GList *item;
+
+  memset (by_pt, 0, sizeof (CodecAssociation *) * CODEC_ASSOCIATION_MAX_PT);
+
+  for (item = codec_associations; item; item = g_list_next (item))
+  {
+    CodecAssociation *ca = item->data;
+
+    if (!ca || ca->codec->id < 0 || ca->codec->id >= CODEC_ASSOCIATION_MAX_PT)
+      continue;
+    if (!want_disabled && (ca->disable || ca->reserved))
+      continue;
+    if (!by_pt[ca->codec->id])
+      by_pt[ca->codec->id] = ca;
+  }
+}
+
 static gint
 _find_first_empty_dynamic_entry (
     GList *new_codec_associations,
     GList *old_codec_associations)
 {
+  CodecAssociation *new_by_pt[CODEC_ASSOCIATION_MAX_PT];
+  CodecAssociation *old_by_pt[CODEC_ASSOCIATION_MAX_PT];
   int id;
 
-  for (id = 96; id < 128; id++)
+  index_codec_associations_by_pt (new_codec_associations, TRUE, new_by_pt);
+  index_codec_associations_by_pt (old_codec_associations, TRUE, old_by_pt);
+
+  for (id = 96; id < CODEC_ASSOCIATION_MAX_PT; id++)
   {
-    if (lookup_codec_association_by_pt_list (new_codec_associations, id, TRUE))
-      continue;
-    if (lookup_codec_association_by_pt_list (old_codec_associations, id, TRUE))
+    if (new_by_pt[id] || old_by_pt[id])
       continue;
     return id;
   }
@@ -439,8 +466,144 @@ _find_first_empty_dynamic_entry (
   return -1;
 }
 
+/*
+ * The negotiation cache remembers, for one session:
+ *  - the results of the caps checks of the blueprints and preferences, which
+ *    stay valid until the preferences or the allowed caps change
+ *  - the result of negotiating each stream, in the order of the streams,
+ *    so that only the streams after the first one whose remote codecs
+ *    changed have to be negotiated again
+ */
+
+typedef struct {
+  /* Only kept for the first step, the input of the others is the output
+   * of the previous one */
+  GList *input;
+  GList *remote_codecs;
+  gboolean multi_stream;
+  GList *output;
+} NegotiationStep;
+
+struct _CodecNegotiationCache {
+  guint prefs_generation;
+
+  GstCaps *input_caps;
+  GstCaps *output_caps;
+  /* GstCaps of a blueprint or preference -> GINT_TO_POINTER (result + 1) */
+  GHashTable *input_results;
+  GHashTable *output_results;
+  /* CodecBlueprint -> GINT_TO_POINTER (result + 1) */
+  GHashTable *disabled;
+
+  /* NegotiationStep, one per stream with remote codecs */
+  GPtrArray *steps;
+  /* Position in steps of the running negotiation, and whether all of the
+   * steps before it could be re-used */
+  guint position;
+  gboolean hit;
+};
+
+static GList *codec_association_list_copy (GList *list);
+
+static void
+negotiation_step_free (gpointer data)
+{
+  NegotiationStep *step = data;
+
+  codec_association_list_destroy (step->input);
+  fs_codec_list_destroy (step->remote_codecs);
+  codec_association_list_destroy (step->output);
+  g_slice_free (NegotiationStep, step);
+}
+
+CodecNegotiationCache *
+codec_negotiation_cache_new (void)
+{
+  CodecNegotiationCache *cache = g_slice_new0 (CodecNegotiationCache);
+
+  cache->input_results = g_hash_table_new (g_direct_hash, g_direct_equal);
+  cache->output_results = g_hash_table_new (g_direct_hash, g_direct_equal);
+  cache->disabled = g_hash_table_new (g_direct_hash, g_direct_equal);
+  cache->steps = g_ptr_array_new_with_free_func (negotiation_step_free);
+
+  return cache;
+}
+
+void
+codec_negotiation_cache_free (CodecNegotiationCache *cache)
+{
+  g_hash_table_destroy (cache->input_results);
+  g_hash_table_destroy (cache->output_results);
+  g_hash_table_destroy (cache->disabled);
+  g_ptr_array_free (cache->steps, TRUE);
+  gst_caps_replace (&cache->input_caps, NULL);
+  gst_caps_replace (&cache->output_caps, NULL);
+  g_slice_free (CodecNegotiationCache, cache);
+}
+
+/**
+ * codec_negotiation_cache_begin:
+ * @cache: a #CodecNegotiationCache
+ * @prefs_generation: a number that changes every time the codec preferences
+ *  change
+ * @input_caps: the allowed input caps of the session
+ * @output_caps: the allowed output caps of the session
+ *
+ * Starts a new negotiation, forgets everything that depended on the
+ * preferences or caps if they have changed.
+ */
+
+void
+codec_negotiation_cache_begin (CodecNegotiationCache *cache,
+    guint prefs_generation, GstCaps *input_caps, GstCaps *output_caps)
+{
+  /* The keys are the caps of the old preferences, which may be gone */
+  if (cache->prefs_generation != prefs_generation)
+  {
+    cache->prefs_generation = prefs_generation;
+    g_hash_table_remove_all (cache->input_results);
+    g_hash_table_remove_all (cache->output_results);
+    g_hash_table_remove_all (cache->disabled);
+  }
+
+  /* A reference is kept so the pointer can not be re-used for other caps */
+  if (cache->input_caps != input_caps)
+  {
+    gst_caps_replace (&cache->input_caps, input_caps);
+    g_hash_table_remove_all (cache->input_results);
+  }
+  if (cache->output_caps != output_caps)
+  {
+    gst_caps_replace (&cache->output_caps, output_caps);
+    g_hash_table_remove_all (cache->output_results);
+  }
+
+  cache->position = 0;
+  cache->hit = TRUE;
+}
+
+static gboolean
+cached_caps_can_intersect (GHashTable *results, GstCaps *filter,
+    GstCaps *caps)
+{
+  gpointer result;
+  gboolean ret;
+
+  if (!results)
+    return gst_caps_can_intersect (filter, caps);
+
+  result = g_hash_table_lookup (results, caps);
+  if (result)
+    return GPOINTER_TO_INT (result) - 1;
+
+  ret = gst_caps_can_intersect (filter, caps);
+  g_hash_table_insert (results, caps, GINT_TO_POINTER (ret + 1));
+
+  return ret;
+}
+
 static gboolean
-_is_disabled (GList *codec_prefs, CodecBlueprint *bp)
+_is_disabled_uncached (GList *codec_prefs, CodecBlueprint *bp)
 {
   GList *item = NULL;
 
@@ -470,6 +633,26 @@ _is_disabled (GList *codec_prefs, CodecBlueprint *bp)
   return FALSE;
 }
 
+static gboolean
+_is_disabled (GList *codec_prefs, CodecBlueprint *bp,
+    CodecNegotiationCache *cache)
+{
+  gpointer result;
+  gboolean ret;
+
+  if (!cache)
+    return _is_disabled_uncached (codec_prefs, bp);
+
+  result = g_hash_table_lookup (cache->disabled, bp);
+  if (result)
+    return GPOINTER_TO_INT (result) - 1;
+
+  ret = _is_disabled_uncached (codec_prefs, bp);
+  g_hash_table_insert (cache->disabled, bp, GINT_TO_POINTER (ret + 1));
+
+  return ret;
+}
+
 /*
  * This function should return TRUE if the codec pref is a "base" of the
  * negotiated codec, but %FALSE otherwise.
@@ -533,11 +716,15 @@ list_insert_local_ca (GList *list, CodecAssociation *ca)
 
 static gboolean
 verify_caps (CodecPreference *cp, CodecBlueprint *bp, GstCaps *input_caps,
-    GstCaps *output_caps)
+    GstCaps *output_caps, CodecNegotiationCache *cache)
 {
+  GHashTable *input_results = cache ? cache->input_results : NULL;
+  GHashTable *output_results = cache ? cache->output_results : NULL;
+
   if (cp && cp->input_caps)
   {
-    if (!gst_caps_can_intersect (input_caps, cp->input_caps))
+    if (!cached_caps_can_intersect (input_results, input_caps,
+            cp->input_caps))
     {
       GST_LOG ("Rejected codec " FS_CODEC_FORMAT " by input caps, filter: %"
           GST_PTR_FORMAT " pref caps: %" GST_PTR_FORMAT,
@@ -547,7 +734,8 @@ verify_caps (CodecPreference *cp, CodecBlueprint *bp, GstCaps *input_caps,
   }
   else if (bp && bp->input_caps)
   {
-    if (!gst_caps_can_intersect (input_caps, bp->input_caps))
+    if (!cached_caps_can_intersect (input_results, input_caps,
+            bp->input_caps))
     {
       GST_LOG ("Rejected codec " FS_CODEC_FORMAT " by input caps, filter: %"
           GST_PTR_FORMAT " blueprint caps: %" GST_PTR_FORMAT,
@@ -558,7 +746,8 @@ verify_caps (CodecPreference *cp, CodecBlueprint *bp, GstCaps *input_caps,
 
   if (cp && cp->output_caps)
   {
-    if (!gst_caps_can_intersect (output_caps, cp->output_caps))
+    if (!cached_caps_can_intersect (output_results, output_caps,
+            cp->output_caps))
     {
       GST_LOG ("Rejected codec " FS_CODEC_FORMAT " by output caps, filter: %"
           GST_PTR_FORMAT " pref caps: %" GST_PTR_FORMAT,
@@ -568,7 +757,8 @@ verify_caps (CodecPreference *cp, CodecBlueprint *bp, GstCaps *input_caps,
   }
   else if (bp && bp->output_caps)
   {
-    if (!gst_caps_can_intersect (output_caps, bp->output_caps))
+    if (!cached_caps_can_intersect (output_results, output_caps,
+            bp->output_caps))
     {
       GST_LOG ("Rejected codec " FS_CODEC_FORMAT " by output caps, filter: %"
           GST_PTR_FORMAT " blueprint caps: %" GST_PTR_FORMAT,
@@ -585,6 +775,9 @@ verify_caps (CodecPreference *cp, CodecBlueprint *bp, GstCaps *input_caps,
  * @blueprints: The #GList of #CodecBlueprint
  * @codec_prefs: The #GList of #CodecPreference representing codec preferences
  * @current_codec_associations: The #GList of current #CodecAssociation
+ * @input_caps: The allowed input caps
+ * @output_caps: The allowed output caps
+ * @cache: A #CodecNegotiationCache for the caps checks, or %NULL
  *
  * This function creates a list of codec associations from installed codecs
  * and the preferences. It also takes into account the currently negotiated
@@ -599,7 +792,8 @@ create_local_codec_associations (
     GList *codec_prefs,
     GList *current_codec_associations,
     GstCaps *input_caps,
-    GstCaps *output_caps)
+    GstCaps *output_caps,
+    CodecNegotiationCache *cache)
 {
   GList *codec_associations = NULL;
   GList *bp_e = NULL;
@@ -654,7 +848,7 @@ create_local_codec_associations (
       continue;
     }
 
-    if (!verify_caps (cp, bp, input_caps, output_caps))
+    if (!verify_caps (cp, bp, input_caps, output_caps, cache))
       continue;
 
     /* Now lets see if there is an existing codec that matches this preference
@@ -806,7 +1000,7 @@ create_local_codec_associations (
       continue;
 
     /* Check if it is disabled in the list of preferred codecs */
-    if (_is_disabled (codec_prefs, bp))
+    if (_is_disabled (codec_prefs, bp, cache))
     {
       gchar *tmp = fs_codec_to_string (bp->codec);
       GST_DEBUG ("Codec %s disabled by config", tmp);
@@ -842,7 +1036,7 @@ create_local_codec_associations (
           continue;
         fs_codec_destroy (codec);
 
-        if (!verify_caps (NULL, bp, input_caps, output_caps))
+        if (!verify_caps (NULL, bp, input_caps, output_caps, cache))
           continue;
 
         ca = g_slice_new0 (CodecAssociation);
@@ -866,7 +1060,7 @@ create_local_codec_associations (
       continue;
     fs_codec_destroy (codec);
 
-    if (!verify_caps (NULL, bp, input_caps, output_caps))
+    if (!verify_caps (NULL, bp, input_caps, output_caps, cache))
       continue;
 
     ca = g_slice_new0 (CodecAssociation);
@@ -1153,6 +1347,74 @@ match_send_codec_no_pt (CodecAssociation *old_ca, gpointer user_data)
   return ret;
 }
 
+/**
+ * codec_negotiation_cache_negotiate_stream:
+ * @cache: a #CodecNegotiationCache on which codec_negotiation_cache_begin()
+ *  has been called
+ * @remote_codecs: same as negotiate_stream_codecs()
+ * @current_codec_associations: same as negotiate_stream_codecs()
+ * @multi_stream: same as negotiate_stream_codecs()
+ *
+ * Does the same as negotiate_stream_codecs(), for each stream with remote
+ * codecs in turn. If the local codecs and the remote codecs of this stream
+ * and of all the previous ones are the same as in the last negotiation, the
+ * result of the last negotiation is returned.
+ *
+ * Returns: a new #GList of #CodecAssociation or %NULL
+ */
+
+GList *
+codec_negotiation_cache_negotiate_stream (CodecNegotiationCache *cache,
+    const GList *remote_codecs,
+    GList *current_codec_associations,
+    gboolean multi_stream)
+{
+  NegotiationStep *step = NULL;
+  GList *new_codec_associations;
+
+  if (cache->hit && cache->position < cache->steps->len)
+  {
+    step = g_ptr_array_index (cache->steps, cache->position);
+
+    if (step->multi_stream != multi_stream ||
+        !fs_codec_list_are_equal (step->remote_codecs,
+            (GList *) remote_codecs) ||
+        (cache->position == 0 &&
+            !codec_association_lists_are_identical (step->input,
+                current_codec_associations)))
+      step = NULL;
+  }
+
+  if (step)
+  {
+    GST_LOG ("Re-using the negotiation of stream %u", cache->position);
+    cache->position++;
+    return codec_association_list_copy (step->output);
+  }
+
+  /* Everything after this stream has to be negotiated again */
+  cache->hit = FALSE;
+  if (cache->position < cache->steps->len)
+    g_ptr_array_set_size (cache->steps, cache->position);
+
+  new_codec_associations = negotiate_stream_codecs (remote_codecs,
+      current_codec_associations, multi_stream);
+
+  if (new_codec_associations)
+  {
+    step = g_slice_new0 (NegotiationStep);
+    if (cache->position == 0)
+      step->input = codec_association_list_copy (current_codec_associations);
+    step->remote_codecs = fs_codec_list_copy (remote_codecs);
+    step->multi_stream = multi_stream;
+    step->output = codec_association_list_copy (new_codec_associations);
+    g_ptr_array_add (cache->steps, step);
+    cache->position++;
+  }
+
+  return new_codec_associations;
+}
+
 /**
  * finish_codec_negotiation:
  * @old_codec_associations: The previous list of negotiated #CodecAssociation
@@ -1179,25 +1441,31 @@ finish_codec_negotiation (
 {
   int i;
   GList *item;
+  CodecAssociation *new_by_pt[CODEC_ASSOCIATION_MAX_PT];
+  CodecAssociation *old_by_pt[CODEC_ASSOCIATION_MAX_PT];
+
+  /* The associations appended below only take ids that have already been
+   * looked at, so the indexes stay valid for the whole loop */
+  index_codec_associations_by_pt (new_codec_associations, TRUE, new_by_pt);
+  index_codec_associations_by_pt (old_codec_associations, FALSE, old_by_pt);
 
   /* Now, lets fill all of the PTs that were previously used in the session
    * even if they are not currently used, so they can't be re-used
    */
 
-  for (i=0; i < 128; i++)
+  for (i=0; i < CODEC_ASSOCIATION_MAX_PT; i++)
   {
     CodecAssociation *local_ca = NULL;
 
     /* We can skip ids where something already exists */
-    if (lookup_codec_association_by_pt_list (new_codec_associations, i, TRUE))
+    if (new_by_pt[i])
       continue;
 
     /* We check if our local table (our offer) and if we offered
      * something, we add it. Some broken implementation (like Tandberg's)
      * send packets on PTs that they did not put in their response
      */
-    local_ca = lookup_codec_association_by_pt_list (old_codec_associations,
-        i, FALSE);
+    local_ca = old_by_pt[i];
     if (local_ca) {
       CodecAssociation *new_ca = codec_association_copy (local_ca);
       new_ca->recv_only = TRUE;
@@ -1305,6 +1573,69 @@ codec_association_list_destroy (GList *list)
   g_list_free (list);
 }
 
+/**
+ * codec_association_table_new:
+ * @codec_associations: a #GList of #CodecAssociation
+ *
+ * Builds the table of the caps of the payload types that are in use, as
+ * lookup_codec_association_by_pt() would find them.
+ *
+ * Returns: a new #CodecAssociationTable
+ */
+
+CodecAssociationTable *
+codec_association_table_new (GList *codec_associations)
+{
+  CodecAssociationTable *table = g_slice_new0 (CodecAssociationTable);
+  CodecAssociation *by_pt[CODEC_ASSOCIATION_MAX_PT];
+  guint pt;
+
+  index_codec_associations_by_pt (codec_associations, FALSE, by_pt);
+
+  for (pt = 0; pt < CODEC_ASSOCIATION_MAX_PT; pt++)
+  {
+    FsCodec *tmpcodec;
+
+    if (!by_pt[pt])
+      continue;
+
+    tmpcodec = codec_copy_filtered (by_pt[pt]->codec, FS_PARAM_TYPE_CONFIG);
+    table->caps[pt] = fs_codec_to_gst_caps (tmpcodec);
+    fs_codec_destroy (tmpcodec);
+  }
+
+  return table;
+}
+
+void
+codec_association_table_free (CodecAssociationTable *table)
+{
+  guint pt;
+
+  for (pt = 0; pt < CODEC_ASSOCIATION_MAX_PT; pt++)
+    if (table->caps[pt])
+      gst_caps_unref (table->caps[pt]);
+
+  g_slice_free (CodecAssociationTable, table);
+}
+
+/**
+ * codec_association_table_get_caps:
+ * @table: a #CodecAssociationTable
+ * @pt: a payload type
+ *
+ * Returns: a new reference to the caps of @pt, or %NULL if it is not in use
+ */
+
+GstCaps *
+codec_association_table_get_caps (CodecAssociationTable *table, guint pt)
+{
+  if (pt >= CODEC_ASSOCIATION_MAX_PT || !table->caps[pt])
+    return NULL;
+
+  return gst_caps_ref (table->caps[pt]);
+}
+
 
 static CodecAssociation *
 codec_association_copy (CodecAssociation *ca)
@@ -1322,6 +1653,44 @@ codec_association_copy (CodecAssociation *ca)
   return newca;
 }
 
+static GList *
+codec_association_list_copy (GList *list)
+{
+  GList *copy = NULL;
+
+  for (; list; list = g_list_next (list))
+    copy = g_list_prepend (copy, codec_association_copy (list->data));
+
+  return g_list_reverse (copy);
+}
+
+/* Unlike codec_associations_list_are_equal(), everything that the
+ * negotiation looks at is compared */
+
+static gboolean
+codec_association_lists_are_identical (GList *list1, GList *list2)
+{
+  for (; list1 && list2;
+       list1 = g_list_next (list1), list2 = g_list_next (list2))
+  {
+    CodecAssociation *ca1 = list1->data;
+    CodecAssociation *ca2 = list2->data;
+
+    if (ca1->blueprint != ca2->blueprint ||
+        ca1->reserved != ca2->reserved ||
+        ca1->disable != ca2->disable ||
+        ca1->need_config != ca2->need_config ||
+        ca1->recv_only != ca2->recv_only ||
+        g_strcmp0 (ca1->send_profile, ca2->send_profile) ||
+        g_strcmp0 (ca1->recv_profile, ca2->recv_profile) ||
+        !fs_codec_are_equal (ca1->codec, ca2->codec) ||
+        !fs_codec_are_equal (ca1->send_codec, ca2->send_codec))
+      return FALSE;
+  }
+
+  return (list1 == NULL && list2 == NULL);
+}
+
 GList *
 codec_associations_to_codecs_internal (GList *codec_associations,
     gboolean include_config, gboolean send_codecs)
@@ -67,6 +67,23 @@ typedef struct _CodecAssociation {
 
 } CodecAssociation;
 
+/* Payload types are 7 bits */
+#define CODEC_ASSOCIATION_MAX_PT (128)
+
+/**
+ * CodecAssociationTable:
+ * @caps: The caps of each payload type in use, without the config
+ *  parameters, or %NULL
+ *
+ * An immutable index by payload type of a list of #CodecAssociation, built
+ * every time the list changes, for the streaming threads that can not take
+ * the session lock.
+ */
+
+typedef struct _CodecAssociationTable {
+  GstCaps *caps[CODEC_ASSOCIATION_MAX_PT];
+} CodecAssociationTable;
+
 typedef struct _CodecPreference {
   FsCodec *codec;
 
@@ -74,6 +91,8 @@ typedef struct _CodecPreference {
   GstCaps *output_caps;
 } CodecPreference;
 
+typedef struct _CodecNegotiationCache CodecNegotiationCache;
+
 GList *validate_codecs_configuration (
     FsMediaType media_type,
     GList *blueprints,
@@ -85,7 +104,8 @@ create_local_codec_associations (
     GList *codec_prefs,
     GList *current_codec_associations,
     GstCaps *input_caps,
-    GstCaps *output_caps);
+    GstCaps *output_caps,
+    CodecNegotiationCache *cache);
 
 GList *
 negotiate_stream_codecs (
@@ -93,6 +113,22 @@ negotiate_stream_codecs (
     GList *current_codec_associations,
     gboolean multi_stream);
 
+CodecNegotiationCache *
+codec_negotiation_cache_new (void);
+
+void
+codec_negotiation_cache_free (CodecNegotiationCache *cache);
+
+void
+codec_negotiation_cache_begin (CodecNegotiationCache *cache,
+    guint prefs_generation, GstCaps *input_caps, GstCaps *output_caps);
+
+GList *
+codec_negotiation_cache_negotiate_stream (CodecNegotiationCache *cache,
+    const GList *remote_codecs,
+    GList *current_codec_associations,
+    gboolean multi_stream);
+
 GList *
 finish_codec_negotiation (
     GList *old_codec_associations,
@@ -125,6 +161,15 @@ codec_associations_list_are_equal (GList *list1, GList *list2);
 void
 codec_association_list_destroy (GList *list);
 
+CodecAssociationTable *
+codec_association_table_new (GList *codec_associations);
+
+void
+codec_association_table_free (CodecAssociationTable *table);
+
+GstCaps *
+codec_association_table_get_caps (CodecAssociationTable *table, guint pt);
+
 typedef gboolean (*CAFindFunc) (CodecAssociation *ca, gpointer user_data);
 
 CodecAssociation *
@@ -33,6 +33,51 @@
  *
  * The various sdes property allow you to set the content of the SDES packet
  * in the sent RTCP reports.
+ *
+ * Receive codec bins are kept in a pool when their substream goes away, and
+ * are built ahead of time for the negotiated codecs, so new substreams can
+ * start decoding without building a codec bin first. The size of the pool
+ * and how long idle bins are kept can be set with the
+ * #FsRtpConference:codec-bin-pool-size and
+ * #FsRtpConference:codec-bin-pool-max-idle properties.
+ *
+ * When the #FsRtpConference:forwarding property is set, the conference acts
+ * as a selective forwarding unit: the RTP packets received from each stream
+ * are sent to the other participants of the session without being decoded,
+ * under an SSRC of their own. If the sender sends simulcast layers, each
+ * receiving stream gets the one chosen by its #FsRtpStream:simulcast-layer
+ * property. The streams created while forwarding get a transmitter of their
+ * own for this, the ones created before get everything that is forwarded.
+ *
+ * Audio sessions can also mix the received audio when their
+ * #FsRtpSession:mixing-speakers property is set. Each stream then gets a
+ * "mix_%u_%u" source pad, given by its #FsRtpStream:mix-pad property, with
+ * the audio of all the other participants. Only the loudest speakers are
+ * decoded, according to the audio level header extension (RFC 6464).
+ *
+ * In audio sessions, the decoding of the SSRCs that announce a level quieter
+ * than the #FsRtpSession:silence-threshold property is paused. The levels
+ * are reported on the bus.
+ *
+ * <refsect2><title>The "<literal>farstream-rtp-audio-level</literal>"
+ *   message</title>
+ * |[
+ * "session"          #FsSession          The session that received the packets
+ * "ssrc"             #guint              The SSRC of the sender
+ * "level"            #guint              The loudest level since the last
+ *                                        message in -dBov, 127 is silence
+ * "voice"            #gboolean           %TRUE if the sender detected voice
+ *                                        since the last message
+ * "paused"           #gboolean           %TRUE if the decoding is paused
+ * ]|
+ * <para>
+ * This message is posted regularly for every SSRC that is not paused, and
+ * when its decoding is paused or resumed. The "level" and "voice" fields are
+ * missing if none of the packets received since the last message carried
+ * the audio level extension. The SSRCs that do not send it are never paused
+ * and are always decoded when mixing.
+ * </para>
+ * </refsect2>
  */
 
 #ifdef HAVE_CONFIG_H
@@ -66,6 +111,9 @@ enum
 {
   PROP_0,
   PROP_SDES,
+  PROP_CODEC_BIN_POOL_SIZE,
+  PROP_CODEC_BIN_POOL_MAX_IDLE,
+  PROP_FORWARDING
 };
 
 
@@ -81,6 +129,12 @@ static GstStaticPadTemplate fs_rtp_conference_src_template =
                            GST_PAD_SOMETIMES,
                            GST_STATIC_CAPS_ANY);
 
+static GstStaticPadTemplate fs_rtp_conference_mix_template =
+  GST_STATIC_PAD_TEMPLATE ("mix_%u_%u",
+                           GST_PAD_SRC,
+                           GST_PAD_SOMETIMES,
+                           GST_STATIC_CAPS_ANY);
+
 
 #define FS_RTP_CONFERENCE_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), FS_TYPE_RTP_CONFERENCE, FsRtpConferencePrivate))
@@ -98,6 +152,12 @@ struct _FsRtpConferencePrivate
 
   /* Array of all internal threads, as GThreads */
   GPtrArray *threads;
+
+  /* Has its own lock */
+  FsRtpCodecBinPool *codec_bin_pool;
+
+  /* Protected by GST_OBJECT_LOCK */
+  gboolean forwarding;
 };
 
 G_DEFINE_TYPE (FsRtpConference, fs_rtp_conference, FS_TYPE_CONFERENCE);
@@ -202,6 +262,8 @@ fs_rtp_conference_finalize (GObject * object)
 
   g_ptr_array_free (self->priv->threads, TRUE);
 
+  fs_rtp_codec_bin_pool_free (self->priv->codec_bin_pool);
+
   G_OBJECT_CLASS (fs_rtp_conference_parent_class)->finalize (object);
 }
 
@@ -226,6 +288,8 @@ fs_rtp_conference_class_init (FsRtpConferenceClass * klass)
             gst_static_pad_template_get (&fs_rtp_conference_sink_template));
   gst_element_class_add_pad_template (gstelement_class,
             gst_static_pad_template_get (&fs_rtp_conference_src_template));
+  gst_element_class_add_pad_template (gstelement_class,
+            gst_static_pad_template_get (&fs_rtp_conference_mix_template));
 
   gst_element_class_set_metadata (gstelement_class,
       "Farstream RTP Conference",
@@ -255,6 +319,32 @@ fs_rtp_conference_class_init (FsRtpConferenceClass * klass)
       g_param_spec_boxed ("sdes", "SDES Items for this conference",
           "SDES items to use for sessions in this conference",
           GST_TYPE_STRUCTURE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_CODEC_BIN_POOL_SIZE,
+      g_param_spec_uint ("codec-bin-pool-size",
+          "Size of the codec bin pool",
+          "Maximum number of idle codec bins kept for reuse (0 to disable)",
+          0, G_MAXUINT, FS_RTP_CODEC_BIN_POOL_DEFAULT_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_CODEC_BIN_POOL_MAX_IDLE,
+      g_param_spec_uint64 ("codec-bin-pool-max-idle",
+          "Maximum idle time of pooled codec bins",
+          "How long an idle codec bin is kept in the pool in nanoseconds"
+          " (0 to keep it until evicted)",
+          0, G_MAXUINT64, FS_RTP_CODEC_BIN_POOL_DEFAULT_MAX_IDLE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FORWARDING,
+      g_param_spec_boolean ("forwarding",
+          "Selective forwarding mode",
+          "Forward the received RTP packets of each stream to the other"
+          " participants of the session without decoding them, no source"
+          " pads are created. Only applies to the data received after it is"
+          " set.",
+          FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -269,6 +359,8 @@ fs_rtp_conference_init (FsRtpConference *conf)
 
   conf->priv->threads = g_ptr_array_new ();
 
+  conf->priv->codec_bin_pool = fs_rtp_codec_bin_pool_new ();
+
   conf->rtpbin = gst_element_factory_make ("rtpbin", NULL);
 
   if (!conf->rtpbin) {
@@ -318,6 +410,17 @@ fs_rtp_conference_get_property (GObject *object,
     case PROP_SDES:
       g_object_get_property (G_OBJECT (self->rtpbin), "sdes", value);
       break;
+    case PROP_CODEC_BIN_POOL_SIZE:
+      g_value_set_uint (value,
+          fs_rtp_codec_bin_pool_get_max_size (self->priv->codec_bin_pool));
+      break;
+    case PROP_CODEC_BIN_POOL_MAX_IDLE:
+      g_value_set_uint64 (value,
+          fs_rtp_codec_bin_pool_get_max_idle (self->priv->codec_bin_pool));
+      break;
+    case PROP_FORWARDING:
+      g_value_set_boolean (value, fs_rtp_conference_is_forwarding (self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -340,6 +443,19 @@ fs_rtp_conference_set_property (GObject *object,
     case PROP_SDES:
       g_object_set_property (G_OBJECT (self->rtpbin), "sdes", value);
       break;
+    case PROP_CODEC_BIN_POOL_SIZE:
+      fs_rtp_codec_bin_pool_set_max_size (self->priv->codec_bin_pool,
+          g_value_get_uint (value));
+      break;
+    case PROP_CODEC_BIN_POOL_MAX_IDLE:
+      fs_rtp_codec_bin_pool_set_max_idle (self->priv->codec_bin_pool,
+          g_value_get_uint64 (value));
+      break;
+    case PROP_FORWARDING:
+      GST_OBJECT_LOCK (self);
+      self->priv->forwarding = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -864,3 +980,29 @@ fs_rtp_conference_is_internal_thread (FsRtpConference *self)
 
   return ret;
 }
+
+/**
+ * fs_rtp_conference_get_codec_bin_pool:
+ * @self: a #FsRtpConference
+ *
+ * Returns: The pool of codec bins of this conference, it is valid for as
+ * long as the conference is
+ */
+
+FsRtpCodecBinPool *
+fs_rtp_conference_get_codec_bin_pool (FsRtpConference *self)
+{
+  return self->priv->codec_bin_pool;
+}
+
+gboolean
+fs_rtp_conference_is_forwarding (FsRtpConference *self)
+{
+  gboolean forwarding;
+
+  GST_OBJECT_LOCK (self);
+  forwarding = self->priv->forwarding;
+  GST_OBJECT_UNLOCK (self);
+
+  return forwarding;
+}
@@ -28,6 +28,8 @@
 
 #include <farstream/fs-conference.h>
 
+#include "fs-rtp-codec-bin-pool.h"
+
 G_BEGIN_DECLS
 
 #define FS_TYPE_RTP_CONFERENCE \
@@ -79,6 +81,11 @@ GstCaps *fs_codec_to_gst_caps_with_ptime (const FsCodec *codec);
 
 gboolean fs_rtp_conference_is_internal_thread (FsRtpConference *self);
 
+FsRtpCodecBinPool *fs_rtp_conference_get_codec_bin_pool (
+    FsRtpConference *self);
+
+gboolean fs_rtp_conference_is_forwarding (FsRtpConference *self);
+
 G_END_DECLS
 
 #endif /* __FS_RTP_CONFERENCE_H__ */
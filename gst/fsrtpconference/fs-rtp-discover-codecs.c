@@ -84,9 +84,19 @@ static void codec_blueprints_add_caps (FsMediaType media_type);
 
 /* GLOBAL variables */
 
+/* Each media type has its own lock, so discovering the codecs for one type
+ * does not block sessions of another type. It is held for the whole
+ * discovery, callers asking for the same type wait for its result. */
 static GList *list_codec_blueprints[FS_MEDIA_TYPE_LAST+1] = { NULL };
 static gint codecs_lists_ref[FS_MEDIA_TYPE_LAST+1] = { 0 };
-G_LOCK_DEFINE_STATIC (codecs_lists);
+static GMutex codecs_lists_mutex[FS_MEDIA_TYPE_LAST+1];
+
+/* Number of threads that filter the element factories, including the
+ * calling thread */
+#define FILTER_THREADS (4)
+
+/* Chunk of factories a thread takes at once */
+#define FILTER_CHUNK (16)
 
 
 static void
@@ -209,19 +219,9 @@ codec_cap_list_free (GList *list)
   g_list_free (list);
 }
 
-/**
- * fs_rtp_blueprints_get
- * @media_type: a #FsMediaType
- *
- * find all plugins that follow the pattern:
- * input (microphone) -> N* -> rtp payloader -> network
- * network  -> rtp depayloader -> N* -> output (soundcard)
- * media_type defines if we want audio or video codecs
- *
- * Returns: a #GList of #CodecBlueprint or NULL on error
- */
-GList *
-fs_rtp_blueprints_get (FsMediaType media_type, GError **error)
+static GList *
+fs_rtp_blueprints_get_internal (FsMediaType media_type, gboolean use_cache,
+    GError **error)
 {
   GstCaps *caps;
   GList *recv_list = NULL;
@@ -235,7 +235,7 @@ fs_rtp_blueprints_get (FsMediaType media_type, GError **error)
     return NULL;
   }
 
-  G_LOCK (codecs_lists);
+  g_mutex_lock (&codecs_lists_mutex[media_type]);
 
   codecs_lists_ref[media_type]++;
 
@@ -250,7 +250,8 @@ fs_rtp_blueprints_get (FsMediaType media_type, GError **error)
     goto out;
   }
 
-  list_codec_blueprints[media_type] = load_codecs_cache (media_type);
+  if (use_cache)
+    list_codec_blueprints[media_type] = load_codecs_cache (media_type);
   if (list_codec_blueprints[media_type]) {
     GST_DEBUG ("Loaded codec blueprints from cache file");
     ret = list_codec_blueprints[media_type];
@@ -300,11 +301,12 @@ fs_rtp_blueprints_get (FsMediaType media_type, GError **error)
   create_codec_lists (media_type, recv_list, send_list);
 
   /* Save the codecs blueprint cache */
-  save_codecs_cache (media_type, list_codec_blueprints[media_type]);
+  if (use_cache)
+    save_codecs_cache (media_type, list_codec_blueprints[media_type]);
   ret = list_codec_blueprints[media_type];
 
  out:
-  G_UNLOCK (codecs_lists);
+  g_mutex_unlock (&codecs_lists_mutex[media_type]);
 
   if (recv_list)
     codec_cap_list_free (recv_list);
@@ -314,6 +316,39 @@ fs_rtp_blueprints_get (FsMediaType media_type, GError **error)
   return ret;
 }
 
+/**
+ * fs_rtp_blueprints_get
+ * @media_type: a #FsMediaType
+ *
+ * find all plugins that follow the pattern:
+ * input (microphone) -> N* -> rtp payloader -> network
+ * network  -> rtp depayloader -> N* -> output (soundcard)
+ * media_type defines if we want audio or video codecs
+ *
+ * Returns: a #GList of #CodecBlueprint or NULL on error
+ */
+GList *
+fs_rtp_blueprints_get (FsMediaType media_type, GError **error)
+{
+  return fs_rtp_blueprints_get_internal (media_type, TRUE, error);
+}
+
+/**
+ * fs_rtp_blueprints_get_uncached
+ * @media_type: a #FsMediaType
+ *
+ * Like fs_rtp_blueprints_get(), but always runs the discovery instead of
+ * loading the cache, and does not save the result. It must be balanced by
+ * fs_rtp_blueprints_unref() like fs_rtp_blueprints_get().
+ *
+ * Returns: a #GList of #CodecBlueprint or NULL on error
+ */
+GList *
+fs_rtp_blueprints_get_uncached (FsMediaType media_type, GError **error)
+{
+  return fs_rtp_blueprints_get_internal (media_type, FALSE, error);
+}
+
 static gboolean
 create_codec_lists (FsMediaType media_type,
     GList *recv_list, GList *send_list)
@@ -1068,7 +1103,7 @@ codec_blueprint_destroy (CodecBlueprint *codec_blueprint)
 void
 fs_rtp_blueprints_unref (FsMediaType media_type)
 {
-  G_LOCK (codecs_lists);
+  g_mutex_lock (&codecs_lists_mutex[media_type]);
 
   codecs_lists_ref[media_type]--;
   if (!codecs_lists_ref[media_type])
@@ -1086,7 +1121,7 @@ fs_rtp_blueprints_unref (FsMediaType media_type)
     }
   }
 
-  G_UNLOCK (codecs_lists);
+  g_mutex_unlock (&codecs_lists_mutex[media_type]);
 }
 
 
@@ -1311,6 +1346,125 @@ compare_ranks (GstPluginFeature * f1, GstPluginFeature * f2)
 
 
 /* creates/returns a list of CodecCap based on given filter function and caps */
+/*
+ * Checking every factory against the caps is what makes discovery slow, so
+ * it is spread over a few threads. The results are stored per factory, so
+ * the lists are then built in rank order exactly as if it was done serially.
+ */
+
+typedef struct {
+  FilterFunc filter;
+  GstCaps *caps;
+  GstElementFactory **factories;
+  guint num_factories;
+  /* Outputs, one per factory */
+  gboolean *matches;
+  GstCaps **matched_caps;
+
+  /* Index of the next factory to check, only accessed atomically */
+  gint next;
+  /* Pool threads still working, protected by filter_mutex */
+  gint pending;
+} FilterJob;
+
+static GThreadPool *filter_pool = NULL;
+static GMutex filter_mutex;
+static GCond filter_cond;
+
+static void
+filter_job_run (FilterJob *job)
+{
+  for (;;)
+  {
+    guint start = g_atomic_int_add (&job->next, FILTER_CHUNK);
+    guint end = MIN (start + FILTER_CHUNK, job->num_factories);
+    guint i;
+
+    if (start >= job->num_factories)
+      break;
+
+    for (i = start; i < end; i++)
+    {
+      GstElementFactory *factory = job->factories[i];
+
+      /* Ignore unranked plugins */
+      if (gst_plugin_feature_get_rank (GST_PLUGIN_FEATURE (factory)) ==
+          GST_RANK_NONE)
+        continue;
+
+      if (!job->filter (factory))
+        continue;
+
+      if (job->caps && !check_caps_compatibility (factory, job->caps,
+              &job->matched_caps[i]))
+        continue;
+
+      job->matches[i] = TRUE;
+    }
+  }
+}
+
+static void
+filter_pool_func (gpointer data, gpointer user_data)
+{
+  FilterJob *job = data;
+
+  filter_job_run (job);
+
+  /* The job lives on the caller's stack, so the static lock and cond are
+   * used to tell it we're done with it */
+  g_mutex_lock (&filter_mutex);
+  job->pending--;
+  g_cond_broadcast (&filter_cond);
+  g_mutex_unlock (&filter_mutex);
+}
+
+static gpointer
+filter_pool_new (gpointer data)
+{
+  return g_thread_pool_new (filter_pool_func, NULL, FILTER_THREADS - 1,
+      FALSE, NULL);
+}
+
+static void
+filter_factories (FilterJob *job)
+{
+  static GOnce pool_once = G_ONCE_INIT;
+  gint i;
+
+  filter_pool = g_once (&pool_once, filter_pool_new, NULL);
+
+  job->next = 0;
+  job->pending = 0;
+
+  if (filter_pool && job->num_factories > FILTER_CHUNK)
+  {
+    for (i = 0; i < FILTER_THREADS - 1; i++)
+    {
+      g_mutex_lock (&filter_mutex);
+      job->pending++;
+      g_mutex_unlock (&filter_mutex);
+
+      if (!g_thread_pool_push (filter_pool, job, NULL))
+      {
+        g_mutex_lock (&filter_mutex);
+        job->pending--;
+        g_mutex_unlock (&filter_mutex);
+        break;
+      }
+    }
+  }
+
+  /* The calling thread works too, so this completes even if all of the
+   * pool's threads are busy with another discovery */
+  filter_job_run (job);
+
+  g_mutex_lock (&filter_mutex);
+  while (job->pending > 0)
+    g_cond_wait (&filter_cond, &filter_mutex);
+  g_mutex_unlock (&filter_mutex);
+}
+
 static GList *
 get_plugins_filtered_from_caps (FilterFunc filter,
                                 GstCaps *caps,
@@ -1318,26 +1472,32 @@ get_plugins_filtered_from_caps (FilterFunc filter,
 {
   GList *walk, *result;
   GList *list = NULL;
-  GstCaps *matched_caps = NULL;
+  FilterJob job;
+  guint i;
 
   result = gst_registry_get_feature_list (gst_registry_get (),
           GST_TYPE_ELEMENT_FACTORY);
 
   result = g_list_sort (result, (GCompareFunc) compare_ranks);
 
-  for (walk = result; walk; walk = walk->next)
-  {
-    GstElementFactory *factory = GST_ELEMENT_FACTORY (walk->data);
+  job.filter = filter;
+  job.caps = caps;
+  job.num_factories = g_list_length (result);
+  job.factories = g_new (GstElementFactory *, job.num_factories);
+  job.matches = g_new0 (gboolean, job.num_factories);
+  job.matched_caps = g_new0 (GstCaps *, job.num_factories);
 
-    /* Ignore unranked plugins */
-    if (gst_plugin_feature_get_rank (GST_PLUGIN_FEATURE (factory)) ==
-        GST_RANK_NONE)
-      continue;
+  for (walk = result, i = 0; walk; walk = walk->next, i++)
+    job.factories[i] = GST_ELEMENT_FACTORY (walk->data);
 
-    if (!filter (factory))
-      continue;
+  filter_factories (&job);
+
+  for (i = 0; i < job.num_factories; i++)
+  {
+    GstElementFactory *factory = job.factories[i];
+    GstCaps *matched_caps = job.matched_caps[i];
 
-    if (caps && !check_caps_compatibility (factory, caps, &matched_caps))
+    if (!job.matches[i])
       continue;
 
     if (!matched_caps)
@@ -1346,7 +1506,7 @@ get_plugins_filtered_from_caps (FilterFunc filter,
     }
     else
     {
-      gint i;
+      guint j;
       GPtrArray *capslist = g_ptr_array_new_with_free_func (
         (GDestroyNotify) gst_caps_unref);
 
@@ -1356,10 +1516,10 @@ get_plugins_filtered_from_caps (FilterFunc filter,
           gst_caps_steal_structure (matched_caps, 0), NULL);
         gboolean got_match = FALSE;
 
-        for (i = 0; i < capslist->len; i++)
+        for (j = 0; j < capslist->len; j++)
         {
           GstCaps *intersect = gst_caps_intersect (stolencaps,
-              g_ptr_array_index (capslist, i));
+              g_ptr_array_index (capslist, j));
 
           if (gst_caps_is_empty (intersect))
           {
@@ -1368,8 +1528,8 @@ get_plugins_filtered_from_caps (FilterFunc filter,
           else
           {
             got_match = TRUE;
-            gst_caps_unref (g_ptr_array_index (capslist, i));
-            g_ptr_array_index (capslist, i) = intersect;
+            gst_caps_unref (g_ptr_array_index (capslist, j));
+            g_ptr_array_index (capslist, j) = intersect;
           }
         }
 
@@ -1381,13 +1541,16 @@ get_plugins_filtered_from_caps (FilterFunc filter,
       }
       gst_caps_unref (matched_caps);
 
-      for (i = 0; i < capslist->len; i++)
+      for (j = 0; j < capslist->len; j++)
         list = create_codec_cap_list (factory, direction, list,
-            g_ptr_array_index (capslist, i));
+            g_ptr_array_index (capslist, j));
       g_ptr_array_unref (capslist);
     }
   }
 
+  g_free (job.factories);
+  g_free (job.matches);
+  g_free (job.matched_caps);
   gst_plugin_feature_list_free (result);
 
   return list;
@@ -56,6 +56,8 @@ typedef struct _CodecBlueprint
 } CodecBlueprint;
 
 GList *fs_rtp_blueprints_get (FsMediaType media_type, GError **error);
+GList *fs_rtp_blueprints_get_uncached (FsMediaType media_type,
+    GError **error);
 void fs_rtp_blueprints_unref (FsMediaType media_type);
 
 gboolean codec_blueprint_has_factory (CodecBlueprint *blueprint,
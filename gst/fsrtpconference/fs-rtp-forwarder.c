@@ -0,0 +1,778 @@
+/*
+ * Farstream Voice+Video library
+ *
+ *  Copyright 2026 agent
+ *   @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The forwarder gets the received RTP packets of one remote participant,
+ * one sink pad per SSRC, and sends them on without depayloading them. It has
+ * one source pad per simulcast layer that is wanted by a receiver, each
+ * with its own SSRC, which forwards one of the inputs. The sequence numbers
+ * and timestamps are rewritten so they stay continuous when the forwarded
+ * input changes. The payload types and header extensions are kept as they
+ * are, the session only forwards what was negotiated for sending too.
+ *
+ * If the participant sends simulcast layers, the inputs are ranked by their
+ * bitrate and the source pad "src_N" forwards the Nth one, 0 being the one
+ * with the highest bitrate. The bitrates are measured over a second, so two
+ * inputs only trade places when the difference is clear, otherwise the
+ * forwarded layers would flap. A keyframe is requested from the new input
+ * when switching.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-forwarder.h"
+
+#include <stdio.h>
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+GST_DEBUG_CATEGORY_STATIC (fs_rtp_forwarder_debug);
+#define GST_CAT_DEFAULT fs_rtp_forwarder_debug
+
+/* Over how long the bitrate of the inputs is measured */
+#define BITRATE_WINDOW (GST_SECOND)
+
+/* How much higher the bitrate of an input must be to rank above another one,
+ * in percent */
+#define RANK_HYSTERESIS (50)
+
+static GstStaticPadTemplate fs_rtp_forwarder_sink_template =
+    GST_STATIC_PAD_TEMPLATE ("sink_%u",
+        GST_PAD_SINK,
+        GST_PAD_REQUEST,
+        GST_STATIC_CAPS ("application/x-rtp"));
+
+static GstStaticPadTemplate fs_rtp_forwarder_src_template =
+    GST_STATIC_PAD_TEMPLATE ("src_%u",
+        GST_PAD_SRC,
+        GST_PAD_REQUEST,
+        GST_STATIC_CAPS ("application/x-rtp"));
+
+struct _FsRtpForwarderInput
+{
+  GstPad *pad;
+
+  guint clock_rate;
+
+  /* Bitrate measurement */
+  guint64 window_bytes;
+  GstClockTime window_start;
+  GstClockTime last_seen;
+  guint bitrate;
+};
+
+struct _FsRtpForwarderOutput
+{
+  GstPad *pad;
+
+  guint layer;
+  guint32 ssrc;
+
+  FsRtpForwarderInput *active;
+
+  /* Mapping of the active input to the output */
+  gboolean synced;
+  guint32 input_ssrc;
+  guint16 seq_delta;
+  guint32 ts_delta;
+
+  /* The last packet that was pushed */
+  gboolean have_last;
+  guint16 last_seq;
+  guint32 last_ts;
+  GstClockTime last_time;
+};
+
+/* What to push on an output once the object lock is released */
+
+typedef struct
+{
+  GstPad *srcpad;
+  guint32 ssrc;
+  guint16 seq;
+  guint32 ts;
+  gboolean switched;
+} ForwarderPush;
+
+static void fs_rtp_forwarder_finalize (GObject *object);
+
+static GstPad *fs_rtp_forwarder_request_new_pad (GstElement *element,
+    GstPadTemplate *templ, const gchar *name, const GstCaps *caps);
+static void fs_rtp_forwarder_release_pad (GstElement *element, GstPad *pad);
+
+static GstFlowReturn fs_rtp_forwarder_chain (GstPad *pad, GstObject *parent,
+    GstBuffer *buffer);
+static gboolean fs_rtp_forwarder_sink_event (GstPad *pad, GstObject *parent,
+    GstEvent *event);
+static gboolean fs_rtp_forwarder_src_event (GstPad *pad, GstObject *parent,
+    GstEvent *event);
+static gboolean fs_rtp_forwarder_src_query (GstPad *pad, GstObject *parent,
+    GstQuery *query);
+
+
+G_DEFINE_TYPE (FsRtpForwarder, fs_rtp_forwarder, GST_TYPE_ELEMENT);
+
+static void
+fs_rtp_forwarder_class_init (FsRtpForwarderClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  gobject_class->finalize = fs_rtp_forwarder_finalize;
+
+  gstelement_class->request_new_pad = fs_rtp_forwarder_request_new_pad;
+  gstelement_class->release_pad = fs_rtp_forwarder_release_pad;
+
+  GST_DEBUG_CATEGORY_INIT
+      (fs_rtp_forwarder_debug, "fsrtpforwarder", 0,
+          "fsrtpforwarder element");
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Farstream RTP Forwarder",
+      "Generic",
+      "Forwards its input RTP streams under SSRCs of its own",
+      "agent <agent@local>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rtp_forwarder_sink_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rtp_forwarder_src_template));
+}
+
+static void
+fs_rtp_forwarder_init (FsRtpForwarder *self)
+{
+}
+
+static void
+fs_rtp_forwarder_finalize (GObject *object)
+{
+  FsRtpForwarder *self = FS_RTP_FORWARDER (object);
+
+  /* The inputs and outputs are freed when their pads are released */
+  g_list_free (self->inputs);
+  g_list_free (self->outputs);
+
+  G_OBJECT_CLASS (fs_rtp_forwarder_parent_class)->finalize (object);
+}
+
+static FsRtpForwarderOutput *
+fs_rtp_forwarder_get_output_locked (FsRtpForwarder *self, guint layer)
+{
+  GList *item;
+
+  for (item = self->outputs; item; item = g_list_next (item))
+  {
+    FsRtpForwarderOutput *output = item->data;
+
+    if (output->layer == layer)
+      return output;
+  }
+
+  return NULL;
+}
+
+/*
+ * The source pads are named after the layer they forward, "src_0" for the
+ * input with the highest bitrate
+ */
+
+static GstPad *
+fs_rtp_forwarder_request_src_pad (FsRtpForwarder *self, GstPadTemplate *templ,
+    const gchar *name)
+{
+  FsRtpForwarderOutput *output;
+  GstPad *pad;
+  gchar *padname;
+  guint layer = 0;
+
+  if (name && sscanf (name, "src_%u", &layer) != 1)
+  {
+    GST_WARNING_OBJECT (self, "Invalid source pad name %s", name);
+    return NULL;
+  }
+
+  GST_OBJECT_LOCK (self);
+  if (fs_rtp_forwarder_get_output_locked (self, layer))
+  {
+    GST_OBJECT_UNLOCK (self);
+    GST_WARNING_OBJECT (self, "There is already an output for layer %u",
+        layer);
+    return NULL;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  padname = g_strdup_printf ("src_%u", layer);
+  pad = gst_pad_new_from_template (templ, padname);
+  g_free (padname);
+
+  gst_pad_set_event_function (pad, fs_rtp_forwarder_src_event);
+  gst_pad_set_query_function (pad, fs_rtp_forwarder_src_query);
+  gst_pad_use_fixed_caps (pad);
+
+  output = g_slice_new0 (FsRtpForwarderOutput);
+  output->pad = pad;
+  output->layer = layer;
+  output->ssrc = g_random_int ();
+  output->last_time = GST_CLOCK_TIME_NONE;
+  gst_pad_set_element_private (pad, output);
+
+  GST_OBJECT_LOCK (self);
+  self->outputs = g_list_append (self->outputs, output);
+  GST_OBJECT_UNLOCK (self);
+
+  gst_pad_set_active (pad, TRUE);
+  gst_element_add_pad (GST_ELEMENT (self), pad);
+
+  return pad;
+}
+
+static GstPad *
+fs_rtp_forwarder_request_new_pad (GstElement *element, GstPadTemplate *templ,
+    const gchar *name, const GstCaps *caps)
+{
+  FsRtpForwarder *self = FS_RTP_FORWARDER (element);
+  FsRtpForwarderInput *input;
+  GstPad *pad;
+  gchar *padname;
+
+  if (GST_PAD_TEMPLATE_DIRECTION (templ) == GST_PAD_SRC)
+    return fs_rtp_forwarder_request_src_pad (self, templ, name);
+
+  GST_OBJECT_LOCK (self);
+  padname = g_strdup_printf ("sink_%u", self->sinkpad_count++);
+  GST_OBJECT_UNLOCK (self);
+
+  pad = gst_pad_new_from_template (templ, padname);
+  g_free (padname);
+
+  gst_pad_set_chain_function (pad, fs_rtp_forwarder_chain);
+  gst_pad_set_event_function (pad, fs_rtp_forwarder_sink_event);
+
+  input = g_slice_new0 (FsRtpForwarderInput);
+  input->pad = pad;
+  input->window_start = GST_CLOCK_TIME_NONE;
+  input->last_seen = GST_CLOCK_TIME_NONE;
+  gst_pad_set_element_private (pad, input);
+
+  GST_OBJECT_LOCK (self);
+  self->inputs = g_list_append (self->inputs, input);
+  self->reselect = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_pad_set_active (pad, TRUE);
+  gst_element_add_pad (element, pad);
+
+  return pad;
+}
+
+static void
+fs_rtp_forwarder_release_pad (GstElement *element, GstPad *pad)
+{
+  FsRtpForwarder *self = FS_RTP_FORWARDER (element);
+  GList *item;
+
+  GST_OBJECT_LOCK (self);
+  if (GST_PAD_IS_SRC (pad))
+  {
+    FsRtpForwarderOutput *output = gst_pad_get_element_private (pad);
+
+    self->outputs = g_list_remove (self->outputs, output);
+    gst_pad_set_element_private (pad, NULL);
+    GST_OBJECT_UNLOCK (self);
+
+    gst_pad_set_active (pad, FALSE);
+    gst_element_remove_pad (element, pad);
+
+    g_slice_free (FsRtpForwarderOutput, output);
+  }
+  else
+  {
+    FsRtpForwarderInput *input = gst_pad_get_element_private (pad);
+
+    self->inputs = g_list_remove (self->inputs, input);
+    for (item = self->outputs; item; item = g_list_next (item))
+    {
+      FsRtpForwarderOutput *output = item->data;
+
+      if (output->active == input)
+        output->active = NULL;
+    }
+    self->reselect = TRUE;
+    GST_OBJECT_UNLOCK (self);
+
+    gst_pad_set_element_private (pad, NULL);
+    gst_pad_set_active (pad, FALSE);
+    gst_element_remove_pad (element, pad);
+
+    g_slice_free (FsRtpForwarderInput, input);
+  }
+}
+
+static void
+fs_rtp_forwarder_update_bitrate_locked (FsRtpForwarder *self,
+    FsRtpForwarderInput *input, gsize size, GstClockTime now)
+{
+  input->last_seen = now;
+
+  if (!GST_CLOCK_TIME_IS_VALID (input->window_start))
+  {
+    input->window_start = now;
+    input->window_bytes = 0;
+  }
+
+  input->window_bytes += size;
+
+  if (now - input->window_start >= BITRATE_WINDOW)
+  {
+    input->bitrate = gst_util_uint64_scale (input->window_bytes * 8,
+        GST_SECOND, now - input->window_start);
+    input->window_start = now;
+    input->window_bytes = 0;
+    self->reselect = TRUE;
+  }
+}
+
+/* Inputs that stopped sending are ranked last */
+
+static guint64
+input_get_bitrate (FsRtpForwarderInput *input, GstClockTime now)
+{
+  if (!GST_CLOCK_TIME_IS_VALID (input->last_seen) ||
+      now - input->last_seen > 2 * BITRATE_WINDOW)
+    return 0;
+
+  return input->bitrate;
+}
+
+/*
+ * Inputs whose bitrates are too close are equal, the sort is stable so they
+ * keep their current ranks
+ */
+
+static gint
+compare_inputs (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  GstClockTime now = *(GstClockTime *) user_data;
+  guint64 bitrate_a = input_get_bitrate ((FsRtpForwarderInput *) a, now);
+  guint64 bitrate_b = input_get_bitrate ((FsRtpForwarderInput *) b, now);
+
+  if (bitrate_a * 100 > bitrate_b * (100 + RANK_HYSTERESIS))
+    return -1;
+  else if (bitrate_b * 100 > bitrate_a * (100 + RANK_HYSTERESIS))
+    return 1;
+  else
+    return 0;
+}
+
+/* Returns TRUE if the active input of @output changed */
+
+static gboolean
+fs_rtp_forwarder_select_input_locked (FsRtpForwarder *self,
+    FsRtpForwarderOutput *output)
+{
+  FsRtpForwarderInput *input;
+
+  if (!self->inputs)
+    return FALSE;
+
+  input = g_list_nth_data (self->inputs,
+      MIN (output->layer, g_list_length (self->inputs) - 1));
+
+  if (input == output->active)
+    return FALSE;
+
+  GST_DEBUG_OBJECT (self, "Forwarding %s:%s instead of %s:%s on %s:%s",
+      GST_DEBUG_PAD_NAME (input->pad),
+      GST_DEBUG_PAD_NAME (output->active ? output->active->pad : NULL),
+      GST_DEBUG_PAD_NAME (output->pad));
+
+  output->active = input;
+  output->synced = FALSE;
+
+  return TRUE;
+}
+
+/*
+ * Ranks the inputs again and gives every output the input of its layer,
+ * returns the list of the inputs that are newly forwarded
+ */
+
+static GList *
+fs_rtp_forwarder_reselect_locked (FsRtpForwarder *self, GstClockTime now)
+{
+  GList *new_inputs = NULL;
+  GList *item;
+
+  self->reselect = FALSE;
+  self->inputs = g_list_sort_with_data (self->inputs, compare_inputs, &now);
+
+  for (item = self->outputs; item; item = g_list_next (item))
+  {
+    FsRtpForwarderOutput *output = item->data;
+
+    if (fs_rtp_forwarder_select_input_locked (self, output) &&
+        !g_list_find (new_inputs, output->active))
+      new_inputs = g_list_prepend (new_inputs, output->active);
+  }
+
+  return new_inputs;
+}
+
+/* Maps the first packet after a switch right after the last one sent */
+
+static void
+fs_rtp_forwarder_sync_output_locked (FsRtpForwarderOutput *output,
+    guint32 ssrc, guint16 seq, guint32 ts, GstClockTime now)
+{
+  guint16 out_seq = seq;
+  guint32 out_ts = ts;
+
+  if (output->have_last)
+  {
+    out_seq = output->last_seq + 1;
+    out_ts = output->last_ts + 1;
+
+    if (output->active->clock_rate && now > output->last_time)
+      out_ts = output->last_ts + gst_util_uint64_scale (
+          now - output->last_time, output->active->clock_rate, GST_SECOND);
+  }
+
+  output->input_ssrc = ssrc;
+  output->seq_delta = out_seq - seq;
+  output->ts_delta = out_ts - ts;
+  output->synced = TRUE;
+}
+
+static GstEvent *
+strip_ssrc_from_caps_event (GstEvent *event)
+{
+  GstCaps *caps;
+  guint i;
+
+  gst_event_parse_caps (event, &caps);
+  caps = gst_caps_copy (caps);
+  for (i = 0; i < gst_caps_get_size (caps); i++)
+    gst_structure_remove_field (gst_caps_get_structure (caps, i), "ssrc");
+
+  event = gst_event_new_caps (caps);
+  gst_caps_unref (caps);
+
+  return event;
+}
+
+/* Sends the stream-start, caps and segment of the new input downstream */
+
+static void
+fs_rtp_forwarder_push_sticky_events (GstPad *srcpad, GstPad *pad)
+{
+  GstEvent *event;
+
+  event = gst_pad_get_sticky_event (srcpad, GST_EVENT_STREAM_START, 0);
+  if (event)
+    gst_event_unref (event);
+  else if ((event = gst_pad_get_sticky_event (pad, GST_EVENT_STREAM_START, 0)))
+    gst_pad_push_event (srcpad, event);
+
+  event = gst_pad_get_sticky_event (pad, GST_EVENT_CAPS, 0);
+  if (event)
+  {
+    gst_pad_push_event (srcpad, strip_ssrc_from_caps_event (event));
+    gst_event_unref (event);
+  }
+
+  event = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+  if (event)
+    gst_pad_push_event (srcpad, event);
+}
+
+static void
+request_keyunit (gpointer data, gpointer user_data)
+{
+  GstPad *pad = data;
+
+  gst_pad_push_event (pad,
+      gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+          gst_structure_new ("GstForceKeyUnit",
+              "all-headers", G_TYPE_BOOLEAN, TRUE,
+              NULL)));
+  gst_object_unref (pad);
+}
+
+static GstFlowReturn
+fs_rtp_forwarder_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  FsRtpForwarder *self = FS_RTP_FORWARDER (parent);
+  FsRtpForwarderInput *input = gst_pad_get_element_private (pad);
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GstClockTime now = g_get_monotonic_time () * GST_USECOND;
+  GList *keyunit_pads = NULL;
+  GArray *pushes;
+  GList *item;
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint32 ssrc;
+  guint16 seq;
+  guint32 ts;
+  guint i;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
+  {
+    GST_WARNING_OBJECT (self, "Dropping invalid RTP packet");
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
+  ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
+  seq = gst_rtp_buffer_get_seq (&rtpbuffer);
+  ts = gst_rtp_buffer_get_timestamp (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  pushes = g_array_new (FALSE, FALSE, sizeof (ForwarderPush));
+
+  GST_OBJECT_LOCK (self);
+  fs_rtp_forwarder_update_bitrate_locked (self, input,
+      gst_buffer_get_size (buffer), now);
+
+  if (self->reselect)
+    keyunit_pads = fs_rtp_forwarder_reselect_locked (self, now);
+
+  for (item = self->outputs; item; item = g_list_next (item))
+  {
+    FsRtpForwarderOutput *output = item->data;
+    ForwarderPush push;
+
+    if (!output->active && fs_rtp_forwarder_select_input_locked (self, output)
+        && !g_list_find (keyunit_pads, output->active))
+      keyunit_pads = g_list_prepend (keyunit_pads, output->active);
+
+    if (output->active != input)
+      continue;
+
+    push.switched = FALSE;
+    if (!output->synced || output->input_ssrc != ssrc)
+    {
+      fs_rtp_forwarder_sync_output_locked (output, ssrc, seq, ts, now);
+      push.switched = TRUE;
+    }
+
+    push.srcpad = gst_object_ref (output->pad);
+    push.ssrc = output->ssrc;
+    push.seq = seq + output->seq_delta;
+    push.ts = ts + output->ts_delta;
+
+    output->have_last = TRUE;
+    output->last_seq = push.seq;
+    output->last_ts = push.ts;
+    output->last_time = now;
+
+    g_array_append_val (pushes, push);
+  }
+
+  /* Hold the pads of the new inputs until the keyframe requests are sent */
+  for (item = keyunit_pads; item; item = g_list_next (item))
+    item->data = gst_object_ref (((FsRtpForwarderInput *) item->data)->pad);
+  GST_OBJECT_UNLOCK (self);
+
+  for (i = 0; i < pushes->len; i++)
+  {
+    ForwarderPush *push = &g_array_index (pushes, ForwarderPush, i);
+    GstBuffer *outbuf;
+    GstFlowReturn push_ret;
+
+    if (push->switched)
+      fs_rtp_forwarder_push_sticky_events (push->srcpad, pad);
+
+    /* Each output rewrites its own copy */
+    if (i < pushes->len - 1)
+    {
+      outbuf = gst_buffer_copy (buffer);
+    }
+    else
+    {
+      outbuf = gst_buffer_make_writable (buffer);
+      buffer = NULL;
+    }
+
+    if (gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtpbuffer))
+    {
+      gst_rtp_buffer_set_ssrc (&rtpbuffer, push->ssrc);
+      gst_rtp_buffer_set_seq (&rtpbuffer, push->seq);
+      gst_rtp_buffer_set_timestamp (&rtpbuffer, push->ts);
+      gst_rtp_buffer_unmap (&rtpbuffer);
+    }
+
+    push_ret = gst_pad_push (push->srcpad, outbuf);
+    gst_object_unref (push->srcpad);
+
+    /*
+     * An output that is not linked must not stop the others, but the
+     * upstream elements have to know about flushes and errors
+     */
+    if (push_ret != GST_FLOW_OK && push_ret != GST_FLOW_NOT_LINKED &&
+        (ret == GST_FLOW_OK || push_ret < ret))
+      ret = push_ret;
+  }
+  g_array_free (pushes, TRUE);
+
+  if (buffer)
+    gst_buffer_unref (buffer);
+
+  /* The receivers can not decode the new inputs until their next keyframe */
+  g_list_foreach (keyunit_pads, request_keyunit, NULL);
+  g_list_free (keyunit_pads);
+
+  return ret;
+}
+
+static gboolean
+fs_rtp_forwarder_sink_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  FsRtpForwarder *self = FS_RTP_FORWARDER (parent);
+  FsRtpForwarderInput *input = gst_pad_get_element_private (pad);
+  GList *srcpads = NULL;
+  GList *item;
+
+  GST_OBJECT_LOCK (self);
+  if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS)
+  {
+    GstCaps *caps;
+    GstStructure *s;
+    gint clock_rate;
+
+    gst_event_parse_caps (event, &caps);
+    s = gst_caps_get_structure (caps, 0);
+    if (gst_structure_get_int (s, "clock-rate", &clock_rate))
+      input->clock_rate = clock_rate;
+  }
+
+  for (item = self->outputs; item; item = g_list_next (item))
+  {
+    FsRtpForwarderOutput *output = item->data;
+
+    if (output->active == input && output->synced)
+      srcpads = g_list_prepend (srcpads, gst_object_ref (output->pad));
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  for (item = srcpads; item; item = g_list_next (item))
+  {
+    switch (GST_EVENT_TYPE (event))
+    {
+      case GST_EVENT_CAPS:
+        gst_pad_push_event (item->data, strip_ssrc_from_caps_event (event));
+        break;
+      case GST_EVENT_SEGMENT:
+        gst_pad_push_event (item->data, gst_event_ref (event));
+        break;
+      default:
+        /* EOS and flushes of one input must not reach the others */
+        break;
+    }
+  }
+  g_list_free_full (srcpads, gst_object_unref);
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static gboolean
+fs_rtp_forwarder_src_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  FsRtpForwarder *self = FS_RTP_FORWARDER (parent);
+  FsRtpForwarderOutput *output;
+  GstPad *active_pad = NULL;
+  gboolean ret;
+
+  /* Keyframe requests from the receivers go to the sender */
+  GST_OBJECT_LOCK (self);
+  output = gst_pad_get_element_private (pad);
+  if (output && output->active)
+    active_pad = gst_object_ref (output->active->pad);
+  GST_OBJECT_UNLOCK (self);
+
+  if (!active_pad)
+  {
+    gst_event_unref (event);
+    return FALSE;
+  }
+
+  ret = gst_pad_push_event (active_pad, event);
+  gst_object_unref (active_pad);
+
+  return ret;
+}
+
+static gboolean
+fs_rtp_forwarder_src_query (GstPad *pad, GstObject *parent, GstQuery *query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_CAPS)
+  {
+    GstCaps *filter, *caps;
+
+    gst_query_parse_caps (query, &filter);
+    caps = gst_pad_get_pad_template_caps (pad);
+    if (filter)
+    {
+      GstCaps *tmp = gst_caps_intersect_full (filter, caps,
+          GST_CAPS_INTERSECT_FIRST);
+      gst_caps_unref (caps);
+      caps = tmp;
+    }
+    gst_query_set_caps_result (query, caps);
+    gst_caps_unref (caps);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+GstElement *
+fs_rtp_forwarder_new (void)
+{
+  return g_object_new (FS_TYPE_RTP_FORWARDER, NULL);
+}
+
+/**
+ * fs_rtp_forwarder_get_output_ssrc:
+ * @self: a #FsRtpForwarder
+ * @layer: the layer forwarded
+ * @ssrc: location for the SSRC of the output
+ *
+ * Returns: %TRUE if the "src_@layer" pad was requested
+ */
+
+gboolean
+fs_rtp_forwarder_get_output_ssrc (FsRtpForwarder *self, guint layer,
+    guint32 *ssrc)
+{
+  FsRtpForwarderOutput *output;
+
+  GST_OBJECT_LOCK (self);
+  output = fs_rtp_forwarder_get_output_locked (self, layer);
+  if (output)
+    *ssrc = output->ssrc;
+  GST_OBJECT_UNLOCK (self);
+
+  return output != NULL;
+}
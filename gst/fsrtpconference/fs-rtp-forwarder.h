@@ -0,0 +1,79 @@
+/*
+ * Farstream Voice+Video library
+ *
+ *  Copyright 2026 agent
+ *   @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_FORWARDER_H__
+#define __FS_RTP_FORWARDER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* #define's don't like whitespacey bits */
+#define FS_TYPE_RTP_FORWARDER \
+  (fs_rtp_forwarder_get_type())
+#define FS_RTP_FORWARDER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+  FS_TYPE_RTP_FORWARDER,FsRtpForwarder))
+#define FS_RTP_FORWARDER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), \
+  FS_TYPE_RTP_FORWARDER,FsRtpForwarderClass))
+#define FS_IS_RTP_FORWARDER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),FS_TYPE_RTP_FORWARDER))
+#define FS_IS_RTP_FORWARDER_CLASS(obj) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),FS_TYPE_RTP_FORWARDER))
+
+typedef struct _FsRtpForwarder FsRtpForwarder;
+typedef struct _FsRtpForwarderClass FsRtpForwarderClass;
+typedef struct _FsRtpForwarderInput FsRtpForwarderInput;
+typedef struct _FsRtpForwarderOutput FsRtpForwarderOutput;
+
+struct _FsRtpForwarder
+{
+  GstElement parent;
+
+  /* Everything below is protected by the object lock */
+
+  /* List of FsRtpForwarderInput, one per sink pad, in the order they
+   * are ranked */
+  GList *inputs;
+  gboolean reselect;
+
+  /* List of FsRtpForwarderOutput, one per source pad */
+  GList *outputs;
+
+  guint sinkpad_count;
+};
+
+struct _FsRtpForwarderClass
+{
+  GstElementClass parent_class;
+};
+
+GType fs_rtp_forwarder_get_type (void);
+
+GstElement *fs_rtp_forwarder_new (void);
+
+gboolean fs_rtp_forwarder_get_output_ssrc (FsRtpForwarder *self, guint layer,
+    guint32 *ssrc);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_FORWARDER_H__ */
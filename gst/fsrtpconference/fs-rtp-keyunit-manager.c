@@ -32,11 +32,29 @@
 
 #include <gst/rtp/gstrtcpbuffer.h>
 
+#include "fs-rtp-conference.h"
+#include "fs-rtp-simulcast.h"
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+
 /* Remove this line as soon as the types are merged
  * in gst-plugins-base
  */
 #define GST_RTCP_PSFB_TYPE_FIR 4
 
+/* The rtpbin requests the keyunit for a FIR synchronously after emitting
+ * the feedback signal, a request from the same thread after this long is
+ * not for the same FIR */
+#define DUPLICATE_WINDOW (100 * GST_MSECOND)
+
+/*
+ * The keyunit manager sits on the pad where the keyunit requests from the
+ * rtpbin go upstream to the encoders. It lets one request through per
+ * minimum interval; the ones that come in between are merged into a single
+ * request sent at the end of the interval, so that many receivers asking
+ * at once only cost one keyframe. Retransmitted FIRs (same sequence number
+ * from the same sender) are dropped.
+ */
 
 struct _FsRtpKeyunitManagerClass
 {
@@ -48,15 +66,50 @@ struct _FsRtpKeyunitManager
   GstObject parent;
 
   GObject *rtpbin_internal_session;
+  gulong rtcp_feedback_id;
 
+  /* Everything below is protected by the object lock */
+
+  /* Only until the periodic keyframes have been disabled */
   GstElement *codecbin;
-  gulong rtcp_feedback_id;
+
+  /* The requests for these are also ours, the main SSRC is not included */
+  guint32 layer_ssrcs[FS_RTP_SIMULCAST_MAX_LAYERS];
+  guint n_layer_ssrcs;
+
+  GstPad *pad;
+  gulong probe_id;
+
+  GstClock *system_clock;
+  GstClockID clockid;
+  GstClockTime min_interval;
+  GstClockTime last_keyunit;
+
+  /* The request that is sent at the end of the interval */
+  gboolean pending_all_headers;
+  GstEvent *coalesced_event;
+
+  /* sender ssrc -> FIR sequence number + 1 */
+  GHashTable *fir_seqnums;
+  /* The thread that is about to request a keyunit for a retransmitted FIR,
+   * it is reset by every feedback packet and only valid for a short while
+   * as the rtpbin may not request anything */
+  GThread *duplicate_thread;
+  GstClockTime duplicate_time;
+
+  guint requests_received;
+  guint keyunits_forced;
 };
 
 
 G_DEFINE_TYPE (FsRtpKeyunitManager, fs_rtp_keyunit_manager, GST_TYPE_OBJECT);
 
 static void fs_rtp_keyunit_manager_dispose (GObject *obj);
+static void fs_rtp_keyunit_manager_finalize (GObject *obj);
+
+static void on_feedback_rtcp (GObject *rtpsession, GstRTCPType type,
+    GstRTCPFBType fbtype, guint sender_ssrc, guint media_ssrc, GstBuffer *fci,
+    gpointer user_data);
 
 static void
 fs_rtp_keyunit_manager_class_init (FsRtpKeyunitManagerClass *klass)
@@ -64,11 +117,17 @@ fs_rtp_keyunit_manager_class_init (FsRtpKeyunitManagerClass *klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
   gobject_class->dispose = fs_rtp_keyunit_manager_dispose;
+  gobject_class->finalize = fs_rtp_keyunit_manager_finalize;
 }
 
 static void
 fs_rtp_keyunit_manager_init (FsRtpKeyunitManager *self)
 {
+  self->system_clock = gst_system_clock_obtain ();
+  self->min_interval =
+      FS_RTP_KEYUNIT_MANAGER_DEFAULT_MIN_INTERVAL * GST_MSECOND;
+  self->last_keyunit = GST_CLOCK_TIME_NONE;
+  self->fir_seqnums = g_hash_table_new (g_direct_hash, g_direct_equal);
 }
 
 static void
@@ -91,21 +150,212 @@ fs_rtp_keyunit_manager_dispose (GObject *obj)
     g_object_unref (self->codecbin);
   self->codecbin = NULL;
 
+  if (self->pad)
+  {
+    if (self->probe_id)
+      gst_pad_remove_probe (self->pad, self->probe_id);
+    self->probe_id = 0;
+    gst_object_unref (self->pad);
+  }
+  self->pad = NULL;
+
+  if (self->clockid)
+  {
+    gst_clock_id_unschedule (self->clockid);
+    gst_clock_id_unref (self->clockid);
+  }
+  self->clockid = NULL;
+
   GST_OBJECT_UNLOCK (self);
 
   G_OBJECT_CLASS (fs_rtp_keyunit_manager_parent_class)->dispose (obj);
 }
 
+static void
+fs_rtp_keyunit_manager_finalize (GObject *obj)
+{
+  FsRtpKeyunitManager *self = FS_RTP_KEYUNIT_MANAGER (obj);
+
+  g_hash_table_destroy (self->fir_seqnums);
+  gst_object_unref (self->system_clock);
+
+  G_OBJECT_CLASS (fs_rtp_keyunit_manager_parent_class)->finalize (obj);
+}
+
+static gboolean
+coalesced_keyunit_cb (GstClock *clock, GstClockTime time, GstClockID clockid,
+    gpointer user_data)
+{
+  FsRtpKeyunitManager *self = FS_RTP_KEYUNIT_MANAGER (user_data);
+  GstEvent *event;
+  GstPad *pad;
+
+  GST_OBJECT_LOCK (self);
+  if (self->clockid != clockid || !self->pad)
+  {
+    GST_OBJECT_UNLOCK (self);
+    return TRUE;
+  }
+  gst_clock_id_unref (self->clockid);
+  self->clockid = NULL;
+
+  event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+      gst_structure_new ("GstForceKeyUnit",
+          "all-headers", G_TYPE_BOOLEAN, self->pending_all_headers,
+          NULL));
+  self->pending_all_headers = FALSE;
+  self->coalesced_event = event;
+  pad = gst_object_ref (self->pad);
+  GST_OBJECT_UNLOCK (self);
+
+  GST_DEBUG ("Sending the coalesced keyunit request");
+  gst_pad_push_event (pad, event);
+  gst_object_unref (pad);
+
+  /* In case it never reached the probe */
+  GST_OBJECT_LOCK (self);
+  if (self->coalesced_event == event)
+    self->coalesced_event = NULL;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+keyunit_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  FsRtpKeyunitManager *self = FS_RTP_KEYUNIT_MANAGER (user_data);
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+  GstClockTime now;
+  gboolean all_headers = FALSE;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_CUSTOM_UPSTREAM ||
+      !gst_event_has_name (event, "GstForceKeyUnit"))
+    return GST_PAD_PROBE_OK;
+
+  now = gst_clock_get_time (self->system_clock);
+
+  GST_OBJECT_LOCK (self);
+
+  if (event == self->coalesced_event)
+  {
+    self->coalesced_event = NULL;
+    goto forward;
+  }
+
+  if (self->duplicate_thread == g_thread_self ())
+  {
+    self->duplicate_thread = NULL;
+    if (now < self->duplicate_time + DUPLICATE_WINDOW)
+    {
+      GST_OBJECT_UNLOCK (self);
+      GST_DEBUG ("Dropping the keyunit request of a retransmitted FIR");
+      return GST_PAD_PROBE_DROP;
+    }
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (self->last_keyunit) &&
+      now < self->last_keyunit + self->min_interval)
+  {
+    gst_structure_get_boolean (gst_event_get_structure (event), "all-headers",
+        &all_headers);
+    self->pending_all_headers |= all_headers;
+
+    if (!self->clockid)
+    {
+      GST_DEBUG ("Keyunit requested %" GST_TIME_FORMAT " after the last one,"
+          " coalescing", GST_TIME_ARGS (now - self->last_keyunit));
+      self->clockid = gst_clock_new_single_shot_id (self->system_clock,
+          self->last_keyunit + self->min_interval);
+      gst_clock_id_wait_async (self->clockid, coalesced_keyunit_cb,
+          gst_object_ref (self), gst_object_unref);
+    }
+    GST_OBJECT_UNLOCK (self);
+    return GST_PAD_PROBE_DROP;
+  }
+
+ forward:
+  /* This one also answers any request waiting for the end of the interval */
+  if (self->clockid)
+  {
+    gst_clock_id_unschedule (self->clockid);
+    gst_clock_id_unref (self->clockid);
+    self->clockid = NULL;
+  }
+  self->pending_all_headers = FALSE;
+  self->last_keyunit = now;
+  self->keyunits_forced++;
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_PAD_PROBE_OK;
+}
+
 FsRtpKeyunitManager *
-fs_rtp_keyunit_manager_new (GObject *rtpbin_internal_session)
+fs_rtp_keyunit_manager_new (GObject *rtpbin_internal_session, GstPad *pad)
 {
   FsRtpKeyunitManager *self =  g_object_new (FS_TYPE_RTP_KEYUNIT_MANAGER, NULL);
 
   self->rtpbin_internal_session = g_object_ref (rtpbin_internal_session);
+  self->pad = gst_object_ref (pad);
+  self->probe_id = gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_UPSTREAM,
+      keyunit_probe, self, NULL);
+  self->rtcp_feedback_id = g_signal_connect_object (
+      self->rtpbin_internal_session, "on-feedback-rtcp",
+      G_CALLBACK (on_feedback_rtcp), self, 0);
 
   return self;
 }
 
+/**
+ * fs_rtp_keyunit_manager_set_min_interval:
+ * @self: a #FsRtpKeyunitManager
+ * @min_interval: the minimum time between two keyunit requests, in ms
+ *
+ * 0 lets every request through
+ */
+
+void
+fs_rtp_keyunit_manager_set_min_interval (FsRtpKeyunitManager *self,
+    guint min_interval)
+{
+  GST_OBJECT_LOCK (self);
+  self->min_interval = min_interval * GST_MSECOND;
+  GST_OBJECT_UNLOCK (self);
+}
+
+guint
+fs_rtp_keyunit_manager_get_min_interval (FsRtpKeyunitManager *self)
+{
+  guint min_interval;
+
+  GST_OBJECT_LOCK (self);
+  min_interval = self->min_interval / GST_MSECOND;
+  GST_OBJECT_UNLOCK (self);
+
+  return min_interval;
+}
+
+/**
+ * fs_rtp_keyunit_manager_get_stats:
+ * @self: a #FsRtpKeyunitManager
+ * @requests_received: location for the number of PLIs and FIRs received
+ *  for our SSRC
+ * @keyunits_forced: location for the number of keyunit requests sent to
+ *  the encoders
+ */
+
+void
+fs_rtp_keyunit_manager_get_stats (FsRtpKeyunitManager *self,
+    guint *requests_received, guint *keyunits_forced)
+{
+  GST_OBJECT_LOCK (self);
+  if (requests_received)
+    *requests_received = self->requests_received;
+  if (keyunits_forced)
+    *keyunits_forced = self->keyunits_forced;
+  GST_OBJECT_UNLOCK (self);
+}
+
 struct ElementProperty {
   gchar *element;
   gchar *property;
@@ -158,6 +408,43 @@ fs_rtp_keyunit_manager_disable_keyframes (GstElement *codecbin)
   g_object_unref (codecbin);
 }
 
+/**
+ * fs_rtp_keyunit_manager_set_layer_ssrcs:
+ * @self: a #FsRtpKeyunitManager
+ * @ssrcs: the SSRCs of the simulcast layers
+ * @n_ssrcs: the number of SSRCs in @ssrcs
+ *
+ * The keyunit requests for these SSRCs are handled like the ones for the
+ * SSRC of the main encoding.
+ */
+
+void
+fs_rtp_keyunit_manager_set_layer_ssrcs (FsRtpKeyunitManager *self,
+    const guint32 *ssrcs, guint n_ssrcs)
+{
+  g_return_if_fail (n_ssrcs <= FS_RTP_SIMULCAST_MAX_LAYERS);
+
+  GST_OBJECT_LOCK (self);
+  memcpy (self->layer_ssrcs, ssrcs, n_ssrcs * sizeof (guint32));
+  self->n_layer_ssrcs = n_ssrcs;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static gboolean
+fs_rtp_keyunit_manager_is_local_ssrc (FsRtpKeyunitManager *self,
+    guint32 local_ssrc, guint32 ssrc)
+{
+  gboolean local = (ssrc == local_ssrc);
+  guint i;
+
+  GST_OBJECT_LOCK (self);
+  for (i = 0; !local && i < self->n_layer_ssrcs; i++)
+    local = (ssrc == self->layer_ssrcs[i]);
+  GST_OBJECT_UNLOCK (self);
+
+  return local;
+}
+
 static void
 on_feedback_rtcp (GObject *rtpsession, GstRTCPType type, GstRTCPFBType fbtype,
     guint sender_ssrc, guint media_ssrc, GstBuffer *fci, gpointer user_data)
@@ -165,6 +452,14 @@ on_feedback_rtcp (GObject *rtpsession, GstRTCPType type, GstRTCPFBType fbtype,
   FsRtpKeyunitManager *self = FS_RTP_KEYUNIT_MANAGER (user_data);
   guint32 local_ssrc;
   GstElement *codecbin;
+  gboolean duplicate = FALSE;
+
+  /* Whatever this packet is, the keyunit the rtpbin may have skipped for
+   * the previous one is not coming anymore */
+  GST_OBJECT_LOCK (self);
+  if (self->duplicate_thread == g_thread_self ())
+    self->duplicate_thread = NULL;
+  GST_OBJECT_UNLOCK (self);
 
   if (type != GST_RTCP_TYPE_PSFB)
     return;
@@ -174,32 +469,42 @@ on_feedback_rtcp (GObject *rtpsession, GstRTCPType type, GstRTCPFBType fbtype,
   /* Let's check if the PLI or FIR is for us */
   if (fbtype == GST_RTCP_PSFB_TYPE_PLI)
   {
-    if (media_ssrc != local_ssrc)
+    if (!fs_rtp_keyunit_manager_is_local_ssrc (self, local_ssrc, media_ssrc))
       return;
   }
   else if (fbtype == GST_RTCP_PSFB_TYPE_FIR)
   {
     guint position = 0;
     gboolean our_request = FALSE;
+    guint8 seqnum = 0;
     GstMapInfo mapinfo;
 
     if (!gst_buffer_map (fci, &mapinfo, GST_MAP_READ))
       return;
 
-    for (position = 0; position < mapinfo.size ; position += 8) {
+    for (position = 0; position + 8 <= mapinfo.size ; position += 8) {
       guint8 *data = mapinfo.data + position;
       guint32 ssrc;
 
       ssrc = GST_READ_UINT32_BE (data);
 
-      if (ssrc == local_ssrc) {
+      if (fs_rtp_keyunit_manager_is_local_ssrc (self, local_ssrc, ssrc)) {
         our_request = TRUE;
+        seqnum = data[4];
         break;
       }
     }
     gst_buffer_unmap (fci, &mapinfo);
     if (!our_request)
       return;
+
+    GST_OBJECT_LOCK (self);
+    duplicate = (GPOINTER_TO_UINT (g_hash_table_lookup (self->fir_seqnums,
+                GUINT_TO_POINTER (sender_ssrc))) == seqnum + 1);
+    if (!duplicate)
+      g_hash_table_insert (self->fir_seqnums, GUINT_TO_POINTER (sender_ssrc),
+          GUINT_TO_POINTER (seqnum + 1));
+    GST_OBJECT_UNLOCK (self);
   }
   else
   {
@@ -207,12 +512,16 @@ on_feedback_rtcp (GObject *rtpsession, GstRTCPType type, GstRTCPFBType fbtype,
   }
 
   GST_OBJECT_LOCK (self);
+  self->requests_received++;
+  /* The rtpbin requests the keyunit right after emitting the signal, from
+   * this thread */
+  if (duplicate)
+  {
+    self->duplicate_thread = g_thread_self ();
+    self->duplicate_time = gst_clock_get_time (self->system_clock);
+  }
   codecbin = self->codecbin;
   self->codecbin = NULL;
-  if (self->rtcp_feedback_id)
-    g_signal_handler_disconnect (self->rtpbin_internal_session,
-        self->rtcp_feedback_id);
-  self->rtcp_feedback_id = 0;
   GST_OBJECT_UNLOCK (self);
 
   if (!codecbin)
@@ -237,21 +546,9 @@ fs_rtp_keyunit_manager_codecbin_changed (FsRtpKeyunitManager *self,
     g_object_unref (self->codecbin);
   self->codecbin = NULL;
 
+  /* The periodic keyframes are disabled on the first request */
   if (fs_rtp_keyunit_manager_has_key_request_feedback (send_codec))
-  {
     self->codecbin = g_object_ref (codecbin);
-    if (!self->rtcp_feedback_id)
-      self->rtcp_feedback_id = g_signal_connect_object (
-        self->rtpbin_internal_session, "on-feedback-rtcp",
-        G_CALLBACK (on_feedback_rtcp), self, 0);
-  }
-  else
-  {
-    if (self->rtcp_feedback_id)
-      g_signal_handler_disconnect (self->rtpbin_internal_session,
-          self->rtcp_feedback_id);
-    self->rtcp_feedback_id = 0;
-  }
 
   GST_OBJECT_UNLOCK (self);
 }
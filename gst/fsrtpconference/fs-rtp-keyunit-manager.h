@@ -53,15 +53,28 @@ typedef struct _FsRtpKeyunitManager FsRtpKeyunitManager;
 typedef struct _FsRtpKeyunitManagerClass FsRtpKeyunitManagerClass;
 typedef struct _FsRtpKeyunitManagerPrivate FsRtpKeyunitManagerPrivate;
 
+/* In milliseconds */
+#define FS_RTP_KEYUNIT_MANAGER_DEFAULT_MIN_INTERVAL (500)
+
 GType fs_rtp_keyunit_manager_get_type (void);
 
 FsRtpKeyunitManager *fs_rtp_keyunit_manager_new (
-  GObject *rtpbin_internal_session);
+  GObject *rtpbin_internal_session, GstPad *pad);
+
+void fs_rtp_keyunit_manager_set_min_interval (FsRtpKeyunitManager *self,
+    guint min_interval);
+guint fs_rtp_keyunit_manager_get_min_interval (FsRtpKeyunitManager *self);
+
+void fs_rtp_keyunit_manager_get_stats (FsRtpKeyunitManager *self,
+    guint *requests_received, guint *keyunits_forced);
 
 
 void fs_rtp_keyunit_manager_codecbin_changed (FsRtpKeyunitManager *self,
     GstElement *codecbin, FsCodec *send_codec);
 
+void fs_rtp_keyunit_manager_set_layer_ssrcs (FsRtpKeyunitManager *self,
+    const guint32 *ssrcs, guint n_ssrcs);
+
 gboolean fs_rtp_keyunit_manager_has_key_request_feedback (FsCodec *send_codec);
 
 G_END_DECLS
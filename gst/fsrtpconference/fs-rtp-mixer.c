@@ -0,0 +1,751 @@
+/*
+ * Farstream Voice+Video library
+ *
+ *  Copyright 2026 agent
+ *   @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The mixer gets the decoded audio of all the remote participants and
+ * produces one output per participant, with everyone except that
+ * participant. Each pad belongs to a group, which is the participant, and
+ * an output has the mix of all the inputs of the other groups.
+ *
+ * All the inputs are summed once, and the outputs whose group has an input
+ * that is currently playing get that input subtracted from the sum. The
+ * others all share the same buffer. So the cost depends on how many inputs
+ * are playing, not on the number of outputs.
+ *
+ * It is a live source that produces a frame every 20ms from its own
+ * thread, with whatever the inputs have queued. Inputs that have nothing
+ * queued are silent.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-mixer.h"
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY_STATIC (fs_rtp_mixer_debug);
+#define GST_CAT_DEFAULT fs_rtp_mixer_debug
+
+#define FRAME_DURATION (20 * GST_MSECOND)
+#define FRAME_SAMPLES (FS_RTP_MIXER_RATE / 50)
+
+/* An input starts playing once it has that much queued */
+#define PREBUFFER_SAMPLES (2 * FRAME_SAMPLES)
+
+/* Older samples are dropped if more than that is queued */
+#define MAX_QUEUED_SAMPLES (FS_RTP_MIXER_RATE / 5)
+
+/* If the mixer is late by more than that, it skips ahead */
+#define MAX_LATENESS (5 * FRAME_DURATION)
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define MIXER_FORMAT "S16LE"
+#else
+#define MIXER_FORMAT "S16BE"
+#endif
+
+/* The rate is FS_RTP_MIXER_RATE */
+#define MIXER_CAPS \
+  "audio/x-raw, format=(string)" MIXER_FORMAT ", layout=(string)interleaved,"\
+  " rate=(int)48000, channels=(int)1"
+
+static GstStaticPadTemplate fs_rtp_mixer_sink_template =
+    GST_STATIC_PAD_TEMPLATE ("sink_%u",
+        GST_PAD_SINK,
+        GST_PAD_REQUEST,
+        GST_STATIC_CAPS (MIXER_CAPS));
+
+static GstStaticPadTemplate fs_rtp_mixer_src_template =
+    GST_STATIC_PAD_TEMPLATE ("src_%u",
+        GST_PAD_SRC,
+        GST_PAD_REQUEST,
+        GST_STATIC_CAPS (MIXER_CAPS));
+
+typedef struct
+{
+  GstPad *pad;
+  guint group;
+
+  /* Queued samples */
+  gint16 *ring;
+  guint ring_start;
+  guint ring_len;
+  gboolean started;
+
+  /* The current frame, only valid if active */
+  gint16 *frame;
+  gboolean active;
+} FsRtpMixerInput;
+
+typedef struct
+{
+  GstPad *pad;
+  guint group;
+
+  gboolean need_events;
+} FsRtpMixerOutput;
+
+typedef struct
+{
+  GstPad *pad;
+  GstBuffer *buffer;
+  gboolean need_events;
+} FsRtpMixerPush;
+
+static void fs_rtp_mixer_finalize (GObject *object);
+
+static GstStateChangeReturn fs_rtp_mixer_change_state (GstElement *element,
+    GstStateChange transition);
+static GstPad *fs_rtp_mixer_request_new_pad (GstElement *element,
+    GstPadTemplate *templ, const gchar *name, const GstCaps *caps);
+static void fs_rtp_mixer_release_pad (GstElement *element, GstPad *pad);
+
+static GstFlowReturn fs_rtp_mixer_chain (GstPad *pad, GstObject *parent,
+    GstBuffer *buffer);
+static gboolean fs_rtp_mixer_sink_event (GstPad *pad, GstObject *parent,
+    GstEvent *event);
+static gboolean fs_rtp_mixer_src_event (GstPad *pad, GstObject *parent,
+    GstEvent *event);
+static gboolean fs_rtp_mixer_src_query (GstPad *pad, GstObject *parent,
+    GstQuery *query);
+
+static void fs_rtp_mixer_loop (gpointer user_data);
+
+
+G_DEFINE_TYPE (FsRtpMixer, fs_rtp_mixer, GST_TYPE_ELEMENT);
+
+static void
+fs_rtp_mixer_class_init (FsRtpMixerClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  gobject_class->finalize = fs_rtp_mixer_finalize;
+
+  gstelement_class->change_state = fs_rtp_mixer_change_state;
+  gstelement_class->request_new_pad = fs_rtp_mixer_request_new_pad;
+  gstelement_class->release_pad = fs_rtp_mixer_release_pad;
+
+  GST_DEBUG_CATEGORY_INIT
+      (fs_rtp_mixer_debug, "fsrtpmixer", 0,
+          "fsrtpmixer element");
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Farstream RTP Mixer",
+      "Generic/Audio",
+      "Mixes the audio of all the participants but one for each participant",
+      "agent <agent@local>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rtp_mixer_sink_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rtp_mixer_src_template));
+}
+
+static void
+fs_rtp_mixer_init (FsRtpMixer *self)
+{
+  g_rec_mutex_init (&self->task_lock);
+  self->task = gst_task_new (fs_rtp_mixer_loop, self, NULL);
+  gst_task_set_lock (self->task, &self->task_lock);
+
+  self->mix = g_new0 (gint32, FRAME_SAMPLES);
+  self->flushing = TRUE;
+
+  GST_OBJECT_FLAG_SET (self, GST_ELEMENT_FLAG_SOURCE);
+}
+
+static void
+fs_rtp_mixer_finalize (GObject *object)
+{
+  FsRtpMixer *self = FS_RTP_MIXER (object);
+
+  gst_object_unref (self->task);
+  g_rec_mutex_clear (&self->task_lock);
+
+  /* The inputs and outputs are freed when their pads are released */
+  g_list_free (self->inputs);
+  g_list_free (self->outputs);
+
+  g_free (self->mix);
+
+  G_OBJECT_CLASS (fs_rtp_mixer_parent_class)->finalize (object);
+}
+
+GstElement *
+fs_rtp_mixer_new (void)
+{
+  return g_object_new (FS_TYPE_RTP_MIXER, NULL);
+}
+
+static GstPad *
+fs_rtp_mixer_request_new_pad (GstElement *element, GstPadTemplate *templ,
+    const gchar *name, const GstCaps *caps)
+{
+  FsRtpMixer *self = FS_RTP_MIXER (element);
+  gboolean is_sink = (GST_PAD_TEMPLATE_DIRECTION (templ) == GST_PAD_SINK);
+  GstPad *pad;
+  gchar *padname;
+
+  GST_OBJECT_LOCK (self);
+  padname = g_strdup_printf (is_sink ? "sink_%u" : "src_%u",
+      self->pad_count++);
+  GST_OBJECT_UNLOCK (self);
+
+  pad = gst_pad_new_from_template (templ, padname);
+  g_free (padname);
+
+  if (is_sink)
+  {
+    FsRtpMixerInput *input = g_slice_new0 (FsRtpMixerInput);
+
+    gst_pad_set_chain_function (pad, fs_rtp_mixer_chain);
+    gst_pad_set_event_function (pad, fs_rtp_mixer_sink_event);
+
+    input->pad = pad;
+    input->ring = g_new0 (gint16, MAX_QUEUED_SAMPLES);
+    input->frame = g_new0 (gint16, FRAME_SAMPLES);
+    gst_pad_set_element_private (pad, input);
+
+    GST_OBJECT_LOCK (self);
+    self->inputs = g_list_append (self->inputs, input);
+    GST_OBJECT_UNLOCK (self);
+  }
+  else
+  {
+    FsRtpMixerOutput *output = g_slice_new0 (FsRtpMixerOutput);
+
+    gst_pad_set_event_function (pad, fs_rtp_mixer_src_event);
+    gst_pad_set_query_function (pad, fs_rtp_mixer_src_query);
+    gst_pad_use_fixed_caps (pad);
+
+    output->pad = pad;
+    output->need_events = TRUE;
+    gst_pad_set_element_private (pad, output);
+
+    GST_OBJECT_LOCK (self);
+    self->outputs = g_list_append (self->outputs, output);
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  gst_pad_set_active (pad, TRUE);
+  gst_element_add_pad (element, pad);
+
+  return pad;
+}
+
+static void
+fs_rtp_mixer_release_pad (GstElement *element, GstPad *pad)
+{
+  FsRtpMixer *self = FS_RTP_MIXER (element);
+  gpointer priv = gst_pad_get_element_private (pad);
+
+  GST_OBJECT_LOCK (self);
+  if (GST_PAD_DIRECTION (pad) == GST_PAD_SINK)
+    self->inputs = g_list_remove (self->inputs, priv);
+  else
+    self->outputs = g_list_remove (self->outputs, priv);
+  gst_pad_set_element_private (pad, NULL);
+  GST_OBJECT_UNLOCK (self);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+
+  if (GST_PAD_DIRECTION (pad) == GST_PAD_SINK)
+  {
+    FsRtpMixerInput *input = priv;
+
+    g_free (input->ring);
+    g_free (input->frame);
+    g_slice_free (FsRtpMixerInput, input);
+  }
+  else
+  {
+    g_slice_free (FsRtpMixerOutput, priv);
+  }
+}
+
+/**
+ * fs_rtp_mixer_get_pad:
+ * @mixer: a #FsRtpMixer
+ * @direction: %GST_PAD_SINK for an input, %GST_PAD_SRC for an output
+ * @group: The group of the new pad
+ *
+ * Requests a new pad, an output gets the mix of the inputs of all the
+ * other groups.
+ *
+ * Returns: the new pad, release it with gst_element_release_request_pad()
+ */
+
+GstPad *
+fs_rtp_mixer_get_pad (GstElement *mixer, GstPadDirection direction,
+    guint group)
+{
+  FsRtpMixer *self = FS_RTP_MIXER (mixer);
+  GstPad *pad;
+
+  pad = gst_element_get_request_pad (mixer,
+      direction == GST_PAD_SINK ? "sink_%u" : "src_%u");
+  if (!pad)
+    return NULL;
+
+  GST_OBJECT_LOCK (self);
+  if (direction == GST_PAD_SINK)
+    ((FsRtpMixerInput *) gst_pad_get_element_private (pad))->group = group;
+  else
+    ((FsRtpMixerOutput *) gst_pad_get_element_private (pad))->group = group;
+  GST_OBJECT_UNLOCK (self);
+
+  return pad;
+}
+
+static void
+fs_rtp_mixer_input_clear (FsRtpMixerInput *input)
+{
+  input->ring_start = 0;
+  input->ring_len = 0;
+  input->started = FALSE;
+  input->active = FALSE;
+}
+
+static GstFlowReturn
+fs_rtp_mixer_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  FsRtpMixer *self = FS_RTP_MIXER (parent);
+  FsRtpMixerInput *input;
+  GstMapInfo map;
+  const gint16 *samples;
+  guint n_samples;
+  guint i;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+  {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
+  samples = (const gint16 *) map.data;
+  n_samples = map.size / sizeof (gint16);
+
+  GST_OBJECT_LOCK (self);
+  input = gst_pad_get_element_private (pad);
+  if (input)
+  {
+    for (i = 0; i < n_samples; i++)
+    {
+      input->ring[(input->ring_start + input->ring_len) % MAX_QUEUED_SAMPLES] =
+          samples[i];
+
+      if (input->ring_len < MAX_QUEUED_SAMPLES)
+        input->ring_len++;
+      else
+        input->ring_start = (input->ring_start + 1) % MAX_QUEUED_SAMPLES;
+    }
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+/* The mixer makes its own stream, so the input events stop here */
+
+static gboolean
+fs_rtp_mixer_sink_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  FsRtpMixer *self = FS_RTP_MIXER (parent);
+  gboolean ret = TRUE;
+
+  switch (GST_EVENT_TYPE (event))
+  {
+    case GST_EVENT_CAPS:
+      {
+        GstCaps *caps;
+        GstCaps *template_caps = gst_pad_get_pad_template_caps (pad);
+
+        gst_event_parse_caps (event, &caps);
+        ret = gst_caps_is_subset (caps, template_caps);
+        gst_caps_unref (template_caps);
+      }
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      {
+        FsRtpMixerInput *input;
+
+        GST_OBJECT_LOCK (self);
+        input = gst_pad_get_element_private (pad);
+        if (input)
+          fs_rtp_mixer_input_clear (input);
+        GST_OBJECT_UNLOCK (self);
+      }
+      break;
+    default:
+      break;
+  }
+
+  gst_event_unref (event);
+
+  return ret;
+}
+
+static gboolean
+fs_rtp_mixer_src_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  gst_event_unref (event);
+
+  return FALSE;
+}
+
+static gboolean
+fs_rtp_mixer_src_query (GstPad *pad, GstObject *parent, GstQuery *query)
+{
+  switch (GST_QUERY_TYPE (query))
+  {
+    case GST_QUERY_LATENCY:
+      /* A frame is sent once all of it has been received */
+      gst_query_set_latency (query, TRUE, FRAME_DURATION,
+          GST_CLOCK_TIME_NONE);
+      return TRUE;
+    default:
+      return gst_pad_query_default (pad, parent, query);
+  }
+}
+
+/* These loops are written so that the compiler can vectorize them */
+
+static void
+add_samples (gint32 *mix, const gint16 *samples, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    mix[i] += samples[i];
+}
+
+static void
+subtract_samples (gint32 *mix, const gint16 *samples, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    mix[i] -= samples[i];
+}
+
+static void
+clamp_samples (gint16 *out, const gint32 *mix, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    out[i] = CLAMP (mix[i], G_MININT16, G_MAXINT16);
+}
+
+/* Takes a frame from each input and sums them */
+
+static void
+fs_rtp_mixer_mix_locked (FsRtpMixer *self)
+{
+  GList *item;
+
+  memset (self->mix, 0, FRAME_SAMPLES * sizeof (gint32));
+
+  for (item = self->inputs; item; item = item->next)
+  {
+    FsRtpMixerInput *input = item->data;
+    guint n, first;
+
+    if (!input->started && input->ring_len >= PREBUFFER_SAMPLES)
+      input->started = TRUE;
+
+    input->active = input->started && input->ring_len > 0;
+    if (!input->active)
+    {
+      input->started = FALSE;
+      continue;
+    }
+
+    n = MIN (input->ring_len, FRAME_SAMPLES);
+
+    /* The samples may wrap around the end of the ring */
+    first = MIN (n, MAX_QUEUED_SAMPLES - input->ring_start);
+    memcpy (input->frame, input->ring + input->ring_start,
+        first * sizeof (gint16));
+    memcpy (input->frame + first, input->ring, (n - first) * sizeof (gint16));
+    memset (input->frame + n, 0, (FRAME_SAMPLES - n) * sizeof (gint16));
+
+    input->ring_start = (input->ring_start + n) % MAX_QUEUED_SAMPLES;
+    input->ring_len -= n;
+
+    add_samples (self->mix, input->frame, FRAME_SAMPLES);
+  }
+}
+
+static gboolean
+fs_rtp_mixer_group_is_active_locked (FsRtpMixer *self, guint group)
+{
+  GList *item;
+
+  for (item = self->inputs; item; item = item->next)
+  {
+    FsRtpMixerInput *input = item->data;
+
+    if (input->active && input->group == group)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Makes a buffer with the mix, without the inputs of @group if @exclude */
+
+static GstBuffer *
+fs_rtp_mixer_make_buffer_locked (FsRtpMixer *self, gboolean exclude,
+    guint group, GstClockTime pts)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gint32 mix[FRAME_SAMPLES];
+  GList *item;
+
+  buffer = gst_buffer_new_allocate (NULL, FRAME_SAMPLES * sizeof (gint16),
+      NULL);
+
+  memcpy (mix, self->mix, sizeof (mix));
+
+  if (exclude)
+  {
+    for (item = self->inputs; item; item = item->next)
+    {
+      FsRtpMixerInput *input = item->data;
+
+      if (input->active && input->group == group)
+        subtract_samples (mix, input->frame, FRAME_SAMPLES);
+    }
+  }
+
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  clamp_samples ((gint16 *) map.data, mix, FRAME_SAMPLES);
+  gst_buffer_unmap (buffer, &map);
+
+  GST_BUFFER_PTS (buffer) = pts;
+  GST_BUFFER_DURATION (buffer) = FRAME_DURATION;
+
+  return buffer;
+}
+
+static void
+fs_rtp_mixer_push_events (FsRtpMixer *self, GstPad *pad)
+{
+  gchar *stream_id;
+  GstCaps *caps;
+  GstSegment segment;
+
+  stream_id = gst_pad_create_stream_id (pad, GST_ELEMENT (self), NULL);
+  gst_pad_push_event (pad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+
+  caps = gst_pad_get_pad_template_caps (pad);
+  gst_pad_push_event (pad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (pad, gst_event_new_segment (&segment));
+}
+
+static void
+fs_rtp_mixer_loop (gpointer user_data)
+{
+  FsRtpMixer *self = FS_RTP_MIXER (user_data);
+  GstClock *clock;
+  GstClockID id;
+  GstClockTime base_time, running_time, now;
+  GstBuffer *shared = NULL;
+  GList *pushes = NULL;
+  GList *item;
+
+  GST_OBJECT_LOCK (self);
+  clock = GST_ELEMENT_CLOCK (self);
+  if (self->flushing || !clock)
+    goto pause;
+
+  base_time = GST_ELEMENT_CAST (self)->base_time;
+
+  now = gst_clock_get_time (clock);
+  if (now > base_time + self->frames * FRAME_DURATION + MAX_LATENESS)
+  {
+    GST_DEBUG_OBJECT (self, "Mixer is late, skipping ahead");
+    self->frames = (now - base_time) / FRAME_DURATION;
+  }
+
+  running_time = self->frames * FRAME_DURATION;
+
+  /* Wait for the end of the frame, so all of it has arrived */
+  id = gst_clock_new_single_shot_id (clock,
+      base_time + running_time + FRAME_DURATION);
+  self->clock_id = id;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_clock_id_wait (id, NULL);
+
+  GST_OBJECT_LOCK (self);
+  self->clock_id = NULL;
+  gst_clock_id_unref (id);
+  if (self->flushing)
+    goto pause;
+
+  self->frames++;
+
+  fs_rtp_mixer_mix_locked (self);
+
+  for (item = self->outputs; item; item = item->next)
+  {
+    FsRtpMixerOutput *output = item->data;
+    FsRtpMixerPush *push = g_slice_new (FsRtpMixerPush);
+
+    push->pad = gst_object_ref (output->pad);
+    push->need_events = output->need_events;
+    output->need_events = FALSE;
+
+    if (fs_rtp_mixer_group_is_active_locked (self, output->group))
+    {
+      push->buffer = fs_rtp_mixer_make_buffer_locked (self, TRUE,
+          output->group, running_time);
+    }
+    else
+    {
+      if (!shared)
+        shared = fs_rtp_mixer_make_buffer_locked (self, FALSE, 0,
+            running_time);
+      push->buffer = gst_buffer_ref (shared);
+    }
+
+    pushes = g_list_prepend (pushes, push);
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  if (shared)
+    gst_buffer_unref (shared);
+
+  for (item = pushes; item; item = item->next)
+  {
+    FsRtpMixerPush *push = item->data;
+    GstFlowReturn ret;
+
+    if (push->need_events)
+      fs_rtp_mixer_push_events (self, push->pad);
+
+    ret = gst_pad_push (push->pad, push->buffer);
+    if (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED)
+      GST_LOG_OBJECT (self, "Could not push on %s:%s: %s",
+          GST_DEBUG_PAD_NAME (push->pad), gst_flow_get_name (ret));
+
+    gst_object_unref (push->pad);
+    g_slice_free (FsRtpMixerPush, push);
+  }
+  g_list_free (pushes);
+
+  return;
+
+ pause:
+  GST_OBJECT_UNLOCK (self);
+  gst_task_pause (self->task);
+}
+
+static void
+fs_rtp_mixer_start (FsRtpMixer *self)
+{
+  GST_OBJECT_LOCK (self);
+  self->flushing = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_task_start (self->task);
+}
+
+static void
+fs_rtp_mixer_stop (FsRtpMixer *self)
+{
+  GST_OBJECT_LOCK (self);
+  self->flushing = TRUE;
+  if (self->clock_id)
+    gst_clock_id_unschedule (self->clock_id);
+  GST_OBJECT_UNLOCK (self);
+
+  gst_task_stop (self->task);
+  gst_task_join (self->task);
+}
+
+static void
+fs_rtp_mixer_reset (FsRtpMixer *self)
+{
+  GList *item;
+
+  GST_OBJECT_LOCK (self);
+  self->frames = 0;
+  for (item = self->inputs; item; item = item->next)
+    fs_rtp_mixer_input_clear (item->data);
+  for (item = self->outputs; item; item = item->next)
+    ((FsRtpMixerOutput *) item->data)->need_events = TRUE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static GstStateChangeReturn
+fs_rtp_mixer_change_state (GstElement *element, GstStateChange transition)
+{
+  FsRtpMixer *self = FS_RTP_MIXER (element);
+  GstStateChangeReturn ret;
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+      fs_rtp_mixer_stop (self);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (fs_rtp_mixer_parent_class)->change_state (element,
+      transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+      /* Live source */
+      ret = GST_STATE_CHANGE_NO_PREROLL;
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+      fs_rtp_mixer_start (self);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      fs_rtp_mixer_reset (self);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
@@ -0,0 +1,88 @@
+/*
+ * Farstream Voice+Video library
+ *
+ *  Copyright 2026 agent
+ *   @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_MIXER_H__
+#define __FS_RTP_MIXER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* #define's don't like whitespacey bits */
+#define FS_TYPE_RTP_MIXER \
+  (fs_rtp_mixer_get_type())
+#define FS_RTP_MIXER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+  FS_TYPE_RTP_MIXER,FsRtpMixer))
+#define FS_RTP_MIXER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), \
+  FS_TYPE_RTP_MIXER,FsRtpMixerClass))
+#define FS_IS_RTP_MIXER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),FS_TYPE_RTP_MIXER))
+#define FS_IS_RTP_MIXER_CLASS(obj) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),FS_TYPE_RTP_MIXER))
+
+/* The format of both the inputs and the outputs */
+#define FS_RTP_MIXER_RATE (48000)
+
+typedef struct _FsRtpMixer FsRtpMixer;
+typedef struct _FsRtpMixerClass FsRtpMixerClass;
+
+struct _FsRtpMixer
+{
+  GstElement parent;
+
+  GstTask *task;
+  GRecMutex task_lock;
+
+  /* Everything below is protected by the object lock */
+
+  /* FsRtpMixerInput and FsRtpMixerOutput, one per request pad */
+  GList *inputs;
+  GList *outputs;
+
+  gboolean flushing;
+  GstClockID clock_id;
+
+  /* Number of frames mixed since the start */
+  guint64 frames;
+
+  /* Only used by the streaming thread */
+  gint32 *mix;
+
+  guint pad_count;
+};
+
+struct _FsRtpMixerClass
+{
+  GstElementClass parent_class;
+};
+
+GType fs_rtp_mixer_get_type (void);
+
+GstElement *fs_rtp_mixer_new (void);
+
+GstPad *fs_rtp_mixer_get_pad (GstElement *mixer, GstPadDirection direction,
+    guint group);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_MIXER_H__ */
@@ -0,0 +1,626 @@
+/*
+ * Farstream Voice+Video library
+ *
+ *  Copyright 2026 agent
+ *   @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The pacer sits between the rtpbin and the transmitters and spreads the
+ * packets out with a token bucket, so that a large keyframe does not hit the
+ * network as one burst. Packets are sent somewhat faster than the target
+ * bitrate so the encoder's own variations do not accumulate in the queue,
+ * and the rate is raised further if what is queued could not be sent within
+ * the maximum delay.
+ *
+ * The packets are timed with the element's clock if it has one, and with the
+ * system clock otherwise. The streaming task is only running while there is
+ * something to pace, packets go straight through without a bitrate.
+ *
+ * The bitrate only covers what is encoded locally, so the packets of the
+ * SSRCs set with fs_rtp_pacer_set_unpaced_ssrcs(), such as forwarded ones,
+ * are not paced.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-pacer.h"
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+GST_DEBUG_CATEGORY_STATIC (fs_rtp_pacer_debug);
+#define GST_CAT_DEFAULT fs_rtp_pacer_debug
+
+/* Send at 2.5 times the target bitrate, like most WebRTC pacers */
+#define PACING_FACTOR_PERCENT (250)
+
+/* How much can be sent at once after being idle */
+#define MAX_BURST_DURATION (5 * GST_MSECOND)
+#define MIN_BURST_BYTES (1500)
+
+static GstStaticPadTemplate fs_rtp_pacer_sink_template =
+    GST_STATIC_PAD_TEMPLATE ("sink",
+        GST_PAD_SINK,
+        GST_PAD_ALWAYS,
+        GST_STATIC_CAPS ("application/x-rtp"));
+
+static GstStaticPadTemplate fs_rtp_pacer_src_template =
+    GST_STATIC_PAD_TEMPLATE ("src",
+        GST_PAD_SRC,
+        GST_PAD_ALWAYS,
+        GST_STATIC_CAPS ("application/x-rtp"));
+enum
+{
+  PROP_0,
+  PROP_BITRATE,
+  PROP_MAX_DELAY,
+  PROP_MAX_SIZE_BYTES,
+};
+
+#define PROP_BITRATE_DEFAULT (0)
+#define PROP_MAX_DELAY_DEFAULT (FS_RTP_PACER_DEFAULT_MAX_DELAY)
+#define PROP_MAX_SIZE_BYTES_DEFAULT (FS_RTP_PACER_DEFAULT_MAX_SIZE_BYTES)
+
+static void fs_rtp_pacer_finalize (GObject *object);
+static void fs_rtp_pacer_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec);
+
+
+G_DEFINE_TYPE (FsRtpPacer, fs_rtp_pacer, GST_TYPE_ELEMENT);
+
+static GstFlowReturn fs_rtp_pacer_chain (GstPad *pad, GstObject *parent,
+    GstBuffer *buffer);
+static gboolean fs_rtp_pacer_sink_event (GstPad *pad, GstObject *parent,
+    GstEvent *event);
+static gboolean fs_rtp_pacer_src_query (GstPad *pad, GstObject *parent,
+    GstQuery *query);
+static gboolean fs_rtp_pacer_src_activate_mode (GstPad *pad,
+    GstObject *parent, GstPadMode mode, gboolean active);
+
+static void
+fs_rtp_pacer_class_init (FsRtpPacerClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  gobject_class->set_property = fs_rtp_pacer_set_property;
+  gobject_class->finalize = fs_rtp_pacer_finalize;
+
+  GST_DEBUG_CATEGORY_INIT
+      (fs_rtp_pacer_debug, "fsrtppacer", 0,
+          "fsrtppacer element");
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Farstream RTP Pacer",
+      "Generic",
+      "Filter that spreads out RTP packets according to a bitrate",
+      "agent <agent@local>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rtp_pacer_sink_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rtp_pacer_src_template));
+
+  g_object_class_install_property (gobject_class,
+      PROP_BITRATE,
+      g_param_spec_uint ("bitrate",
+          "Bitrate to pace for",
+          "The target bitrate in bits/sec (0 means no pacing)",
+          0, G_MAXUINT, PROP_BITRATE_DEFAULT,
+          G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_MAX_DELAY,
+      g_param_spec_uint64 ("max-delay",
+          "Maximum queueing delay",
+          "The pacing rate is raised so nothing stays queued longer than this"
+          " (0 means no limit)",
+          0, G_MAXUINT64, PROP_MAX_DELAY_DEFAULT,
+          G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_MAX_SIZE_BYTES,
+      g_param_spec_uint ("max-size-bytes",
+          "Maximum queued bytes",
+          "Packets are dropped instead of queued past this size"
+          " (0 means no limit)",
+          0, G_MAXUINT, PROP_MAX_SIZE_BYTES_DEFAULT,
+          G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+fs_rtp_pacer_init (FsRtpPacer *self)
+{
+  self->sinkpad = gst_pad_new_from_static_template (
+    &fs_rtp_pacer_sink_template, "sink");
+  gst_pad_set_chain_function (self->sinkpad, fs_rtp_pacer_chain);
+  gst_pad_set_event_function (self->sinkpad, fs_rtp_pacer_sink_event);
+  GST_PAD_SET_PROXY_CAPS (self->sinkpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
+
+  self->srcpad = gst_pad_new_from_static_template (
+    &fs_rtp_pacer_src_template, "src");
+  gst_pad_set_activatemode_function (self->srcpad,
+      fs_rtp_pacer_src_activate_mode);
+  gst_pad_set_query_function (self->srcpad, fs_rtp_pacer_src_query);
+  GST_PAD_SET_PROXY_CAPS (self->srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
+
+  self->system_clock = gst_system_clock_obtain ();
+
+  self->bitrate = PROP_BITRATE_DEFAULT;
+  self->max_delay = PROP_MAX_DELAY_DEFAULT;
+  self->max_size_bytes = PROP_MAX_SIZE_BYTES_DEFAULT;
+
+  g_queue_init (&self->queue);
+  g_cond_init (&self->cond);
+  self->flushing = TRUE;
+  self->srcresult = GST_FLOW_FLUSHING;
+  self->last_refill = GST_CLOCK_TIME_NONE;
+}
+
+static void
+fs_rtp_pacer_flush_locked (FsRtpPacer *self)
+{
+  GstMiniObject *item;
+
+  while ((item = g_queue_pop_head (&self->queue)))
+    gst_mini_object_unref (item);
+  self->queued_bytes = 0;
+
+  self->tokens = 0;
+  self->last_refill = GST_CLOCK_TIME_NONE;
+}
+
+static void
+fs_rtp_pacer_finalize (GObject *object)
+{
+  FsRtpPacer *self = FS_RTP_PACER (object);
+
+  fs_rtp_pacer_flush_locked (self);
+  g_cond_clear (&self->cond);
+
+  if (self->unpaced_ssrcs)
+    g_hash_table_destroy (self->unpaced_ssrcs);
+
+  if (self->system_clock)
+    gst_object_unref (self->system_clock);
+
+  G_OBJECT_CLASS (fs_rtp_pacer_parent_class)->finalize (object);
+}
+
+static void
+fs_rtp_pacer_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  FsRtpPacer *self = FS_RTP_PACER (object);
+  gboolean latency_changed = FALSE;
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id)
+  {
+    case PROP_BITRATE:
+      /* Only turning pacing on or off changes the latency */
+      latency_changed = self->max_delay &&
+          !self->bitrate != !g_value_get_uint (value);
+      self->bitrate = g_value_get_uint (value);
+      if (self->bitrate == 0)
+        self->last_refill = GST_CLOCK_TIME_NONE;
+      /* Lets the task pause itself if the queue is empty */
+      g_cond_signal (&self->cond);
+      break;
+    case PROP_MAX_DELAY:
+      latency_changed = self->bitrate &&
+          self->max_delay != g_value_get_uint64 (value);
+      self->max_delay = g_value_get_uint64 (value);
+      break;
+    case PROP_MAX_SIZE_BYTES:
+      self->max_size_bytes = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+
+  /* Re-compute the wait with the new rate */
+  if (self->clockid)
+    gst_clock_id_unschedule (self->clockid);
+  GST_OBJECT_UNLOCK (self);
+
+  if (latency_changed)
+    gst_element_post_message (GST_ELEMENT (self),
+        gst_message_new_latency (GST_OBJECT (self)));
+}
+
+/* Returns the current pacing rate in bytes/sec, 0 if not pacing */
+static guint64
+fs_rtp_pacer_get_rate_locked (FsRtpPacer *self)
+{
+  guint64 rate;
+
+  if (self->bitrate == 0)
+    return 0;
+
+  rate = (guint64) self->bitrate * PACING_FACTOR_PERCENT / 100 / 8;
+
+  if (self->max_delay && self->queued_bytes)
+    rate = MAX (rate, gst_util_uint64_scale_ceil (self->queued_bytes,
+            GST_SECOND, self->max_delay));
+
+  return MAX (rate, 1);
+}
+
+static void
+fs_rtp_pacer_refill_locked (FsRtpPacer *self, GstClockTime now, guint64 rate)
+{
+  gint64 bucket_size = MAX (MIN_BURST_BYTES,
+      gst_util_uint64_scale (rate, MAX_BURST_DURATION, GST_SECOND));
+
+  if (!GST_CLOCK_TIME_IS_VALID (self->last_refill))
+    self->tokens = bucket_size;
+  else if (now > self->last_refill)
+    self->tokens += gst_util_uint64_scale (now - self->last_refill, rate,
+        GST_SECOND);
+
+  self->tokens = MIN (self->tokens, bucket_size);
+  self->last_refill = now;
+}
+
+static void
+fs_rtp_pacer_loop (gpointer user_data)
+{
+  FsRtpPacer *self = FS_RTP_PACER (user_data);
+  GstMiniObject *item;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  GST_OBJECT_LOCK (self);
+
+  for (;;)
+  {
+    GstClock *clock;
+    GstClockTime now;
+    GstClockID id;
+    guint64 rate;
+
+    while (!self->flushing && g_queue_is_empty (&self->queue))
+    {
+      /* Nothing left to pace, the next buffer will restart the task. This
+       * is done with the lock held so the chain function can't restart it
+       * before it is paused. */
+      if (self->bitrate == 0)
+      {
+        GST_DEBUG_OBJECT (self, "Pausing task, not pacing");
+        self->task_running = FALSE;
+        gst_pad_pause_task (self->srcpad);
+        GST_OBJECT_UNLOCK (self);
+        return;
+      }
+      g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+    }
+
+    if (self->flushing)
+      goto flushing;
+
+    item = g_queue_peek_head (&self->queue);
+    if (!GST_IS_BUFFER (item))
+      break;
+
+    rate = fs_rtp_pacer_get_rate_locked (self);
+    if (rate == 0)
+      break;
+
+    clock = GST_ELEMENT_CLOCK (self);
+    if (!clock)
+      clock = self->system_clock;
+    gst_object_ref (clock);
+
+    now = gst_clock_get_time (clock);
+    fs_rtp_pacer_refill_locked (self, now, rate);
+
+    if (self->tokens >= 0)
+    {
+      self->tokens -= gst_buffer_get_size (GST_BUFFER (item));
+      gst_object_unref (clock);
+      break;
+    }
+
+    GST_LOG_OBJECT (self, "Out of tokens (%" G_GINT64_FORMAT "), %u bytes"
+        " queued, pacing at %" G_GUINT64_FORMAT " bytes/sec", self->tokens,
+        self->queued_bytes, rate);
+
+    id = self->clockid = gst_clock_new_single_shot_id (clock,
+        now + gst_util_uint64_scale_ceil (-self->tokens, GST_SECOND, rate));
+    GST_OBJECT_UNLOCK (self);
+
+    gst_clock_id_wait (id, NULL);
+    gst_object_unref (clock);
+
+    GST_OBJECT_LOCK (self);
+    gst_clock_id_unref (id);
+    self->clockid = NULL;
+  }
+
+  g_queue_pop_head (&self->queue);
+  if (GST_IS_BUFFER (item))
+    self->queued_bytes -= gst_buffer_get_size (GST_BUFFER (item));
+  self->pushing = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (GST_IS_BUFFER (item))
+    ret = gst_pad_push (self->srcpad, GST_BUFFER (item));
+  else
+    gst_pad_push_event (self->srcpad, GST_EVENT (item));
+
+  GST_OBJECT_LOCK (self);
+  self->pushing = FALSE;
+  if (ret == GST_FLOW_FLUSHING)
+    goto flushing;
+  /* Report errors upstream on the next buffer, but keep going */
+  if (!self->flushing)
+    self->srcresult = ret;
+  GST_OBJECT_UNLOCK (self);
+
+  return;
+
+flushing:
+  GST_DEBUG_OBJECT (self, "Pausing task, flushing");
+  self->srcresult = GST_FLOW_FLUSHING;
+  self->task_running = FALSE;
+  GST_OBJECT_UNLOCK (self);
+  gst_pad_pause_task (self->srcpad);
+}
+
+static gboolean
+fs_rtp_pacer_is_unpaced_locked (FsRtpPacer *self, GstBuffer *buffer)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  guint32 ssrc;
+
+  if (!self->unpaced_ssrcs || g_hash_table_size (self->unpaced_ssrcs) == 0)
+    return FALSE;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
+    return FALSE;
+  ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  return g_hash_table_contains (self->unpaced_ssrcs, GUINT_TO_POINTER (ssrc));
+}
+
+static GstFlowReturn
+fs_rtp_pacer_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  FsRtpPacer *self = FS_RTP_PACER (parent);
+  GstFlowReturn ret;
+  gboolean start_task = FALSE;
+
+  GST_OBJECT_LOCK (self);
+  if (self->srcresult == GST_FLOW_FLUSHING)
+  {
+    GST_OBJECT_UNLOCK (self);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_FLUSHING;
+  }
+
+  /* Without a bitrate, don't go through the task unless something is still
+   * queued from before. The unpaced SSRCs never wait, they are not in order
+   * with the other ones anyway. */
+  if ((self->bitrate == 0 && g_queue_is_empty (&self->queue) &&
+          !self->pushing) ||
+      fs_rtp_pacer_is_unpaced_locked (self, buffer))
+  {
+    GST_OBJECT_UNLOCK (self);
+    return gst_pad_push (self->srcpad, buffer);
+  }
+
+  ret = self->srcresult;
+
+  /* Bound the memory used if the rate can't keep up, max-delay only limits
+   * the time things stay queued */
+  if (self->max_size_bytes &&
+      self->queued_bytes + gst_buffer_get_size (buffer) > self->max_size_bytes)
+  {
+    GST_DEBUG_OBJECT (self, "Dropping buffer, %u bytes already queued",
+        self->queued_bytes);
+    GST_OBJECT_UNLOCK (self);
+    gst_buffer_unref (buffer);
+    return ret;
+  }
+
+  self->queued_bytes += gst_buffer_get_size (buffer);
+  g_queue_push_tail (&self->queue, buffer);
+  g_cond_signal (&self->cond);
+
+  if (!self->task_running)
+    start_task = self->task_running = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (start_task)
+    gst_pad_start_task (self->srcpad, fs_rtp_pacer_loop, self, NULL);
+
+  return ret;
+}
+
+static gboolean
+fs_rtp_pacer_sink_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  FsRtpPacer *self = FS_RTP_PACER (parent);
+  gboolean ret;
+
+  switch (GST_EVENT_TYPE (event))
+  {
+    case GST_EVENT_FLUSH_START:
+      ret = gst_pad_push_event (self->srcpad, event);
+
+      GST_OBJECT_LOCK (self);
+      self->flushing = TRUE;
+      self->srcresult = GST_FLOW_FLUSHING;
+      if (self->clockid)
+        gst_clock_id_unschedule (self->clockid);
+      g_cond_signal (&self->cond);
+      self->task_running = FALSE;
+      GST_OBJECT_UNLOCK (self);
+
+      gst_pad_pause_task (self->srcpad);
+      return ret;
+    case GST_EVENT_FLUSH_STOP:
+      GST_OBJECT_LOCK (self);
+      fs_rtp_pacer_flush_locked (self);
+      self->flushing = FALSE;
+      self->srcresult = GST_FLOW_OK;
+      GST_OBJECT_UNLOCK (self);
+
+      /* The task is restarted by the next buffer */
+      return gst_pad_push_event (self->srcpad, event);
+    default:
+      break;
+  }
+
+  if (!GST_EVENT_IS_SERIALIZED (event))
+    return gst_pad_push_event (self->srcpad, event);
+
+  /* Serialized events must stay in order with the queued buffers */
+  GST_OBJECT_LOCK (self);
+  if (self->flushing)
+  {
+    GST_OBJECT_UNLOCK (self);
+    gst_event_unref (event);
+    return FALSE;
+  }
+
+  if (g_queue_is_empty (&self->queue) && !self->pushing)
+  {
+    GST_OBJECT_UNLOCK (self);
+    return gst_pad_push_event (self->srcpad, event);
+  }
+
+  g_queue_push_tail (&self->queue, event);
+  g_cond_signal (&self->cond);
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static gboolean
+fs_rtp_pacer_src_query (GstPad *pad, GstObject *parent, GstQuery *query)
+{
+  FsRtpPacer *self = FS_RTP_PACER (parent);
+  gboolean live;
+  GstClockTime min, max;
+  GstClockTime delay = 0;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_LATENCY)
+    return gst_pad_query_default (pad, parent, query);
+
+  if (!gst_pad_peer_query (self->sinkpad, query))
+    return FALSE;
+
+  /* While pacing, a packet can be held back for up to max-delay */
+  GST_OBJECT_LOCK (self);
+  if (self->bitrate)
+    delay = self->max_delay;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_query_parse_latency (query, &live, &min, &max);
+  GST_DEBUG_OBJECT (self, "Upstream latency min %" GST_TIME_FORMAT " max %"
+      GST_TIME_FORMAT ", adding %" GST_TIME_FORMAT, GST_TIME_ARGS (min),
+      GST_TIME_ARGS (max), GST_TIME_ARGS (delay));
+
+  min += delay;
+  if (GST_CLOCK_TIME_IS_VALID (max))
+    max += delay;
+  gst_query_set_latency (query, live, min, max);
+
+  return TRUE;
+}
+
+static gboolean
+fs_rtp_pacer_src_activate_mode (GstPad *pad, GstObject *parent,
+    GstPadMode mode, gboolean active)
+{
+  FsRtpPacer *self = FS_RTP_PACER (parent);
+  gboolean ret;
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  if (active)
+  {
+    /* The task is started by the first buffer that has to be paced */
+    GST_OBJECT_LOCK (self);
+    self->flushing = FALSE;
+    self->srcresult = GST_FLOW_OK;
+    GST_OBJECT_UNLOCK (self);
+
+    ret = TRUE;
+  }
+  else
+  {
+    GST_OBJECT_LOCK (self);
+    self->flushing = TRUE;
+    self->srcresult = GST_FLOW_FLUSHING;
+    if (self->clockid)
+      gst_clock_id_unschedule (self->clockid);
+    g_cond_signal (&self->cond);
+    GST_OBJECT_UNLOCK (self);
+
+    ret = gst_pad_stop_task (pad);
+
+    GST_OBJECT_LOCK (self);
+    self->task_running = FALSE;
+    fs_rtp_pacer_flush_locked (self);
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  return ret;
+}
+
+GstElement *
+fs_rtp_pacer_new (void)
+{
+  return g_object_new (FS_TYPE_RTP_PACER, NULL);
+}
+
+/**
+ * fs_rtp_pacer_set_unpaced_ssrcs:
+ * @self: a #FsRtpPacer
+ * @ssrcs: (transfer full) (allow-none): a set of SSRCs, as a #GHashTable
+ *  whose keys are the SSRCs
+ *
+ * The packets of these SSRCs are pushed right away instead of being paced,
+ * they replace the previous ones.
+ */
+
+void
+fs_rtp_pacer_set_unpaced_ssrcs (FsRtpPacer *self, GHashTable *ssrcs)
+{
+  GHashTable *old;
+
+  GST_OBJECT_LOCK (self);
+  old = self->unpaced_ssrcs;
+  self->unpaced_ssrcs = ssrcs;
+  GST_OBJECT_UNLOCK (self);
+
+  if (old)
+    g_hash_table_destroy (old);
+}
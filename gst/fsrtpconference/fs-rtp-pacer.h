@@ -0,0 +1,99 @@
+/*
+ * Farstream Voice+Video library
+ *
+ *  Copyright 2026 agent
+ *   @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_PACER_H__
+#define __FS_RTP_PACER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* #define's don't like whitespacey bits */
+#define FS_TYPE_RTP_PACER \
+  (fs_rtp_pacer_get_type())
+#define FS_RTP_PACER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+  FS_TYPE_RTP_PACER,FsRtpPacer))
+#define FS_RTP_PACER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), \
+  FS_TYPE_RTP_PACER,FsRtpPacerClass))
+#define FS_IS_RTP_PACER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),FS_TYPE_RTP_PACER))
+#define FS_IS_RTP_PACER_CLASS(obj) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),FS_TYPE_RTP_PACER))
+
+#define FS_RTP_PACER_DEFAULT_MAX_DELAY (300 * GST_MSECOND)
+#define FS_RTP_PACER_DEFAULT_MAX_SIZE_BYTES (1024 * 1024)
+
+typedef struct _FsRtpPacer FsRtpPacer;
+typedef struct _FsRtpPacerClass FsRtpPacerClass;
+
+struct _FsRtpPacer
+{
+  GstElement parent;
+
+  GstPad *srcpad;
+  GstPad *sinkpad;
+
+  GstClock *system_clock;
+
+  /* Everything below is protected by the object lock */
+
+  /* Target bitrate in bits/sec, 0 means no pacing */
+  guint bitrate;
+  GstClockTime max_delay;
+  /* Buffers that do not fit are dropped, 0 means no limit */
+  guint max_size_bytes;
+  /* SSRCs whose packets go straight through, can be NULL */
+  GHashTable *unpaced_ssrcs;
+
+  /* Buffers and serialized events waiting to be pushed */
+  GQueue queue;
+  guint queued_bytes;
+  GCond cond;
+  /* The streaming task is pushing something that is no longer queued */
+  gboolean pushing;
+  gboolean flushing;
+  /* The streaming task is only started once there is something to pace and
+   * pauses itself when the queue is empty and pacing is off */
+  gboolean task_running;
+  GstFlowReturn srcresult;
+  GstClockID clockid;
+
+  /* The token bucket, in bytes, can go negative after a large packet */
+  gint64 tokens;
+  GstClockTime last_refill;
+};
+
+struct _FsRtpPacerClass
+{
+  GstElementClass parent_class;
+};
+
+GType fs_rtp_pacer_get_type (void);
+
+GstElement *fs_rtp_pacer_new (void);
+
+void fs_rtp_pacer_set_unpaced_ssrcs (FsRtpPacer *self, GHashTable *ssrcs);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_PACER_H__ */
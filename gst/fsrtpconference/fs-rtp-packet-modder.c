@@ -44,10 +44,24 @@ static GstStaticPadTemplate fs_rtp_packet_modder_src_template =
         GST_PAD_ALWAYS,
         GST_STATIC_CAPS ("application/x-rtp"));
 
+enum
+{
+  PROP_0,
+  PROP_PACING_INTERVAL
+};
+
+static void fs_rtp_packet_modder_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec);
+static void fs_rtp_packet_modder_finalize (GObject *object);
+
 G_DEFINE_TYPE (FsRtpPacketModder, fs_rtp_packet_modder, GST_TYPE_ELEMENT);
 
 static GstFlowReturn fs_rtp_packet_modder_chain (GstPad *pad,
     GstObject *parent, GstBuffer *buffer);
+static GstFlowReturn fs_rtp_packet_modder_chain_list (GstPad *pad,
+    GstObject *parent, GstBufferList *list);
 static GstCaps *fs_rtp_packet_modder_getcaps (FsRtpPacketModder *self,
     GstPad *pad, GstCaps *filter);
 static gboolean fs_rtp_packet_modder_sink_event (GstPad *pad,
@@ -63,8 +77,12 @@ static GstStateChangeReturn fs_rtp_packet_modder_change_state (
 static void
 fs_rtp_packet_modder_class_init (FsRtpPacketModderClass *klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
 
+  gobject_class->set_property = fs_rtp_packet_modder_set_property;
+  gobject_class->finalize = fs_rtp_packet_modder_finalize;
+
   GST_DEBUG_CATEGORY_INIT
       (fs_rtp_packet_modder_debug, "fsrtppacketmodder", 0,
           "fsrtppacketmodder element");
@@ -81,6 +99,62 @@ fs_rtp_packet_modder_class_init (FsRtpPacketModderClass *klass)
       gst_static_pad_template_get (&fs_rtp_packet_modder_src_template));
 
   gstelement_class->change_state = fs_rtp_packet_modder_change_state;
+
+  g_object_class_install_property (gobject_class,
+      PROP_PACING_INTERVAL,
+      g_param_spec_uint64 ("pacing-interval",
+          "Pacing interval",
+          "If non-zero, wake up once per interval and send all the packets"
+          " that are due before the next wakeup in one burst",
+          0, G_MAXUINT64, 0,
+          G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+fs_rtp_packet_modder_clear_pacing_locked (FsRtpPacketModder *self)
+{
+  if (self->pacing_id)
+  {
+    gst_clock_id_unschedule (self->pacing_id);
+    gst_clock_id_unref (self->pacing_id);
+  }
+  self->pacing_id = NULL;
+  self->pacing_clock = NULL;
+}
+
+static void
+fs_rtp_packet_modder_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  FsRtpPacketModder *self = FS_RTP_PACKET_MODDER (object);
+
+  switch (prop_id)
+  {
+    case PROP_PACING_INTERVAL:
+      GST_OBJECT_LOCK (self);
+      self->pacing_interval = g_value_get_uint64 (value);
+      /* The streaming thread will pick up the new interval on wakeup */
+      if (self->clock_id)
+        gst_clock_id_unschedule (self->clock_id);
+      fs_rtp_packet_modder_clear_pacing_locked (self);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_rtp_packet_modder_finalize (GObject *object)
+{
+  FsRtpPacketModder *self = FS_RTP_PACKET_MODDER (object);
+
+  fs_rtp_packet_modder_clear_pacing_locked (self);
+
+  G_OBJECT_CLASS (fs_rtp_packet_modder_parent_class)->finalize (object);
 }
 
 static void
@@ -91,6 +165,8 @@ fs_rtp_packet_modder_init (FsRtpPacketModder *self)
   self->sinkpad = gst_pad_new_from_static_template (
     &fs_rtp_packet_modder_sink_template, "sink");
   gst_pad_set_chain_function (self->sinkpad, fs_rtp_packet_modder_chain);
+  gst_pad_set_chain_list_function (self->sinkpad,
+      fs_rtp_packet_modder_chain_list);
   gst_pad_set_query_function (self->sinkpad, fs_rtp_packet_modder_query);
   gst_pad_set_event_function (self->sinkpad, fs_rtp_packet_modder_sink_event);
   GST_PAD_SET_PROXY_CAPS (self->sinkpad);
@@ -121,6 +197,47 @@ fs_rtp_packet_modder_new (FsRtpPacketModderFunc modder_func,
   return self;
 }
 
+static GstClockTime
+fs_rtp_packet_modder_get_clock_time_locked (FsRtpPacketModder *self,
+    GstClockTime running_time)
+{
+  return running_time + GST_ELEMENT_CAST (self)->base_time +
+      self->peer_latency;
+}
+
+/* In pacing mode, anything that is due before the next wakeup goes out in
+ * the current burst */
+static gboolean
+fs_rtp_packet_modder_is_due_locked (FsRtpPacketModder *self, GstClock *clock,
+    GstClockTime sync_time)
+{
+  if (self->pacing_interval && self->pacing_id && self->pacing_clock == clock)
+    return sync_time <= self->pacing_window_end;
+  else
+    return sync_time <= gst_clock_get_time (clock);
+}
+
+static gboolean
+fs_rtp_packet_modder_is_due (FsRtpPacketModder *self, GstClockTime buffer_ts)
+{
+  GstClockTime running_time;
+  GstClock *clock;
+  gboolean due = TRUE;
+
+  GST_OBJECT_LOCK (self);
+  clock = GST_ELEMENT_CLOCK (self);
+  if (clock)
+  {
+    running_time = gst_segment_to_running_time (&self->segment,
+        GST_FORMAT_TIME, buffer_ts);
+    due = fs_rtp_packet_modder_is_due_locked (self, clock,
+        fs_rtp_packet_modder_get_clock_time_locked (self, running_time));
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  return due;
+}
+
 static void
 fs_rtp_packet_modder_sync_to_clock (FsRtpPacketModder *self,
   GstClockTime buffer_ts)
@@ -130,14 +247,16 @@ fs_rtp_packet_modder_sync_to_clock (FsRtpPacketModder *self,
   GstClockID id;
   GstClock *clock;
   GstClockReturn clockret;
+  GstClockTimeDiff jitter;
+  gboolean periodic;
 
   GST_OBJECT_LOCK (self);
   running_time = gst_segment_to_running_time (&self->segment, GST_FORMAT_TIME,
      buffer_ts);
 
-  do {
-    sync_time = running_time + GST_ELEMENT_CAST (self)->base_time +
-        self->peer_latency;
+  for (;;) {
+    sync_time = fs_rtp_packet_modder_get_clock_time_locked (self,
+        running_time);
 
     clock = GST_ELEMENT_CLOCK (self);
     if (!clock) {
@@ -147,20 +266,64 @@ fs_rtp_packet_modder_sync_to_clock (FsRtpPacketModder *self,
       return;
     }
 
+    if (fs_rtp_packet_modder_is_due_locked (self, clock, sync_time))
+      break;
+
     GST_LOG_OBJECT (self, "sync to running timestamp %" GST_TIME_FORMAT,
         GST_TIME_ARGS (running_time));
 
-    id = self->clock_id = gst_clock_new_single_shot_id (clock, sync_time);
+    periodic = (self->pacing_interval != 0);
+    if (periodic)
+    {
+      if (!self->pacing_id || self->pacing_clock != clock)
+      {
+        GstClockTime now = gst_clock_get_time (clock);
+
+        fs_rtp_packet_modder_clear_pacing_locked (self);
+        self->pacing_id = gst_clock_new_periodic_id (clock,
+            now + self->pacing_interval, self->pacing_interval);
+        self->pacing_clock = clock;
+        self->pacing_window_end = now;
+        continue;
+      }
+      id = gst_clock_id_ref (self->pacing_id);
+    }
+    else
+    {
+      id = gst_clock_new_single_shot_id (clock, sync_time);
+    }
+
+    self->clock_id = id;
     self->unscheduled = FALSE;
     GST_OBJECT_UNLOCK (self);
 
-    clockret = gst_clock_id_wait (id, NULL);
+    clockret = gst_clock_id_wait (id, &jitter);
 
     GST_OBJECT_LOCK (self);
-    gst_clock_id_unref (id);
     self->clock_id = NULL;
 
-  } while  (clockret == GST_CLOCK_UNSCHEDULED && !self->unscheduled);
+    if (periodic && id == self->pacing_id)
+    {
+      /* If we fell more than one period behind, start again from now
+       * instead of releasing one burst per missed period */
+      if (clockret == GST_CLOCK_UNSCHEDULED ||
+          jitter > (GstClockTimeDiff) self->pacing_interval)
+        fs_rtp_packet_modder_clear_pacing_locked (self);
+      else
+        self->pacing_window_end = gst_clock_id_get_time (id);
+    }
+    gst_clock_id_unref (id);
+
+    if (clockret == GST_CLOCK_UNSCHEDULED)
+    {
+      if (self->unscheduled)
+        break;
+    }
+    else if (!periodic)
+    {
+      break;
+    }
+  }
   GST_OBJECT_UNLOCK (self);
 }
 
@@ -192,6 +355,90 @@ invalid:
   return ret;
 }
 
+struct ChainListData {
+  FsRtpPacketModder *self;
+  GstBufferList *out;
+  GstFlowReturn ret;
+};
+
+static gboolean
+fs_rtp_packet_modder_chain_list_func (GstBuffer **buf, guint idx,
+    gpointer user_data)
+{
+  struct ChainListData *data = user_data;
+  FsRtpPacketModder *self = data->self;
+  GstBuffer *buffer = *buf;
+  GstClockTime buffer_ts = GST_BUFFER_TIMESTAMP (buffer);
+
+  /* Take the buffer out of the list */
+  *buf = NULL;
+
+  if (GST_CLOCK_TIME_IS_VALID (buffer_ts))
+    buffer_ts = self->sync_func (self, buffer, self->user_data);
+
+  if (GST_CLOCK_TIME_IS_VALID (buffer_ts) &&
+      !fs_rtp_packet_modder_is_due (self, buffer_ts))
+  {
+    /* Send what is already due before waiting for the next one */
+    if (gst_buffer_list_length (data->out))
+    {
+      data->ret = gst_pad_push_list (self->srcpad, data->out);
+      data->out = gst_buffer_list_new ();
+      if (data->ret != GST_FLOW_OK)
+      {
+        gst_buffer_unref (buffer);
+        return FALSE;
+      }
+    }
+
+    fs_rtp_packet_modder_sync_to_clock (self, buffer_ts);
+  }
+
+  buffer = self->modder_func (self, buffer, buffer_ts, self->user_data);
+
+  if (!buffer)
+  {
+    GST_LOG_OBJECT (self, "Got NULL from FsRtpPacketModderFunc");
+    data->ret = GST_FLOW_ERROR;
+    return FALSE;
+  }
+
+  gst_buffer_list_add (data->out, buffer);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+fs_rtp_packet_modder_chain_list (GstPad *pad, GstObject *parent,
+    GstBufferList *list)
+{
+  FsRtpPacketModder *self = FS_RTP_PACKET_MODDER (parent);
+  struct ChainListData data;
+
+  data.self = self;
+  data.out = gst_buffer_list_new_sized (gst_buffer_list_length (list));
+  data.ret = GST_FLOW_OK;
+
+  /* We steal the buffers so the list has to be writable */
+  list = gst_buffer_list_make_writable (list);
+  gst_buffer_list_foreach (list, fs_rtp_packet_modder_chain_list_func, &data);
+  gst_buffer_list_unref (list);
+
+  if (gst_buffer_list_length (data.out))
+  {
+    GstFlowReturn ret = gst_pad_push_list (self->srcpad, data.out);
+
+    if (data.ret == GST_FLOW_OK)
+      data.ret = ret;
+  }
+  else
+  {
+    gst_buffer_list_unref (data.out);
+  }
+
+  return data.ret;
+}
+
 
 static GstCaps *
 fs_rtp_packet_modder_getcaps (FsRtpPacketModder *self, GstPad *pad,
@@ -295,6 +542,11 @@ fs_rtp_packet_modder_change_state (GstElement *element,
       }
       GST_OBJECT_UNLOCK (self);
       break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      GST_OBJECT_LOCK (self);
+      fs_rtp_packet_modder_clear_pacing_locked (self);
+      GST_OBJECT_UNLOCK (self);
+      break;
    default:
       break;
   }
@@ -75,6 +75,13 @@ struct _FsRtpPacketModder {
   /* the latency of the upstream peer, we have to take this into account when
    * synchronizing the buffers. */
   GstClockTime peer_latency;
+
+  /* for pacing, all protected by the object lock */
+  GstClockTime pacing_interval;
+  GstClock *pacing_clock;
+  GstClockID pacing_id;
+  /* Buffers that must go out before this clock time are released now */
+  GstClockTime pacing_window_end;
 };
 
 struct _FsRtpPacketModderClass {
@@ -122,13 +122,18 @@
 #include <farstream/fs-rtp.h>
 
 #include "fs-rtp-bitrate-adapter.h"
+#include "fs-rtp-forwarder.h"
+#include "fs-rtp-mixer.h"
+#include "fs-rtp-pacer.h"
 #include "fs-rtp-stream.h"
 #include "fs-rtp-participant.h"
 #include "fs-rtp-discover-codecs.h"
+#include "fs-rtp-codec-bin-pool.h"
 #include "fs-rtp-codec-negotiation.h"
 #include "fs-rtp-substream.h"
 #include "fs-rtp-special-source.h"
 #include "fs-rtp-codec-specific.h"
+#include "fs-rtp-simulcast.h"
 #include "fs-rtp-tfrc.h"
 
 #define GST_CAT_DEFAULT fsrtpconference_debug
@@ -160,10 +165,55 @@ enum
   PROP_ALLOWED_SINK_CAPS,
   PROP_ALLOWED_SRC_CAPS,
   PROP_ENCRYPTION_PARAMETERS,
-  PROP_INTERNAL_SESSION
+  PROP_INTERNAL_SESSION,
+  PROP_SIMULCAST_LAYERS,
+  PROP_MIXING_SPEAKERS,
+  PROP_SILENCE_THRESHOLD,
+  PROP_MIN_KEYFRAME_INTERVAL,
+  PROP_KEYFRAME_REQUESTS,
+  PROP_KEYFRAMES_FORCED,
+  PROP_BITRATE_ESTIMATOR,
+  PROP_BITRATE_PERCENTILE,
+  PROP_BITRATE_EWMA_WEIGHT,
+  PROP_PACING_MAX_DELAY
 };
 
 #define DEFAULT_NO_RTCP_TIMEOUT (7000)
+#define DEFAULT_SIMULCAST_LAYERS (1)
+#define DEFAULT_MIXING_SPEAKERS (0)
+#define DEFAULT_SILENCE_THRESHOLD (FS_RTP_AUDIO_LEVEL_SILENT)
+#define DEFAULT_PACING_MAX_DELAY (FS_RTP_PACER_DEFAULT_MAX_DELAY / GST_MSECOND)
+
+/* How many SSRCs that were refused an SRTP key are remembered, and for how
+ * long, in microseconds */
+#define SRTP_REFUSED_MAX (64)
+#define SRTP_REFUSED_TIMEOUT (G_USEC_PER_SEC)
+
+/* The mixer output of a stream */
+typedef struct {
+  guint group;
+
+  GstPad *mixer_pad;
+  GstPad *ghostpad;
+} FsRtpSessionMixOutput;
+
+/*
+ * Chooses the RTP packets that go to a stream with a transmitter of its own,
+ * it belongs to the probe on the transmitter tee pad of that transmitter
+ */
+typedef struct {
+  GMutex mutex;
+  /* SSRC of the simulcast layers -> whether the stream gets them */
+  GHashTable *ssrcs;
+  /* Whether the stream gets the other SSRCs, the main encoding */
+  gboolean main;
+  /* Nothing goes through before the session chose */
+  gboolean configured;
+
+  /* Protected by the session mutex */
+  gchar *transmitter_key;
+  gulong probe_id;
+} FsRtpSessionRoute;
 
 struct _FsRtpSessionPrivate
 {
@@ -181,12 +231,17 @@ struct _FsRtpSessionPrivate
   GstElement *send_bitrate_adapter;
   GstElement *send_tee;
   GstElement *send_capsfilter;
+  GstElement *send_pacer;
+  /* In ms, protected by the session mutex */
+  guint pacing_max_delay;
   GstElement *transmitter_rtp_tee;
   GstElement *transmitter_rtcp_tee;
   GstElement *transmitter_rtp_funnel;
   GstElement *transmitter_rtcp_funnel;
 
   GstElement *rtpmuxer;
+  /* Merges the simulcast layers and the forwarders with the muxer output */
+  GstElement *send_funnel;
   GstElement *srtpenc;
   GstElement *srtpdec;
 
@@ -231,6 +286,42 @@ struct _FsRtpSessionPrivate
   GstElement *send_codecbin;
   GList *extra_send_capsfilters;
 
+  /* List of FsRtpSimulcastLayer, it is modified by the streaming thread with
+   * the pad blocked, but it is protected by the session mutex */
+  GList *simulcast;
+  /* Protected by the session mutex */
+  guint simulcast_layers;
+  gboolean simulcast_changed;
+
+  /* Given to the bitrate adapters of the video sessions, protected by the
+   * session mutex */
+  FsRtpBitrateAdapterEstimator bitrate_estimator;
+  guint bitrate_percentile;
+  gdouble bitrate_ewma_weight;
+
+  /* FsRtpStream -> forwarder element, when the conference is forwarding,
+   * protected by the session mutex */
+  GHashTable *forwarders;
+
+  /* FsRtpStream -> FsRtpSessionRoute of the streams with a transmitter of
+   * their own, protected by the session mutex */
+  GHashTable *routes;
+
+  /* Only for audio sessions once mixing-speakers has been set, protected by
+   * the session mutex. The mixer stays until the session is disposed of */
+  GstElement *mixer;
+  FsRtpSpeakerSelector *speakers;
+  guint mixing_speakers;
+  /* FsRtpStream -> FsRtpSessionMixOutput */
+  GHashTable *mix_outputs;
+  guint mix_groups;
+
+  /* Only for audio sessions, created at construction, it has its own lock */
+  FsRtpLevelTracker *levels;
+  gulong levels_probe_id;
+  /* Protected by the session mutex */
+  guint silence_threshold;
+
   /* These lists are protected by the session mutex */
   GList *streams;
   guint streams_cookie;
@@ -245,6 +336,12 @@ struct _FsRtpSessionPrivate
 
   /* These are protected by the session mutex */
   GList *codec_associations;
+  CodecNegotiationCache *nego_cache;
+
+  /* Rebuilt with the codec associations, the pointer is protected by
+   * pt_table_lock so that request-pt-map does not need the session mutex */
+  CodecAssociationTable *pt_table;
+  GRWLock pt_table_lock;
 
   GList *hdrext_negotiated;
   GList *hdrext_preferences;
@@ -262,6 +359,14 @@ struct _FsRtpSessionPrivate
   GHashTable *ssrc_streams;
   GHashTable *ssrc_streams_manual;
 
+  /* ssrc -> monotonic time at which srtpdec was refused a key for it.
+   * srtpdec keeps the keys it is given, but asks again for every packet of
+   * an SSRC it was refused, so the refusals are remembered for a short
+   * while. Anyone can send packets with random SSRCs, so the table is
+   * bounded. Cleared when the streams or their decryption parameters
+   * change. Protected by the session mutex */
+  GHashTable *srtp_refused;
+
   GError *construction_error;
 
   gulong send_pad_block_id;
@@ -383,8 +488,37 @@ _discovery_pad_blocked_callback (GstPad *pad, GstPadProbeInfo *info,
 
 static void
 fs_rtp_session_set_send_bitrate (FsRtpSession *self, guint bitrate);
+static void
+fs_rtp_session_set_pacer_bitrate_locked (FsRtpSession *self, guint bitrate);
 static gboolean
 codecbin_set_bitrate (GstElement *codecbin, guint bitrate);
+static void
+fs_rtp_session_update_simulcast_locked (FsRtpSession *self,
+    FsRtpStream *changed_stream, gboolean changed_sending);
+static void
+fs_rtp_session_set_simulcast_bitrate_locked (FsRtpSession *self);
+static void
+fs_rtp_session_configure_bitrate_adapters_locked (FsRtpSession *self);
+static void
+fs_rtp_session_remove_simulcast_layers (FsRtpSession *self, GList *layers);
+static void
+fs_rtp_session_remove_forwarder (FsRtpSession *self, GstElement *forwarder);
+static void
+fs_rtp_session_remove_stream_transmitter (FsRtpSession *self,
+    FsTransmitter *transmitter, gulong probe_id);
+static GstPad *
+_substream_get_forward_pad (FsRtpSubStream *substream, FsRtpStream *stream,
+    FsRtpSession *session);
+static void
+fs_rtp_session_set_mixing_speakers (FsRtpSession *self, guint speakers);
+static void
+fs_rtp_session_add_mix_output (FsRtpSession *self, FsRtpStream *stream);
+static void
+fs_rtp_session_remove_mix_output (FsRtpSession *self,
+    FsRtpSessionMixOutput *output);
+static GstPad *
+_substream_get_mix_pad (FsRtpSubStream *substream, FsRtpStream *stream,
+    FsRtpSession *session);
 static gboolean
 fs_rtp_session_set_allowed_caps (FsSession *session, GstCaps *sink_caps,
     GstCaps *src_caps, GError **error);
@@ -506,6 +640,114 @@ fs_rtp_session_class_init (FsRtpSessionClass *klass)
           G_TYPE_OBJECT,
           G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class,
+      PROP_SIMULCAST_LAYERS,
+      g_param_spec_uint ("simulcast-layers",
+          "Number of simulcast layers",
+          "The number of encodings of the video that are sent, each one"
+          " with its own SSRC, at a quarter of the bitrate of the previous"
+          " one. Each FsStream selects the layer it wants with its"
+          " \"simulcast-layer\" property. The streams created while there"
+          " is more than one layer get a transmitter of their own so they only"
+          " get the layer they selected, so it can not be raised from 1 once"
+          " the session has streams. Only for video sessions.",
+          1, FS_RTP_SIMULCAST_MAX_LAYERS, DEFAULT_SIMULCAST_LAYERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_MIXING_SPEAKERS,
+      g_param_spec_uint ("mixing-speakers",
+          "Number of speakers that are mixed",
+          "If not 0, the received audio is mixed and each FsStream gets the"
+          " audio of all the other participants on its \"mix-pad\" instead"
+          " of a pad per SSRC. Only this many of the loudest speakers are"
+          " decoded, according to the audio level header extension."
+          " Only for audio sessions, it only applies to the SSRCs received"
+          " after it has been set.",
+          0, G_MAXUINT, DEFAULT_MIXING_SPEAKERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SILENCE_THRESHOLD,
+      g_param_spec_uint ("silence-threshold",
+          "Audio level under which the decoding is paused",
+          "The decoding of the received SSRCs that announce a level quieter"
+          " than this many -dBov without voice activity in the audio level"
+          " header extension is paused until they are louder again."
+          " 127 means that nothing is ever paused. Only for audio sessions.",
+          0, FS_RTP_AUDIO_LEVEL_SILENT, DEFAULT_SILENCE_THRESHOLD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_MIN_KEYFRAME_INTERVAL,
+      g_param_spec_uint ("min-keyframe-interval",
+          "Minimum interval between keyframes (in ms)",
+          "The keyframe requests (PLI or FIR) received less than this many"
+          " milliseconds after the last keyframe was requested from the"
+          " encoder are merged into a single request sent at the end of the"
+          " interval. 0 means that every request is sent to the encoder.",
+          0, G_MAXUINT, FS_RTP_KEYUNIT_MANAGER_DEFAULT_MIN_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_KEYFRAME_REQUESTS,
+      g_param_spec_uint ("keyframe-requests",
+          "Keyframe requests received",
+          "The number of PLI and FIR packets received for the SSRC of this"
+          " session",
+          0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_KEYFRAMES_FORCED,
+      g_param_spec_uint ("keyframes-forced",
+          "Keyframes requested from the encoder",
+          "The number of keyframes that have been requested from the encoder,"
+          " after the duplicates and the requests that came too close to each"
+          " other have been merged",
+          0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_BITRATE_ESTIMATOR,
+      g_param_spec_enum ("bitrate-estimator",
+          "Bitrate estimator",
+          "How the bitrate the sent video is adapted for is computed from the"
+          " bitrates estimated over the last seconds. Only for video"
+          " sessions.",
+          FS_TYPE_RTP_BITRATE_ADAPTER_ESTIMATOR,
+          FS_RTP_BITRATE_ADAPTER_DEFAULT_ESTIMATOR,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_BITRATE_PERCENTILE,
+      g_param_spec_uint ("bitrate-percentile",
+          "Bitrate percentile",
+          "The percentile of the estimated bitrates the sent video is adapted"
+          " for with the percentile estimator. Only for video sessions.",
+          0, 100, FS_RTP_BITRATE_ADAPTER_DEFAULT_PERCENTILE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_BITRATE_EWMA_WEIGHT,
+      g_param_spec_double ("bitrate-ewma-weight",
+          "Bitrate EWMA weight",
+          "The weight of each new estimated bitrate with the ewma estimator."
+          " Only for video sessions.",
+          0, 1, FS_RTP_BITRATE_ADAPTER_DEFAULT_EWMA_WEIGHT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_PACING_MAX_DELAY,
+      g_param_spec_uint ("pacing-max-delay",
+          "Maximum pacing delay (in ms)",
+          "The sent packets are spread out according to the send bitrate,"
+          " but faster if they would otherwise wait longer than this many"
+          " milliseconds. 0 means no limit. The packets are not paced"
+          " again when TFRC is in use, as it already paces them.",
+          0, G_MAXUINT, DEFAULT_PACING_MAX_DELAY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->dispose = fs_rtp_session_dispose;
   gobject_class->finalize = fs_rtp_session_finalize;
 
@@ -526,14 +768,27 @@ fs_rtp_session_init (FsRtpSession *self)
   g_mutex_init (&self->mutex);
 
   g_rw_lock_init (&self->priv->disposed_lock);
+  g_rw_lock_init (&self->priv->pt_table_lock);
+  self->priv->nego_cache = codec_negotiation_cache_new ();
 
   self->priv->media_type = FS_MEDIA_TYPE_LAST + 1;
 
   self->priv->no_rtcp_timeout = DEFAULT_NO_RTCP_TIMEOUT;
+  self->priv->simulcast_layers = DEFAULT_SIMULCAST_LAYERS;
+  self->priv->silence_threshold = DEFAULT_SILENCE_THRESHOLD;
+  self->priv->bitrate_estimator = FS_RTP_BITRATE_ADAPTER_DEFAULT_ESTIMATOR;
+  self->priv->bitrate_percentile = FS_RTP_BITRATE_ADAPTER_DEFAULT_PERCENTILE;
+  self->priv->bitrate_ewma_weight = FS_RTP_BITRATE_ADAPTER_DEFAULT_EWMA_WEIGHT;
+  self->priv->pacing_max_delay = DEFAULT_PACING_MAX_DELAY;
+  self->priv->forwarders = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->priv->routes = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->priv->mix_outputs = g_hash_table_new (g_direct_hash, g_direct_equal);
 
   self->priv->ssrc_streams = g_hash_table_new (g_direct_hash, g_direct_equal);
   self->priv->ssrc_streams_manual = g_hash_table_new (g_direct_hash,
       g_direct_equal);
+  self->priv->srtp_refused = g_hash_table_new_full (g_direct_hash,
+      g_direct_equal, NULL, g_free);
 
   g_queue_init (&self->priv->telephony_events);
 }
@@ -647,6 +902,7 @@ fs_rtp_session_dispose (GObject *obj)
       "gst-sink");
 
   stop_and_remove (conferencebin, &self->priv->transmitter_rtp_tee, TRUE);
+  stop_and_remove (conferencebin, &self->priv->send_pacer, TRUE);
   stop_and_remove (conferencebin, &self->priv->transmitter_rtcp_tee, TRUE);
 
   if (self->priv->rtpbin_send_rtcp_src)
@@ -717,7 +973,44 @@ fs_rtp_session_dispose (GObject *obj)
     }
   }
 
+  fs_rtp_session_remove_simulcast_layers (self, self->priv->simulcast);
+  self->priv->simulcast = NULL;
+
+  if (self->priv->forwarders)
+  {
+    GHashTableIter iter;
+    gpointer forwarder;
+
+    g_hash_table_iter_init (&iter, self->priv->forwarders);
+    while (g_hash_table_iter_next (&iter, NULL, &forwarder))
+    {
+      g_hash_table_iter_remove (&iter);
+      fs_rtp_session_remove_forwarder (self, forwarder);
+    }
+  }
+
+  /* The routes go with the transmitter tee */
+  if (self->priv->routes)
+    g_hash_table_remove_all (self->priv->routes);
+
+  if (self->priv->mix_outputs)
+  {
+    GHashTableIter iter;
+    gpointer stream, output;
+
+    g_hash_table_iter_init (&iter, self->priv->mix_outputs);
+    while (g_hash_table_iter_next (&iter, &stream, &output))
+    {
+      /* The stream may outlive the session */
+      FS_RTP_STREAM (stream)->mix_pad = NULL;
+      g_hash_table_iter_remove (&iter);
+      fs_rtp_session_remove_mix_output (self, output);
+    }
+  }
+  stop_and_remove (conferencebin, &self->priv->mixer, TRUE);
+
   stop_and_remove (conferencebin, &self->priv->rtpmuxer, TRUE);
+  stop_and_remove (conferencebin, &self->priv->send_funnel, TRUE);
   stop_and_remove (conferencebin, &self->priv->send_capsfilter, TRUE);
 
   while (self->priv->extra_send_capsfilters)
@@ -793,6 +1086,10 @@ fs_rtp_session_dispose (GObject *obj)
 
   if (self->priv->rtpbin_recv_rtp_sink)
   {
+    if (self->priv->levels_probe_id)
+      gst_pad_remove_probe (self->priv->rtpbin_recv_rtp_sink,
+          self->priv->levels_probe_id);
+    self->priv->levels_probe_id = 0;
     gst_pad_set_active (self->priv->rtpbin_recv_rtp_sink, FALSE);
     gst_element_release_request_pad (self->priv->conference->rtpbin,
       self->priv->rtpbin_recv_rtp_sink);
@@ -844,6 +1141,7 @@ fs_rtp_session_dispose (GObject *obj)
   self->priv->streams_cookie++;
   g_hash_table_remove_all (self->priv->ssrc_streams);
   g_hash_table_remove_all (self->priv->ssrc_streams_manual);
+  g_hash_table_remove_all (self->priv->srtp_refused);
 
   if (self->priv->transmitters)
   {
@@ -870,6 +1168,10 @@ fs_rtp_session_finalize (GObject *object)
   g_list_free_full (self->priv->codec_preferences,
       (GDestroyNotify) codec_preference_destroy);
   codec_association_list_destroy (self->priv->codec_associations);
+  codec_negotiation_cache_free (self->priv->nego_cache);
+  if (self->priv->pt_table)
+    codec_association_table_free (self->priv->pt_table);
+  g_rw_lock_clear (&self->priv->pt_table_lock);
 
   fs_rtp_header_extension_list_destroy (self->priv->hdrext_preferences);
   fs_rtp_header_extension_list_destroy (self->priv->hdrext_negotiated);
@@ -884,6 +1186,18 @@ fs_rtp_session_finalize (GObject *object)
     g_hash_table_destroy (self->priv->ssrc_streams);
   if (self->priv->ssrc_streams_manual)
     g_hash_table_destroy (self->priv->ssrc_streams_manual);
+  if (self->priv->srtp_refused)
+    g_hash_table_destroy (self->priv->srtp_refused);
+  if (self->priv->forwarders)
+    g_hash_table_destroy (self->priv->forwarders);
+  if (self->priv->routes)
+    g_hash_table_destroy (self->priv->routes);
+  if (self->priv->mix_outputs)
+    g_hash_table_destroy (self->priv->mix_outputs);
+  if (self->priv->speakers)
+    fs_rtp_speaker_selector_free (self->priv->speakers);
+  if (self->priv->levels)
+    fs_rtp_level_tracker_free (self->priv->levels);
 
   gst_caps_unref (self->priv->input_caps);
   gst_caps_unref (self->priv->output_caps);
@@ -922,6 +1236,40 @@ fs_rtp_session_has_disposed_exit (FsRtpSession *self)
   g_rw_lock_reader_unlock (&self->priv->disposed_lock);
 }
 
+/**
+ * fs_rtp_session_get_speaker_selector:
+ * @self: a #FsRtpSession
+ *
+ * Returns: The speaker selector if the session is mixing, it stays valid
+ *  until the session is finalized, or %NULL
+ */
+
+FsRtpSpeakerSelector *
+fs_rtp_session_get_speaker_selector (FsRtpSession *self)
+{
+  FsRtpSpeakerSelector *speakers;
+
+  FS_RTP_SESSION_LOCK (self);
+  speakers = self->priv->speakers;
+  FS_RTP_SESSION_UNLOCK (self);
+
+  return speakers;
+}
+
+/**
+ * fs_rtp_session_get_level_tracker:
+ * @self: a #FsRtpSession
+ *
+ * Returns: The level tracker of an audio session, it stays valid until the
+ *  session is finalized, or %NULL
+ */
+
+FsRtpLevelTracker *
+fs_rtp_session_get_level_tracker (FsRtpSession *self)
+{
+  return self->priv->levels;
+}
+
 static void
 fs_rtp_session_get_property (GObject *object,
                              guint prop_id,
@@ -1061,6 +1409,66 @@ fs_rtp_session_get_property (GObject *object,
     case PROP_INTERNAL_SESSION:
       g_value_set_object (value, self->priv->rtpbin_internal_session);
       break;
+    case PROP_SIMULCAST_LAYERS:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_uint (value, self->priv->simulcast_layers);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_MIXING_SPEAKERS:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_uint (value, self->priv->mixing_speakers);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_SILENCE_THRESHOLD:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_uint (value, self->priv->silence_threshold);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_MIN_KEYFRAME_INTERVAL:
+      if (self->priv->keyunit_manager)
+        g_value_set_uint (value, fs_rtp_keyunit_manager_get_min_interval (
+                self->priv->keyunit_manager));
+      break;
+    case PROP_KEYFRAME_REQUESTS:
+      if (self->priv->keyunit_manager)
+      {
+        guint requests;
+
+        fs_rtp_keyunit_manager_get_stats (self->priv->keyunit_manager,
+            &requests, NULL);
+        g_value_set_uint (value, requests);
+      }
+      break;
+    case PROP_KEYFRAMES_FORCED:
+      if (self->priv->keyunit_manager)
+      {
+        guint forced;
+
+        fs_rtp_keyunit_manager_get_stats (self->priv->keyunit_manager,
+            NULL, &forced);
+        g_value_set_uint (value, forced);
+      }
+      break;
+    case PROP_BITRATE_ESTIMATOR:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_enum (value, self->priv->bitrate_estimator);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_BITRATE_PERCENTILE:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_uint (value, self->priv->bitrate_percentile);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_BITRATE_EWMA_WEIGHT:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_double (value, self->priv->bitrate_ewma_weight);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_PACING_MAX_DELAY:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_uint (value, self->priv->pacing_max_delay);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1119,6 +1527,54 @@ fs_rtp_session_set_property (GObject *object,
     case PROP_SEND_BITRATE:
       fs_rtp_session_set_send_bitrate (self, g_value_get_uint (value));
       break;
+    case PROP_SIMULCAST_LAYERS:
+      if (self->priv->media_type != FS_MEDIA_TYPE_VIDEO)
+      {
+        GST_WARNING ("Simulcast is only supported for video sessions");
+        break;
+      }
+      FS_RTP_SESSION_LOCK (self);
+      if (self->priv->simulcast_layers == 1 && g_value_get_uint (value) > 1 &&
+          self->priv->streams)
+      {
+        /* The existing streams share a transmitter which would send them
+         * every layer */
+        GST_WARNING ("Simulcast can not be enabled once the session has"
+            " streams");
+      }
+      else if (self->priv->simulcast_layers != g_value_get_uint (value))
+      {
+        self->priv->simulcast_layers = g_value_get_uint (value);
+        self->priv->simulcast_changed = TRUE;
+        fs_rtp_session_verify_send_codec_bin_locked (self);
+      }
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_MIXING_SPEAKERS:
+      if (self->priv->media_type != FS_MEDIA_TYPE_AUDIO)
+      {
+        GST_WARNING ("Mixing is only supported for audio sessions");
+        break;
+      }
+      fs_rtp_session_set_mixing_speakers (self, g_value_get_uint (value));
+      break;
+    case PROP_SILENCE_THRESHOLD:
+      if (self->priv->media_type != FS_MEDIA_TYPE_AUDIO)
+      {
+        GST_WARNING ("The silence threshold only applies to audio sessions");
+        break;
+      }
+      FS_RTP_SESSION_LOCK (self);
+      self->priv->silence_threshold = g_value_get_uint (value);
+      fs_rtp_level_tracker_set_threshold (self->priv->levels,
+          self->priv->silence_threshold);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_MIN_KEYFRAME_INTERVAL:
+      if (self->priv->keyunit_manager)
+        fs_rtp_keyunit_manager_set_min_interval (self->priv->keyunit_manager,
+            g_value_get_uint (value));
+      break;
     case PROP_RTP_HEADER_EXTENSION_PREFERENCES:
       FS_RTP_SESSION_LOCK (self);
       fs_rtp_header_extension_list_destroy (self->priv->hdrext_preferences);
@@ -1127,6 +1583,32 @@ fs_rtp_session_set_property (GObject *object,
       /* This call can't fail because the codecs do NOT change */
       fs_rtp_session_update_codecs (self, NULL, NULL, NULL);
       break;
+    case PROP_BITRATE_ESTIMATOR:
+      FS_RTP_SESSION_LOCK (self);
+      self->priv->bitrate_estimator = g_value_get_enum (value);
+      fs_rtp_session_configure_bitrate_adapters_locked (self);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_BITRATE_PERCENTILE:
+      FS_RTP_SESSION_LOCK (self);
+      self->priv->bitrate_percentile = g_value_get_uint (value);
+      fs_rtp_session_configure_bitrate_adapters_locked (self);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_BITRATE_EWMA_WEIGHT:
+      FS_RTP_SESSION_LOCK (self);
+      self->priv->bitrate_ewma_weight = g_value_get_double (value);
+      fs_rtp_session_configure_bitrate_adapters_locked (self);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_PACING_MAX_DELAY:
+      FS_RTP_SESSION_LOCK (self);
+      self->priv->pacing_max_delay = g_value_get_uint (value);
+      if (self->priv->send_pacer)
+        g_object_set (self->priv->send_pacer, "max-delay",
+            self->priv->pacing_max_delay * GST_MSECOND, NULL);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1186,6 +1668,46 @@ _rtpbin_request_decoder (GstElement *rtpbin, guint session_id,
     return NULL;
 }
 
+/* The levels are read before the jitterbuffer, the header extensions are not
+ * encrypted by SRTP */
+static GstPadProbeReturn
+_levels_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  FsRtpSession *self = FS_RTP_SESSION (user_data);
+  GstStructure *s;
+  guint32 ssrc;
+  gboolean has_level;
+  guint8 level;
+  gboolean voice;
+  gboolean paused;
+
+  if (!fs_rtp_level_tracker_process (self->priv->levels,
+          GST_PAD_PROBE_INFO_BUFFER (info), &ssrc, &has_level, &level, &voice,
+          &paused))
+    return GST_PAD_PROBE_OK;
+
+  if (fs_rtp_session_has_disposed_enter (self, NULL))
+    return GST_PAD_PROBE_OK;
+
+  s = gst_structure_new ("farstream-rtp-audio-level",
+      "session", FS_TYPE_SESSION, self,
+      "ssrc", G_TYPE_UINT, ssrc,
+      "paused", G_TYPE_BOOLEAN, paused,
+      NULL);
+  if (has_level)
+    gst_structure_set (s,
+        "level", G_TYPE_UINT, (guint) level,
+        "voice", G_TYPE_BOOLEAN, voice,
+        NULL);
+
+  gst_element_post_message (GST_ELEMENT (self->priv->conference),
+      gst_message_new_element (GST_OBJECT (self->priv->conference), s));
+
+  fs_rtp_session_has_disposed_exit (self);
+
+  return GST_PAD_PROBE_OK;
+}
+
 static void
 fs_rtp_session_constructed (GObject *object)
 {
@@ -1195,10 +1717,12 @@ fs_rtp_session_constructed (GObject *object)
   GstElement *tee = NULL;
   GstElement *funnel = NULL;
   GstElement *muxer = NULL;
+  GstElement *pacer = NULL;
   GstPad *tee_sink_pad = NULL;
   GstPad *valve_sink_pad = NULL;
   GstPad *funnel_src_pad = NULL;
   GstPad *muxer_src_pad = NULL;
+  GstPad *muxer_peer_pad = NULL;
   GstPad *transmitter_rtcp_tee_sink_pad;
   GstPad *pad;
   GstPadLinkReturn ret;
@@ -1406,6 +1930,14 @@ fs_rtp_session_constructed (GObject *object)
          self->id);
      return;
   }
+  if (self->priv->media_type == FS_MEDIA_TYPE_AUDIO)
+  {
+    self->priv->levels =
+        fs_rtp_level_tracker_new (self->priv->silence_threshold);
+    self->priv->levels_probe_id =
+        gst_pad_add_probe (self->priv->rtpbin_recv_rtp_sink,
+            GST_PAD_PROBE_TYPE_BUFFER, _levels_probe, self, NULL);
+  }
   if (!self->priv->rtpbin_recv_rtcp_sink)
   {
      self->priv->construction_error = g_error_new (FS_ERROR,
@@ -1675,7 +2207,51 @@ fs_rtp_session_constructed (GObject *object)
 
   muxer_src_pad = gst_element_get_static_pad (muxer, "src");
 
-  ret = gst_pad_link (muxer_src_pad, self->priv->rtpbin_send_rtp_sink);
+  /* The simulcast layers and forwarded packets can not go through the muxer
+   * because it rewrites the SSRC, so they are merged with its output
+   */
+  tmp = g_strdup_printf ("send_rtp_funnel_%u", self->id);
+  funnel = gst_element_factory_make ("funnel", tmp);
+  g_free (tmp);
+
+  if (!funnel)
+  {
+    self->priv->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not create the send rtp funnel element");
+    gst_object_unref (muxer_src_pad);
+    return;
+  }
+
+  if (!gst_bin_add (GST_BIN (self->priv->conference), funnel))
+  {
+    self->priv->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not add the send rtp funnel element to the FsRtpConference");
+    gst_object_unref (funnel);
+    gst_object_unref (muxer_src_pad);
+    return;
+  }
+
+  self->priv->send_funnel = gst_object_ref (funnel);
+
+  funnel_src_pad = gst_element_get_static_pad (funnel, "src");
+  ret = gst_pad_link (funnel_src_pad, self->priv->rtpbin_send_rtp_sink);
+  gst_object_unref (funnel_src_pad);
+
+  if (GST_PAD_LINK_FAILED (ret))
+  {
+    self->priv->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not link the send rtp funnel to the rtpbin");
+    gst_object_unref (muxer_src_pad);
+    return;
+  }
+
+  muxer_peer_pad = gst_element_get_request_pad (funnel, "sink_%u");
+  gst_element_set_state (funnel, GST_STATE_PLAYING);
+
+  ret = gst_pad_link (muxer_src_pad, muxer_peer_pad);
 
   if (GST_PAD_LINK_FAILED (ret))
   {
@@ -1683,12 +2259,14 @@ fs_rtp_session_constructed (GObject *object)
         FS_ERROR_CONSTRUCTION,
         "Could not link pad %s with pad %s",
         GST_PAD_NAME (muxer_src_pad),
-        GST_PAD_NAME (self->priv->rtpbin_send_rtp_sink));
+        GST_PAD_NAME (muxer_peer_pad));
 
+    gst_object_unref (muxer_peer_pad);
     gst_object_unref (muxer_src_pad);
     return;
   }
 
+  gst_object_unref (muxer_peer_pad);
   gst_object_unref (muxer_src_pad);
 
   gst_element_set_state (muxer, GST_STATE_PLAYING);
@@ -1703,7 +2281,7 @@ fs_rtp_session_constructed (GObject *object)
   }
 
   self->priv->keyunit_manager = fs_rtp_keyunit_manager_new (
-    self->priv->rtpbin_internal_session);
+    self->priv->rtpbin_internal_session, self->priv->rtpbin_send_rtp_sink);
 
   /* Now create the transmitter RTP tee */
 
@@ -1732,14 +2310,43 @@ fs_rtp_session_constructed (GObject *object)
 
   self->priv->transmitter_rtp_tee = gst_object_ref (tee);
 
+  /* Now create the pacer that goes in front of the RTP tee */
+
+  pacer = fs_rtp_pacer_new ();
+
+  if (!gst_bin_add (GST_BIN (self->priv->conference), pacer))
+  {
+    self->priv->construction_error = g_error_new (FS_ERROR,
+      FS_ERROR_CONSTRUCTION,
+      "Could not add the rtp pacer element to the FsRtpConference");
+    gst_object_unref (pacer);
+    return;
+  }
+
+  self->priv->send_pacer = gst_object_ref (pacer);
+
+  g_object_set (pacer,
+      "bitrate", self->priv->send_bitrate,
+      "max-delay", self->priv->pacing_max_delay * GST_MSECOND,
+      NULL);
+
+  if (!gst_element_link (pacer, self->priv->transmitter_rtp_tee))
+  {
+    self->priv->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION, "Could not link rtp pacer to tee");
+    return;
+  }
+
+  gst_element_set_state (pacer, GST_STATE_PLAYING);
+
   tmp = g_strdup_printf ("send_rtp_src_%u", self->id);
   if (!gst_element_link_pads (
           self->priv->conference->rtpbin, tmp,
-          self->priv->transmitter_rtp_tee, "sink"))
+          self->priv->send_pacer, "sink"))
   {
     self->priv->construction_error = g_error_new (FS_ERROR,
         FS_ERROR_CONSTRUCTION,
-        "Could not link rtpbin %s pad to tee sink", tmp);
+        "Could not link rtpbin %s pad to pacer sink", tmp);
     g_free (tmp);
     return;
   }
@@ -1867,6 +2474,7 @@ fs_rtp_session_add_ssrc_stream_locked (FsRtpSession *self, guint32 ssrc,
   {
     g_hash_table_insert (self->priv->ssrc_streams, GUINT_TO_POINTER (ssrc),
         stream);
+    g_hash_table_remove (self->priv->srtp_refused, GUINT_TO_POINTER (ssrc));
     if (self->priv->srtpdec)
       g_signal_emit_by_name (self->priv->srtpdec, "remove-key", ssrc);
     return TRUE;
@@ -1978,9 +2586,26 @@ _stream_sending_changed_locked (FsRtpStream *stream, gboolean sending,
     g_object_set (session->priv->rtp_tfrc, "sending",
         (session->priv->streams_sending > 0), NULL);
 
+  /* The direction of the stream is only updated after this callback */
+  fs_rtp_session_update_simulcast_locked (session, stream, sending);
+
   fs_rtp_session_has_disposed_exit (session);
 }
 
+static void
+_stream_notify_simulcast_layer (FsRtpStream *stream, GParamSpec *pspec,
+    FsRtpSession *self)
+{
+  if (fs_rtp_session_has_disposed_enter (self, NULL))
+    return;
+
+  FS_RTP_SESSION_LOCK (self);
+  fs_rtp_session_update_simulcast_locked (self, NULL, FALSE);
+  FS_RTP_SESSION_UNLOCK (self);
+
+  fs_rtp_session_has_disposed_exit (self);
+}
+
 static void
 _stream_ssrc_added_cb (FsRtpStream *stream, guint32 ssrc, gpointer user_data)
 {
@@ -2012,6 +2637,11 @@ _remove_stream (gpointer user_data,
     GObject *where_the_object_was)
 {
   FsRtpSession *self = FS_RTP_SESSION (user_data);
+  GstElement *forwarder;
+  FsRtpSessionMixOutput *mix_output;
+  FsRtpSessionRoute *route;
+  FsTransmitter *transmitter = NULL;
+  gulong probe_id = 0;
 
   if (fs_rtp_session_has_disposed_enter (self, NULL))
     return;
@@ -2025,8 +2655,44 @@ _remove_stream (gpointer user_data,
       where_the_object_was);
   g_hash_table_foreach_remove (self->priv->ssrc_streams_manual,
       _remove_stream_from_ht, where_the_object_was);
+  g_hash_table_remove_all (self->priv->srtp_refused);
+
+  forwarder = g_hash_table_lookup (self->priv->forwarders,
+      where_the_object_was);
+  g_hash_table_remove (self->priv->forwarders, where_the_object_was);
+
+  mix_output = g_hash_table_lookup (self->priv->mix_outputs,
+      where_the_object_was);
+  g_hash_table_remove (self->priv->mix_outputs, where_the_object_was);
+
+  /* The transmitter of its own goes with the stream */
+  route = g_hash_table_lookup (self->priv->routes, where_the_object_was);
+  if (route)
+  {
+    transmitter = g_hash_table_lookup (self->priv->transmitters,
+        route->transmitter_key);
+    if (transmitter)
+    {
+      g_object_ref (transmitter);
+      g_hash_table_remove (self->priv->transmitters, route->transmitter_key);
+    }
+    probe_id = route->probe_id;
+    g_hash_table_remove (self->priv->routes, where_the_object_was);
+  }
+
+  /* The stream's choice of layer does not count anymore */
+  fs_rtp_session_update_simulcast_locked (self, NULL, FALSE);
   FS_RTP_SESSION_UNLOCK (self);
 
+  if (transmitter)
+    fs_rtp_session_remove_stream_transmitter (self, transmitter, probe_id);
+
+  if (forwarder)
+    fs_rtp_session_remove_forwarder (self, forwarder);
+
+  if (mix_output)
+    fs_rtp_session_remove_mix_output (self, mix_output);
+
   fs_rtp_session_has_disposed_exit (self);
 }
 
@@ -2082,6 +2748,11 @@ fs_rtp_session_new_stream (FsSession *session,
     self->priv->streams = g_list_append (self->priv->streams, new_stream);
     self->priv->streams_cookie++;
     FS_RTP_SESSION_UNLOCK (self);
+
+    g_signal_connect_object (new_stream, "notify::simulcast-layer",
+        G_CALLBACK (_stream_notify_simulcast_layer), self, 0);
+
+    fs_rtp_session_add_mix_output (self, FS_RTP_STREAM (new_stream));
   }
 
   g_object_weak_ref (G_OBJECT (new_stream), _remove_stream, self);
@@ -2432,24 +3103,14 @@ GstCaps *
 fs_rtp_session_request_pt_map (FsRtpSession *session, guint pt)
 {
   GstCaps *caps = NULL;
-  CodecAssociation *ca = NULL;
 
   if (fs_rtp_session_has_disposed_enter (session, NULL))
     return NULL;
 
-  FS_RTP_SESSION_LOCK (session);
-
-  ca = lookup_codec_association_by_pt (
-      session->priv->codec_associations, pt);
-
-  if (ca)
-  {
-    FsCodec *tmpcodec = codec_copy_filtered (ca->codec, FS_PARAM_TYPE_CONFIG);
-    caps = fs_codec_to_gst_caps (tmpcodec);
-    fs_codec_destroy (tmpcodec);
-  }
-
-  FS_RTP_SESSION_UNLOCK (session);
+  g_rw_lock_reader_lock (&session->priv->pt_table_lock);
+  if (session->priv->pt_table)
+    caps = codec_association_table_get_caps (session->priv->pt_table, pt);
+  g_rw_lock_reader_unlock (&session->priv->pt_table_lock);
 
   if (!caps)
     GST_WARNING ("Could not get caps for payload type %u in session %d",
@@ -2517,9 +3178,109 @@ _transmitter_error (
   fs_session_emit_error (session, errorno, error_msg);
 }
 
+static FsRtpSessionRoute *
+fs_rtp_session_route_new (void)
+{
+  FsRtpSessionRoute *route = g_slice_new0 (FsRtpSessionRoute);
+
+  g_mutex_init (&route->mutex);
+  route->ssrcs = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  return route;
+}
+
+static void
+fs_rtp_session_route_free (gpointer data)
+{
+  FsRtpSessionRoute *route = data;
+
+  g_hash_table_destroy (route->ssrcs);
+  g_free (route->transmitter_key);
+  g_mutex_clear (&route->mutex);
+  g_slice_free (FsRtpSessionRoute, route);
+}
+
+/* The packets may be encrypted, only the header is read */
+
+static gboolean
+route_lets_through (FsRtpSessionRoute *route, GstBuffer *buffer)
+{
+  guint8 header[12];
+  gpointer value;
+  guint32 ssrc;
+  gboolean ret;
+
+  if (gst_buffer_extract (buffer, 0, header, sizeof (header)) !=
+      sizeof (header) || (header[0] >> 6) != 2)
+    return TRUE;
+
+  ssrc = GST_READ_UINT32_BE (header + 8);
+
+  g_mutex_lock (&route->mutex);
+  if (!route->configured)
+    ret = FALSE;
+  else if (g_hash_table_lookup_extended (route->ssrcs,
+          GUINT_TO_POINTER (ssrc), NULL, &value))
+    ret = GPOINTER_TO_INT (value);
+  else
+    ret = route->main;
+  g_mutex_unlock (&route->mutex);
+
+  return ret;
+}
+
+static GstPadProbeReturn
+_route_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  FsRtpSessionRoute *route = user_data;
+  GstBufferList *list, *filtered;
+  guint len, i;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER)
+  {
+    if (route_lets_through (route, GST_PAD_PROBE_INFO_BUFFER (info)))
+      return GST_PAD_PROBE_OK;
+    else
+      return GST_PAD_PROBE_DROP;
+  }
+
+  list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+  len = gst_buffer_list_length (list);
+  filtered = gst_buffer_list_new_sized (len);
+  for (i = 0; i < len; i++)
+  {
+    GstBuffer *buffer = gst_buffer_list_get (list, i);
+
+    if (route_lets_through (route, buffer))
+      gst_buffer_list_add (filtered, gst_buffer_ref (buffer));
+  }
+
+  if (gst_buffer_list_length (filtered) == len)
+  {
+    gst_buffer_list_unref (filtered);
+    return GST_PAD_PROBE_OK;
+  }
+  else if (gst_buffer_list_length (filtered) == 0)
+  {
+    gst_buffer_list_unref (filtered);
+    return GST_PAD_PROBE_DROP;
+  }
+
+  gst_buffer_list_unref (list);
+  GST_PAD_PROBE_INFO_DATA (info) = filtered;
+
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * The packets meant for a stream with a transmitter of its own are chosen
+ * by @route
+ */
+
 static gboolean
 fs_rtp_session_add_transmitter_gst_sink (FsRtpSession *self,
     FsTransmitter *transmitter,
+    FsRtpSessionRoute *route,
     GError **error)
 {
   GstElement *sink;
@@ -2540,6 +3301,18 @@ fs_rtp_session_add_transmitter_gst_sink (FsRtpSession *self,
       "rtp tee", sink, "sink_1", GST_PAD_SINK, error))
     goto error;
 
+  if (route)
+  {
+    GstPad *pad = gst_element_get_static_pad (sink, "sink_1");
+    GstPad *tee_pad = gst_pad_get_peer (pad);
+
+    route->probe_id = gst_pad_add_probe (tee_pad,
+        GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+        _route_probe, route, fs_rtp_session_route_free);
+    gst_object_unref (tee_pad);
+    gst_object_unref (pad);
+  }
+
   if (!_get_request_pad_and_link (self->priv->transmitter_rtcp_tee,
       "rtcp tee", sink, "sink_2", GST_PAD_SINK, error))
     goto error;
@@ -2555,34 +3328,48 @@ fs_rtp_session_add_transmitter_gst_sink (FsRtpSession *self,
   return FALSE;
 }
 
+static gchar *
+transmitter_key (const gchar *transmitter_name, FsRtpStream *stream)
+{
+  if (stream)
+    return g_strdup_printf ("%s-%p", transmitter_name, stream);
+  else
+    return g_strdup (transmitter_name);
+}
+
 /**
  * fs_rtp_session_get_transmitter:
  * @self: a #FsRtpSession
  * @transmitter_name: The name of the transmitter
+ * @stream: The #FsRtpStream that gets a transmitter of its own or %NULL
  * @error: a #GError or %NULL
  *
  * Returns the requested #FsTransmitter, possibly creating it if it
- * does not exist.
+ * does not exist. The transmitters are shared by all the streams of the
+ * session, unless a @stream is given.
  *
  * Returns: a #FsTransmitter or %NULL on error
  */
 static FsTransmitter *
 fs_rtp_session_get_transmitter (FsRtpSession *self,
     const gchar *transmitter_name,
+    FsRtpStream *stream,
     GError **error)
 {
   FsTransmitter *transmitter;
+  FsRtpSessionRoute *route = NULL;
   GstElement *src = NULL;
+  gchar *key = transmitter_key (transmitter_name, stream);
   guint tos;
 
   FS_RTP_SESSION_LOCK (self);
-  transmitter = g_hash_table_lookup (self->priv->transmitters,
-    transmitter_name);
+  transmitter = g_hash_table_lookup (self->priv->transmitters, key);
 
   if (transmitter)
   {
     g_object_ref (transmitter);
     FS_RTP_SESSION_UNLOCK (self);
+    g_free (key);
     return transmitter;
   }
   tos = self->priv->tos;
@@ -2590,13 +3377,28 @@ fs_rtp_session_get_transmitter (FsRtpSession *self,
 
   transmitter = fs_transmitter_new (transmitter_name, 2, tos, error);
   if (!transmitter)
+  {
+    g_free (key);
     return NULL;
+  }
 
   g_signal_connect (transmitter, "error", G_CALLBACK (_transmitter_error),
       self);
 
-  if (!fs_rtp_session_add_transmitter_gst_sink (self, transmitter, error))
+  /* The probe owns the route */
+  if (stream)
+  {
+    route = fs_rtp_session_route_new ();
+    route->transmitter_key = g_strdup (key);
+  }
+
+  if (!fs_rtp_session_add_transmitter_gst_sink (self, transmitter, route,
+          error))
+  {
+    if (route && !route->probe_id)
+      fs_rtp_session_route_free (route);
     goto error;
+  }
 
   g_object_get (transmitter, "gst-src", &src, NULL);
 
@@ -2620,7 +3422,7 @@ fs_rtp_session_get_transmitter (FsRtpSession *self,
 
   FS_RTP_SESSION_LOCK (self);
   /* Check if two were added at the same time */
-  if (g_hash_table_lookup (self->priv->transmitters, transmitter_name))
+  if (g_hash_table_lookup (self->priv->transmitters, key))
   {
     FS_RTP_SESSION_UNLOCK (self);
 
@@ -2631,8 +3433,14 @@ fs_rtp_session_get_transmitter (FsRtpSession *self,
 
   g_object_ref (transmitter);
 
-  g_hash_table_insert (self->priv->transmitters, g_strdup (transmitter_name),
-      transmitter);
+  g_hash_table_insert (self->priv->transmitters, key, transmitter);
+  key = NULL;
+
+  if (route)
+  {
+    g_hash_table_insert (self->priv->routes, stream, route);
+    fs_rtp_session_update_simulcast_locked (self, NULL, FALSE);
+  }
   FS_RTP_SESSION_UNLOCK (self);
 
   gst_object_unref (src);
@@ -2646,6 +3454,7 @@ fs_rtp_session_get_transmitter (FsRtpSession *self,
   */
 
  error:
+  g_free (key);
   if (src)
     gst_object_unref (src);
   if (transmitter)
@@ -2654,6 +3463,53 @@ fs_rtp_session_get_transmitter (FsRtpSession *self,
   return NULL;
 }
 
+static void
+release_transmitter_request_pad (GstElement *tee_funnel,
+    GstElement *sinksrc, const gchar *sinksrc_padname, gulong probe_id)
+{
+  GstPad *pad = gst_element_get_static_pad (sinksrc, sinksrc_padname);
+  GstPad *requestpad = gst_pad_get_peer (pad);
+
+  if (requestpad)
+  {
+    if (probe_id)
+      gst_pad_remove_probe (requestpad, probe_id);
+    gst_element_release_request_pad (tee_funnel, requestpad);
+    gst_object_unref (requestpad);
+  }
+
+  gst_object_unref (pad);
+}
+
+/*
+ * Removes the transmitter of a stream that had one of its own, the route of
+ * the stream goes with its probe
+ */
+
+static void
+fs_rtp_session_remove_stream_transmitter (FsRtpSession *self,
+    FsTransmitter *transmitter, gulong probe_id)
+{
+  GstElement *src, *sink;
+
+  g_object_get (transmitter, "gst-sink", &sink, "gst-src", &src, NULL);
+
+  release_transmitter_request_pad (self->priv->transmitter_rtp_tee, sink,
+      "sink_1", probe_id);
+  release_transmitter_request_pad (self->priv->transmitter_rtcp_tee, sink,
+      "sink_2", 0);
+  release_transmitter_request_pad (self->priv->transmitter_rtp_funnel, src,
+      "src_1", 0);
+  release_transmitter_request_pad (self->priv->transmitter_rtcp_funnel, src,
+      "src_2", 0);
+
+  gst_object_unref (src);
+  gst_object_unref (sink);
+
+  _remove_transmitter (NULL, transmitter, self);
+  g_object_unref (transmitter);
+}
+
 
 static FsStreamTransmitter *
 _stream_get_new_stream_transmitter (FsRtpStream *stream,
@@ -2667,11 +3523,24 @@ _stream_get_new_stream_transmitter (FsRtpStream *stream,
   FsTransmitter *transmitter;
   FsStreamTransmitter *st = NULL;
   FsRtpSession *self = user_data;
+  gboolean own_transmitter;
 
   if (fs_rtp_session_has_disposed_enter (self, error))
     return NULL;
 
-  transmitter = fs_rtp_session_get_transmitter (self, transmitter_name, error);
+  /*
+   * The transmitters send everything to all of their streams, so a stream
+   * needs one of its own to only get the simulcast layer it selected or to
+   * not get back its own forwarded packets.
+   */
+  FS_RTP_SESSION_LOCK (self);
+  own_transmitter = (self->priv->simulcast_layers > 1);
+  FS_RTP_SESSION_UNLOCK (self);
+  if (fs_rtp_conference_is_forwarding (self->priv->conference))
+    own_transmitter = TRUE;
+
+  transmitter = fs_rtp_session_get_transmitter (self, transmitter_name,
+      own_transmitter ? stream : NULL, error);
 
   if (!transmitter)
   {
@@ -2714,6 +3583,84 @@ fs_rtp_session_get_stream_by_ssrc_locked (FsRtpSession *self,
 }
 
 
+typedef struct {
+  FsCodec *codec;
+  CodecBlueprint *blueprint;
+} PrewarmCodec;
+
+static void
+prewarm_codec_free (PrewarmCodec *prewarm)
+{
+  fs_codec_destroy (prewarm->codec);
+  g_slice_free (PrewarmCodec, prewarm);
+}
+
+/**
+ * fs_rtp_session_get_prewarm_codecs_locked
+ * @session: A #FsRtpSession
+ *
+ * Lists the negotiated codecs whose receive codec bins can be built ahead of
+ * time, with their blueprints. The blueprints belong to the session.
+ *
+ * Returns: a #GList of #PrewarmCodec, free it with
+ * fs_rtp_session_prewarm_recv_codec_bins()
+ */
+
+static GList *
+fs_rtp_session_get_prewarm_codecs_locked (FsRtpSession *session)
+{
+  GList *prewarm_codecs = NULL;
+  GList *item;
+
+  for (item = session->priv->codec_associations; item; item = item->next)
+  {
+    CodecAssociation *ca = item->data;
+    PrewarmCodec *prewarm;
+
+    if (ca->disable || ca->reserved || ca->recv_profile || !ca->blueprint ||
+        !codec_blueprint_has_factory (ca->blueprint, FS_DIRECTION_RECV))
+      continue;
+
+    prewarm = g_slice_new (PrewarmCodec);
+    prewarm->codec = fs_codec_copy (ca->codec);
+    prewarm->blueprint = ca->blueprint;
+    prewarm_codecs = g_list_prepend (prewarm_codecs, prewarm);
+  }
+
+  return g_list_reverse (prewarm_codecs);
+}
+
+/**
+ * fs_rtp_session_prewarm_recv_codec_bins
+ * @session: A #FsRtpSession
+ * @prewarm_codecs: The list from fs_rtp_session_get_prewarm_codecs_locked(),
+ *  this function frees it
+ *
+ * Builds the receive codec bins of the negotiated codecs ahead of time in the
+ * conference's pool, so that the streaming thread does not have to build them
+ * when the first packet of a new substream arrives. Building them takes a
+ * while, so it must be called without the session lock.
+ */
+
+static void
+fs_rtp_session_prewarm_recv_codec_bins (FsRtpSession *session,
+    GList *prewarm_codecs)
+{
+  FsRtpCodecBinPool *pool =
+    fs_rtp_conference_get_codec_bin_pool (session->priv->conference);
+  GList *item;
+
+  for (item = prewarm_codecs; item; item = item->next)
+  {
+    PrewarmCodec *prewarm = item->data;
+
+    fs_rtp_codec_bin_pool_prewarm (pool, prewarm->codec, prewarm->blueprint,
+        FS_DIRECTION_RECV);
+  }
+
+  g_list_free_full (prewarm_codecs, (GDestroyNotify) prewarm_codec_free);
+}
+
 /**
  * fs_rtp_session_verify_recv_codecs_locked
  * @session: A #FsRtpSession
@@ -2879,6 +3826,8 @@ fs_rtp_session_negotiate_codecs_locked (FsRtpSession *session,
   gint streams_with_codecs = 0;
   gboolean has_many_streams = FALSE;
   GList *new_negotiated_codec_associations = NULL;
+  CodecAssociationTable *new_pt_table;
+  CodecAssociationTable *old_pt_table;
   GList *item;
   guint8 hdrext_used_ids[8];
   GList *new_hdrexts = NULL;
@@ -2904,10 +3853,14 @@ fs_rtp_session_negotiate_codecs_locked (FsRtpSession *session,
   if (streams_with_codecs >= 2)
     has_many_streams = TRUE;
 
+  codec_negotiation_cache_begin (session->priv->nego_cache,
+      session->priv->codec_preferences_generation, session->priv->input_caps,
+      session->priv->output_caps);
+
   new_negotiated_codec_associations = create_local_codec_associations (
       session->priv->blueprints, session->priv->codec_preferences,
       session->priv->codec_associations, session->priv->input_caps,
-      session->priv->output_caps);
+      session->priv->output_caps, session->priv->nego_cache);
 
   if (!new_negotiated_codec_associations)
   {
@@ -2938,7 +3891,9 @@ fs_rtp_session_negotiate_codecs_locked (FsRtpSession *session,
 
       *has_remotes = TRUE;
 
-      tmp_codec_associations = negotiate_stream_codecs (codecs,
+      /* Only the streams from the first one that changed are negotiated */
+      tmp_codec_associations = codec_negotiation_cache_negotiate_stream (
+          session->priv->nego_cache, codecs,
           new_negotiated_codec_associations, has_many_streams);
 
       codec_association_list_destroy (new_negotiated_codec_associations);
@@ -2978,11 +3933,27 @@ fs_rtp_session_negotiate_codecs_locked (FsRtpSession *session,
   codec_association_list_destroy (session->priv->codec_associations);
   session->priv->codec_associations = new_negotiated_codec_associations;
 
+  new_pt_table = codec_association_table_new (
+      new_negotiated_codec_associations);
+  g_rw_lock_writer_lock (&session->priv->pt_table_lock);
+  old_pt_table = session->priv->pt_table;
+  session->priv->pt_table = new_pt_table;
+  g_rw_lock_writer_unlock (&session->priv->pt_table_lock);
+  if (old_pt_table)
+    codec_association_table_free (old_pt_table);
+
   new_hdrexts = finish_header_extensions_nego (new_hdrexts, hdrext_used_ids);
 
   fs_rtp_header_extension_list_destroy (session->priv->hdrext_negotiated);
   session->priv->hdrext_negotiated = new_hdrexts;
 
+  if (session->priv->speakers)
+    fs_rtp_speaker_selector_set_extension_id (session->priv->speakers,
+        fs_rtp_audio_level_find_extension_id (new_hdrexts));
+  if (session->priv->levels)
+    fs_rtp_level_tracker_set_extension_id (session->priv->levels,
+        fs_rtp_audio_level_find_extension_id (new_hdrexts));
+
   return TRUE;
 
  error:
@@ -3018,6 +3989,7 @@ fs_rtp_session_update_codecs (FsRtpSession *session,
 {
   gboolean is_new = TRUE;
   gboolean has_remotes = FALSE;
+  GList *prewarm_codecs = NULL;
 
   FS_RTP_SESSION_LOCK (session);
 
@@ -3029,17 +4001,24 @@ fs_rtp_session_update_codecs (FsRtpSession *session,
   }
 
   if (session->priv->rtp_tfrc)
+  {
     fs_rtp_tfrc_codecs_updated (session->priv->rtp_tfrc,
         session->priv->codec_associations,
         session->priv->hdrext_negotiated);
+    fs_rtp_session_set_pacer_bitrate_locked (session,
+        session->priv->send_bitrate);
+  }
 
   fs_rtp_session_distribute_recv_codecs_locked (session, stream, remote_codecs);
 
   fs_rtp_session_verify_recv_codecs_locked (session);
 
   if (is_new)
+  {
     g_signal_emit_by_name (session->priv->conference->rtpbin,
         "clear-pt-map");
+    prewarm_codecs = fs_rtp_session_get_prewarm_codecs_locked (session);
+  }
 
   fs_rtp_session_start_codec_param_gathering_locked (session);
 
@@ -3050,6 +4029,8 @@ fs_rtp_session_update_codecs (FsRtpSession *session,
 
   FS_RTP_SESSION_UNLOCK (session);
 
+  fs_rtp_session_prewarm_recv_codec_bins (session, prewarm_codecs);
+
   if (is_new)
   {
     g_object_notify (G_OBJECT (session), "codecs");
@@ -3230,6 +4211,12 @@ fs_rtp_session_new_recv_pad (FsRtpSession *session, GstPad *new_pad,
   g_signal_connect_object (substream, "get-codec-bin",
       G_CALLBACK (_substream_get_codec_bin), session, 0);
 
+  g_signal_connect_object (substream, "get-forward-pad",
+      G_CALLBACK (_substream_get_forward_pad), session, 0);
+
+  g_signal_connect_object (substream, "get-mix-pad",
+      G_CALLBACK (_substream_get_mix_pad), session, 0);
+
   g_signal_connect_object (substream, "unlinked",
       G_CALLBACK (_substream_unlinked), session, 0);
 
@@ -3355,9 +4342,15 @@ validate_src_pads (const GValue *item, GValue *ret, gpointer user_data)
 }
 
 
+/*
+ * If @pool is non-NULL, blueprint based codec bins are taken from it, and
+ * must be given back with fs_rtp_codec_bin_pool_recycle().
+ */
+
 static GstElement *
 _create_codec_bin (const CodecAssociation *ca, const FsCodec *codec,
     const gchar *name, FsStreamDirection direction, GList *codecs,
+    FsRtpCodecBinPool *pool,
     guint current_builder_hash, guint *new_builder_hash, GError **error)
 {
   GstElement *codec_bin = NULL;
@@ -3473,8 +4466,12 @@ _create_codec_bin (const CodecAssociation *ca, const FsCodec *codec,
     return NULL;
   }
 
-  return create_codec_bin_from_blueprint (codec, ca->blueprint, name,
-      direction, error);
+  if (pool)
+    return fs_rtp_codec_bin_pool_checkout (pool, codec, ca->blueprint, name,
+        direction, error);
+  else
+    return create_codec_bin_from_blueprint (codec, ca->blueprint, name,
+        direction, error);
 }
 
 /**
@@ -3932,7 +4929,7 @@ fs_rtp_session_add_send_codec_bin_unlock (FsRtpSession *session,
   codecs = codec_associations_to_send_codecs (
       session->priv->codec_associations);
   codecbin = _create_codec_bin (ca, ca->send_codec, name, FS_DIRECTION_SEND,
-      codecs, 0, NULL, error);
+      codecs, NULL, 0, NULL, error);
   g_free (name);
 
   sendcaps = fs_codec_to_gst_caps (ca->send_codec);
@@ -4106,103 +5103,359 @@ fs_rtp_session_add_send_codec_bin_unlock (FsRtpSession *session,
   return NULL;
 }
 
-/**
- * _send_src_pad_blocked_callback:
- *
- * This is the callback for the pad blocking on the media src pad
- * It is used to replace the codec bin when the send codec has been changed.
+/*
+ * Removes simulcast layers that are not in the session's list anymore,
+ * frees the list.
  */
 
-static GstPadProbeReturn
-_send_src_pad_blocked_callback (GstPad *pad, GstPadProbeInfo *info,
-    gpointer user_data)
+static void
+fs_rtp_session_remove_simulcast_layers (FsRtpSession *self, GList *layers)
 {
-  FsRtpSession *self = FS_RTP_SESSION (user_data);
-  CodecAssociation *ca = NULL;
-  FsCodec *send_codec_copy = NULL;
-  FsCodec *codec_copy = NULL;
-  GError *error = NULL;
-  gboolean changed = FALSE;
-  GList *other_codecs = NULL;
+  GList *item;
 
-  if (fs_rtp_session_has_disposed_enter (self, NULL))
+  for (item = layers; item; item = g_list_next (item))
   {
-    FS_RTP_SESSION_LOCK (self);
-    self->priv->send_pad_block_id = 0;
-    FS_RTP_SESSION_UNLOCK (self);
-    return GST_PAD_PROBE_REMOVE;
-  }
-
-  FS_RTP_SESSION_LOCK (self);
-  self->priv->send_pad_block_id = 0;
+    FsRtpSimulcastLayer *layer = item->data;
 
-  ca = fs_rtp_session_select_send_codec_locked (self, &error);
-
-  if (!ca)
-  {
-    g_prefix_error (&error, "Could not select a new send codec: ");
-    fs_session_emit_error (FS_SESSION (self), error->code, error->message);
-    goto done_locked;
-  }
+    /* Unlink it from the tee first so that no more data comes in */
+    if (layer->tee_pad)
+      gst_element_release_request_pad (self->priv->send_tee, layer->tee_pad);
 
-  g_clear_error (&error);
+    gst_element_set_locked_state (layer->bin, TRUE);
+    if (gst_element_set_state (layer->bin, GST_STATE_NULL) !=
+        GST_STATE_CHANGE_SUCCESS)
+      GST_WARNING ("Could not set simulcast layer %u to GST_STATE_NULL",
+          layer->index);
 
-  send_codec_copy = fs_codec_copy (ca->send_codec);
-  if (fs_codec_are_equal (ca->codec, self->priv->current_send_codec))
-  {
-    codec_copy = fs_codec_copy (ca->codec);
-    FS_RTP_SESSION_UNLOCK (self);
+    if (layer->funnel_pad)
+      gst_element_release_request_pad (self->priv->send_funnel,
+          layer->funnel_pad);
 
-    /* If the main codec has not changed, the special codecs could still
-     * have changed, so lets try to see if it is necessary to do something
-     * about it.
-     */
+    if (GST_OBJECT_PARENT (layer->bin))
+      gst_bin_remove (GST_BIN (self->priv->conference), layer->bin);
 
-    changed |= fs_rtp_special_sources_remove (
-        &self->priv->extra_sources,
-        &self->priv->codec_associations,
-        FS_RTP_SESSION_GET_LOCK (self),
-        codec_copy,
-        special_source_stopped, self);
-    goto skip_main_codec;
+    fs_rtp_simulcast_layer_free (layer);
   }
 
-  FS_RTP_SESSION_UNLOCK (self);
-
-  g_object_set (self->priv->media_sink_valve, "drop", TRUE, NULL);
+  g_list_free (layers);
+}
 
-  if (!fs_rtp_session_remove_send_codec_bin (self, send_codec_copy, NULL, TRUE))
-    goto done;
+static gboolean
+fs_rtp_session_ssrc_is_used_locked (FsRtpSession *self, guint32 ssrc,
+    guint32 internal_ssrc, GList *layers)
+{
+  GHashTableIter iter;
+  gpointer value;
+  GList *item;
+  guint i;
 
+  if (ssrc == internal_ssrc ||
+      g_hash_table_lookup (self->priv->ssrc_streams, GUINT_TO_POINTER (ssrc)) ||
+      g_hash_table_lookup (self->priv->ssrc_streams_manual,
+          GUINT_TO_POINTER (ssrc)))
+    return TRUE;
 
-  FS_RTP_SESSION_LOCK (self);
-  /* We have to re-fetch the ca because we lifted the lock */
-  fs_codec_destroy (send_codec_copy);
-  send_codec_copy = NULL;
-  ca = fs_rtp_session_select_send_codec_locked (self, &error);
+  for (item = layers; item; item = g_list_next (item))
+    if (((FsRtpSimulcastLayer *) item->data)->ssrc == ssrc)
+      return TRUE;
 
-  if (!ca)
+  g_hash_table_iter_init (&iter, self->priv->forwarders);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
   {
-    g_prefix_error (&error, "Could not select a new send codec: ");
-    fs_session_emit_error (FS_SESSION (self), error->code,
-        error->message);
-    goto done_locked;
+    for (i = 0; i < FS_RTP_SIMULCAST_MAX_LAYERS; i++)
+    {
+      guint32 output_ssrc;
+
+      if (fs_rtp_forwarder_get_output_ssrc (value, i, &output_ssrc) &&
+          output_ssrc == ssrc)
+        return TRUE;
+    }
   }
 
-  g_clear_error (&error);
+  return FALSE;
+}
 
-  send_codec_copy = fs_codec_copy (ca->send_codec);
-  codec_copy = fs_codec_copy (ca->codec);
+/*
+ * Draws an SSRC for a simulcast layer that is not used by the main
+ * encoding, a known remote source, a forwarded source or one of @layers
+ */
 
-  if (!fs_rtp_session_add_send_codec_bin_unlock (self, ca, &other_codecs,
-          &error))
-  {
-    g_prefix_error (&error, "Could not build a new send codec bin: ");
-    fs_session_emit_error (FS_SESSION (self), error->code,
-        error->message);
-  }
+static guint32
+fs_rtp_session_new_simulcast_ssrc_locked (FsRtpSession *self,
+    guint32 internal_ssrc, GList *layers)
+{
+  guint32 ssrc;
 
-  changed = TRUE;
+  do {
+    ssrc = g_random_int ();
+  } while (fs_rtp_session_ssrc_is_used_locked (self, ssrc, internal_ssrc,
+          layers));
+
+  return ssrc;
+}
+
+static FsRtpSimulcastLayer *
+fs_rtp_session_add_simulcast_layer (FsRtpSession *self, guint index,
+    guint32 ssrc, GstElement *codecbin, GError **error)
+{
+  FsRtpSimulcastLayer *layer;
+  GstPad *pad;
+  GstPadLinkReturn ret;
+
+  layer = fs_rtp_simulcast_layer_new (self->id, index, ssrc, codecbin,
+      error);
+  if (!layer)
+    return NULL;
+
+  gst_element_set_locked_state (layer->bin, TRUE);
+
+  if (!gst_bin_add (GST_BIN (self->priv->conference), layer->bin))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not add simulcast layer %u to the conference", index);
+    goto error;
+  }
+
+  layer->funnel_pad = gst_element_get_request_pad (self->priv->send_funnel,
+      "sink_%u");
+  pad = gst_element_get_static_pad (layer->bin, "src");
+  ret = gst_pad_link (pad, layer->funnel_pad);
+  gst_object_unref (pad);
+
+  if (GST_PAD_LINK_FAILED (ret))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link simulcast layer %u to the send funnel", index);
+    goto error;
+  }
+
+  gst_element_set_locked_state (layer->bin, FALSE);
+  if (!gst_element_sync_state_with_parent (layer->bin))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not sync the state of simulcast layer %u with the state"
+        " of the conference", index);
+    goto error;
+  }
+
+  /* Link it to the tee last, when it is ready to get data */
+  layer->tee_pad = gst_element_get_request_pad (self->priv->send_tee,
+      "src_%u");
+  pad = gst_element_get_static_pad (layer->bin, "sink");
+  ret = gst_pad_link (layer->tee_pad, pad);
+  gst_object_unref (pad);
+
+  if (GST_PAD_LINK_FAILED (ret))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link simulcast layer %u to the send tee", index);
+    goto error;
+  }
+
+  return layer;
+
+ error:
+  fs_rtp_session_remove_simulcast_layers (self, g_list_prepend (NULL, layer));
+  return NULL;
+}
+
+/*
+ * Replaces the simulcast layers with new ones using the current send codec.
+ * It does nothing unless @force is set or the number of layers changed.
+ *
+ * Must be called from the streaming thread with the send pad blocked and
+ * without the session lock.
+ */
+
+static void
+fs_rtp_session_rebuild_simulcast_layers (FsRtpSession *self, gboolean force)
+{
+  GList *layers = NULL;
+  GError *error = NULL;
+  guint32 internal_ssrc;
+  guint32 ssrcs[FS_RTP_SIMULCAST_MAX_LAYERS];
+  guint n_ssrcs = 0;
+  GList *item;
+  guint i;
+
+  FS_RTP_SESSION_LOCK (self);
+  if (!force && !self->priv->simulcast_changed)
+  {
+    FS_RTP_SESSION_UNLOCK (self);
+    return;
+  }
+  self->priv->simulcast_changed = FALSE;
+  layers = self->priv->simulcast;
+  self->priv->simulcast = NULL;
+  FS_RTP_SESSION_UNLOCK (self);
+
+  fs_rtp_session_remove_simulcast_layers (self, layers);
+  layers = NULL;
+
+  g_object_get (self->priv->rtpbin_internal_session, "internal-ssrc",
+      &internal_ssrc, NULL);
+
+  for (i = 1; ; i++)
+  {
+    CodecAssociation *ca = NULL;
+    GstElement *codecbin = NULL;
+    FsRtpSimulcastLayer *layer;
+    guint32 ssrc = 0;
+    gchar *name;
+
+    FS_RTP_SESSION_LOCK (self);
+    if (i < self->priv->simulcast_layers && self->priv->send_codecbin)
+      ca = fs_rtp_session_select_send_codec_locked (self, NULL);
+    if (ca)
+    {
+      name = g_strdup_printf ("send_%u_%u_layer_%u", self->id,
+          ca->send_codec->id, i);
+      codecbin = _create_codec_bin (ca, ca->send_codec, name,
+          FS_DIRECTION_SEND, NULL, NULL, 0, NULL, &error);
+      g_free (name);
+      ssrc = fs_rtp_session_new_simulcast_ssrc_locked (self, internal_ssrc,
+          layers);
+    }
+    FS_RTP_SESSION_UNLOCK (self);
+
+    if (!ca)
+      break;
+
+    if (codecbin)
+      layer = fs_rtp_session_add_simulcast_layer (self, i, ssrc, codecbin,
+          &error);
+    else
+      layer = NULL;
+
+    if (!layer)
+    {
+      g_prefix_error (&error, "Could not build simulcast layer %u: ", i);
+      fs_session_emit_error (FS_SESSION (self), error->code, error->message);
+      g_clear_error (&error);
+      break;
+    }
+
+    layers = g_list_append (layers, layer);
+  }
+
+  /* So the keyunit requests for the layers are seen as ours */
+  for (item = layers; item; item = g_list_next (item))
+    ssrcs[n_ssrcs++] = ((FsRtpSimulcastLayer *) item->data)->ssrc;
+  if (self->priv->keyunit_manager)
+    fs_rtp_keyunit_manager_set_layer_ssrcs (self->priv->keyunit_manager,
+        ssrcs, n_ssrcs);
+
+  FS_RTP_SESSION_LOCK (self);
+  self->priv->simulcast = layers;
+  fs_rtp_session_configure_bitrate_adapters_locked (self);
+  fs_rtp_session_set_simulcast_bitrate_locked (self);
+  fs_rtp_session_update_simulcast_locked (self, NULL, FALSE);
+  FS_RTP_SESSION_UNLOCK (self);
+}
+
+/**
+ * _send_src_pad_blocked_callback:
+ *
+ * This is the callback for the pad blocking on the media src pad
+ * It is used to replace the codec bin when the send codec has been changed.
+ */
+
+static GstPadProbeReturn
+_send_src_pad_blocked_callback (GstPad *pad, GstPadProbeInfo *info,
+    gpointer user_data)
+{
+  FsRtpSession *self = FS_RTP_SESSION (user_data);
+  CodecAssociation *ca = NULL;
+  FsCodec *send_codec_copy = NULL;
+  FsCodec *codec_copy = NULL;
+  GError *error = NULL;
+  gboolean changed = FALSE;
+  GList *other_codecs = NULL;
+
+  if (fs_rtp_session_has_disposed_enter (self, NULL))
+  {
+    FS_RTP_SESSION_LOCK (self);
+    self->priv->send_pad_block_id = 0;
+    FS_RTP_SESSION_UNLOCK (self);
+    return GST_PAD_PROBE_REMOVE;
+  }
+
+  FS_RTP_SESSION_LOCK (self);
+  self->priv->send_pad_block_id = 0;
+
+  ca = fs_rtp_session_select_send_codec_locked (self, &error);
+
+  if (!ca)
+  {
+    g_prefix_error (&error, "Could not select a new send codec: ");
+    fs_session_emit_error (FS_SESSION (self), error->code, error->message);
+    goto done_locked;
+  }
+
+  g_clear_error (&error);
+
+  send_codec_copy = fs_codec_copy (ca->send_codec);
+  if (fs_codec_are_equal (ca->codec, self->priv->current_send_codec))
+  {
+    codec_copy = fs_codec_copy (ca->codec);
+    FS_RTP_SESSION_UNLOCK (self);
+
+    /* If the main codec has not changed, the special codecs could still
+     * have changed, so lets try to see if it is necessary to do something
+     * about it.
+     */
+
+    changed |= fs_rtp_special_sources_remove (
+        &self->priv->extra_sources,
+        &self->priv->codec_associations,
+        FS_RTP_SESSION_GET_LOCK (self),
+        codec_copy,
+        special_source_stopped, self);
+
+    /* Only the number of simulcast layers may have changed */
+    fs_rtp_session_rebuild_simulcast_layers (self, FALSE);
+    goto skip_main_codec;
+  }
+
+  FS_RTP_SESSION_UNLOCK (self);
+
+  g_object_set (self->priv->media_sink_valve, "drop", TRUE, NULL);
+
+  if (!fs_rtp_session_remove_send_codec_bin (self, send_codec_copy, NULL, TRUE))
+    goto done;
+
+
+  FS_RTP_SESSION_LOCK (self);
+  /* We have to re-fetch the ca because we lifted the lock */
+  fs_codec_destroy (send_codec_copy);
+  send_codec_copy = NULL;
+  ca = fs_rtp_session_select_send_codec_locked (self, &error);
+
+  if (!ca)
+  {
+    g_prefix_error (&error, "Could not select a new send codec: ");
+    fs_session_emit_error (FS_SESSION (self), error->code,
+        error->message);
+    goto done_locked;
+  }
+
+  g_clear_error (&error);
+
+  send_codec_copy = fs_codec_copy (ca->send_codec);
+  codec_copy = fs_codec_copy (ca->codec);
+
+  if (!fs_rtp_session_add_send_codec_bin_unlock (self, ca, &other_codecs,
+          &error))
+  {
+    g_prefix_error (&error, "Could not build a new send codec bin: ");
+    fs_session_emit_error (FS_SESSION (self), error->code,
+        error->message);
+  }
+
+  /* The layers must use the new codec too */
+  fs_rtp_session_rebuild_simulcast_layers (self, TRUE);
+
+  changed = TRUE;
 
  skip_main_codec:
 
@@ -4214,111 +5467,518 @@ _send_src_pad_blocked_callback (GstPad *pad, GstPadProbeInfo *info,
       GST_ELEMENT (self->priv->conference),
       self->priv->rtpmuxer);
 
-  if (changed && !error)
+  if (changed && !error)
+  {
+    GList *secondary_codecs;
+
+    FS_RTP_SESSION_LOCK (self);
+    secondary_codecs = fs_rtp_special_sources_get_codecs_locked (
+        self->priv->extra_sources, self->priv->codec_associations,
+        codec_copy);
+    FS_RTP_SESSION_UNLOCK (self);
+
+    secondary_codecs = g_list_concat (secondary_codecs, other_codecs);
+
+    g_object_notify (G_OBJECT (self), "current-send-codec");
+    gst_element_post_message (GST_ELEMENT (self->priv->conference),
+        gst_message_new_element (GST_OBJECT (self->priv->conference),
+            gst_structure_new ("farstream-send-codec-changed",
+                "session", FS_TYPE_SESSION, self,
+                "codec", FS_TYPE_CODEC, codec_copy,
+                "secondary-codecs", FS_TYPE_CODEC_LIST, secondary_codecs,
+                NULL)));
+
+    fs_codec_list_destroy (secondary_codecs);
+
+    fs_rtp_session_try_sending_dtmf_event (self);
+  }
+
+ done:
+  g_clear_error (&error);
+  fs_codec_destroy (send_codec_copy);
+  fs_codec_destroy (codec_copy);
+
+  /* If we have a codec bin, the required/preferred caps may have changed,
+   * in this case, we need to drop the current buffer and wait for a buffer
+   * with the right caps to come in. Only then can we drop the pad block
+   */
+
+  fs_rtp_session_has_disposed_exit (self);
+  return GST_PAD_PROBE_REMOVE;
+
+ done_locked:
+  FS_RTP_SESSION_UNLOCK (self);
+  goto done;
+}
+
+/**
+ * fs_rtp_session_verify_send_codec_bin_locked:
+ *
+ * Verify that the current send codec is still valid and if it is not
+ * do whats required to have the right one be used.
+ *
+ * Does not care about locks
+ *
+ */
+
+static void
+fs_rtp_session_verify_send_codec_bin_locked (FsRtpSession *self)
+{
+  if (self->priv->send_pad_block_id == 0)
+    self->priv->send_pad_block_id =
+      gst_pad_add_probe (self->priv->send_tee_media_pad,
+          GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM,
+          _send_src_pad_blocked_callback, g_object_ref (self), g_object_unref);
+}
+
+/*
+ * This callback is called when the pad of a substream has been locked because
+ * the codec needs to be changed.
+ *
+ * It will return a new codecbin if it needs changing. If there is an error,
+ * the GError * will be set.
+ */
+
+static GstElement *
+_substream_get_codec_bin (FsRtpSubStream *substream,
+    FsRtpStream *stream, FsCodec **new_codec,
+    guint current_builder_hash, guint *new_builder_hash,
+    GError **error, FsRtpSession *session)
+{
+  GstElement *codecbin = NULL;
+  gchar *name;
+  CodecAssociation *ca = NULL;
+
+  if (fs_rtp_session_has_disposed_enter (session, NULL))
+    return NULL;
+
+  FS_RTP_SESSION_LOCK (session);
+
+  ca = fs_rtp_session_get_recv_codec_locked (session, substream->pt, stream,
+      new_codec, error);
+  if (!ca)
+    goto out;
+
+  /* Forwarded packets are not decoded, only the codec is needed */
+  if (substream->forwarding)
+    goto out;
+
+  name = g_strdup_printf ("recv_%u_%u_%u", session->id, substream->ssrc,
+      substream->pt);
+  codecbin = _create_codec_bin (ca, *new_codec, name, FS_DIRECTION_RECV, NULL,
+      fs_rtp_conference_get_codec_bin_pool (session->priv->conference),
+      current_builder_hash, new_builder_hash, error);
+  g_free (name);
+
+ out:
+
+  fs_rtp_session_has_disposed_exit (session);
+
+  FS_RTP_SESSION_UNLOCK (session);
+
+  return codecbin;
+}
+
+/*
+ * The outputs of the forwarders are added when a receiver selects their
+ * layer, see fs_rtp_session_update_simulcast_locked()
+ */
+
+static GstElement *
+fs_rtp_session_add_forwarder (FsRtpSession *self, GError **error)
+{
+  GstElement *forwarder;
+  gchar *name;
+
+  forwarder = fs_rtp_forwarder_new ();
+  name = g_strdup_printf ("send_forwarder_%u_%u", self->id, g_random_int ());
+  gst_object_set_name (GST_OBJECT (forwarder), name);
+  g_free (name);
+
+  if (!gst_bin_add (GST_BIN (self->priv->conference), forwarder))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not add the forwarder to the conference");
+    gst_object_unref (forwarder);
+    return NULL;
+  }
+
+  gst_object_ref (forwarder);
+
+  if (!gst_element_sync_state_with_parent (forwarder))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not sync the state of the forwarder with the state"
+        " of the conference");
+    fs_rtp_session_remove_forwarder (self, forwarder);
+    return NULL;
+  }
+
+  return forwarder;
+}
+
+/*
+ * Links a new output of a forwarder to the send funnel, it stays until the
+ * forwarder is removed. The outputs are only linked once the routes know
+ * their SSRC, so their packets do not reach the wrong streams.
+ */
+
+static void
+fs_rtp_session_link_forwarder_output_locked (FsRtpSession *self,
+    GstPad *srcpad)
+{
+  GstPad *funnel_pad;
+  GstPadLinkReturn ret;
+
+  funnel_pad = gst_element_get_request_pad (self->priv->send_funnel,
+      "sink_%u");
+  ret = gst_pad_link (srcpad, funnel_pad);
+  gst_object_unref (funnel_pad);
+
+  if (GST_PAD_LINK_FAILED (ret))
+    GST_WARNING ("Could not link %s:%s to the send funnel",
+        GST_DEBUG_PAD_NAME (srcpad));
+}
+
+static void
+fs_rtp_session_remove_forwarder (FsRtpSession *self, GstElement *forwarder)
+{
+  GstIterator *it;
+  GValue item = G_VALUE_INIT;
+  GList *srcpads = NULL;
+  GList *pad_item;
+
+  gst_element_set_locked_state (forwarder, TRUE);
+  gst_element_set_state (forwarder, GST_STATE_NULL);
+
+  it = gst_element_iterate_src_pads (forwarder);
+  while (gst_iterator_next (it, &item) == GST_ITERATOR_OK)
+  {
+    srcpads = g_list_prepend (srcpads, g_value_dup_object (&item));
+    g_value_reset (&item);
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  for (pad_item = srcpads; pad_item; pad_item = g_list_next (pad_item))
+  {
+    GstPad *funnel_pad = gst_pad_get_peer (pad_item->data);
+
+    if (funnel_pad)
+    {
+      gst_element_release_request_pad (self->priv->send_funnel, funnel_pad);
+      gst_object_unref (funnel_pad);
+    }
+    gst_element_release_request_pad (forwarder, pad_item->data);
+  }
+  g_list_free_full (srcpads, gst_object_unref);
+
+  gst_bin_remove (GST_BIN (self->priv->conference), forwarder);
+  gst_object_unref (forwarder);
+}
+
+static gboolean
+fs_rtp_session_can_forward_locked (FsRtpSession *self, guint pt,
+    GError **error)
+{
+  CodecAssociation *ca;
+  GList *item;
+
+  ca = lookup_codec_association_by_pt (self->priv->codec_associations, pt);
+  if (!ca || !codec_association_is_valid_for_sending (ca, FALSE))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_NEGOTIATION_FAILED,
+        "Can not forward payload type %u, it is not negotiated for sending",
+        pt);
+    return FALSE;
+  }
+
+  for (item = self->priv->hdrext_negotiated; item; item = g_list_next (item))
+  {
+    FsRtpHeaderExtension *hdrext = item->data;
+
+    if (!(hdrext->direction & FS_DIRECTION_SEND))
+    {
+      g_set_error (error, FS_ERROR, FS_ERROR_NEGOTIATION_FAILED,
+          "Can not forward header extension %u (%s), it is only negotiated"
+          " for receiving", hdrext->id, hdrext->uri);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/*
+ * Returns a new sink pad on the forwarder of @stream, the forwarder is
+ * created with the first one
+ */
+
+static GstPad *
+_substream_get_forward_pad (FsRtpSubStream *substream, FsRtpStream *stream,
+    FsRtpSession *session)
+{
+  GstElement *forwarder;
+  GstPad *pad = NULL;
+  GError *error = NULL;
+
+  if (fs_rtp_session_has_disposed_enter (session, NULL))
+    return NULL;
+
+  /*
+   * The payload types and header extension ids are negotiated for the whole
+   * session, so the packets can be forwarded unchanged as long as their
+   * codec may be sent and the extensions can go both ways.
+   */
+  FS_RTP_SESSION_LOCK (session);
+  if (!fs_rtp_session_can_forward_locked (session, substream->pt, &error))
+  {
+    FS_RTP_SESSION_UNLOCK (session);
+    fs_stream_emit_error (FS_STREAM (stream), error->code, error->message);
+    g_clear_error (&error);
+    goto out;
+  }
+  forwarder = g_hash_table_lookup (session->priv->forwarders, stream);
+  if (forwarder)
+    gst_object_ref (forwarder);
+  FS_RTP_SESSION_UNLOCK (session);
+
+  if (!forwarder)
+  {
+    GstElement *other;
+
+    forwarder = fs_rtp_session_add_forwarder (session, &error);
+    if (!forwarder)
+    {
+      fs_stream_emit_error (FS_STREAM (stream), error->code, error->message);
+      g_clear_error (&error);
+      goto out;
+    }
+
+    /* Another substream of the same stream may have been faster */
+    FS_RTP_SESSION_LOCK (session);
+    other = g_hash_table_lookup (session->priv->forwarders, stream);
+    if (other)
+    {
+      gst_object_ref (other);
+    }
+    else
+    {
+      g_hash_table_insert (session->priv->forwarders, stream,
+          gst_object_ref (forwarder));
+      fs_rtp_session_update_simulcast_locked (session, NULL, FALSE);
+    }
+    FS_RTP_SESSION_UNLOCK (session);
+
+    if (other)
+    {
+      fs_rtp_session_remove_forwarder (session, forwarder);
+      forwarder = other;
+    }
+  }
+
+  pad = gst_element_get_request_pad (forwarder, "sink_%u");
+  gst_object_unref (forwarder);
+
+ out:
+  fs_rtp_session_has_disposed_exit (session);
+
+  return pad;
+}
+
+static void
+fs_rtp_session_set_mixing_speakers (FsRtpSession *self, guint speakers)
+{
+  GstElement *mixer;
+  GList *streams;
+  GList *item;
+  gchar *name;
+
+  FS_RTP_SESSION_LOCK (self);
+  self->priv->mixing_speakers = speakers;
+  if (self->priv->speakers || speakers == 0)
+  {
+    if (self->priv->speakers)
+      fs_rtp_speaker_selector_set_max_speakers (self->priv->speakers,
+          speakers);
+    FS_RTP_SESSION_UNLOCK (self);
+    return;
+  }
+  FS_RTP_SESSION_UNLOCK (self);
+
+  mixer = fs_rtp_mixer_new ();
+  gst_object_ref_sink (mixer);
+
+  name = g_strdup_printf ("mixer_%u", self->id);
+  gst_object_set_name (GST_OBJECT (mixer), name);
+  g_free (name);
+
+  if (!gst_bin_add (GST_BIN (self->priv->conference), mixer))
+  {
+    fs_session_emit_error (FS_SESSION (self), FS_ERROR_CONSTRUCTION,
+        "Could not add the mixer to the conference");
+    gst_object_unref (mixer);
+    return;
+  }
+
+  if (!gst_element_sync_state_with_parent (mixer))
   {
-    GList *secondary_codecs;
+    fs_session_emit_error (FS_SESSION (self), FS_ERROR_CONSTRUCTION,
+        "Could not set the mixer to the state of the conference");
+    stop_and_remove (GST_BIN (self->priv->conference), &mixer, TRUE);
+    return;
+  }
 
-    FS_RTP_SESSION_LOCK (self);
-    secondary_codecs = fs_rtp_special_sources_get_codecs_locked (
-        self->priv->extra_sources, self->priv->codec_associations,
-        codec_copy);
+  FS_RTP_SESSION_LOCK (self);
+  /* It may have been set from another thread in the meantime */
+  if (self->priv->mixer)
+  {
     FS_RTP_SESSION_UNLOCK (self);
+    stop_and_remove (GST_BIN (self->priv->conference), &mixer, TRUE);
+    return;
+  }
+  self->priv->mixer = mixer;
+  self->priv->speakers =
+      fs_rtp_speaker_selector_new (self->priv->mixing_speakers);
+  fs_rtp_speaker_selector_set_extension_id (self->priv->speakers,
+      fs_rtp_audio_level_find_extension_id (self->priv->hdrext_negotiated));
+  streams = g_list_copy (self->priv->streams);
+  g_list_foreach (streams, (GFunc) g_object_ref, NULL);
+  FS_RTP_SESSION_UNLOCK (self);
 
-    secondary_codecs = g_list_concat (secondary_codecs, other_codecs);
+  GST_DEBUG ("Mixing the %u loudest speakers in session %u", speakers,
+      self->id);
 
-    g_object_notify (G_OBJECT (self), "current-send-codec");
-    gst_element_post_message (GST_ELEMENT (self->priv->conference),
-        gst_message_new_element (GST_OBJECT (self->priv->conference),
-            gst_structure_new ("farstream-send-codec-changed",
-                "session", FS_TYPE_SESSION, self,
-                "codec", FS_TYPE_CODEC, codec_copy,
-                "secondary-codecs", FS_TYPE_CODEC_LIST, secondary_codecs,
-                NULL)));
+  for (item = streams; item; item = item->next)
+  {
+    fs_rtp_session_add_mix_output (self, item->data);
+    g_object_unref (item->data);
+  }
+  g_list_free (streams);
+}
 
-    fs_codec_list_destroy (secondary_codecs);
+/*
+ * Gives @stream a source pad on the conference with the mix of everyone
+ * else, if the session is mixing and it does not already have one
+ */
 
-    fs_rtp_session_try_sending_dtmf_event (self);
+static void
+fs_rtp_session_add_mix_output (FsRtpSession *self, FsRtpStream *stream)
+{
+  FsRtpSessionMixOutput *output;
+  GstElement *mixer;
+  GstPad *mixer_pad;
+  GstPad *ghostpad;
+  gchar *padname;
+
+  FS_RTP_SESSION_LOCK (self);
+  if (!self->priv->mixer ||
+      g_hash_table_lookup (self->priv->mix_outputs, stream))
+  {
+    FS_RTP_SESSION_UNLOCK (self);
+    return;
   }
 
- done:
-  g_clear_error (&error);
-  fs_codec_destroy (send_codec_copy);
-  fs_codec_destroy (codec_copy);
+  output = g_slice_new0 (FsRtpSessionMixOutput);
+  output->group = ++self->priv->mix_groups;
+  g_hash_table_insert (self->priv->mix_outputs, stream, output);
+  mixer = gst_object_ref (self->priv->mixer);
+  FS_RTP_SESSION_UNLOCK (self);
 
-  /* If we have a codec bin, the required/preferred caps may have changed,
-   * in this case, we need to drop the current buffer and wait for a buffer
-   * with the right caps to come in. Only then can we drop the pad block
-   */
+  mixer_pad = fs_rtp_mixer_get_pad (mixer, GST_PAD_SRC, output->group);
+  gst_object_unref (mixer);
 
-  fs_rtp_session_has_disposed_exit (self);
-  return GST_PAD_PROBE_REMOVE;
+  if (!mixer_pad)
+  {
+    fs_session_emit_error (FS_SESSION (self), FS_ERROR_CONSTRUCTION,
+        "Could not get a pad from the mixer");
+    return;
+  }
 
- done_locked:
+  padname = g_strdup_printf ("mix_%u_%u", self->id, output->group);
+  ghostpad = gst_ghost_pad_new_from_template (padname, mixer_pad,
+      gst_element_class_get_pad_template (
+          GST_ELEMENT_GET_CLASS (self->priv->conference), "mix_%u_%u"));
+  g_free (padname);
+
+  gst_pad_set_active (ghostpad, TRUE);
+
+  if (!gst_element_add_pad (GST_ELEMENT (self->priv->conference), ghostpad))
+  {
+    fs_session_emit_error (FS_SESSION (self), FS_ERROR_CONSTRUCTION,
+        "Could not add the mixer pad to the conference");
+    gst_object_unref (ghostpad);
+    gst_element_release_request_pad (self->priv->mixer, mixer_pad);
+    gst_object_unref (mixer_pad);
+    return;
+  }
+
+  FS_RTP_SESSION_LOCK (self);
+  output->mixer_pad = mixer_pad;
+  output->ghostpad = ghostpad;
+  stream->mix_pad = ghostpad;
   FS_RTP_SESSION_UNLOCK (self);
-  goto done;
-}
 
-/**
- * fs_rtp_session_verify_send_codec_bin_locked:
- *
- * Verify that the current send codec is still valid and if it is not
- * do whats required to have the right one be used.
- *
- * Does not care about locks
- *
- */
+  g_object_notify (G_OBJECT (stream), "mix-pad");
+}
 
 static void
-fs_rtp_session_verify_send_codec_bin_locked (FsRtpSession *self)
+fs_rtp_session_remove_mix_output (FsRtpSession *self,
+    FsRtpSessionMixOutput *output)
 {
-  if (self->priv->send_pad_block_id == 0)
-    self->priv->send_pad_block_id =
-      gst_pad_add_probe (self->priv->send_tee_media_pad,
-          GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM,
-          _send_src_pad_blocked_callback, g_object_ref (self), g_object_unref);
+  if (output->ghostpad)
+  {
+    gst_pad_set_active (output->ghostpad, FALSE);
+    gst_element_remove_pad (GST_ELEMENT (self->priv->conference),
+        output->ghostpad);
+  }
+
+  if (output->mixer_pad)
+  {
+    gst_element_release_request_pad (self->priv->mixer, output->mixer_pad);
+    gst_object_unref (output->mixer_pad);
+  }
+
+  g_slice_free (FsRtpSessionMixOutput, output);
 }
 
 /*
- * This callback is called when the pad of a substream has been locked because
- * the codec needs to be changed.
- *
- * It will return a new codecbin if it needs changing. If there is an error,
- * the GError * will be set.
+ * Returns a new sink pad on the mixer, in the group of @stream so its
+ * own audio is not in its output
  */
 
-static GstElement *
-_substream_get_codec_bin (FsRtpSubStream *substream,
-    FsRtpStream *stream, FsCodec **new_codec,
-    guint current_builder_hash, guint *new_builder_hash,
-    GError **error, FsRtpSession *session)
+static GstPad *
+_substream_get_mix_pad (FsRtpSubStream *substream, FsRtpStream *stream,
+    FsRtpSession *session)
 {
-  GstElement *codecbin = NULL;
-  gchar *name;
-  CodecAssociation *ca = NULL;
+  FsRtpSessionMixOutput *output;
+  GstElement *mixer = NULL;
+  GstPad *pad = NULL;
+  guint group = 0;
 
   if (fs_rtp_session_has_disposed_enter (session, NULL))
     return NULL;
 
-  FS_RTP_SESSION_LOCK (session);
-
-  ca = fs_rtp_session_get_recv_codec_locked (session, substream->pt, stream,
-      new_codec, error);
-  if (!ca)
-    goto out;
+  fs_rtp_session_add_mix_output (session, stream);
 
-  name = g_strdup_printf ("recv_%u_%u_%u", session->id, substream->ssrc,
-      substream->pt);
-  codecbin = _create_codec_bin (ca, *new_codec, name, FS_DIRECTION_RECV, NULL,
-      current_builder_hash, new_builder_hash, error);
-  g_free (name);
+  FS_RTP_SESSION_LOCK (session);
+  output = g_hash_table_lookup (session->priv->mix_outputs, stream);
+  if (output && session->priv->mixer)
+  {
+    group = output->group;
+    mixer = gst_object_ref (session->priv->mixer);
+  }
+  FS_RTP_SESSION_UNLOCK (session);
 
- out:
+  if (mixer)
+  {
+    pad = fs_rtp_mixer_get_pad (mixer, GST_PAD_SINK, group);
+    gst_object_unref (mixer);
+  }
 
   fs_rtp_session_has_disposed_exit (session);
 
-  FS_RTP_SESSION_UNLOCK (session);
-
-  return codecbin;
+  return pad;
 }
 
 static void
@@ -4522,6 +6182,7 @@ fs_rtp_session_bye_ssrc (FsRtpSession *session,
   if (!g_hash_table_lookup (session->priv->ssrc_streams_manual,
           GUINT_TO_POINTER (ssrc)))
     g_hash_table_remove (session->priv->ssrc_streams, GUINT_TO_POINTER (ssrc));
+  g_hash_table_remove (session->priv->srtp_refused, GUINT_TO_POINTER (ssrc));
   FS_RTP_SESSION_UNLOCK (session);
 
   /*
@@ -4752,7 +6413,7 @@ fs_rtp_session_get_codec_params_unlock (FsRtpSession *session,
 
   tmp = g_strdup_printf ("discoverAA_%u_%u", session->id, ca->send_codec->id);
   codecbin = _create_codec_bin (ca, ca->send_codec, tmp, FS_DIRECTION_SEND,
-      NULL,
+      NULL, NULL,
       0, NULL, error);
   g_free (tmp);
 
@@ -5135,7 +6796,7 @@ fs_rtp_session_get_stream_transmitter_type (FsSession *session,
   GType st_type = 0;
   FsTransmitter *trans;
 
-  trans = fs_rtp_session_get_transmitter (self, transmitter, NULL);
+  trans = fs_rtp_session_get_transmitter (self, transmitter, NULL, NULL);
 
   if (transmitter)
     st_type = fs_transmitter_get_stream_transmitter_type (trans);
@@ -5153,7 +6814,8 @@ fs_rtp_session_ssrc_validated (FsRtpSession *session,
   if (fs_rtp_session_has_disposed_enter (session, NULL))
     return;
 
-  gst_element_send_event (session->priv->rtpmuxer,
+  /* Through the keyunit manager, like the requests from the rtpbin */
+  gst_pad_push_event (session->priv->rtpbin_send_rtp_sink,
       gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
           gst_structure_new ("GstForceKeyUnit",
               "all-headers", G_TYPE_BOOLEAN, TRUE,
@@ -5202,6 +6864,214 @@ codecbin_set_bitrate (GstElement *codecbin, guint bitrate)
   return data.ret;
 }
 
+static void
+configure_bitrate_adapter_locked (FsRtpSession *self, GstElement *adapter)
+{
+  g_object_set (adapter,
+      "estimator", self->priv->bitrate_estimator,
+      "percentile", self->priv->bitrate_percentile,
+      "ewma-weight", self->priv->bitrate_ewma_weight,
+      NULL);
+}
+
+/* Gives the estimator properties to the main and simulcast adapters */
+
+static void
+fs_rtp_session_configure_bitrate_adapters_locked (FsRtpSession *self)
+{
+  GList *item;
+
+  if (self->priv->send_bitrate_adapter)
+    configure_bitrate_adapter_locked (self, self->priv->send_bitrate_adapter);
+
+  for (item = self->priv->simulcast; item; item = g_list_next (item))
+  {
+    FsRtpSimulcastLayer *layer = item->data;
+
+    configure_bitrate_adapter_locked (self, layer->bitrate_adapter);
+  }
+}
+
+static void
+fs_rtp_session_set_simulcast_bitrate_locked (FsRtpSession *self)
+{
+  GList *item;
+
+  for (item = self->priv->simulcast; item; item = g_list_next (item))
+  {
+    FsRtpSimulcastLayer *layer = item->data;
+    guint bitrate = fs_rtp_simulcast_layer_bitrate (self->priv->send_bitrate,
+        layer->index);
+
+    codecbin_set_bitrate (layer->codecbin, bitrate);
+    fs_rtp_simulcast_layer_set_bitrate (layer, bitrate);
+  }
+}
+
+static gboolean
+stream_is_sending_locked (FsRtpStream *stream, FsRtpStream *changed_stream,
+    gboolean changed_sending)
+{
+  if (stream == changed_stream)
+    return changed_sending;
+  else
+    return fs_rtp_stream_is_sending_locked (stream);
+}
+
+/*
+ * A stream with a transmitter of its own only gets the simulcast layer it
+ * selected, the main encoding being layer 0, and the same layer of what the
+ * other streams send when forwarding
+ */
+
+static void
+fs_rtp_session_route_stream_locked (FsRtpSession *self, FsRtpStream *stream,
+    FsRtpSessionRoute *route)
+{
+  guint wanted = MIN (stream->simulcast_layer,
+      g_list_length (self->priv->simulcast));
+  GHashTable *ssrcs = g_hash_table_new (g_direct_hash, g_direct_equal);
+  GList *item;
+  GHashTableIter iter;
+  gpointer key, value;
+  guint i;
+
+  for (item = self->priv->simulcast; item; item = g_list_next (item))
+  {
+    FsRtpSimulcastLayer *layer = item->data;
+
+    g_hash_table_insert (ssrcs, GUINT_TO_POINTER (layer->ssrc),
+        GINT_TO_POINTER (layer->index == wanted));
+  }
+
+  g_hash_table_iter_init (&iter, self->priv->forwarders);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+  {
+    for (i = 0; i < FS_RTP_SIMULCAST_MAX_LAYERS; i++)
+    {
+      guint32 ssrc;
+
+      if (fs_rtp_forwarder_get_output_ssrc (value, i, &ssrc))
+        g_hash_table_insert (ssrcs, GUINT_TO_POINTER (ssrc),
+            GINT_TO_POINTER (key != stream && i == stream->simulcast_layer));
+    }
+  }
+
+  g_mutex_lock (&route->mutex);
+  g_hash_table_destroy (route->ssrcs);
+  route->ssrcs = ssrcs;
+  route->main = (wanted == 0);
+  route->configured = TRUE;
+  g_mutex_unlock (&route->mutex);
+}
+
+/*
+ * Only encodes the simulcast layers that a sending stream has selected,
+ * @changed_stream is about to start or stop sending, as per @changed_sending
+ *
+ * Each forwarder has an output for the layer selected by every other
+ * sending stream, then the streams are told which SSRCs they get.
+ */
+
+static void
+fs_rtp_session_update_simulcast_locked (FsRtpSession *self,
+    FsRtpStream *changed_stream, gboolean changed_sending)
+{
+  guint n_layers = g_list_length (self->priv->simulcast);
+  guint selected = 0;
+  GList *item;
+  GList *new_outputs = NULL;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  for (item = self->priv->streams; item; item = g_list_next (item))
+  {
+    FsRtpStream *stream = item->data;
+
+    if (stream_is_sending_locked (stream, changed_stream, changed_sending))
+      selected |= 1 << MIN (stream->simulcast_layer, n_layers);
+  }
+
+  for (item = self->priv->simulcast; item; item = g_list_next (item))
+  {
+    FsRtpSimulcastLayer *layer = item->data;
+
+    fs_rtp_simulcast_layer_set_active (layer,
+        (selected & (1 << layer->index)) != 0);
+  }
+
+  g_hash_table_iter_init (&iter, self->priv->forwarders);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+  {
+    for (item = self->priv->streams; item; item = g_list_next (item))
+    {
+      FsRtpStream *stream = item->data;
+      guint32 ssrc;
+
+      if (stream != key &&
+          stream_is_sending_locked (stream, changed_stream, changed_sending) &&
+          !fs_rtp_forwarder_get_output_ssrc (value, stream->simulcast_layer,
+              &ssrc))
+      {
+        gchar *name = g_strdup_printf ("src_%u", stream->simulcast_layer);
+        GstPad *srcpad = gst_element_get_request_pad (value, name);
+
+        g_free (name);
+        if (srcpad)
+          new_outputs = g_list_prepend (new_outputs, srcpad);
+      }
+    }
+  }
+
+  g_hash_table_iter_init (&iter, self->priv->routes);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    fs_rtp_session_route_stream_locked (self, key, value);
+
+  /* The pacer is sized for what is encoded here, the forwarded packets were
+   * already paced by their sender */
+  if (self->priv->send_pacer)
+  {
+    GHashTable *unpaced = g_hash_table_new (g_direct_hash, g_direct_equal);
+    guint i;
+
+    g_hash_table_iter_init (&iter, self->priv->forwarders);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      for (i = 0; i < FS_RTP_SIMULCAST_MAX_LAYERS; i++)
+      {
+        guint32 ssrc;
+
+        if (fs_rtp_forwarder_get_output_ssrc (value, i, &ssrc))
+          g_hash_table_add (unpaced, GUINT_TO_POINTER (ssrc));
+      }
+    }
+
+    fs_rtp_pacer_set_unpaced_ssrcs (FS_RTP_PACER (self->priv->send_pacer),
+        unpaced);
+  }
+
+  for (item = new_outputs; item; item = g_list_next (item))
+    fs_rtp_session_link_forwarder_output_locked (self, item->data);
+  g_list_free_full (new_outputs, gst_object_unref);
+}
+
+/*
+ * The TFRC packet modder already paces the packets, they should not be
+ * delayed a second time.
+ */
+
+static void
+fs_rtp_session_set_pacer_bitrate_locked (FsRtpSession *self, guint bitrate)
+{
+  if (!self->priv->send_pacer)
+    return;
+
+  if (self->priv->rtp_tfrc && fs_rtp_tfrc_is_pacing (self->priv->rtp_tfrc))
+    bitrate = 0;
+
+  g_object_set (self->priv->send_pacer, "bitrate", bitrate, NULL);
+}
+
 static void
 fs_rtp_session_set_send_bitrate (FsRtpSession *self, guint bitrate)
 {
@@ -5216,6 +7086,10 @@ fs_rtp_session_set_send_bitrate (FsRtpSession *self, guint bitrate)
   if (self->priv->send_bitrate_adapter)
     g_object_set (self->priv->send_bitrate_adapter, "bitrate", bitrate, NULL);
 
+  fs_rtp_session_set_simulcast_bitrate_locked (self);
+
+  fs_rtp_session_set_pacer_bitrate_locked (self, bitrate);
+
   FS_RTP_SESSION_UNLOCK (self);
 }
 
@@ -5502,17 +7376,73 @@ done:
   return ret;
 }
 
+/*
+ * Remembers that srtpdec was refused a key for @ssrc, if the table is full
+ * the expired refusals are dropped, or the oldest one if none is
+ */
+
+static void
+fs_rtp_session_srtp_refuse_locked (FsRtpSession *self, guint32 ssrc,
+    gint64 now)
+{
+  gint64 *refused_time;
+
+  if (g_hash_table_size (self->priv->srtp_refused) >= SRTP_REFUSED_MAX)
+  {
+    GHashTableIter iter;
+    gpointer key, value;
+    gpointer oldest_key = NULL;
+    gint64 oldest_time = G_MAXINT64;
+
+    g_hash_table_iter_init (&iter, self->priv->srtp_refused);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      gint64 time = *(gint64 *) value;
+
+      if (now - time >= SRTP_REFUSED_TIMEOUT)
+      {
+        g_hash_table_iter_remove (&iter);
+      }
+      else if (time < oldest_time)
+      {
+        oldest_time = time;
+        oldest_key = key;
+      }
+    }
+
+    if (g_hash_table_size (self->priv->srtp_refused) >= SRTP_REFUSED_MAX)
+      g_hash_table_remove (self->priv->srtp_refused, oldest_key);
+  }
+
+  refused_time = g_new (gint64, 1);
+  *refused_time = now;
+  g_hash_table_insert (self->priv->srtp_refused, GUINT_TO_POINTER (ssrc),
+      refused_time);
+}
+
 static GstCaps *
 _srtpdec_request_key (GstElement *srtpdec, guint ssrc, gpointer user_data)
 {
   FsRtpSession *self = FS_RTP_SESSION (user_data);
   FsRtpStream *stream;
   GstCaps *caps = NULL;
+  gint64 now = g_get_monotonic_time ();
+  gint64 *refused_time;
 
   if (fs_rtp_session_has_disposed_enter (self, NULL))
     return NULL;
 
   FS_RTP_SESSION_LOCK (self);
+
+  refused_time = g_hash_table_lookup (self->priv->srtp_refused,
+      GUINT_TO_POINTER (ssrc));
+  if (refused_time)
+  {
+    if (now - *refused_time < SRTP_REFUSED_TIMEOUT)
+      goto out;
+    g_hash_table_remove (self->priv->srtp_refused, GUINT_TO_POINTER (ssrc));
+  }
+
   stream = fs_rtp_session_get_stream_by_ssrc_locked (self, ssrc);
 
   if (stream)
@@ -5547,6 +7477,10 @@ _srtpdec_request_key (GstElement *srtpdec, guint ssrc, gpointer user_data)
     }
   }
 
+  if (!caps)
+    fs_rtp_session_srtp_refuse_locked (self, ssrc, now);
+
+ out:
   FS_RTP_SESSION_UNLOCK (self);
 
   fs_rtp_session_has_disposed_exit (self);
@@ -5564,6 +7498,9 @@ _stream_decrypt_clear_locked_cb (FsRtpStream *stream, gpointer user_data)
   if (!self->priv->srtpdec)
     return FALSE;
 
+  /* The answer for the SSRCs without a stream may also change */
+  g_hash_table_remove_all (self->priv->srtp_refused);
+
   g_hash_table_iter_init (&iter, self->priv->ssrc_streams);
 
   while (g_hash_table_iter_next (&iter, &key, &value))
@@ -30,6 +30,7 @@
 #include <farstream/fs-session.h>
 
 #include "fs-rtp-conference.h"
+#include "fs-rtp-audio-level.h"
 
 G_BEGIN_DECLS
 
@@ -143,6 +144,8 @@ GstPad *fs_rtp_session_get_rtpbin_recv_rtp_sink (FsRtpSession *self);
 GstPad *fs_rtp_session_get_rtpbin_recv_rtcp_sink (FsRtpSession *self);
 GObject *fs_rtp_session_get_rtpbin_internal_session (FsRtpSession *self);
 GstElement *fs_rtp_session_get_rtpmuxer(FsRtpSession *self);
+FsRtpSpeakerSelector *fs_rtp_session_get_speaker_selector (FsRtpSession *self);
+FsRtpLevelTracker *fs_rtp_session_get_level_tracker (FsRtpSession *self);
 
 G_END_DECLS
 
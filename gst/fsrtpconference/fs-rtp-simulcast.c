@@ -0,0 +1,273 @@
+/*
+ * Farstream - Farstream RTP Simulcast layers
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-rtp-simulcast.c - Extra encodings of the sent video
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * A simulcast layer is an extra encoding of the video sent by a session,
+ * with its own SSRC. Its bin is:
+ *
+ * valve ! queue ! videoscale ! fsrtpbitrateadapter ! codecbin
+ *
+ * The bitrate adapter picks a resolution that suits the bitrate of the
+ * layer, so each layer is smaller than the previous one. The SSRC set by
+ * the payloader is rewritten on the way out, and it is removed from the
+ * caps so that rtpbin does not take it as the SSRC of the session.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-simulcast.h"
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include <farstream/fs-conference.h>
+
+#include "fs-rtp-bitrate-adapter.h"
+#include "fs-rtp-conference.h"
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+
+/* Each layer has a quarter of the bitrate of the previous one, which is
+ * about half the width and height
+ */
+#define LAYER_BITRATE_SHIFT (2)
+
+static void
+rewrite_ssrc (GstBuffer *buffer, guint32 ssrc)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READWRITE, &rtpbuffer))
+    return;
+
+  gst_rtp_buffer_set_ssrc (&rtpbuffer, ssrc);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+}
+
+static gboolean
+rewrite_ssrc_list_func (GstBuffer **buffer, guint idx, gpointer user_data)
+{
+  *buffer = gst_buffer_make_writable (*buffer);
+  rewrite_ssrc (*buffer, GPOINTER_TO_UINT (user_data));
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+rewrite_ssrc_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  guint32 ssrc = GPOINTER_TO_UINT (user_data);
+
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER)
+  {
+    GstBuffer *buffer = gst_buffer_make_writable (
+        GST_PAD_PROBE_INFO_BUFFER (info));
+
+    rewrite_ssrc (buffer, ssrc);
+    GST_PAD_PROBE_INFO_DATA (info) = buffer;
+  }
+  else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+  {
+    GstBufferList *list = gst_buffer_list_make_writable (
+        GST_PAD_PROBE_INFO_BUFFER_LIST (info));
+
+    gst_buffer_list_foreach (list, rewrite_ssrc_list_func, user_data);
+    GST_PAD_PROBE_INFO_DATA (info) = list;
+  }
+  else if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_CAPS)
+  {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+    GstCaps *caps;
+    guint i;
+
+    gst_event_parse_caps (event, &caps);
+    caps = gst_caps_copy (caps);
+    for (i = 0; i < gst_caps_get_size (caps); i++)
+      gst_structure_remove_field (gst_caps_get_structure (caps, i), "ssrc");
+
+    GST_PAD_PROBE_INFO_DATA (info) = gst_event_new_caps (caps);
+    gst_caps_unref (caps);
+    gst_event_unref (event);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstElement *
+make_element (GstBin *bin, const gchar *factory, GError **error)
+{
+  GstElement *elem = gst_element_factory_make (factory, NULL);
+
+  if (!elem)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not create the %s element for the simulcast layer", factory);
+    return NULL;
+  }
+
+  gst_bin_add (bin, elem);
+
+  return elem;
+}
+
+static gboolean
+add_ghost_pad (GstElement *bin, GstElement *elem, const gchar *padname,
+    const gchar *ghostname, GError **error)
+{
+  GstPad *pad = gst_element_get_static_pad (elem, padname);
+  GstPad *ghostpad;
+
+  if (!pad)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "The simulcast layer has no %s pad", padname);
+    return FALSE;
+  }
+
+  ghostpad = gst_ghost_pad_new (ghostname, pad);
+  gst_object_unref (pad);
+  gst_pad_set_active (ghostpad, TRUE);
+
+  return gst_element_add_pad (bin, ghostpad);
+}
+
+/**
+ * fs_rtp_simulcast_layer_new:
+ * @session_id: The id of the session
+ * @index: The index of the layer, starting from 1
+ * @ssrc: The SSRC the layer is sent with
+ * @codecbin: A send codec bin for the same codec as the main one, this
+ *  function takes ownership of it
+ * @error: location of a #GError, or NULL
+ *
+ * Builds the bin of a simulcast layer, the session must add it to the
+ * conference and link it. The layer starts inactive.
+ *
+ * Returns: The new layer or NULL on error
+ */
+
+FsRtpSimulcastLayer *
+fs_rtp_simulcast_layer_new (guint session_id, guint index, guint32 ssrc,
+    GstElement *codecbin, GError **error)
+{
+  FsRtpSimulcastLayer *layer = g_slice_new0 (FsRtpSimulcastLayer);
+  GstElement *queue, *scale;
+  GstPad *pad;
+  gchar *name;
+
+  layer->index = index;
+  layer->ssrc = ssrc;
+
+  name = g_strdup_printf ("send_simulcast_%u_%u", session_id, index);
+  layer->bin = gst_bin_new (name);
+  g_free (name);
+  gst_object_ref_sink (layer->bin);
+
+  layer->codecbin = codecbin;
+  gst_bin_add (GST_BIN (layer->bin), codecbin);
+
+  layer->valve = make_element (GST_BIN (layer->bin), "valve", error);
+  if (!layer->valve)
+    goto error;
+  g_object_set (layer->valve, "drop", TRUE, NULL);
+
+  /* Never block the main encoding */
+  queue = make_element (GST_BIN (layer->bin), "queue", error);
+  if (!queue)
+    goto error;
+  g_object_set (queue, "leaky", 2, "max-size-buffers", 2,
+      "max-size-bytes", 0, "max-size-time", (guint64) 0, NULL);
+
+  scale = make_element (GST_BIN (layer->bin), "videoscale", error);
+  if (!scale)
+    goto error;
+
+  layer->bitrate_adapter = fs_rtp_bitrate_adapter_new ();
+  gst_bin_add (GST_BIN (layer->bin), layer->bitrate_adapter);
+
+  if (!gst_element_link_many (layer->valve, queue, scale,
+          layer->bitrate_adapter, NULL) ||
+      !gst_element_link_pads (layer->bitrate_adapter, "src", codecbin,
+          "sink"))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link the elements of simulcast layer %u", index);
+    goto error;
+  }
+
+  if (!add_ghost_pad (layer->bin, layer->valve, "sink", "sink", error) ||
+      !add_ghost_pad (layer->bin, codecbin, "src", "src", error))
+    goto error;
+
+  pad = gst_element_get_static_pad (layer->bin, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER |
+      GST_PAD_PROBE_TYPE_BUFFER_LIST | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      rewrite_ssrc_probe, GUINT_TO_POINTER (layer->ssrc), NULL);
+  gst_object_unref (pad);
+
+  GST_DEBUG ("Created simulcast layer %u with ssrc %X", index, layer->ssrc);
+
+  return layer;
+
+ error:
+  fs_rtp_simulcast_layer_free (layer);
+  return NULL;
+}
+
+void
+fs_rtp_simulcast_layer_free (FsRtpSimulcastLayer *layer)
+{
+  if (layer->tee_pad)
+    gst_object_unref (layer->tee_pad);
+  if (layer->funnel_pad)
+    gst_object_unref (layer->funnel_pad);
+  gst_object_unref (layer->bin);
+
+  g_slice_free (FsRtpSimulcastLayer, layer);
+}
+
+/* Inactive layers drop the raw video before encoding it */
+
+void
+fs_rtp_simulcast_layer_set_active (FsRtpSimulcastLayer *layer,
+    gboolean active)
+{
+  g_object_set (layer->valve, "drop", !active, NULL);
+}
+
+/* The caller must set the bitrate of the codec bin itself */
+
+void
+fs_rtp_simulcast_layer_set_bitrate (FsRtpSimulcastLayer *layer,
+    guint bitrate)
+{
+  if (bitrate)
+    g_object_set (layer->bitrate_adapter, "bitrate", bitrate, NULL);
+}
+
+guint
+fs_rtp_simulcast_layer_bitrate (guint send_bitrate, guint index)
+{
+  return send_bitrate >> (LAYER_BITRATE_SHIFT * index);
+}
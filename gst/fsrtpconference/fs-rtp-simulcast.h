@@ -0,0 +1,66 @@
+/*
+ * Farstream - Farstream RTP Simulcast layers
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-rtp-simulcast.h - Extra encodings of the sent video
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_SIMULCAST_H__
+#define __FS_RTP_SIMULCAST_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Including the main encoding, which is layer 0 */
+#define FS_RTP_SIMULCAST_MAX_LAYERS (4)
+
+typedef struct _FsRtpSimulcastLayer FsRtpSimulcastLayer;
+
+struct _FsRtpSimulcastLayer
+{
+  guint index;
+  guint32 ssrc;
+
+  /* Contains all the elements below, owned by the conference once added */
+  GstElement *bin;
+
+  GstElement *valve;
+  GstElement *bitrate_adapter;
+  GstElement *codecbin;
+
+  /* The request pads the bin is linked to */
+  GstPad *tee_pad;
+  GstPad *funnel_pad;
+};
+
+FsRtpSimulcastLayer *fs_rtp_simulcast_layer_new (guint session_id,
+    guint index, guint32 ssrc, GstElement *codecbin, GError **error);
+void fs_rtp_simulcast_layer_free (FsRtpSimulcastLayer *layer);
+
+void fs_rtp_simulcast_layer_set_active (FsRtpSimulcastLayer *layer,
+    gboolean active);
+void fs_rtp_simulcast_layer_set_bitrate (FsRtpSimulcastLayer *layer,
+    guint bitrate);
+
+guint fs_rtp_simulcast_layer_bitrate (guint send_bitrate, guint index);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_SIMULCAST_H__ */
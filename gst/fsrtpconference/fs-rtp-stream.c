@@ -55,6 +55,8 @@
 
 #include <farstream/fs-rtp.h>
 
+#include "fs-rtp-simulcast.h"
+
 /* Signals */
 enum
 {
@@ -78,7 +80,9 @@ enum
   PROP_RTP_HEADER_EXTENSIONS,
   PROP_DECRYPTION_PARAMETERS,
   PROP_SEND_RTCP_MUX,
-  PROP_REQUIRE_ENCRYPTION
+  PROP_REQUIRE_ENCRYPTION,
+  PROP_SIMULCAST_LAYER,
+  PROP_MIX_PAD
 };
 
 struct _FsRtpStreamPrivate
@@ -246,6 +250,27 @@ fs_rtp_stream_class_init (FsRtpStreamClass *klass)
           "Send RTCP muxed with on the same RTP connection",
           FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SIMULCAST_LAYER,
+      g_param_spec_uint ("simulcast-layer",
+          "Simulcast layer wanted by this stream",
+          "The simulcast layer this participant wants to receive, 0 is the"
+          " full quality one, see the \"simulcast-layers\" property of the"
+          " session. The streams created before the session had more than"
+          " one layer share their transmitter and get all of them",
+          0, FS_RTP_SIMULCAST_MAX_LAYERS - 1, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_MIX_PAD,
+      g_param_spec_object ("mix-pad",
+          "The mixed audio for this stream",
+          "The source pad of the conference with the audio of all the other"
+          " participants mixed together, only when the \"mixing-speakers\""
+          " property of the session is set",
+          GST_TYPE_PAD,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -486,6 +511,16 @@ fs_rtp_stream_get_property (GObject *object,
       g_value_set_boolean (value, fs_rtp_stream_requires_crypto_locked (self));
       FS_RTP_SESSION_UNLOCK (session);
       break;
+    case PROP_SIMULCAST_LAYER:
+      FS_RTP_SESSION_LOCK (session);
+      g_value_set_uint (value, self->simulcast_layer);
+      FS_RTP_SESSION_UNLOCK (session);
+      break;
+    case PROP_MIX_PAD:
+      FS_RTP_SESSION_LOCK (session);
+      g_value_set_object (value, self->mix_pad);
+      FS_RTP_SESSION_UNLOCK (session);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -612,6 +647,18 @@ fs_rtp_stream_set_property (GObject *object,
         }
       }
       break;
+    case PROP_SIMULCAST_LAYER:
+      {
+        FsRtpSession *session = fs_rtp_stream_get_session (self, NULL);
+
+        if (session) {
+          FS_RTP_SESSION_LOCK (session);
+          self->simulcast_layer = g_value_get_uint (value);
+          FS_RTP_SESSION_UNLOCK (session);
+          g_object_unref (session);
+        }
+      }
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1607,3 +1654,9 @@ fs_rtp_stream_requires_crypto_locked (FsRtpStream *self)
 {
   return self->priv->encrypted;
 }
+
+gboolean
+fs_rtp_stream_is_sending_locked (FsRtpStream *self)
+{
+  return (self->priv->direction & FS_DIRECTION_SEND) != 0;
+}
@@ -82,6 +82,13 @@ struct _FsRtpStream
   /* Dont modify, call add_substream() */
   GList *substreams;
 
+  /* Hold FsRtpSession lock, modify by setting the property */
+  guint simulcast_layer;
+
+  /* Hold FsRtpSession lock, only set by the session when it is mixing,
+   * the conference owns the pad */
+  GstPad *mix_pad;
+
   FsRtpParticipant *participant;
 
   FsRtpStreamPrivate *priv;
@@ -134,6 +141,9 @@ fs_rtp_stream_get_srtp_caps_locked (FsRtpStream *self);
 gboolean
 fs_rtp_stream_requires_crypto_locked (FsRtpStream *self);
 
+gboolean
+fs_rtp_stream_is_sending_locked (FsRtpStream *self);
+
 G_END_DECLS
 
 #endif /* __FS_RTP_STREAM_H__ */
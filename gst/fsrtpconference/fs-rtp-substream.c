@@ -31,8 +31,10 @@
 
 #include <farstream/fs-stream.h>
 #include <farstream/fs-session.h>
+#include <farstream/fs-timer.h>
 
 #include "fs-rtp-stream.h"
+#include "fs-rtp-codec-bin-pool.h"
 
 
 #define GST_CAT_DEFAULT fsrtpconference_debug
@@ -45,6 +47,18 @@
  *
  * rtpbin_pad -> input_valve -> capsfilter -> codecbin -> output_valve -> output_ghostad
  *
+ * When the conference is forwarding, the packets are not decoded, the
+ * capsfilter is linked to a sink pad of the forwarder of the session for
+ * the stream instead and there is no output ghostpad.
+ *
+ * When the session is mixing, the output valve is linked to the mixer of the
+ * session through an audioconvert ! audioresample bin instead of an output
+ * ghostpad, and the packets are only let through to the codecbin while
+ * their sender is one of the loudest speakers.
+ *
+ * In audio sessions, the packets are also dropped before the codecbin while
+ * the session has paused the decoding of the SSRC because it has been
+ * silent according to the audio level header extension.
  */
 
 /* signals */
@@ -55,6 +69,8 @@ enum
   CODEC_CHANGED,
   ERROR_SIGNAL,
   GET_CODEC_BIN,
+  GET_FORWARD_PAD,
+  GET_MIX_PAD,
   UNLINKED,
   LAST_SIGNAL
 };
@@ -99,9 +115,30 @@ struct _FsRtpSubStreamPrivate {
   GstElement *codecbin;
   guint builder_hash;
 
+  /* The forwarder pad the capsfilter is linked to, if forwarding */
+  /* Protected by the session mutex */
+  GstPad *forward_pad;
+
   /* This is only created when the substream is associated with a FsRtpStream */
   GstPad *output_ghostpad;
 
+  /* Instead of the output ghostpad when mixing, the pad is a request pad of
+   * the mixer */
+  GstElement *mix_convert;
+  GstPad *mix_pad;
+
+  /* Owned by the session, only set when mixing */
+  FsRtpSpeakerSelector *speakers;
+  gulong speaker_probe_id;
+  /* Only used by the streaming thread */
+  gboolean not_speaking;
+
+  /* Owned by the session, only set for audio sessions */
+  FsRtpLevelTracker *levels;
+  gulong levels_probe_id;
+  /* Only used by the streaming thread */
+  gboolean silent;
+
   /* Set to TRUE if the ghostpad is already being added */
   /* Proteced by the session mutex */
   gboolean adding_output_ghostpad;
@@ -120,9 +157,8 @@ struct _FsRtpSubStreamPrivate {
 
   /* Protected by the this mutex */
   GMutex mutex;
-  GstClockID no_rtcp_timeout_id;
-  GstClockTime next_no_rtcp_timeout;
-  GThread *no_rtcp_timeout_thread;
+  FsTimer *no_rtcp_timer;
+  gboolean no_rtcp_timeout_armed;
 
   /* Can only be used while using the lock */
   GRWLock stopped_lock;
@@ -384,6 +420,40 @@ fs_rtp_sub_stream_class_init (FsRtpSubStreamClass *klass)
       G_TYPE_POINTER, 5, G_TYPE_POINTER, G_TYPE_POINTER, G_TYPE_UINT,
       G_TYPE_POINTER, G_TYPE_POINTER);
 
+ /**
+   * FsRtpSubStream:get-forward-pad
+   * @self: #FsRtpSubStream that emitted the signal
+   * @stream: the #FsRtpStream this substream is attached to
+   *
+   * This emitted when a forwarding substream is attached to a stream and
+   * wants to send its packets on to the other participants.
+   *
+   * Returns: A new reference to a request pad of the forwarder of @stream,
+   *   the substream releases it
+   */
+  signals[GET_FORWARD_PAD] = g_signal_new ("get-forward-pad",
+      G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST,
+      0, NULL, NULL, NULL,
+      G_TYPE_POINTER, 1, G_TYPE_POINTER);
+
+ /**
+   * FsRtpSubStream:get-mix-pad
+   * @self: #FsRtpSubStream that emitted the signal
+   * @stream: the #FsRtpStream this substream is attached to
+   *
+   * This emitted when a mixing substream is attached to a stream and
+   * wants to send its decoded audio to the mixer of the session.
+   *
+   * Returns: A new reference to a request pad of the mixer for @stream,
+   *   the substream releases it
+   */
+  signals[GET_MIX_PAD] = g_signal_new ("get-mix-pad",
+      G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST,
+      0, NULL, NULL, NULL,
+      G_TYPE_POINTER, 1, G_TYPE_POINTER);
+
 
  /**
    * FsRtpSubStream:unlinked
@@ -416,123 +486,128 @@ fs_rtp_sub_stream_init (FsRtpSubStream *self)
 }
 
 
-static gpointer
+static void
 no_rtcp_timeout_func (gpointer user_data)
 {
   FsRtpSubStream *self = FS_RTP_SUB_STREAM (user_data);
-  GstClock *sysclock = NULL;
-  GstClockID id;
-  gboolean emit = TRUE;
-
-  sysclock = gst_system_clock_obtain ();
-  if (sysclock == NULL)
-    goto no_sysclock;
+  gboolean emit;
 
   FS_RTP_SUB_STREAM_LOCK(self);
-  id = self->priv->no_rtcp_timeout_id = gst_clock_new_single_shot_id (sysclock,
-      self->priv->next_no_rtcp_timeout);
-
+  emit = self->priv->no_rtcp_timeout_armed;
+  self->priv->no_rtcp_timeout_armed = FALSE;
   FS_RTP_SUB_STREAM_UNLOCK(self);
-  gst_clock_id_wait (id, NULL);
+
+  if (emit)
+    g_signal_emit (self, signals[NO_RTCP_TIMEDOUT], 0);
+}
+
+static void
+fs_rtp_sub_stream_start_no_rtcp_timeout (FsRtpSubStream *self)
+{
+  FS_RTP_SESSION_LOCK (self->priv->session);
   FS_RTP_SUB_STREAM_LOCK(self);
 
-  gst_clock_id_unref (id);
-  self->priv->no_rtcp_timeout_id = NULL;
+  if (self->priv->no_rtcp_timer == NULL)
+    self->priv->no_rtcp_timer = _fs_timer_new (no_rtcp_timeout_func, self);
 
-  if (self->priv->next_no_rtcp_timeout == 0)
-    emit = FALSE;
+  self->priv->no_rtcp_timeout_armed = TRUE;
+  _fs_timer_schedule (self->priv->no_rtcp_timer,
+      self->no_rtcp_timeout * GST_MSECOND);
 
   FS_RTP_SUB_STREAM_UNLOCK(self);
+  FS_RTP_SESSION_UNLOCK (self->priv->session);
+}
 
-  gst_object_unref (sysclock);
+static void
+fs_rtp_sub_stream_stop_no_rtcp_timeout (FsRtpSubStream *self)
+{
+  FsTimer *timer;
 
-  if (emit)
-    g_signal_emit (self, signals[NO_RTCP_TIMEDOUT], 0);
+  FS_RTP_SUB_STREAM_LOCK(self);
+  self->priv->no_rtcp_timeout_armed = FALSE;
+  timer = self->priv->no_rtcp_timer;
+  FS_RTP_SUB_STREAM_UNLOCK(self);
 
-  return NULL;
+  /* Waits for a running callback, so it must be done without the lock */
+  if (timer)
+    _fs_timer_cancel (timer);
+}
 
- no_sysclock:
-  {
-    fs_rtp_sub_stream_emit_error (self, FS_ERROR_INTERNAL,
-        "Could not get system clock",
-        "Could not get system clock");
-    return NULL;
-  }
+static void
+rtpbin_pad_unlinked (GstPad *pad, GstPad *peer, gpointer user_data)
+{
+  FsRtpSubStream *self = user_data;
+
+  g_signal_emit (self, signals[UNLINKED], 0);
 }
 
-static gboolean
-fs_rtp_sub_stream_start_no_rtcp_timeout_thread (FsRtpSubStream *self,
-    GError **error)
+static void
+release_request_pad (GstPad *pad)
 {
-  gboolean res = TRUE;
-  GstClock *sysclock = NULL;
+  GstElement *element = gst_pad_get_parent_element (pad);
 
-  sysclock = gst_system_clock_obtain ();
-  if (sysclock == NULL)
+  /* The forwarder or the mixer may already be gone */
+  if (element)
   {
-    g_set_error (error, FS_ERROR, FS_ERROR_INTERNAL,
-        "Could not obtain gst system clock");
-    return FALSE;
+    gst_element_release_request_pad (element, pad);
+    gst_object_unref (element);
   }
 
-  FS_RTP_SESSION_LOCK (self->priv->session);
-  FS_RTP_SUB_STREAM_LOCK(self);
+  gst_object_unref (pad);
+}
 
-  self->priv->next_no_rtcp_timeout = gst_clock_get_time (sysclock) +
-    (self->no_rtcp_timeout * GST_MSECOND);
+static void
+set_discont (GstPadProbeInfo *info)
+{
+  GstBuffer *buffer;
 
-  gst_object_unref (sysclock);
+  buffer = gst_buffer_make_writable (GST_PAD_PROBE_INFO_BUFFER (info));
+  GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+  GST_PAD_PROBE_INFO_DATA (info) = buffer;
+}
 
-  if (self->priv->no_rtcp_timeout_thread == NULL) {
-    /* only create a new thread if the old one was stopped. Otherwise we can
-     * just reuse the currently running one. */
-    self->priv->no_rtcp_timeout_thread =
-        g_thread_try_new ("no rtcp timeout", no_rtcp_timeout_func, self, error);
-  }
+/* Only the loudest speakers are decoded, the decoder is told about the gap */
 
-  res = (self->priv->no_rtcp_timeout_thread != NULL);
+static GstPadProbeReturn
+_speaker_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  FsRtpSubStream *self = FS_RTP_SUB_STREAM (user_data);
 
-  if (res == FALSE && error && *error == NULL)
-    g_set_error (error, FS_ERROR, FS_ERROR_INTERNAL, "Unknown error creating"
-        " thread");
+  if (!fs_rtp_speaker_selector_process (self->priv->speakers,
+          GST_PAD_PROBE_INFO_BUFFER (info)))
+  {
+    self->priv->not_speaking = TRUE;
+    return GST_PAD_PROBE_DROP;
+  }
 
-  FS_RTP_SUB_STREAM_UNLOCK(self);
-  FS_RTP_SESSION_UNLOCK (self->priv->session);
+  if (self->priv->not_speaking)
+  {
+    self->priv->not_speaking = FALSE;
+    set_discont (info);
+  }
 
-  return res;
+  return GST_PAD_PROBE_OK;
 }
 
-static void
-fs_rtp_sub_stream_stop_no_rtcp_timeout_thread (FsRtpSubStream *self)
+/* Silent SSRCs are not decoded, the decoder is told about the gap */
+static GstPadProbeReturn
+_levels_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
 {
-  FS_RTP_SUB_STREAM_LOCK(self);
-  self->priv->next_no_rtcp_timeout = 0;
-  if (self->priv->no_rtcp_timeout_id)
-    gst_clock_id_unschedule (self->priv->no_rtcp_timeout_id);
+  FsRtpSubStream *self = FS_RTP_SUB_STREAM (user_data);
 
-  if (self->priv->no_rtcp_timeout_thread == NULL)
+  if (fs_rtp_level_tracker_is_paused (self->priv->levels, self->ssrc))
   {
-    FS_RTP_SUB_STREAM_UNLOCK(self);
-    return;
+    self->priv->silent = TRUE;
+    return GST_PAD_PROBE_DROP;
   }
-  else
+
+  if (self->priv->silent)
   {
-    FS_RTP_SUB_STREAM_UNLOCK(self);
+    self->priv->silent = FALSE;
+    set_discont (info);
   }
 
-  g_thread_join (self->priv->no_rtcp_timeout_thread);
-
-  FS_RTP_SUB_STREAM_LOCK(self);
-  self->priv->no_rtcp_timeout_thread = NULL;
-  FS_RTP_SUB_STREAM_UNLOCK(self);
-}
-
-static void
-rtpbin_pad_unlinked (GstPad *pad, GstPad *peer, gpointer user_data)
-{
-  FsRtpSubStream *self = user_data;
-
-  g_signal_emit (self, signals[UNLINKED], 0);
+  return GST_PAD_PROBE_OK;
 }
 
 static void
@@ -552,6 +627,17 @@ fs_rtp_sub_stream_constructed (GObject *object)
     return;
   }
 
+  self->forwarding = fs_rtp_conference_is_forwarding (self->priv->conference);
+
+  if (!self->forwarding)
+    self->priv->speakers =
+        fs_rtp_session_get_speaker_selector (self->priv->session);
+  self->mixing = (self->priv->speakers != NULL);
+
+  if (!self->forwarding)
+    self->priv->levels =
+        fs_rtp_session_get_level_tracker (self->priv->session);
+
   self->priv->rtpbin_unlinked_sig = g_signal_connect_object (
       self->priv->rtpbin_pad, "unlinked", G_CALLBACK (rtpbin_pad_unlinked),
       self, 0);
@@ -681,10 +767,16 @@ fs_rtp_sub_stream_constructed (GObject *object)
     return;
   }
 
+  if (self->mixing)
+    self->priv->speaker_probe_id = gst_pad_add_probe (self->priv->rtpbin_pad,
+        GST_PAD_PROBE_TYPE_BUFFER, _speaker_probe, self, NULL);
+
+  if (self->priv->levels)
+    self->priv->levels_probe_id = gst_pad_add_probe (self->priv->rtpbin_pad,
+        GST_PAD_PROBE_TYPE_BUFFER, _levels_probe, self, NULL);
+
   if (self->no_rtcp_timeout > 0)
-    if (!fs_rtp_sub_stream_start_no_rtcp_timeout_thread (self,
-            &self->priv->construction_error))
-      return;
+    fs_rtp_sub_stream_start_no_rtcp_timeout (self);
 
   GST_CALL_PARENT (G_OBJECT_CLASS, constructed, (object));
 }
@@ -695,7 +787,7 @@ fs_rtp_sub_stream_dispose (GObject *object)
 {
   FsRtpSubStream *self = FS_RTP_SUB_STREAM (object);
 
-  fs_rtp_sub_stream_stop_no_rtcp_timeout_thread (self);
+  fs_rtp_sub_stream_stop_no_rtcp_timeout (self);
 
   if (self->priv->output_ghostpad) {
     gst_element_remove_pad (GST_ELEMENT (self->priv->conference),
@@ -703,6 +795,18 @@ fs_rtp_sub_stream_dispose (GObject *object)
     self->priv->output_ghostpad = NULL;
   }
 
+  if (self->priv->mix_pad) {
+    release_request_pad (self->priv->mix_pad);
+    self->priv->mix_pad = NULL;
+  }
+
+  if (self->priv->mix_convert) {
+    gst_element_set_locked_state (self->priv->mix_convert, TRUE);
+    gst_element_set_state (self->priv->mix_convert, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (self->priv->conference), self->priv->mix_convert);
+    self->priv->mix_convert = NULL;
+  }
+
   if (self->priv->output_valve) {
     gst_element_set_locked_state (self->priv->output_valve, TRUE);
     gst_element_set_state (self->priv->output_valve, GST_STATE_NULL);
@@ -711,10 +815,15 @@ fs_rtp_sub_stream_dispose (GObject *object)
   }
 
   if (self->priv->codecbin) {
-    gst_element_set_locked_state (self->priv->codecbin, TRUE);
-    gst_element_set_state (self->priv->codecbin, GST_STATE_NULL);
-    gst_bin_remove (GST_BIN (self->priv->conference), self->priv->codecbin);
+    GstElement *codecbin = gst_object_ref (self->priv->codecbin);
+
+    gst_element_set_locked_state (codecbin, TRUE);
+    gst_element_set_state (codecbin, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (self->priv->conference), codecbin);
     self->priv->codecbin = NULL;
+    fs_rtp_codec_bin_pool_recycle (
+        fs_rtp_conference_get_codec_bin_pool (self->priv->conference),
+        codecbin);
   }
 
   if (self->priv->capsfilter) {
@@ -724,6 +833,11 @@ fs_rtp_sub_stream_dispose (GObject *object)
     self->priv->capsfilter = NULL;
   }
 
+  if (self->priv->forward_pad) {
+    release_request_pad (self->priv->forward_pad);
+    self->priv->forward_pad = NULL;
+  }
+
   if (self->priv->input_valve) {
     gst_element_set_locked_state (self->priv->input_valve, TRUE);
     gst_element_set_state (self->priv->input_valve, GST_STATE_NULL);
@@ -732,6 +846,14 @@ fs_rtp_sub_stream_dispose (GObject *object)
   }
 
   if (self->priv->rtpbin_pad) {
+    if (self->priv->speaker_probe_id)
+      gst_pad_remove_probe (self->priv->rtpbin_pad,
+          self->priv->speaker_probe_id);
+    self->priv->speaker_probe_id = 0;
+    if (self->priv->levels_probe_id)
+      gst_pad_remove_probe (self->priv->rtpbin_pad,
+          self->priv->levels_probe_id);
+    self->priv->levels_probe_id = 0;
     gst_object_unref (self->priv->rtpbin_pad);
     self->priv->rtpbin_pad = NULL;
   }
@@ -744,6 +866,9 @@ fs_rtp_sub_stream_finalize (GObject *object)
 {
   FsRtpSubStream *self = FS_RTP_SUB_STREAM (object);
 
+  if (self->priv->no_rtcp_timer)
+    _fs_timer_free (self->priv->no_rtcp_timer);
+
   fs_codec_destroy (self->codec);
   g_mutex_clear (&self->priv->mutex);
   g_rw_lock_clear (&self->priv->stopped_lock);
@@ -876,11 +1001,13 @@ fs_rtp_sub_stream_set_codecbin (FsRtpSubStream *substream,
 
   if (substream->priv->codecbin)
   {
-    gst_element_set_locked_state (substream->priv->codecbin, TRUE);
-    if (gst_element_set_state (substream->priv->codecbin, GST_STATE_NULL) !=
+    GstElement *old_codecbin = substream->priv->codecbin;
+
+    gst_element_set_locked_state (old_codecbin, TRUE);
+    if (gst_element_set_state (old_codecbin, GST_STATE_NULL) !=
         GST_STATE_CHANGE_SUCCESS)
     {
-      gst_element_set_locked_state (substream->priv->codecbin, FALSE);
+      gst_element_set_locked_state (old_codecbin, FALSE);
       g_set_error (error, FS_ERROR, FS_ERROR_INTERNAL,
           "Could not set the codec bin for ssrc %u"
           " and payload type %d to the state NULL", substream->ssrc,
@@ -889,13 +1016,17 @@ fs_rtp_sub_stream_set_codecbin (FsRtpSubStream *substream,
       return FALSE;
     }
 
-    gst_bin_remove (GST_BIN (substream->priv->conference),
-        substream->priv->codecbin);
+    gst_object_ref (old_codecbin);
+    gst_bin_remove (GST_BIN (substream->priv->conference), old_codecbin);
 
     FS_RTP_SESSION_LOCK (substream->priv->session);
     substream->priv->codecbin = NULL;
     substream->priv->builder_hash = 0;
     FS_RTP_SESSION_UNLOCK (substream->priv->session);
+
+    fs_rtp_codec_bin_pool_recycle (
+        fs_rtp_conference_get_codec_bin_pool (substream->priv->conference),
+        old_codecbin);
   }
 
 
@@ -1033,9 +1164,29 @@ fs_rtp_sub_stream_stop (FsRtpSubStream *substream)
     substream->priv->check_caps_id = 0;
   }
 
+  if (substream->priv->speaker_probe_id != 0)
+  {
+    gst_pad_remove_probe (substream->priv->rtpbin_pad,
+        substream->priv->speaker_probe_id);
+    substream->priv->speaker_probe_id = 0;
+  }
+
+  if (substream->priv->levels_probe_id != 0)
+  {
+    gst_pad_remove_probe (substream->priv->rtpbin_pad,
+        substream->priv->levels_probe_id);
+    substream->priv->levels_probe_id = 0;
+  }
+
   if (substream->priv->output_ghostpad)
     gst_pad_set_active (substream->priv->output_ghostpad, FALSE);
 
+  if (substream->priv->mix_convert)
+  {
+    gst_element_set_locked_state (substream->priv->mix_convert, TRUE);
+    gst_element_set_state (substream->priv->mix_convert, GST_STATE_NULL);
+  }
+
   if (substream->priv->output_valve)
   {
     gst_element_set_locked_state (substream->priv->output_valve, TRUE);
@@ -1061,6 +1212,92 @@ fs_rtp_sub_stream_stop (FsRtpSubStream *substream)
   }
 }
 
+/*
+ * Links the output valve to the mixer of the session instead of an output
+ * ghostpad
+ */
+
+static gboolean
+fs_rtp_sub_stream_link_mixer (FsRtpSubStream *substream, GError **error)
+{
+  GstElement *convert;
+  GstPad *pad = NULL;
+  GstPad *srcpad;
+  GstPadLinkReturn ret;
+  gchar *tmp;
+
+  convert = gst_parse_bin_from_description ("audioconvert ! audioresample",
+      TRUE, error);
+  if (!convert)
+  {
+    g_prefix_error (error, "Could not build the mixer converter: ");
+    return FALSE;
+  }
+
+  tmp = g_strdup_printf ("mix_convert_%u_%u_%u", substream->priv->session->id,
+      substream->ssrc, substream->pt);
+  gst_object_set_name (GST_OBJECT (convert), tmp);
+  g_free (tmp);
+
+  if (!gst_bin_add (GST_BIN (substream->priv->conference), convert))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not add the mixer converter to the conference");
+    gst_object_unref (convert);
+    return FALSE;
+  }
+  substream->priv->mix_convert = convert;
+
+  if (!gst_element_link (substream->priv->output_valve, convert))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link the output valve to the mixer converter");
+    return FALSE;
+  }
+
+  g_signal_emit (substream, signals[GET_MIX_PAD], 0,
+      substream->priv->stream, &pad);
+
+  if (!pad)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not get a mixer pad");
+    return FALSE;
+  }
+
+  srcpad = gst_element_get_static_pad (convert, "src");
+  ret = gst_pad_link (srcpad, pad);
+  gst_object_unref (srcpad);
+
+  if (GST_PAD_LINK_FAILED (ret))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link the mixer converter to the mixer (%d)", ret);
+    release_request_pad (pad);
+    return FALSE;
+  }
+
+  FS_RTP_SESSION_LOCK (substream->priv->session);
+  substream->priv->mix_pad = pad;
+  FS_RTP_SESSION_UNLOCK (substream->priv->session);
+
+  if (!gst_element_sync_state_with_parent (convert))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not set the mixer converter to the state of the conference");
+    return FALSE;
+  }
+
+  GST_DEBUG ("Mixing substream for ssrc:%X pt:%u", substream->ssrc,
+      substream->pt);
+
+  g_signal_emit (substream, signals[CODEC_CHANGED], 0);
+
+  g_object_set (substream->priv->output_valve, "drop", FALSE, NULL);
+
+  return TRUE;
+}
+
 /**
  * fs_rtp_sub_stream_add_output_ghostpad_unlock:
  *
@@ -1092,6 +1329,23 @@ fs_rtp_sub_stream_add_output_ghostpad_unlock (FsRtpSubStream *substream,
     goto out;
   }
 
+  /* Forwarded packets are not decoded, there is nothing to output */
+  if (substream->forwarding)
+  {
+    FS_RTP_SESSION_UNLOCK (substream->priv->session);
+    goto out;
+  }
+
+  if (substream->mixing)
+  {
+    substream->priv->adding_output_ghostpad = TRUE;
+    FS_RTP_SESSION_UNLOCK (substream->priv->session);
+
+    if (!fs_rtp_sub_stream_link_mixer (substream, error))
+      goto error;
+    goto out;
+  }
+
   g_assert (substream->priv->output_ghostpad == NULL);
 
   substream->priv->adding_output_ghostpad = TRUE;
@@ -1202,7 +1456,7 @@ _probe_check_caps (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
 
   FS_RTP_SESSION_LOCK (self->priv->session);
 
-  if (self->priv->codecbin && self->codec)
+  if ((self->priv->codecbin || self->forwarding) && self->codec)
   {
     GstCaps *caps;
 
@@ -1220,6 +1474,51 @@ _probe_check_caps (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
   return ret;
 }
 
+/*
+ * Links the capsfilter to the forwarder of the stream instead of a codec bin
+ */
+
+static gboolean
+fs_rtp_sub_stream_link_forwarder (FsRtpSubStream *substream, GError **error)
+{
+  GstPad *pad = NULL;
+  GstPad *srcpad;
+  GstPadLinkReturn ret;
+
+  g_signal_emit (substream, signals[GET_FORWARD_PAD], 0,
+      substream->priv->stream, &pad);
+
+  if (!pad)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not get a forwarder pad");
+    return FALSE;
+  }
+
+  srcpad = gst_element_get_static_pad (substream->priv->capsfilter, "src");
+  ret = gst_pad_link (srcpad, pad);
+  gst_object_unref (srcpad);
+
+  if (GST_PAD_LINK_FAILED (ret))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link the receive capsfilter to the forwarder (%d)", ret);
+    release_request_pad (pad);
+    return FALSE;
+  }
+
+  FS_RTP_SESSION_LOCK (substream->priv->session);
+  substream->priv->forward_pad = pad;
+  FS_RTP_SESSION_UNLOCK (substream->priv->session);
+
+  GST_DEBUG ("Forwarding substream for ssrc:%X pt:%u", substream->ssrc,
+      substream->pt);
+
+  g_signal_emit (substream, signals[CODEC_CHANGED], 0);
+
+  return TRUE;
+}
+
 static GstPadProbeReturn
 _rtpbin_pad_blocked_callback (GstPad *pad, GstPadProbeInfo *info,
     gpointer user_data)
@@ -1293,6 +1592,12 @@ _rtpbin_pad_blocked_callback (GstPad *pad, GstPadProbeInfo *info,
             &error))
       goto error;
   }
+  else if (substream->forwarding && substream->codec &&
+      substream->priv->stream && !substream->priv->forward_pad)
+  {
+    if (!fs_rtp_sub_stream_link_forwarder (substream, &error))
+      goto error;
+  }
 
   if (caps)
   {
@@ -77,6 +77,13 @@ struct _FsRtpSubStream
 
   gint no_rtcp_timeout;
 
+  /* Set at construction, the packets are forwarded instead of decoded */
+  gboolean forwarding;
+
+  /* Set at construction, the decoded audio goes to the mixer of the session
+   * instead of an output ghostpad */
+  gboolean mixing;
+
   FsRtpSubStreamPrivate *priv;
 };
 
@@ -39,6 +39,9 @@
 
 #define ONE_32BIT_CYCLE ((guint64) (((guint64)0xffffffff) + ((guint64)1)))
 
+/* The packet modder wakes up at most once per interval to send a burst */
+#define PACING_INTERVAL (5 * GST_MSECOND)
+
 
 GST_DEBUG_CATEGORY_STATIC (fsrtpconference_tfrc);
 #define GST_CAT_DEFAULT fsrtpconference_tfrc
@@ -188,6 +191,7 @@ fs_rtp_tfrc_destroy (FsRtpTfrc *self)
   self->on_sending_rtcp_id = 0;
 
   g_hash_table_destroy (g_hash_table_ref (self->tfrc_sources));
+  self->last_recv_src = NULL;
 
   self->fsrtpsession = NULL;
 
@@ -205,6 +209,7 @@ fs_rtp_tfrc_dispose (GObject *object)
     g_hash_table_destroy (self->tfrc_sources);
   self->tfrc_sources = NULL;
   self->last_src = NULL;
+  self->last_recv_src = NULL;
 
   if (self->initial_src)
     tracked_src_free (self->initial_src);
@@ -292,9 +297,15 @@ clear_sender (gpointer key, gpointer value, gpointer user_data)
     self->last_src = NULL;
 
   if (src->receiver)
+  {
     return FALSE;
+  }
   else
+  {
+    if (self->last_recv_src == src)
+      self->last_recv_src = NULL;
     return TRUE;
+  }
 }
 
 static void
@@ -633,52 +644,161 @@ rtpsession_sending_rtcp (GObject *rtpsession, GstBuffer *buffer,
   return data.ret;
 }
 
-static GstPadProbeReturn
-incoming_rtp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+/*
+ * Parses the fixed RTP header and finds the rtt-sendts extension directly in
+ * the mapped data, this is cheaper than going through a GstRTPBuffer.
+ * Returns FALSE if it is not a valid RTP packet, @ext_data is NULL if the
+ * extension is not present.
+ */
+static gboolean
+parse_rtp_header (const guint8 *data, gsize size, ExtensionType ext_type,
+    guint ext_id, guint32 *ssrc, guint8 *pt, guint16 *seq,
+    const guint8 **ext_data, guint *ext_size)
 {
-  FsRtpTfrc *self = FS_RTP_TFRC (user_data);
-  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  const guint8 *ext, *ext_end;
+  guint16 profile;
+  gsize offset;
+
+  *ext_data = NULL;
+  *ext_size = 0;
+
+  if (G_UNLIKELY (size < 12 || (data[0] >> 6) != 2))
+    return FALSE;
+
+  *pt = data[1] & 0x7f;
+  *seq = GST_READ_UINT16_BE (data + 2);
+  *ssrc = GST_READ_UINT32_BE (data + 8);
+
+  /* No header extension */
+  if (!(data[0] & 0x10))
+    return TRUE;
+
+  offset = 12 + (data[0] & 0x0f) * 4;
+  if (G_UNLIKELY (size < offset + 4))
+    return FALSE;
+
+  profile = GST_READ_UINT16_BE (data + offset);
+  ext = data + offset + 4;
+  ext_end = ext + GST_READ_UINT16_BE (data + offset + 2) * 4;
+  if (G_UNLIKELY (ext_end > data + size))
+    return FALSE;
+
+  if (ext_type == EXTENSION_ONE_BYTE && profile == 0xBEDE)
+  {
+    /* RFC 5285 section 4.2 */
+    while (ext < ext_end)
+    {
+      guint id = *ext >> 4;
+      guint len = (*ext & 0x0f) + 1;
+
+      if (*ext == 0)
+      {
+        /* Padding */
+        ext++;
+        continue;
+      }
+      if (id == 15 || ext + 1 + len > ext_end)
+        break;
+      if (id == ext_id)
+      {
+        *ext_data = ext + 1;
+        *ext_size = len;
+        break;
+      }
+      ext += 1 + len;
+    }
+  }
+  else if (ext_type == EXTENSION_TWO_BYTES && (profile >> 4) == 0x100)
+  {
+    /* RFC 5285 section 4.3 */
+    while (ext < ext_end)
+    {
+      guint len;
+
+      if (*ext == 0)
+      {
+        /* Padding */
+        ext++;
+        continue;
+      }
+      if (ext + 2 > ext_end)
+        break;
+      len = ext[1];
+      if (ext + 2 + len > ext_end)
+        break;
+      if (ext[0] == ext_id)
+      {
+        *ext_data = ext + 2;
+        *ext_size = len;
+        break;
+      }
+      ext += 2 + len;
+    }
+  }
+
+  return TRUE;
+}
+
+/*
+ * Updates the receiver of the source that sent @buffer.
+ * @now is read from the clock the first time it is needed and then re-used,
+ * so a whole buffer list shares a single timestamp.
+ * Returns the source if it needs to send feedback.
+ */
+
+static struct TrackedSource *
+fs_rtp_tfrc_receive_rtp_locked (FsRtpTfrc *self, GstBuffer *buffer,
+    guint64 *now)
+{
+  GstMapInfo map;
   guint32 ssrc;
-  guint8 *data;
+  const guint8 *data;
   guint size;
-  gboolean got_header = FALSE;
   struct TrackedSource *src = NULL;
-  guint32 rtt, seq;
+  guint32 rtt = 0, seq;
+  guint16 seq16;
   gint64 ts_delta;
-  guint64 ts;
+  guint64 ts = 0;
+  gboolean got_header;
   gboolean send_rtcp = FALSE;
-  guint64 now;
+  gsize packet_len;
   guint8 pt;
   gint seq_delta;
-  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
 
-  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
-    return GST_PAD_PROBE_OK;
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return NULL;
 
-  GST_OBJECT_LOCK (self);
-
-  if (!self->fsrtpsession)
-    goto out_no_header_unmap;
+  if (!parse_rtp_header (map.data, map.size, self->extension_type,
+          self->extension_id, &ssrc, &pt, &seq16, &data, &size))
+  {
+    gst_buffer_unmap (buffer, &map);
+    return NULL;
+  }
 
-  ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
-  pt = gst_rtp_buffer_get_payload_type (&rtpbuffer);
-  seq = gst_rtp_buffer_get_seq (&rtpbuffer);
+  packet_len = map.size;
+  seq = seq16;
+  got_header = (data && size == 7);
+  if (got_header)
+  {
+    rtt = GST_READ_UINT24_BE (data);
+    ts = GST_READ_UINT32_BE (data + 3);
+  }
 
-  if (pt >= 128 || !self->pts[pt])
-    goto out_no_header_unmap;
+  gst_buffer_unmap (buffer, &map);
 
-  if (self->extension_type == EXTENSION_NONE)
-    goto out_no_header_unmap;
-  else if (self->extension_type == EXTENSION_ONE_BYTE)
-    got_header = gst_rtp_buffer_get_extension_onebyte_header (&rtpbuffer,
-        self->extension_id, 0, (gpointer *) &data, &size);
-  else if (self->extension_type == EXTENSION_TWO_BYTES)
-    got_header = gst_rtp_buffer_get_extension_twobytes_header (&rtpbuffer,
-        NULL, self->extension_id, 0, (gpointer *) &data, &size);
+  if (!self->pts[pt])
+    return NULL;
 
-  gst_rtp_buffer_unmap (&rtpbuffer);
-
-  src = fs_rtp_tfrc_get_remote_ssrc_locked (self, ssrc, NULL);
+  /* Most of the time, packets come in runs from the same source */
+  if (G_LIKELY (self->last_recv_src && self->last_recv_src->ssrc == ssrc))
+  {
+    src = self->last_recv_src;
+  }
+  else
+  {
+    src = fs_rtp_tfrc_get_remote_ssrc_locked (self, ssrc, NULL);
+    self->last_recv_src = src;
+  }
 
   if (src->rtpsource == NULL)
   {
@@ -686,20 +806,20 @@ incoming_rtp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
     goto out;
   }
 
-  if (!got_header || size != 7)
-    goto out_no_header;
+  if (!got_header)
+  {
+    src->got_nohdr_pkt = TRUE;
+    goto out;
+  }
 
   src->got_nohdr_pkt = FALSE;
 
-  now =  fs_rtp_tfrc_get_now (self);
-
-  rtt = GST_READ_UINT24_BE (data);
-  ts = GST_READ_UINT32_BE (data + 3);
-
+  if (*now == 0)
+    *now = fs_rtp_tfrc_get_now (self);
 
   if (!src->receiver)
   {
-    src->receiver = tfrc_receiver_new (now);
+    src->receiver = tfrc_receiver_new (*now);
   }
   else if (rtt == 0 && src->last_rtt != 0)
   {
@@ -710,7 +830,7 @@ incoming_rtp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
     src->last_now = 0;
     src->last_rtt = 0;
     tfrc_receiver_free (src->receiver);
-    src->receiver = tfrc_receiver_new (now);
+    src->receiver = tfrc_receiver_new (*now);
     if (src->receiver_id)
     {
       gst_clock_id_unschedule (src->receiver_id);
@@ -734,40 +854,87 @@ incoming_rtp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
   src->last_ts = ts;
   ts += src->ts_cycles;
 
-  send_rtcp = tfrc_receiver_got_packet (src->receiver, ts, now, seq, rtt,
-      gst_rtp_buffer_get_packet_len (&rtpbuffer));
+  send_rtcp = tfrc_receiver_got_packet (src->receiver, ts, *now, seq, rtt,
+      packet_len);
 
   GST_LOG_OBJECT (self, "Got RTP packet");
 
   if (rtt && src->last_rtt == 0)
-    fs_rtp_tfrc_receiver_timer_func_locked (self, src, now);
+    fs_rtp_tfrc_receiver_timer_func_locked (self, src, *now);
 
-  src->last_now = now;
+  src->last_now = *now;
   src->last_rtt = rtt;
 
 out:
-
   if (send_rtcp)
   {
     src->send_feedback = TRUE;
+    return src;
+  }
+
+  return NULL;
+}
+
+struct ReceiveRtpListData {
+  FsRtpTfrc *self;
+  guint64 now;
+  gboolean send_rtcp;
+};
+
+static gboolean
+receive_rtp_list_func (GstBuffer **buffer, guint idx, gpointer user_data)
+{
+  struct ReceiveRtpListData *data = user_data;
+
+  if (fs_rtp_tfrc_receive_rtp_locked (data->self, *buffer, &data->now))
+    data->send_rtcp = TRUE;
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+incoming_rtp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  FsRtpTfrc *self = FS_RTP_TFRC (user_data);
+  gboolean send_rtcp = FALSE;
+  GObject *rtpsession = NULL;
+  guint64 now = 0;
+
+  GST_OBJECT_LOCK (self);
+
+  if (!self->fsrtpsession || self->extension_type == EXTENSION_NONE)
+  {
     GST_OBJECT_UNLOCK (self);
-    g_signal_emit_by_name (src->self->rtpsession, "send-rtcp", (guint64) 0);
+    return GST_PAD_PROBE_OK;
+  }
+
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+  {
+    struct ReceiveRtpListData data = { self, 0, FALSE };
+
+    /* Feedback requested by any of the packets is sent once for the list */
+    gst_buffer_list_foreach (GST_PAD_PROBE_INFO_BUFFER_LIST (info),
+        receive_rtp_list_func, &data);
+    send_rtcp = data.send_rtcp;
   }
   else
   {
-    GST_OBJECT_UNLOCK (self);
+    send_rtcp = (fs_rtp_tfrc_receive_rtp_locked (self,
+            GST_PAD_PROBE_INFO_BUFFER (info), &now) != NULL);
   }
 
-  return GST_PAD_PROBE_OK;
+  if (send_rtcp)
+    rtpsession = g_object_ref (self->rtpsession);
 
-out_no_header_unmap:
+  GST_OBJECT_UNLOCK (self);
 
-  gst_rtp_buffer_unmap (&rtpbuffer);
+  if (rtpsession)
+  {
+    g_signal_emit_by_name (rtpsession, "send-rtcp", (guint64) 0);
+    g_object_unref (rtpsession);
+  }
 
-out_no_header:
-  if (src)
-    src->got_nohdr_pkt = TRUE;
-  goto out;
+  return GST_PAD_PROBE_OK;
 }
 
 static gboolean
@@ -1231,6 +1398,8 @@ send_rtp_pad_blocked (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
     self->packet_modder = GST_ELEMENT (fs_rtp_packet_modder_new (
           fs_rtp_tfrc_outgoing_packets, fs_rtp_tfrc_get_sync_time, self));
     g_object_ref (self->packet_modder);
+    g_object_set (self->packet_modder, "pacing-interval", PACING_INTERVAL,
+        NULL);
 
     if (!gst_bin_add (self->parent_bin, self->packet_modder))
     {
@@ -1354,7 +1523,8 @@ fs_rtp_tfrc_new (FsRtpSession *fsrtpsession)
   gst_object_unref (rtpmuxer);
 
   self->in_rtp_probe_id = gst_pad_add_probe (self->in_rtp_pad,
-      GST_PAD_PROBE_TYPE_BUFFER, incoming_rtp_probe,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      incoming_rtp_probe,
       g_object_ref (self), (GDestroyNotify) g_object_unref);
   self->in_rtcp_probe_id = gst_pad_add_probe (self->in_rtcp_pad,
       GST_PAD_PROBE_TYPE_BUFFER, incoming_rtcp_probe,
@@ -1502,3 +1672,18 @@ fs_rtp_tfrc_is_enabled (FsRtpTfrc *self, guint pt)
 
   return is_enabled;
 }
+
+/* The packet modder paces the packets, it is there whenever the RTT
+ * header extension has been negotiated */
+
+gboolean
+fs_rtp_tfrc_is_pacing (FsRtpTfrc *self)
+{
+  gboolean is_pacing;
+
+  GST_OBJECT_LOCK (self);
+  is_pacing = (self->extension_type != EXTENSION_NONE);
+  GST_OBJECT_UNLOCK (self);
+
+  return is_pacing;
+}
@@ -119,6 +119,8 @@ struct _FsRtpTfrc
   GHashTable *tfrc_sources;
   struct TrackedSource *initial_src;
   struct TrackedSource *last_src;
+  /* Source of the last received RTP packet, to skip the hash table lookup */
+  struct TrackedSource *last_recv_src;
 
   /* Sender stuff */
   gboolean sending;
@@ -153,6 +155,8 @@ void fs_rtp_tfrc_codecs_updated (FsRtpTfrc *self,
 
 gboolean fs_rtp_tfrc_is_enabled (FsRtpTfrc *self, guint pt);
 
+gboolean fs_rtp_tfrc_is_pacing (FsRtpTfrc *self);
+
 G_END_DECLS
 
 #endif /* __FS_RTP_TFRC_H__ */
@@ -517,8 +517,19 @@ typedef struct  {
   guint64 last_recvtime;
 } ReceivedInterval;
 
+/* Power of two larger than MAX_HISTORY_SIZE + 1 */
+#define RECEIVED_INTERVALS_MIN_CAPACITY (32)
+
 struct _TfrcReceiver {
-  GQueue received_intervals;
+  /* Ring buffer of the received intervals, oldest first. Its capacity is a
+   * power of two, it only grows past RECEIVED_INTERVALS_MIN_CAPACITY while
+   * there is less than MIN_HISTORY_DURATION RTTs of history, as the history
+   * is not trimmed then.
+   */
+  ReceivedInterval *received_intervals;
+  guint received_intervals_capacity;
+  guint received_intervals_head;
+  guint received_intervals_len;
 
   gboolean sp;
 
@@ -548,7 +559,9 @@ tfrc_receiver_new (guint64 now)
 {
   TfrcReceiver *receiver = g_slice_new0 (TfrcReceiver);
 
-  g_queue_init (&receiver->received_intervals);
+  receiver->received_intervals = g_new (ReceivedInterval,
+      RECEIVED_INTERVALS_MIN_CAPACITY);
+  receiver->received_intervals_capacity = RECEIVED_INTERVALS_MIN_CAPACITY;
   receiver->received_bytes_reset_time = now;
   receiver->prev_received_bytes_reset_time = now;
 
@@ -569,14 +582,90 @@ tfrc_receiver_new_sp (guint64 now)
 void
 tfrc_receiver_free (TfrcReceiver *receiver)
 {
-  ReceivedInterval *ri;
-
-  while ((ri = g_queue_pop_tail (&receiver->received_intervals)))
-    g_slice_free (ReceivedInterval, ri);
+  g_free (receiver->received_intervals);
 
   g_slice_free (TfrcReceiver, receiver);
 }
 
+static inline ReceivedInterval *
+received_interval_get (TfrcReceiver *receiver, guint i)
+{
+  return &receiver->received_intervals[(receiver->received_intervals_head + i) &
+      (receiver->received_intervals_capacity - 1)];
+}
+
+static void
+received_intervals_grow (TfrcReceiver *receiver)
+{
+  guint capacity = receiver->received_intervals_capacity * 2;
+  ReceivedInterval *intervals = g_new (ReceivedInterval, capacity);
+  guint first_part = MIN (receiver->received_intervals_len,
+      receiver->received_intervals_capacity -
+      receiver->received_intervals_head);
+
+  memcpy (intervals,
+      receiver->received_intervals + receiver->received_intervals_head,
+      first_part * sizeof (ReceivedInterval));
+  memcpy (intervals + first_part, receiver->received_intervals,
+      (receiver->received_intervals_len - first_part) *
+      sizeof (ReceivedInterval));
+
+  g_free (receiver->received_intervals);
+  receiver->received_intervals = intervals;
+  receiver->received_intervals_capacity = capacity;
+  receiver->received_intervals_head = 0;
+}
+
+/*
+ * Makes room for a new interval at position @pos, the intervals from @pos
+ * onwards are moved up by one. This invalidates pointers to the intervals
+ * unless @pos is 0 or the end of the history.
+ */
+static ReceivedInterval *
+received_intervals_insert (TfrcReceiver *receiver, guint pos)
+{
+  guint i;
+
+  if (receiver->received_intervals_len ==
+      receiver->received_intervals_capacity)
+    received_intervals_grow (receiver);
+
+  if (pos == 0)
+    receiver->received_intervals_head =
+      (receiver->received_intervals_head +
+          receiver->received_intervals_capacity - 1) &
+      (receiver->received_intervals_capacity - 1);
+  else
+    for (i = receiver->received_intervals_len; i > pos; i--)
+      *received_interval_get (receiver, i) =
+        *received_interval_get (receiver, i - 1);
+
+  receiver->received_intervals_len++;
+
+  return received_interval_get (receiver, pos);
+}
+
+/*
+ * Removes the interval at position @pos. This invalidates pointers to the
+ * intervals unless @pos is 0.
+ */
+static void
+received_intervals_remove (TfrcReceiver *receiver, guint pos)
+{
+  guint i;
+
+  if (pos == 0)
+    receiver->received_intervals_head =
+      (receiver->received_intervals_head + 1) &
+      (receiver->received_intervals_capacity - 1);
+  else
+    for (i = pos; i < receiver->received_intervals_len - 1; i++)
+      *received_interval_get (receiver, i) =
+        *received_interval_get (receiver, i + 1);
+
+  receiver->received_intervals_len--;
+}
+
 /*
  * @s:  segment size in bytes
  * @R: RTT in milli seconds (instead of seconds)
@@ -623,7 +712,9 @@ calculate_loss_event_rate (TfrcReceiver *receiver, guint64 now)
   guint loss_intervals[LOSS_EVENTS_MAX];
   const gdouble weights[8] = { 1.0, 1.0, 1.0, 1.0, 0.8, 0.6, 0.4, 0.2 };
   gint max_index = -1;
-  GList *item;
+  guint item;
+  ReceivedInterval *current = NULL;
+  ReceivedInterval *prev;
   guint max_seqnum = 0;
   gint i;
   guint max_interval;
@@ -635,20 +726,20 @@ calculate_loss_event_rate (TfrcReceiver *receiver, guint64 now)
   if (receiver->sender_rtt == 0)
     return 0;
 
-  if (receiver->received_intervals.length < 2)
+  if (receiver->received_intervals_len < 2)
     return 0;
 
   DEBUG_RECEIVER (receiver, "start loss event rate computation (rtt: %u)",
       receiver->sender_rtt);
 
-  for (item = g_queue_peek_head_link (&receiver->received_intervals)->next;
-       item;
-       item = item->next) {
-    ReceivedInterval *current = item->data;
-    ReceivedInterval *prev = item->prev->data;
+  current = received_interval_get (receiver, 0);
+  for (item = 1; item < receiver->received_intervals_len; item++) {
     guint64 start_ts;
     guint start_seqnum;
 
+    prev = current;
+    current = received_interval_get (receiver, item);
+
     max_seqnum = current->last_seqnum;
 
     DEBUG_RECEIVER (receiver, "Loss: ts %"G_GUINT64_FORMAT
@@ -833,7 +924,9 @@ gboolean
 tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
     guint64 now, guint seqnum, guint sender_rtt, guint packet_size)
 {
-  GList *item = NULL;
+  gint item;
+  gint current_pos = -1;
+  gint prev_pos = -1;
   ReceivedInterval *current = NULL;
   ReceivedInterval *prev = NULL;
   gboolean recalculate_loss_rate = FALSE;
@@ -851,7 +944,7 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
     receiver->sender_rtt = sender_rtt;
 
   /* RFC 5348 section 6.3: First packet received */
-  if (g_queue_get_length (&receiver->received_intervals) == 0 ||
+  if (receiver->received_intervals_len == 0 ||
       receiver->sender_rtt == 0) {
     if (receiver->sender_rtt)
       receiver->feedback_timer_expiry = now + receiver->sender_rtt;
@@ -862,11 +955,13 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
 
   /* RFC 5348 section 6.1 Step 1: Add to packet history */
 
-  for (item = g_queue_peek_tail_link (&receiver->received_intervals);
-       item;
-       item = item->prev) {
-    current = item->data;
-    prev = item->prev ? item->prev->data : NULL;
+  for (item = (gint) receiver->received_intervals_len - 1;
+       item >= 0;
+       item--) {
+    current_pos = item;
+    prev_pos = item - 1;
+    current = received_interval_get (receiver, current_pos);
+    prev = prev_pos >= 0 ? received_interval_get (receiver, prev_pos) : NULL;
 
     if (G_LIKELY (seqnum == current->last_seqnum + 1)) {
       /* Extend the current packet forwardd */
@@ -878,15 +973,16 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
       /* Is inside the current interval, must be duplicate, ignore */
     } else if (seqnum > current->last_seqnum + 1) {
       /* We had a loss, lets add a new one */
-      prev = current;
+      prev_pos = current_pos;
+      current_pos = receiver->received_intervals_len;
 
-      current = g_slice_new (ReceivedInterval);
+      current = received_intervals_insert (receiver, current_pos);
       current->first_timestamp = current->last_timestamp = timestamp;
       current->first_seqnum = current->last_seqnum = seqnum;
       current->first_recvtime = current->last_recvtime = now;
-      g_queue_push_tail (&receiver->received_intervals, current);
 
-      item = g_queue_peek_tail_link (&receiver->received_intervals);
+      /* Appending may have grown the buffer */
+      prev = received_interval_get (receiver, prev_pos);
     } else if (seqnum == current->first_seqnum - 1) {
       /* Extend the current packet backwards */
       current->first_seqnum = seqnum;
@@ -896,15 +992,14 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
         (!prev || seqnum > prev->last_seqnum + 1)) {
       /* We have something that goes in the middle of a gap,
          so lets created a new received interval */
-      current = g_slice_new (ReceivedInterval);
+      current = received_intervals_insert (receiver, current_pos);
 
       current->first_timestamp = current->last_timestamp = timestamp;
       current->first_seqnum = current->last_seqnum = seqnum;
       current->first_recvtime = current->last_recvtime = now;
 
-      g_queue_insert_before (&receiver->received_intervals, item, current);
-      item = item->prev;
-      prev = item->prev ? item->prev->data : NULL;
+      prev = prev_pos >= 0 ?
+          received_interval_get (receiver, prev_pos) : NULL;
     } else
       continue;
     break;
@@ -915,13 +1010,11 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
    */
   if (!history_too_short)
   {
-    ReceivedInterval *newest =
-      g_queue_peek_tail (&receiver->received_intervals);
-    ReceivedInterval *oldest =
-      g_queue_peek_head (&receiver->received_intervals);
-    if (newest && oldest)
+    if (receiver->received_intervals_len > 0)
       history_too_short =
-        newest->last_timestamp - oldest->first_timestamp <
+        received_interval_get (receiver,
+            receiver->received_intervals_len - 1)->last_timestamp -
+        received_interval_get (receiver, 0)->first_timestamp <
         MIN_HISTORY_DURATION * receiver->sender_rtt;
     else
       history_too_short = TRUE;
@@ -931,23 +1024,26 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
   if (G_UNLIKELY (!current)) {
     /* If its before MAX_HISTORY_SIZE, its too old, just discard it */
     if (!history_too_short &&
-        g_queue_get_length (&receiver->received_intervals) > MAX_HISTORY_SIZE)
+        receiver->received_intervals_len > MAX_HISTORY_SIZE)
       return retval;
 
-    current = g_slice_new (ReceivedInterval);
+    current_pos = 0;
+    prev_pos = -1;
+    current = received_intervals_insert (receiver, current_pos);
 
     current->first_timestamp = current->last_timestamp = timestamp;
     current->first_seqnum = current->last_seqnum = seqnum;
     current->first_recvtime = current->last_recvtime = now;
-    g_queue_push_head (&receiver->received_intervals, current);
   }
 
+  /* Removing the head doesn't move the other intervals */
   if (!history_too_short &&
-      g_queue_get_length (&receiver->received_intervals) > MAX_HISTORY_SIZE) {
-    ReceivedInterval *remove = g_queue_pop_head (&receiver->received_intervals);
-    if (remove == prev)
+      receiver->received_intervals_len > MAX_HISTORY_SIZE) {
+    received_intervals_remove (receiver, 0);
+    current_pos--;
+    prev_pos--;
+    if (prev_pos < 0)
       prev = NULL;
-    g_slice_free (ReceivedInterval, remove);
   }
 
 
@@ -961,10 +1057,8 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
     current->first_timestamp = prev->first_timestamp;
     current->first_recvtime = prev->first_recvtime;
 
-    g_slice_free (ReceivedInterval, prev);
-    g_queue_delete_link (&receiver->received_intervals, item->prev);
-
-    prev = item->prev ? item->prev->data : NULL;
+    received_intervals_remove (receiver, current_pos - 1);
+    current = prev = NULL;
 
     recalculate_loss_rate = TRUE;
   }
@@ -0,0 +1,212 @@
+/* Farstream unit tests for the RTP audio level tracking
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "fs-rtp-audio-level.h"
+#include "fs-rtp-conference.h"
+
+#define EXT_ID (3)
+#define THRESHOLD (50)
+
+#define QUIET (100)
+#define LOUD (10)
+
+/* A packet every 20ms */
+#define PACKET_INTERVAL (20 * 1000)
+
+/* How long a SSRC has to be silent to be paused */
+#define SILENCE_HOLD (500 * 1000)
+
+static void
+setup_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+}
+
+static GstBuffer *
+make_packet (guint32 ssrc, gboolean has_level, guint8 level)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+
+  buffer = gst_rtp_buffer_new_allocate (20, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_READWRITE, &rtpbuffer);
+  gst_rtp_buffer_set_payload_type (&rtpbuffer, 0);
+  gst_rtp_buffer_set_ssrc (&rtpbuffer, ssrc);
+  if (has_level)
+    fail_unless (gst_rtp_buffer_add_extension_onebyte_header (&rtpbuffer,
+            EXT_ID, &level, 1));
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  return buffer;
+}
+
+/* Returns TRUE if the level was reported, the other arguments may be NULL */
+
+static gboolean
+process (FsRtpLevelTracker *tracker, guint32 ssrc, gboolean has_level,
+    guint8 level, gboolean *reported_has_level, gboolean *paused)
+{
+  GstBuffer *buffer = make_packet (ssrc, has_level, level);
+  guint32 out_ssrc;
+  gboolean out_has_level = FALSE, out_voice = FALSE, out_paused = FALSE;
+  guint8 out_level = 0;
+  gboolean report;
+
+  report = fs_rtp_level_tracker_process (tracker, buffer, &out_ssrc,
+      &out_has_level, &out_level, &out_voice, &out_paused);
+  gst_buffer_unref (buffer);
+
+  fail_unless (out_ssrc == ssrc);
+  if (reported_has_level)
+    *reported_has_level = out_has_level;
+  if (paused)
+    *paused = out_paused;
+
+  return report;
+}
+
+GST_START_TEST (test_rtpaudiolevel_pause_silence)
+{
+  FsRtpLevelTracker *tracker = fs_rtp_level_tracker_new (THRESHOLD);
+  gint64 start = g_get_monotonic_time ();
+  gboolean has_level, paused = FALSE;
+
+  fs_rtp_level_tracker_set_extension_id (tracker, EXT_ID);
+
+  while (!paused)
+  {
+    fail_unless (g_get_monotonic_time () - start < 2 * SILENCE_HOLD,
+        "The silent SSRC was never paused");
+    if (process (tracker, 1, TRUE, QUIET, &has_level, &paused))
+      fail_unless (has_level);
+    g_usleep (PACKET_INTERVAL);
+  }
+
+  fail_unless (g_get_monotonic_time () - start >= SILENCE_HOLD,
+      "The SSRC was paused too early");
+  fail_unless (fs_rtp_level_tracker_is_paused (tracker, 1));
+
+  /* It is resumed as soon as it is louder than the threshold */
+  fail_unless (process (tracker, 1, TRUE, LOUD, &has_level, &paused),
+      "The resume was not reported");
+  fail_unless (has_level);
+  fail_if (paused);
+  fail_if (fs_rtp_level_tracker_is_paused (tracker, 1));
+
+  fs_rtp_level_tracker_free (tracker);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtpaudiolevel_no_extension)
+{
+  FsRtpLevelTracker *tracker = fs_rtp_level_tracker_new (THRESHOLD);
+  gint64 start = g_get_monotonic_time ();
+
+  fs_rtp_level_tracker_set_extension_id (tracker, EXT_ID);
+
+  /* Nothing is known about its level, so it is never paused nor reported */
+  while (g_get_monotonic_time () - start < 2 * SILENCE_HOLD)
+  {
+    fail_if (process (tracker, 2, FALSE, 0, NULL, NULL),
+        "A level was reported for a SSRC without levels");
+    fail_if (fs_rtp_level_tracker_is_paused (tracker, 2));
+    g_usleep (PACKET_INTERVAL);
+  }
+
+  fs_rtp_level_tracker_free (tracker);
+}
+GST_END_TEST;
+
+static gboolean
+is_selected (FsRtpSpeakerSelector *selector, guint32 ssrc, gboolean has_level,
+    guint8 level)
+{
+  GstBuffer *buffer = make_packet (ssrc, has_level, level);
+  gboolean selected;
+
+  selected = fs_rtp_speaker_selector_process (selector, buffer);
+  gst_buffer_unref (buffer);
+
+  return selected;
+}
+
+GST_START_TEST (test_rtpaudiolevel_speaker_selector)
+{
+  FsRtpSpeakerSelector *selector = fs_rtp_speaker_selector_new (1);
+
+  fs_rtp_speaker_selector_set_extension_id (selector, EXT_ID);
+
+  fail_unless (is_selected (selector, 1, TRUE, LOUD));
+  fail_if (is_selected (selector, 2, TRUE, QUIET),
+      "There is only room for one speaker");
+
+  /* The ones without levels are decoded and do not take the place */
+  fail_unless (is_selected (selector, 3, FALSE, 0));
+  fail_if (is_selected (selector, 2, TRUE, QUIET));
+
+  /* The speaker that stops announcing its level leaves its place */
+  fail_unless (is_selected (selector, 1, FALSE, 0));
+  g_usleep (200 * 1000);
+  fail_unless (is_selected (selector, 2, TRUE, QUIET),
+      "The second speaker did not get the free place");
+
+  fs_rtp_speaker_selector_free (selector);
+}
+GST_END_TEST;
+
+
+static Suite *
+fsrtpaudiolevel_suite (void)
+{
+  Suite *s = suite_create ("fsrtpaudiolevel");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("fsrtpaudiolevel_pause_silence");
+  tcase_add_checked_fixture (tc_chain, setup_debug, NULL);
+  tcase_add_test (tc_chain, test_rtpaudiolevel_pause_silence);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpaudiolevel_no_extension");
+  tcase_add_checked_fixture (tc_chain, setup_debug, NULL);
+  tcase_add_test (tc_chain, test_rtpaudiolevel_no_extension);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpaudiolevel_speaker_selector");
+  tcase_add_checked_fixture (tc_chain, setup_debug, NULL);
+  tcase_add_test (tc_chain, test_rtpaudiolevel_speaker_selector);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtpaudiolevel);
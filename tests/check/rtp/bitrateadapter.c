@@ -0,0 +1,407 @@
+/* Farstream unit tests for the RTP bitrate adapter
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <gst/check/gstcheck.h>
+
+#include "fs-rtp-bitrate-adapter.h"
+
+static GstElement *adapter;
+static GstPad *srcpad;
+static GstPad *sinkpad;
+static guint caps_queries;
+
+/* What the encoder after the adapter would accept */
+static gboolean
+_sink_query (GstPad *pad, GstObject *parent, GstQuery *query)
+{
+  GstCaps *caps, *filter;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_CAPS)
+    return gst_pad_query_default (pad, parent, query);
+
+  caps_queries++;
+
+  gst_query_parse_caps (query, &filter);
+  caps = gst_caps_new_empty_simple ("video/x-raw");
+  if (filter)
+  {
+    GstCaps *tmp = gst_caps_intersect (filter, caps);
+    gst_caps_unref (caps);
+    caps = tmp;
+  }
+  gst_query_set_caps_result (query, caps);
+  gst_caps_unref (caps);
+
+  return TRUE;
+}
+
+static gboolean
+_src_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  gst_event_unref (event);
+  return TRUE;
+}
+
+static void
+setup_adapter (void)
+{
+  GstPad *pad;
+
+  adapter = fs_rtp_bitrate_adapter_new ();
+  caps_queries = 0;
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  gst_pad_set_event_function (srcpad, _src_event);
+  sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_query_function (sinkpad, _sink_query);
+
+  pad = gst_element_get_static_pad (adapter, "sink");
+  fail_unless (gst_pad_link (srcpad, pad) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (adapter, "src");
+  fail_unless (gst_pad_link (pad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_if (gst_element_set_state (adapter, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+}
+
+static void
+teardown_adapter (void)
+{
+  gst_element_set_state (adapter, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (adapter);
+}
+
+/*
+ * Makes the adapter use @bitrate right away instead of at the end of its
+ * interval, going back to PLAYING recomputes it from the last one received
+ */
+static void
+set_bitrate (guint bitrate)
+{
+  gst_element_set_state (adapter, GST_STATE_PAUSED);
+  g_object_set (adapter, "bitrate", bitrate, NULL);
+  gst_element_set_state (adapter, GST_STATE_PLAYING);
+}
+
+static gboolean
+caps_offer (GstCaps *caps, guint width, guint height, guint par_n,
+    guint par_d, guint framerate)
+{
+  GstCaps *wanted = gst_caps_new_simple ("video/x-raw",
+      "width", G_TYPE_INT, width,
+      "height", G_TYPE_INT, height,
+      "pixel-aspect-ratio", GST_TYPE_FRACTION, par_n, par_d,
+      "framerate", GST_TYPE_FRACTION, framerate, 1,
+      NULL);
+  gboolean ret = gst_caps_can_intersect (caps, wanted);
+
+  gst_caps_unref (wanted);
+
+  return ret;
+}
+
+GST_START_TEST (test_rtpbitrateadapter_twelve_on_eleven)
+{
+  GstCaps *caps;
+
+  /* 512 kbit/s is 12.8 Mpixels/s, enough for 704x576 at 31 fps */
+  set_bitrate (512000);
+  caps = gst_pad_peer_query_caps (srcpad, NULL);
+  fail_unless (caps_offer (caps, 704, 576, 12, 11, 30),
+      "4CIF is not offered at 512 kbit/s: %" GST_PTR_FORMAT, caps);
+  fail_unless (caps_offer (caps, 176, 144, 12, 11, 30),
+      "QCIF is not offered at 512 kbit/s: %" GST_PTR_FORMAT, caps);
+  fail_unless (caps_offer (caps, 640, 480, 1, 1, 30),
+      "VGA is not offered at 512 kbit/s: %" GST_PTR_FORMAT, caps);
+  gst_caps_unref (caps);
+
+  /* 64 kbit/s is only enough for 704x576 at 3 fps, which is not offered
+   * when something larger than 20 fps is */
+  set_bitrate (64000);
+  caps = gst_pad_peer_query_caps (srcpad, NULL);
+  fail_if (caps_offer (caps, 704, 576, 12, 11, 3),
+      "4CIF is offered at 64 kbit/s: %" GST_PTR_FORMAT, caps);
+  fail_unless (caps_offer (caps, 176, 144, 12, 11, 30),
+      "QCIF is not offered at 64 kbit/s: %" GST_PTR_FORMAT, caps);
+  gst_caps_unref (caps);
+}
+GST_END_TEST;
+
+/*
+ * Queries the caps of the adapter's sink pad, checks if the adapter asked
+ * downstream or used the result it had cached
+ */
+static GstCaps *
+query_caps (GstCaps *filter, gboolean cached, GstCaps *previous)
+{
+  guint queries = caps_queries;
+  GstCaps *caps = gst_pad_peer_query_caps (srcpad, filter);
+
+  if (cached)
+  {
+    fail_unless (caps_queries == queries, "Downstream was queried again");
+    fail_unless (caps == previous, "The cached caps were not returned");
+  }
+  else
+  {
+    fail_unless (caps_queries == queries + 1,
+        "The cached caps were used after a change");
+  }
+
+  if (previous)
+    gst_caps_unref (previous);
+
+  return caps;
+}
+
+GST_START_TEST (test_rtpbitrateadapter_quantization)
+{
+  GstCaps *caps;
+
+  /* Both round to 512 kbit/s */
+  set_bitrate (510000);
+  caps = query_caps (NULL, FALSE, NULL);
+  set_bitrate (515000);
+  caps = query_caps (NULL, TRUE, caps);
+
+  /* Rounds to 528 kbit/s */
+  set_bitrate (530000);
+  caps = query_caps (NULL, FALSE, caps);
+
+  /* Low bitrates round up to one quantum instead of down to 0 */
+  set_bitrate (1000);
+  caps = query_caps (NULL, FALSE, caps);
+  set_bitrate (16000);
+  caps = query_caps (NULL, TRUE, caps);
+
+  /* Everything above what the largest resolution needs is the same */
+  set_bitrate (50 * 1000 * 1000);
+  caps = query_caps (NULL, FALSE, caps);
+  set_bitrate (G_MAXUINT - 1);
+  caps = query_caps (NULL, TRUE, caps);
+
+  gst_caps_unref (caps);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtpbitrateadapter_cache)
+{
+  GstCaps *caps;
+  GstCaps *filter;
+  GstPad *pad;
+
+  set_bitrate (512000);
+  caps = query_caps (NULL, FALSE, NULL);
+  caps = query_caps (NULL, TRUE, caps);
+
+  /* A different filter is a miss, an equal one a hit */
+  filter = gst_caps_from_string ("video/x-raw, width=(int)704");
+  caps = query_caps (filter, FALSE, caps);
+  gst_caps_unref (filter);
+  filter = gst_caps_from_string ("video/x-raw, width=(int)704");
+  caps = query_caps (filter, TRUE, caps);
+
+  /* Downstream says what it accepts changed */
+  gst_pad_push_event (sinkpad, gst_event_new_reconfigure ());
+  caps = query_caps (filter, FALSE, caps);
+  caps = query_caps (filter, TRUE, caps);
+
+  /* Downstream is a different element */
+  pad = gst_element_get_static_pad (adapter, "src");
+  fail_unless (gst_pad_unlink (pad, sinkpad));
+  fail_unless (gst_pad_link (pad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+  caps = query_caps (filter, FALSE, caps);
+
+  gst_caps_unref (filter);
+  gst_caps_unref (caps);
+}
+GST_END_TEST;
+
+/* Recomputes the bitrate from the history right away and returns it */
+static guint
+get_bitrate (void)
+{
+  FsRtpBitrateAdapter *self = FS_RTP_BITRATE_ADAPTER (adapter);
+  guint bitrate;
+
+  gst_element_set_state (adapter, GST_STATE_PAUSED);
+  gst_element_set_state (adapter, GST_STATE_PLAYING);
+
+  GST_OBJECT_LOCK (self);
+  bitrate = self->bitrate;
+  GST_OBJECT_UNLOCK (self);
+
+  return bitrate;
+}
+
+#define HISTORY_POINTS (100)
+
+/*
+ * Fills the history with 1000, 2000, ... 100000 in a shuffled order. Out of
+ * PLAYING, only the last bitrate is kept, so the first ones move the start
+ * of the ring buffer forward before it has to grow past its 64 entries.
+ */
+static void
+fill_history (void)
+{
+  guint i;
+
+  gst_element_set_state (adapter, GST_STATE_PAUSED);
+  for (i = 0; i < 10; i++)
+    g_object_set (adapter, "bitrate", 1000 * (i + 1), NULL);
+  gst_element_set_state (adapter, GST_STATE_PLAYING);
+
+  /* 37 is prime with 100, so this goes through every value once, the 10th
+   * one set above is the one that was kept */
+  for (i = 1; i < HISTORY_POINTS; i++)
+    g_object_set (adapter, "bitrate", 1000 * ((9 + i * 37) % 100 + 1), NULL);
+
+  fail_unless (FS_RTP_BITRATE_ADAPTER (adapter)->history_len ==
+      HISTORY_POINTS, "The history has %u points instead of %u",
+      FS_RTP_BITRATE_ADAPTER (adapter)->history_len, HISTORY_POINTS);
+}
+
+GST_START_TEST (test_rtpbitrateadapter_mean_stddev)
+{
+  guint bitrate;
+  /* The population standard deviation of 1..n is sqrt ((n^2 - 1) / 12) */
+  guint expected = 50500 - 1000 * sqrt ((HISTORY_POINTS * HISTORY_POINTS - 1)
+      / 12.0);
+
+  fill_history ();
+
+  bitrate = get_bitrate ();
+  fail_unless (bitrate + 1 >= expected && bitrate <= expected + 1,
+      "Got %u instead of %u", bitrate, expected);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtpbitrateadapter_percentile)
+{
+  guint bitrate;
+
+  g_object_set (adapter,
+      "estimator", FS_RTP_BITRATE_ADAPTER_ESTIMATOR_PERCENTILE, NULL);
+  fill_history ();
+
+  /* The index is rounded down, the 10th percentile of 100 points is the
+   * 10th smallest */
+  g_object_set (adapter, "percentile", 10, NULL);
+  bitrate = get_bitrate ();
+  fail_unless (bitrate == 10000, "10th percentile is %u", bitrate);
+
+  g_object_set (adapter, "percentile", 50, NULL);
+  bitrate = get_bitrate ();
+  fail_unless (bitrate == 50000, "Median is %u", bitrate);
+
+  g_object_set (adapter, "percentile", 0, NULL);
+  bitrate = get_bitrate ();
+  fail_unless (bitrate == 1000, "Minimum is %u", bitrate);
+
+  g_object_set (adapter, "percentile", 100, NULL);
+  bitrate = get_bitrate ();
+  fail_unless (bitrate == 100000, "Maximum is %u", bitrate);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtpbitrateadapter_ewma)
+{
+  guint bitrate;
+
+  g_object_set (adapter, "estimator", FS_RTP_BITRATE_ADAPTER_ESTIMATOR_EWMA,
+      "ewma-weight", 0.5, NULL);
+
+  /* A first bitrate of 0 is a real average, not a missing one */
+  gst_element_set_state (adapter, GST_STATE_PAUSED);
+  g_object_set (adapter, "bitrate", 0, NULL);
+  g_object_set (adapter, "bitrate", 1000, NULL);
+  g_object_set (adapter, "bitrate", 2000, NULL);
+  bitrate = get_bitrate ();
+  fail_unless (bitrate == 1250, "Average of 0, 1000, 2000 is %u", bitrate);
+
+  /* Going back to READY starts over */
+  gst_element_set_state (adapter, GST_STATE_READY);
+  g_object_set (adapter, "bitrate", 8000, NULL);
+  bitrate = get_bitrate ();
+  fail_unless (bitrate == 8000, "Average after a restart is %u", bitrate);
+}
+GST_END_TEST;
+
+
+static Suite *
+fsrtpbitrateadapter_suite (void)
+{
+  Suite *s = suite_create ("fsrtpbitrateadapter");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("fsrtpbitrateadapter_twelve_on_eleven");
+  tcase_add_checked_fixture (tc_chain, setup_adapter, teardown_adapter);
+  tcase_add_test (tc_chain, test_rtpbitrateadapter_twelve_on_eleven);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpbitrateadapter_quantization");
+  tcase_add_checked_fixture (tc_chain, setup_adapter, teardown_adapter);
+  tcase_add_test (tc_chain, test_rtpbitrateadapter_quantization);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpbitrateadapter_cache");
+  tcase_add_checked_fixture (tc_chain, setup_adapter, teardown_adapter);
+  tcase_add_test (tc_chain, test_rtpbitrateadapter_cache);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpbitrateadapter_mean_stddev");
+  tcase_add_checked_fixture (tc_chain, setup_adapter, teardown_adapter);
+  tcase_add_test (tc_chain, test_rtpbitrateadapter_mean_stddev);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpbitrateadapter_percentile");
+  tcase_add_checked_fixture (tc_chain, setup_adapter, teardown_adapter);
+  tcase_add_test (tc_chain, test_rtpbitrateadapter_percentile);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpbitrateadapter_ewma");
+  tcase_add_checked_fixture (tc_chain, setup_adapter, teardown_adapter);
+  tcase_add_test (tc_chain, test_rtpbitrateadapter_ewma);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtpbitrateadapter);
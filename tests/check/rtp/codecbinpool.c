@@ -0,0 +1,241 @@
+/* Farstream unit tests for the pool of codec bins
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include "fs-rtp-codec-bin-pool.h"
+#include "fs-rtp-conference.h"
+
+/* Set on the bins before giving them back, the pooled ones keep it */
+#define MARKER "codecbinpool-marker"
+
+static CodecBlueprint *blueprint;
+static FsCodec *codec;
+
+static void
+setup_blueprint (void)
+{
+  GList *blueprints, *item;
+
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_disco, "fsrtpconference_disco",
+      0, "Farstream RTP Codec Discovery");
+
+  blueprints = fs_rtp_blueprints_get (FS_MEDIA_TYPE_AUDIO, NULL);
+  fail_if (blueprints == NULL, "Could not discover the audio codecs");
+
+  blueprint = NULL;
+  for (item = blueprints; item; item = g_list_next (item))
+  {
+    if (codec_blueprint_has_factory (item->data, FS_DIRECTION_RECV))
+    {
+      blueprint = item->data;
+      break;
+    }
+  }
+  fail_if (blueprint == NULL, "There is no audio codec that can be received");
+
+  codec = fs_codec_copy (blueprint->codec);
+  if (codec->id < 0)
+    codec->id = 96;
+}
+
+static void
+teardown_blueprint (void)
+{
+  fs_codec_destroy (codec);
+  fs_rtp_blueprints_unref (FS_MEDIA_TYPE_AUDIO);
+}
+
+static GstElement *
+checkout (FsRtpCodecBinPool *pool, const FsCodec *checkout_codec)
+{
+  GstElement *codecbin;
+  GError *error = NULL;
+
+  codecbin = fs_rtp_codec_bin_pool_checkout (pool, checkout_codec, blueprint,
+      "recv_codecbin", FS_DIRECTION_RECV, &error);
+  fail_if (codecbin == NULL, "Could not build the codec bin: %s",
+      error ? error->message : "unknown error");
+
+  return gst_object_ref_sink (codecbin);
+}
+
+static void
+recycle (FsRtpCodecBinPool *pool, GstElement *codecbin)
+{
+  g_object_set_data (G_OBJECT (codecbin), MARKER, GINT_TO_POINTER (1));
+  fs_rtp_codec_bin_pool_recycle (pool, codecbin);
+}
+
+static gboolean
+is_recycled (GstElement *codecbin)
+{
+  return g_object_get_data (G_OBJECT (codecbin), MARKER) != NULL;
+}
+
+GST_START_TEST (test_rtpcodecbinpool_reuse)
+{
+  FsRtpCodecBinPool *pool = fs_rtp_codec_bin_pool_new ();
+  GstElement *codecbin;
+  FsCodec *other_codec;
+
+  codecbin = checkout (pool, codec);
+  fail_if (is_recycled (codecbin));
+  recycle (pool, codecbin);
+
+  /* Another payload type must not get the bin of the first one */
+  other_codec = fs_codec_copy (codec);
+  other_codec->id = codec->id == 97 ? 98 : 97;
+  codecbin = checkout (pool, other_codec);
+  fail_if (is_recycled (codecbin), "Got the bin of another payload type");
+  gst_object_unref (codecbin);
+  fs_codec_destroy (other_codec);
+
+  codecbin = checkout (pool, codec);
+  fail_unless (is_recycled (codecbin), "The idle bin was not reused");
+  fail_unless (GST_STATE (codecbin) == GST_STATE_READY);
+  fail_unless (!strcmp (GST_OBJECT_NAME (codecbin), "recv_codecbin"));
+  gst_object_unref (codecbin);
+
+  /* It was taken out of the pool */
+  codecbin = checkout (pool, codec);
+  fail_if (is_recycled (codecbin), "The same bin was given out twice");
+  gst_object_unref (codecbin);
+
+  fs_rtp_codec_bin_pool_free (pool);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtpcodecbinpool_max_size)
+{
+  FsRtpCodecBinPool *pool = fs_rtp_codec_bin_pool_new ();
+  GstElement *codecbin;
+
+  fs_rtp_codec_bin_pool_set_max_size (pool, 0);
+  fail_unless (fs_rtp_codec_bin_pool_get_max_size (pool) == 0);
+
+  codecbin = checkout (pool, codec);
+  recycle (pool, codecbin);
+  codecbin = checkout (pool, codec);
+  fail_if (is_recycled (codecbin), "A disabled pool kept a bin");
+  recycle (pool, codecbin);
+
+  /* Shrinking the pool drops what no longer fits */
+  fs_rtp_codec_bin_pool_set_max_size (pool, 1);
+  codecbin = checkout (pool, codec);
+  recycle (pool, codecbin);
+  fs_rtp_codec_bin_pool_set_max_size (pool, 0);
+  codecbin = checkout (pool, codec);
+  fail_if (is_recycled (codecbin), "The bin was not evicted");
+  gst_object_unref (codecbin);
+
+  fs_rtp_codec_bin_pool_free (pool);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtpcodecbinpool_max_idle)
+{
+  FsRtpCodecBinPool *pool = fs_rtp_codec_bin_pool_new ();
+  GstElement *codecbin;
+
+  fs_rtp_codec_bin_pool_set_max_idle (pool, 10 * GST_MSECOND);
+
+  codecbin = checkout (pool, codec);
+  recycle (pool, codecbin);
+  g_usleep (50 * 1000);
+
+  codecbin = checkout (pool, codec);
+  fail_if (is_recycled (codecbin), "An expired bin was reused");
+  gst_object_unref (codecbin);
+
+  fs_rtp_codec_bin_pool_free (pool);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtpcodecbinpool_prewarm)
+{
+  FsRtpCodecBinPool *pool = fs_rtp_codec_bin_pool_new ();
+  GstElement *codecbin;
+
+  fs_rtp_codec_bin_pool_prewarm (pool, codec, blueprint, FS_DIRECTION_RECV);
+
+  /* Only the prewarmed bins are already in READY when given out */
+  codecbin = checkout (pool, codec);
+  fail_unless (GST_STATE (codecbin) == GST_STATE_READY,
+      "The prewarmed bin was not used");
+  gst_object_unref (codecbin);
+
+  codecbin = checkout (pool, codec);
+  fail_unless (GST_STATE (codecbin) == GST_STATE_NULL);
+  gst_object_unref (codecbin);
+
+  /* A full pool is not prewarmed */
+  fs_rtp_codec_bin_pool_set_max_size (pool, 0);
+  fs_rtp_codec_bin_pool_prewarm (pool, codec, blueprint, FS_DIRECTION_RECV);
+  codecbin = checkout (pool, codec);
+  fail_unless (GST_STATE (codecbin) == GST_STATE_NULL);
+  gst_object_unref (codecbin);
+
+  fs_rtp_codec_bin_pool_free (pool);
+}
+GST_END_TEST;
+
+
+static Suite *
+fsrtpcodecbinpool_suite (void)
+{
+  Suite *s = suite_create ("fsrtpcodecbinpool");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("fsrtpcodecbinpool_reuse");
+  tcase_add_checked_fixture (tc_chain, setup_blueprint, teardown_blueprint);
+  tcase_add_test (tc_chain, test_rtpcodecbinpool_reuse);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpcodecbinpool_max_size");
+  tcase_add_checked_fixture (tc_chain, setup_blueprint, teardown_blueprint);
+  tcase_add_test (tc_chain, test_rtpcodecbinpool_max_size);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpcodecbinpool_max_idle");
+  tcase_add_checked_fixture (tc_chain, setup_blueprint, teardown_blueprint);
+  tcase_add_test (tc_chain, test_rtpcodecbinpool_max_idle);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpcodecbinpool_prewarm");
+  tcase_add_checked_fixture (tc_chain, setup_blueprint, teardown_blueprint);
+  tcase_add_test (tc_chain, test_rtpcodecbinpool_prewarm);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtpcodecbinpool);
@@ -0,0 +1,312 @@
+/* Farstream unit tests for the RTP forwarder
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "fs-rtp-forwarder.h"
+
+#define INPUTS (2)
+#define OUTPUTS (2)
+
+/* What an output received last, the first payload byte is the input */
+typedef struct {
+  guint packets;
+  guint input;
+  guint32 ssrc;
+  guint16 seq;
+  GstFlowReturn flow;
+} Received;
+
+static Received received[OUTPUTS];
+static guint keyunit_requests[INPUTS];
+
+static GstElement *forwarder;
+static GstPad *srcpads[INPUTS];
+static GstPad *sinkpads[OUTPUTS];
+static guint16 seqs[INPUTS];
+
+static GstFlowReturn
+_sink_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  Received *r = g_object_get_data (G_OBJECT (pad), "received");
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer));
+  r->packets++;
+  r->input = *(guint8 *) gst_rtp_buffer_get_payload (&rtpbuffer);
+  r->ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
+  r->seq = gst_rtp_buffer_get_seq (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+  gst_buffer_unref (buffer);
+
+  return r->flow;
+}
+
+static gboolean
+_src_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  guint *requests = g_object_get_data (G_OBJECT (pad), "keyunit-requests");
+
+  if (gst_event_has_name (event, "GstForceKeyUnit"))
+    (*requests)++;
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static void
+setup_forwarder (void)
+{
+  GstSegment segment;
+  guint i;
+
+  memset (received, 0, sizeof (received));
+  memset (keyunit_requests, 0, sizeof (keyunit_requests));
+  memset (seqs, 0, sizeof (seqs));
+
+  forwarder = fs_rtp_forwarder_new ();
+  gst_object_ref_sink (forwarder);
+  fail_if (gst_element_set_state (forwarder, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+
+  for (i = 0; i < INPUTS; i++)
+  {
+    GstPad *pad = gst_element_get_request_pad (forwarder, "sink_%u");
+
+    srcpads[i] = gst_pad_new ("src", GST_PAD_SRC);
+    g_object_set_data (G_OBJECT (srcpads[i]), "keyunit-requests",
+        &keyunit_requests[i]);
+    gst_pad_set_event_function (srcpads[i], _src_event);
+    fail_unless (gst_pad_link (srcpads[i], pad) == GST_PAD_LINK_OK);
+    gst_object_unref (pad);
+    gst_pad_set_active (srcpads[i], TRUE);
+
+    gst_pad_push_event (srcpads[i], gst_event_new_stream_start ("forwarder"));
+    gst_pad_push_event (srcpads[i], gst_event_new_caps (
+            gst_caps_new_simple ("application/x-rtp",
+                "clock-rate", G_TYPE_INT, 90000,
+                NULL)));
+    gst_pad_push_event (srcpads[i], gst_event_new_segment (&segment));
+  }
+
+  for (i = 0; i < OUTPUTS; i++)
+  {
+    gchar *name = g_strdup_printf ("src_%u", i);
+    GstPad *pad = gst_element_get_request_pad (forwarder, name);
+
+    g_free (name);
+    fail_if (pad == NULL);
+
+    received[i].flow = GST_FLOW_OK;
+    sinkpads[i] = gst_pad_new ("sink", GST_PAD_SINK);
+    g_object_set_data (G_OBJECT (sinkpads[i]), "received", &received[i]);
+    gst_pad_set_chain_function (sinkpads[i], _sink_chain);
+    fail_unless (gst_pad_link (pad, sinkpads[i]) == GST_PAD_LINK_OK);
+    gst_object_unref (pad);
+    gst_pad_set_active (sinkpads[i], TRUE);
+  }
+}
+
+static void
+teardown_forwarder (void)
+{
+  guint i;
+
+  gst_element_set_state (forwarder, GST_STATE_NULL);
+
+  for (i = 0; i < INPUTS; i++)
+  {
+    gst_pad_set_active (srcpads[i], FALSE);
+    gst_object_unref (srcpads[i]);
+  }
+  for (i = 0; i < OUTPUTS; i++)
+  {
+    gst_pad_set_active (sinkpads[i], FALSE);
+    gst_object_unref (sinkpads[i]);
+  }
+
+  gst_object_unref (forwarder);
+}
+
+static GstFlowReturn
+push_packet (guint input, guint size)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+  guint16 seq = seqs[input]++;
+
+  buffer = gst_rtp_buffer_new_allocate (size, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtpbuffer);
+  gst_rtp_buffer_set_payload_type (&rtpbuffer, 96);
+  gst_rtp_buffer_set_ssrc (&rtpbuffer, 0x1000 + input);
+  gst_rtp_buffer_set_seq (&rtpbuffer, seq);
+  gst_rtp_buffer_set_timestamp (&rtpbuffer, seq * 3000);
+  memset (gst_rtp_buffer_get_payload (&rtpbuffer), input, size);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  return gst_pad_push (srcpads[input], buffer);
+}
+
+GST_START_TEST (test_rtpforwarder_outputs)
+{
+  guint32 ssrc0, ssrc1, ssrc;
+  GstPad *pad;
+
+  fail_unless (fs_rtp_forwarder_get_output_ssrc (
+          FS_RTP_FORWARDER (forwarder), 0, &ssrc0));
+  fail_unless (fs_rtp_forwarder_get_output_ssrc (
+          FS_RTP_FORWARDER (forwarder), 1, &ssrc1));
+  fail_if (fs_rtp_forwarder_get_output_ssrc (
+          FS_RTP_FORWARDER (forwarder), 2, &ssrc));
+  fail_if (ssrc0 == ssrc1, "The two outputs have the same SSRC");
+
+  /* There is only one output per layer */
+  pad = gst_element_get_request_pad (forwarder, "src_1");
+  fail_unless (pad == NULL);
+
+  /* Before any bitrate is known, the inputs are ranked in order */
+  fail_unless (push_packet (0, 100) == GST_FLOW_OK);
+  fail_unless (push_packet (1, 100) == GST_FLOW_OK);
+
+  fail_unless (received[0].packets == 1);
+  fail_unless (received[0].input == 0);
+  fail_unless (received[0].ssrc == ssrc0);
+  fail_unless (received[1].packets == 1);
+  fail_unless (received[1].input == 1);
+  fail_unless (received[1].ssrc == ssrc1);
+
+  /* Each new input is asked for a keyframe */
+  fail_unless (keyunit_requests[0] == 1);
+  fail_unless (keyunit_requests[1] == 1);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtpforwarder_flow_return)
+{
+  GstPad *pad = gst_element_get_static_pad (forwarder, "src_1");
+
+  /* An output that is not linked does not stop the others */
+  fail_unless (gst_pad_unlink (pad, sinkpads[1]));
+  fail_unless (push_packet (1, 100) == GST_FLOW_OK);
+
+  received[1].flow = GST_FLOW_FLUSHING;
+  fail_unless (gst_pad_link (pad, sinkpads[1]) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+  fail_unless (push_packet (1, 100) == GST_FLOW_FLUSHING,
+      "The output was flushing, but not the input");
+
+  received[0].flow = GST_FLOW_ERROR;
+  fail_unless (push_packet (0, 100) == GST_FLOW_ERROR,
+      "The error of the output was not returned upstream");
+
+  received[0].flow = GST_FLOW_OK;
+  fail_unless (push_packet (0, 100) == GST_FLOW_OK);
+}
+GST_END_TEST;
+
+/*
+ * Pushes @packets packets on both inputs, then waits for the bitrate window
+ * to end and pushes one more packet on each, which makes the forwarder rank
+ * the inputs again
+ */
+
+static void
+measure_bitrates (guint packets, guint size0, guint size1)
+{
+  guint i;
+
+  for (i = 0; i < packets; i++)
+  {
+    fail_unless (push_packet (0, size0) == GST_FLOW_OK);
+    fail_unless (push_packet (1, size1) == GST_FLOW_OK);
+  }
+
+  g_usleep (G_USEC_PER_SEC + G_USEC_PER_SEC / 10);
+
+  fail_unless (push_packet (0, size0) == GST_FLOW_OK);
+  fail_unless (push_packet (1, size1) == GST_FLOW_OK);
+}
+
+GST_START_TEST (test_rtpforwarder_hysteresis)
+{
+  guint16 seq;
+
+  /* A bitrate a bit higher is not enough to change the ranks */
+  measure_bitrates (10, 1000, 1200);
+  fail_unless (received[0].input == 0, "The inputs were ranked again");
+  fail_unless (received[1].input == 1, "The inputs were ranked again");
+  fail_unless (keyunit_requests[0] == 1);
+  fail_unless (keyunit_requests[1] == 1);
+
+  seq = received[0].seq;
+
+  /* A clearly higher one is, from the last packet of the second input */
+  measure_bitrates (10, 1000, 4000);
+  fail_unless (received[0].input == 1, "The first output did not switch");
+  fail_unless (keyunit_requests[0] == 2);
+  fail_unless (keyunit_requests[1] == 2);
+
+  /* The sequence numbers stay continuous across the switch */
+  fail_unless (received[0].seq == (guint16) (seq + 12),
+      "The sequence number jumped from %u to %u", seq, received[0].seq);
+
+  fail_unless (push_packet (0, 1000) == GST_FLOW_OK);
+  fail_unless (received[1].input == 0, "The second output did not switch");
+}
+GST_END_TEST;
+
+
+static Suite *
+fsrtpforwarder_suite (void)
+{
+  Suite *s = suite_create ("fsrtpforwarder");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("fsrtpforwarder_outputs");
+  tcase_add_checked_fixture (tc_chain, setup_forwarder, teardown_forwarder);
+  tcase_add_test (tc_chain, test_rtpforwarder_outputs);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpforwarder_flow_return");
+  tcase_add_checked_fixture (tc_chain, setup_forwarder, teardown_forwarder);
+  tcase_add_test (tc_chain, test_rtpforwarder_flow_return);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpforwarder_hysteresis");
+  tcase_add_checked_fixture (tc_chain, setup_forwarder, teardown_forwarder);
+  tcase_add_test (tc_chain, test_rtpforwarder_hysteresis);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtpforwarder);
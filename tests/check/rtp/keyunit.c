@@ -0,0 +1,256 @@
+/* Farstream unit tests for the keyunit request manager
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+
+#include "fs-rtp-conference.h"
+#include "fs-rtp-keyunit-manager.h"
+
+#define LOCAL_SSRC (0x1234)
+#define REMOTE_SSRC (0x5678)
+#define FIR_TYPE (4)
+
+#define MIN_INTERVAL (100)
+
+/*
+ * Stands in for the internal session of the rtpbin, it only has what the
+ * keyunit manager uses
+ */
+
+typedef struct {
+  GObject parent;
+} FakeSession;
+
+typedef struct {
+  GObjectClass parent_class;
+} FakeSessionClass;
+
+static GType fake_session_get_type (void);
+
+G_DEFINE_TYPE (FakeSession, fake_session, G_TYPE_OBJECT);
+
+static void
+fake_session_get_property (GObject *object, guint prop_id, GValue *value,
+    GParamSpec *pspec)
+{
+  g_value_set_uint (value, LOCAL_SSRC);
+}
+
+static void
+fake_session_class_init (FakeSessionClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->get_property = fake_session_get_property;
+
+  g_object_class_install_property (gobject_class, 1,
+      g_param_spec_uint ("internal-ssrc", "Internal SSRC", "Internal SSRC",
+          0, G_MAXUINT, LOCAL_SSRC, G_PARAM_READABLE));
+
+  g_signal_new ("on-feedback-rtcp", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 5,
+      G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT, GST_TYPE_BUFFER);
+}
+
+static void
+fake_session_init (FakeSession *self)
+{
+}
+
+static GMutex mutex;
+static GCond cond;
+static guint keyunits;
+static gboolean last_all_headers;
+
+static GObject *session;
+static FsRtpKeyunitManager *manager;
+static GstPad *encoder_pad, *pad;
+
+static gboolean
+_encoder_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  if (gst_event_has_name (event, "GstForceKeyUnit"))
+  {
+    g_mutex_lock (&mutex);
+    keyunits++;
+    last_all_headers = FALSE;
+    gst_structure_get_boolean (gst_event_get_structure (event), "all-headers",
+        &last_all_headers);
+    g_cond_signal (&cond);
+    g_mutex_unlock (&mutex);
+  }
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static void
+setup_manager (void)
+{
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+
+  keyunits = 0;
+  last_all_headers = FALSE;
+
+  encoder_pad = gst_pad_new ("src", GST_PAD_SRC);
+  gst_pad_set_event_function (encoder_pad, _encoder_event);
+  pad = gst_pad_new ("sink", GST_PAD_SINK);
+  fail_unless (gst_pad_link (encoder_pad, pad) == GST_PAD_LINK_OK);
+  gst_pad_set_active (encoder_pad, TRUE);
+  gst_pad_set_active (pad, TRUE);
+
+  session = g_object_new (fake_session_get_type (), NULL);
+  manager = fs_rtp_keyunit_manager_new (session, pad);
+  fs_rtp_keyunit_manager_set_min_interval (manager, MIN_INTERVAL);
+}
+
+static void
+teardown_manager (void)
+{
+  g_object_unref (manager);
+  g_object_unref (session);
+  gst_pad_set_active (encoder_pad, FALSE);
+  gst_pad_set_active (pad, FALSE);
+  gst_object_unref (encoder_pad);
+  gst_object_unref (pad);
+}
+
+static void
+request_keyunit (gboolean all_headers)
+{
+  gst_pad_push_event (pad, gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+          gst_structure_new ("GstForceKeyUnit",
+              "all-headers", G_TYPE_BOOLEAN, all_headers,
+              NULL)));
+}
+
+/* Like the rtpbin, it requests the keyunit right after the signal */
+
+static void
+receive_fir (guint8 seqnum)
+{
+  GstBuffer *fci = gst_buffer_new_allocate (NULL, 8, NULL);
+  GstMapInfo map;
+
+  gst_buffer_map (fci, &map, GST_MAP_WRITE);
+  memset (map.data, 0, map.size);
+  GST_WRITE_UINT32_BE (map.data, LOCAL_SSRC);
+  map.data[4] = seqnum;
+  gst_buffer_unmap (fci, &map);
+
+  g_signal_emit_by_name (session, "on-feedback-rtcp", GST_RTCP_TYPE_PSFB,
+      FIR_TYPE, REMOTE_SSRC, 0, fci);
+  gst_buffer_unref (fci);
+
+  request_keyunit (TRUE);
+}
+
+GST_START_TEST (test_rtpkeyunit_coalesce)
+{
+  gint64 end_time;
+  guint forced;
+
+  request_keyunit (FALSE);
+  fail_unless (keyunits == 1, "The first request was not let through");
+
+  /* These all end up in a single request at the end of the interval */
+  request_keyunit (FALSE);
+  request_keyunit (TRUE);
+  request_keyunit (FALSE);
+  fail_unless (keyunits == 1, "A request was let through too early");
+
+  end_time = g_get_monotonic_time () + 5 * MIN_INTERVAL * 1000;
+  g_mutex_lock (&mutex);
+  while (keyunits < 2)
+    fail_unless (g_cond_wait_until (&cond, &mutex, end_time),
+        "The coalesced request was never sent");
+  g_mutex_unlock (&mutex);
+
+  fail_unless (last_all_headers,
+      "The coalesced request did not keep all-headers");
+
+  /* Give a second coalesced request some time to show up */
+  g_usleep (2 * MIN_INTERVAL * 1000);
+  fail_unless (keyunits == 2, "Got %u keyunit requests instead of 2",
+      keyunits);
+
+  fs_rtp_keyunit_manager_get_stats (manager, NULL, &forced);
+  fail_unless (forced == 2);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtpkeyunit_fir_retransmission)
+{
+  guint received, forced;
+
+  /* Only the retransmissions are dropped, not the rate limiting */
+  fs_rtp_keyunit_manager_set_min_interval (manager, 0);
+
+  receive_fir (1);
+  fail_unless (keyunits == 1);
+
+  receive_fir (1);
+  fail_unless (keyunits == 1, "The retransmitted FIR made a keyunit");
+
+  receive_fir (2);
+  fail_unless (keyunits == 2, "The new FIR was dropped");
+
+  /* Other requests are not taken for retransmissions */
+  request_keyunit (FALSE);
+  fail_unless (keyunits == 3);
+
+  fs_rtp_keyunit_manager_get_stats (manager, &received, &forced);
+  fail_unless (received == 3);
+  fail_unless (forced == 3);
+}
+GST_END_TEST;
+
+
+static Suite *
+fsrtpkeyunit_suite (void)
+{
+  Suite *s = suite_create ("fsrtpkeyunit");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("fsrtpkeyunit_coalesce");
+  tcase_add_checked_fixture (tc_chain, setup_manager, teardown_manager);
+  tcase_add_test (tc_chain, test_rtpkeyunit_coalesce);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpkeyunit_fir_retransmission");
+  tcase_add_checked_fixture (tc_chain, setup_manager, teardown_manager);
+  tcase_add_test (tc_chain, test_rtpkeyunit_fir_retransmission);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtpkeyunit);
@@ -0,0 +1,197 @@
+/* Farstream unit tests for the RTP audio mixer
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include "fs-rtp-mixer.h"
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define MIXER_FORMAT "S16LE"
+#else
+#define MIXER_FORMAT "S16BE"
+#endif
+
+/* Groups 0 and 1 are talking, groups 2 and 3 only listen */
+#define GROUPS (4)
+#define TALKERS (2)
+
+/* Enough to start the inputs, 4 frames of 20ms */
+#define SAMPLES (4 * FS_RTP_MIXER_RATE / 50)
+
+static const gint16 levels[TALKERS] = { 1000, 100 };
+
+static GMutex mutex;
+static GCond cond;
+static GstBuffer *first_buffer[GROUPS];
+
+static GstFlowReturn
+_sink_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  guint group = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad),
+          "group"));
+
+  g_mutex_lock (&mutex);
+  if (!first_buffer[group])
+  {
+    first_buffer[group] = buffer;
+    g_cond_signal (&cond);
+  }
+  else
+  {
+    gst_buffer_unref (buffer);
+  }
+  g_mutex_unlock (&mutex);
+
+  return GST_FLOW_OK;
+}
+
+static gint16
+first_sample (GstBuffer *buffer)
+{
+  gint16 sample;
+
+  fail_unless (gst_buffer_extract (buffer, 0, &sample, sizeof (sample)) ==
+      sizeof (sample));
+
+  return sample;
+}
+
+GST_START_TEST (test_rtpmixer_n_minus_one)
+{
+  GstElement *pipeline, *mixer;
+  GstPad *srcpads[TALKERS], *sinkpads[GROUPS];
+  GstPad *pad;
+  GstSegment segment;
+  guint i, j;
+
+  memset (first_buffer, 0, sizeof (first_buffer));
+
+  pipeline = gst_pipeline_new (NULL);
+  mixer = fs_rtp_mixer_new ();
+  gst_bin_add (GST_BIN (pipeline), mixer);
+
+  for (i = 0; i < GROUPS; i++)
+  {
+    pad = fs_rtp_mixer_get_pad (mixer, GST_PAD_SRC, i);
+    fail_if (pad == NULL);
+    sinkpads[i] = gst_pad_new ("sink", GST_PAD_SINK);
+    g_object_set_data (G_OBJECT (sinkpads[i]), "group", GUINT_TO_POINTER (i));
+    gst_pad_set_chain_function (sinkpads[i], _sink_chain);
+    fail_unless (gst_pad_link (pad, sinkpads[i]) == GST_PAD_LINK_OK);
+    gst_object_unref (pad);
+    gst_pad_set_active (sinkpads[i], TRUE);
+  }
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+
+  /* Queue the audio of the talkers before the mixer starts */
+  for (i = 0; i < TALKERS; i++)
+  {
+    GstBuffer *buffer;
+    GstMapInfo map;
+
+    pad = fs_rtp_mixer_get_pad (mixer, GST_PAD_SINK, i);
+    fail_if (pad == NULL);
+    srcpads[i] = gst_pad_new ("src", GST_PAD_SRC);
+    fail_unless (gst_pad_link (srcpads[i], pad) == GST_PAD_LINK_OK);
+    gst_object_unref (pad);
+    gst_pad_set_active (srcpads[i], TRUE);
+
+    gst_pad_push_event (srcpads[i], gst_event_new_stream_start ("mixer"));
+    gst_pad_push_event (srcpads[i], gst_event_new_caps (
+            gst_caps_new_simple ("audio/x-raw",
+                "format", G_TYPE_STRING, MIXER_FORMAT,
+                "layout", G_TYPE_STRING, "interleaved",
+                "rate", G_TYPE_INT, FS_RTP_MIXER_RATE,
+                "channels", G_TYPE_INT, 1,
+                NULL)));
+    gst_pad_push_event (srcpads[i], gst_event_new_segment (&segment));
+
+    buffer = gst_buffer_new_allocate (NULL, SAMPLES * sizeof (gint16), NULL);
+    gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+    for (j = 0; j < SAMPLES; j++)
+      ((gint16 *) map.data)[j] = levels[i];
+    gst_buffer_unmap (buffer, &map);
+    fail_unless (gst_pad_push (srcpads[i], buffer) == GST_FLOW_OK);
+  }
+
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  g_mutex_lock (&mutex);
+  for (i = 0; i < GROUPS; i++)
+    while (!first_buffer[i])
+      g_cond_wait (&cond, &mutex);
+  g_mutex_unlock (&mutex);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  /* Everyone hears everyone else, but not themselves */
+  fail_unless (first_sample (first_buffer[0]) == levels[1],
+      "The first talker got %d", first_sample (first_buffer[0]));
+  fail_unless (first_sample (first_buffer[1]) == levels[0],
+      "The second talker got %d", first_sample (first_buffer[1]));
+  for (i = TALKERS; i < GROUPS; i++)
+    fail_unless (first_sample (first_buffer[i]) == levels[0] + levels[1],
+        "Listener %u got %d", i, first_sample (first_buffer[i]));
+
+  /* The listeners all get the same buffer */
+  fail_unless (first_buffer[2] == first_buffer[3],
+      "The mix was made twice for the listeners");
+
+  for (i = 0; i < GROUPS; i++)
+  {
+    gst_buffer_unref (first_buffer[i]);
+    gst_pad_set_active (sinkpads[i], FALSE);
+    gst_object_unref (sinkpads[i]);
+  }
+  for (i = 0; i < TALKERS; i++)
+  {
+    gst_pad_set_active (srcpads[i], FALSE);
+    gst_object_unref (srcpads[i]);
+  }
+  gst_object_unref (pipeline);
+}
+GST_END_TEST;
+
+
+static Suite *
+fsrtpmixer_suite (void)
+{
+  Suite *s = suite_create ("fsrtpmixer");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("fsrtpmixer_n_minus_one");
+  tcase_add_test (tc_chain, test_rtpmixer_n_minus_one);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtpmixer);
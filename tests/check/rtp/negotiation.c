@@ -0,0 +1,381 @@
+/* Farstream unit tests for the RTP codec negotiation
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include "fs-rtp-codec-negotiation.h"
+#include "fs-rtp-conference.h"
+
+/* PCMU has a static payload type, SPEEX gets the first dynamic one */
+#define PCMU_PT (0)
+#define SPEEX_PT (96)
+#define RESERVED_PT (97)
+#define REMOTE_SPEEX_PT (110)
+
+static GList *blueprints;
+
+/* Only what the negotiation looks at is filled, the factories are there so
+ * the codecs can be sent */
+
+static CodecBlueprint *
+make_blueprint (gint id, const gchar *encoding_name)
+{
+  CodecBlueprint *bp = g_slice_new0 (CodecBlueprint);
+  GstElementFactory *factory = gst_element_factory_find ("identity");
+
+  fail_if (factory == NULL, "Could not find identity");
+
+  bp->codec = fs_codec_new (id, encoding_name, FS_MEDIA_TYPE_AUDIO, 8000);
+  bp->media_caps = gst_caps_new_empty_simple ("audio/x-raw");
+  bp->rtp_caps = fs_codec_to_gst_caps (bp->codec);
+  bp->send_pipeline_factory = g_list_prepend (NULL,
+      g_list_prepend (NULL, gst_object_ref (factory)));
+  bp->receive_pipeline_factory = g_list_prepend (NULL,
+      g_list_prepend (NULL, factory));
+
+  return bp;
+}
+
+static void
+setup_blueprints (void)
+{
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_nego, "fsrtpconference_nego", 0,
+      "Farstream RTP Codec Negotiation");
+
+  blueprints = g_list_append (NULL, make_blueprint (PCMU_PT, "PCMU"));
+  blueprints = g_list_append (blueprints,
+      make_blueprint (FS_CODEC_ID_ANY, "SPEEX"));
+}
+
+static void
+teardown_blueprints (void)
+{
+  g_list_foreach (blueprints, (GFunc) codec_blueprint_destroy, NULL);
+  g_list_free (blueprints);
+  blueprints = NULL;
+}
+
+static CodecPreference *
+make_preference (gint id, const gchar *encoding_name)
+{
+  CodecPreference *cp = g_slice_new0 (CodecPreference);
+
+  cp->codec = fs_codec_new (id, encoding_name, FS_MEDIA_TYPE_AUDIO, 0);
+
+  return cp;
+}
+
+static void
+check_table_caps (CodecAssociationTable *table, GList *codec_associations,
+    guint pt)
+{
+  CodecAssociation *ca = lookup_codec_association_by_pt (codec_associations,
+      pt);
+  GstCaps *caps = codec_association_table_get_caps (table, pt);
+  GstCaps *expected;
+
+  fail_if (ca == NULL, "There is no codec for payload type %u", pt);
+  fail_if (caps == NULL, "There are no caps for payload type %u", pt);
+
+  expected = fs_codec_to_gst_caps (ca->codec);
+  fail_unless (gst_caps_is_equal (caps, expected),
+      "The caps of payload type %u are %" GST_PTR_FORMAT " instead of %"
+      GST_PTR_FORMAT, pt, caps, expected);
+  gst_caps_unref (expected);
+  gst_caps_unref (caps);
+}
+
+GST_START_TEST (test_rtpnegotiation_pt_table)
+{
+  GList *prefs, *local, *remote, *negotiated;
+  CodecAssociationTable *table;
+  GstCaps *any = gst_caps_new_any ();
+  GstCaps *caps;
+
+  prefs = g_list_append (NULL, make_preference (RESERVED_PT, "reserve-pt"));
+  local = create_local_codec_associations (blueprints, prefs, NULL, any, any,
+      NULL);
+  fail_if (local == NULL);
+
+  /* The remote side does not want SPEEX and has PCMA which we do not have */
+  remote = g_list_append (NULL,
+      fs_codec_new (PCMU_PT, "PCMU", FS_MEDIA_TYPE_AUDIO, 8000));
+  remote = g_list_append (remote,
+      fs_codec_new (8, "PCMA", FS_MEDIA_TYPE_AUDIO, 8000));
+  negotiated = negotiate_stream_codecs (remote, local, FALSE);
+  fail_if (negotiated == NULL);
+  negotiated = finish_codec_negotiation (local, negotiated);
+
+  table = codec_association_table_new (negotiated);
+
+  /* The lists can go away, the table keeps its own caps */
+  codec_association_list_destroy (local);
+
+  check_table_caps (table, negotiated, PCMU_PT);
+
+  /* SPEEX was offered, so it can still be received */
+  check_table_caps (table, negotiated, SPEEX_PT);
+
+  fail_unless (codec_association_table_get_caps (table, RESERVED_PT) == NULL,
+      "There are caps for a reserved payload type");
+  fail_unless (codec_association_table_get_caps (table, 8) == NULL,
+      "There are caps for a disabled payload type");
+  fail_unless (codec_association_table_get_caps (table, 18) == NULL,
+      "There are caps for an unused payload type");
+  fail_unless (codec_association_table_get_caps (table,
+          CODEC_ASSOCIATION_MAX_PT) == NULL);
+
+  /* Every call returns a new reference to the same caps */
+  caps = codec_association_table_get_caps (table, PCMU_PT);
+  codec_association_list_destroy (negotiated);
+  fail_unless (caps == codec_association_table_get_caps (table, PCMU_PT));
+  gst_caps_unref (caps);
+  gst_caps_unref (caps);
+
+  codec_association_table_free (table);
+  fs_codec_list_destroy (remote);
+  g_list_foreach (prefs, (GFunc) codec_preference_destroy, NULL);
+  g_list_free (prefs);
+  gst_caps_unref (any);
+}
+GST_END_TEST;
+
+static GList *
+make_remote_codecs (gboolean with_speex)
+{
+  GList *codecs = NULL;
+
+  if (with_speex)
+    codecs = g_list_append (codecs, fs_codec_new (REMOTE_SPEEX_PT, "SPEEX",
+            FS_MEDIA_TYPE_AUDIO, 8000));
+  codecs = g_list_append (codecs,
+      fs_codec_new (PCMU_PT, "PCMU", FS_MEDIA_TYPE_AUDIO, 8000));
+
+  return codecs;
+}
+
+static gboolean
+can_send (GList *codec_associations, const gchar *encoding_name)
+{
+  GList *item;
+
+  for (item = codec_associations; item; item = g_list_next (item))
+  {
+    CodecAssociation *ca = item->data;
+
+    if (codec_association_is_valid_for_sending (ca, TRUE) &&
+        !g_ascii_strcasecmp (ca->codec->encoding_name, encoding_name))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Negotiates the streams in order like FsRtpSession does, with @cache or
+ * without any if it is %NULL */
+
+static GList *
+negotiate (GList **streams, guint n_streams, GList *prefs,
+    guint prefs_generation, GstCaps *caps, CodecNegotiationCache *cache)
+{
+  GList *codec_associations;
+  guint i;
+
+  if (cache)
+    codec_negotiation_cache_begin (cache, prefs_generation, caps, caps);
+
+  codec_associations = create_local_codec_associations (blueprints, prefs,
+      NULL, caps, caps, cache);
+  fail_if (codec_associations == NULL);
+
+  for (i = 0; i < n_streams; i++)
+  {
+    GList *tmp;
+
+    if (cache)
+      tmp = codec_negotiation_cache_negotiate_stream (cache, streams[i],
+          codec_associations, n_streams >= 2);
+    else
+      tmp = negotiate_stream_codecs (streams[i], codec_associations,
+          n_streams >= 2);
+    codec_association_list_destroy (codec_associations);
+    codec_associations = tmp;
+    fail_if (codec_associations == NULL, "Could not negotiate stream %u", i);
+  }
+
+  return finish_codec_negotiation (NULL, codec_associations);
+}
+
+/* Whatever the cache re-used, the result must be the same as when
+ * everything is negotiated again */
+
+static GList *
+negotiate_and_compare (GList **streams, guint n_streams, GList *prefs,
+    guint prefs_generation, GstCaps *caps, CodecNegotiationCache *cache)
+{
+  GList *cached, *full;
+
+  cached = negotiate (streams, n_streams, prefs, prefs_generation, caps,
+      cache);
+  full = negotiate (streams, n_streams, prefs, prefs_generation, caps, NULL);
+  fail_unless (codec_associations_list_are_equal (cached, full),
+      "The negotiation with the cache is different from the full one");
+  codec_association_list_destroy (full);
+
+  return cached;
+}
+
+GST_START_TEST (test_rtpnegotiation_cache_streams)
+{
+  CodecNegotiationCache *cache = codec_negotiation_cache_new ();
+  GstCaps *any = gst_caps_new_any ();
+  GList *streams[2];
+  GList *result;
+
+  streams[0] = make_remote_codecs (TRUE);
+  streams[1] = make_remote_codecs (FALSE);
+  result = negotiate_and_compare (streams, 2, NULL, 0, any, cache);
+  fail_if (can_send (result, "SPEEX"), "The second stream has no SPEEX");
+  codec_association_list_destroy (result);
+
+  /* Nothing changed, everything is re-used */
+  result = negotiate_and_compare (streams, 2, NULL, 0, any, cache);
+  fail_if (can_send (result, "SPEEX"));
+  codec_association_list_destroy (result);
+
+  /* The first stream can be re-used, but not the second one */
+  fs_codec_list_destroy (streams[1]);
+  streams[1] = make_remote_codecs (TRUE);
+  result = negotiate_and_compare (streams, 2, NULL, 0, any, cache);
+  fail_unless (can_send (result, "SPEEX"),
+      "The change of the second stream was ignored");
+  codec_association_list_destroy (result);
+
+  /* Nothing can be re-used */
+  fs_codec_list_destroy (streams[0]);
+  streams[0] = make_remote_codecs (FALSE);
+  result = negotiate_and_compare (streams, 2, NULL, 0, any, cache);
+  fail_if (can_send (result, "SPEEX"),
+      "The change of the first stream was ignored");
+  codec_association_list_destroy (result);
+
+  /* The first stream is gone, the second one is alone */
+  result = negotiate_and_compare (streams + 1, 1, NULL, 0, any, cache);
+  fail_unless (can_send (result, "SPEEX"));
+  fail_if (lookup_codec_association_by_pt (result, REMOTE_SPEEX_PT) == NULL,
+      "A single stream should get the remote payload types");
+  codec_association_list_destroy (result);
+
+  fs_codec_list_destroy (streams[0]);
+  fs_codec_list_destroy (streams[1]);
+  gst_caps_unref (any);
+  codec_negotiation_cache_free (cache);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtpnegotiation_cache_invalidation)
+{
+  CodecNegotiationCache *cache = codec_negotiation_cache_new ();
+  CodecBlueprint *speex_bp = g_list_last (blueprints)->data;
+  GstCaps *any = gst_caps_new_any ();
+  GstCaps *narrow;
+  GList *prefs;
+  GList *streams[1];
+  GList *result;
+
+  speex_bp->input_caps = gst_caps_new_simple ("audio/x-raw",
+      "rate", G_TYPE_INT, 16000, NULL);
+  streams[0] = make_remote_codecs (TRUE);
+
+  /* The caps checks are forgotten when the allowed caps change */
+  narrow = gst_caps_new_simple ("audio/x-raw", "rate", G_TYPE_INT, 8000,
+      NULL);
+  result = negotiate_and_compare (streams, 1, NULL, 1, narrow, cache);
+  fail_if (can_send (result, "SPEEX"), "SPEEX was not filtered by the caps");
+  codec_association_list_destroy (result);
+  gst_caps_unref (narrow);
+
+  result = negotiate_and_compare (streams, 1, NULL, 1, any, cache);
+  fail_unless (can_send (result, "SPEEX"),
+      "SPEEX is still filtered by the old caps");
+  codec_association_list_destroy (result);
+
+  narrow = gst_caps_new_simple ("audio/x-raw", "rate", G_TYPE_INT, 8000,
+      NULL);
+  result = negotiate_and_compare (streams, 1, NULL, 1, narrow, cache);
+  fail_if (can_send (result, "SPEEX"), "SPEEX was not filtered again");
+  codec_association_list_destroy (result);
+  gst_caps_unref (narrow);
+
+  /* And so are the disabled codecs when the preferences change */
+  prefs = g_list_append (NULL, make_preference (FS_CODEC_ID_DISABLE, "SPEEX"));
+  result = negotiate_and_compare (streams, 1, prefs, 2, any, cache);
+  fail_if (can_send (result, "SPEEX"), "SPEEX was not disabled");
+  codec_association_list_destroy (result);
+  g_list_foreach (prefs, (GFunc) codec_preference_destroy, NULL);
+  g_list_free (prefs);
+
+  result = negotiate_and_compare (streams, 1, NULL, 3, any, cache);
+  fail_unless (can_send (result, "SPEEX"), "SPEEX is still disabled");
+  codec_association_list_destroy (result);
+
+  fs_codec_list_destroy (streams[0]);
+  gst_caps_unref (any);
+  codec_negotiation_cache_free (cache);
+}
+GST_END_TEST;
+
+
+static Suite *
+fsrtpnegotiation_suite (void)
+{
+  Suite *s = suite_create ("fsrtpnegotiation");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("fsrtpnegotiation_pt_table");
+  tcase_add_checked_fixture (tc_chain, setup_blueprints, teardown_blueprints);
+  tcase_add_test (tc_chain, test_rtpnegotiation_pt_table);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpnegotiation_cache_streams");
+  tcase_add_checked_fixture (tc_chain, setup_blueprints, teardown_blueprints);
+  tcase_add_test (tc_chain, test_rtpnegotiation_cache_streams);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpnegotiation_cache_invalidation");
+  tcase_add_checked_fixture (tc_chain, setup_blueprints, teardown_blueprints);
+  tcase_add_test (tc_chain, test_rtpnegotiation_cache_invalidation);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtpnegotiation);
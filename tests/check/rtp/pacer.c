@@ -0,0 +1,392 @@
+/* Farstream unit tests for the RTP pacer
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gsttestclock.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "fs-rtp-pacer.h"
+
+#define PACKETS (10)
+#define PACKET_SIZE (1000)
+
+/* Paced at 2.5 times this, so 25000 bytes/sec or one packet every 40ms */
+#define BITRATE (80000)
+#define PACKET_INTERVAL (40 * GST_MSECOND)
+
+#define UPSTREAM_MIN_LATENCY (10 * GST_MSECOND)
+#define UPSTREAM_MAX_LATENCY (20 * GST_MSECOND)
+
+static GMutex mutex;
+static guint received;
+static GstClockTime arrival[PACKETS];
+static GstClock *pacer_clock;
+
+static GstFlowReturn
+_sink_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  g_mutex_lock (&mutex);
+  fail_unless (received < PACKETS, "Received too many packets");
+  arrival[received++] = gst_clock_get_time (pacer_clock);
+  g_mutex_unlock (&mutex);
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+_src_query (GstPad *pad, GstObject *parent, GstQuery *query)
+{
+  if (GST_QUERY_TYPE (query) != GST_QUERY_LATENCY)
+    return gst_pad_query_default (pad, parent, query);
+
+  gst_query_set_latency (query, TRUE, UPSTREAM_MIN_LATENCY,
+      UPSTREAM_MAX_LATENCY);
+  return TRUE;
+}
+
+static GstElement *
+setup_pacer (GstPad **srcpad, GstPad **sinkpad)
+{
+  GstElement *pacer = fs_rtp_pacer_new ();
+  GstPad *pad;
+  GstSegment segment;
+
+  received = 0;
+
+  /* The pacer times the packets with its element clock */
+  pacer_clock = gst_test_clock_new ();
+  gst_element_set_clock (pacer, pacer_clock);
+
+  *srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  gst_pad_set_query_function (*srcpad, _src_query);
+  *sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_chain_function (*sinkpad, _sink_chain);
+
+  pad = gst_element_get_static_pad (pacer, "sink");
+  fail_unless (gst_pad_link (*srcpad, pad) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (pacer, "src");
+  fail_unless (gst_pad_link (pad, *sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  gst_pad_set_active (*srcpad, TRUE);
+  gst_pad_set_active (*sinkpad, TRUE);
+  fail_if (gst_element_set_state (pacer, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  gst_pad_push_event (*srcpad, gst_event_new_stream_start ("pacer"));
+  gst_pad_push_event (*srcpad, gst_event_new_caps (
+          gst_caps_new_empty_simple ("application/x-rtp")));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (*srcpad, gst_event_new_segment (&segment));
+
+  return pacer;
+}
+
+static void
+teardown_pacer (GstElement *pacer, GstPad *srcpad, GstPad *sinkpad)
+{
+  gst_element_set_state (pacer, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (pacer);
+  gst_object_unref (pacer_clock);
+}
+
+static void
+push_packets (GstPad *srcpad)
+{
+  guint i;
+
+  for (i = 0; i < PACKETS; i++)
+    fail_unless (gst_pad_push (srcpad,
+            gst_buffer_new_allocate (NULL, PACKET_SIZE, NULL)) ==
+        GST_FLOW_OK);
+}
+
+/*
+ * Moves the test clock to each wait of the pacer in turn until nothing is
+ * queued anymore. The real time is only used to poll for the next wait.
+ */
+static void
+run_clock (GstElement *pacer)
+{
+  FsRtpPacer *self = FS_RTP_PACER (pacer);
+  GstTestClock *test_clock = GST_TEST_CLOCK (pacer_clock);
+
+  for (;;)
+  {
+    GstClockID id;
+    gboolean idle;
+
+    if (gst_test_clock_peek_next_pending_id (test_clock, &id))
+    {
+      gst_test_clock_set_time (test_clock, gst_clock_id_get_time (id));
+      gst_clock_id_unref (id);
+      id = gst_test_clock_process_next_clock_id (test_clock);
+      if (id)
+        gst_clock_id_unref (id);
+      continue;
+    }
+
+    GST_OBJECT_LOCK (self);
+    idle = g_queue_is_empty (&self->queue) && !self->pushing;
+    GST_OBJECT_UNLOCK (self);
+    if (idle)
+      break;
+
+    g_usleep (1000);
+  }
+}
+
+GST_START_TEST (test_rtppacer_interval)
+{
+  GstElement *pacer;
+  GstPad *srcpad, *sinkpad;
+  guint i;
+
+  pacer = setup_pacer (&srcpad, &sinkpad);
+  /* Without a delay limit, the rate stays the same whatever is queued */
+  g_object_set (pacer, "bitrate", BITRATE, "max-delay", (guint64) 0, NULL);
+
+  push_packets (srcpad);
+  run_clock (pacer);
+
+  fail_unless (received == PACKETS, "Only %u of the %u packets were sent",
+      received, PACKETS);
+
+  /*
+   * The bucket starts with 1500 bytes, so the first two packets are sent at
+   * once and the third one when the 500 bytes of debt are paid back, 20ms
+   * later. After that, one packet goes out every 40ms.
+   */
+  fail_unless (arrival[0] == 0 && arrival[1] == 0,
+      "The first two packets were not sent right away");
+  for (i = 2; i < PACKETS; i++)
+  {
+    GstClockTime expected = PACKET_INTERVAL / 2 + (i - 2) * PACKET_INTERVAL;
+
+    fail_unless (arrival[i] == expected,
+        "Packet %u sent at %" GST_TIME_FORMAT ", expected %" GST_TIME_FORMAT,
+        i, GST_TIME_ARGS (arrival[i]), GST_TIME_ARGS (expected));
+  }
+
+  teardown_pacer (pacer, srcpad, sinkpad);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtppacer_max_delay)
+{
+  GstElement *pacer;
+  GstPad *srcpad, *sinkpad;
+
+  pacer = setup_pacer (&srcpad, &sinkpad);
+  /* Everything queued must go out faster than the bitrate allows */
+  g_object_set (pacer, "bitrate", BITRATE,
+      "max-delay", (guint64) (50 * GST_MSECOND), NULL);
+
+  push_packets (srcpad);
+  run_clock (pacer);
+
+  fail_unless (received == PACKETS, "Only %u of the %u packets were sent",
+      received, PACKETS);
+  fail_unless (arrival[PACKETS - 1] <
+      PACKET_INTERVAL / 2 + (PACKETS - 3) * PACKET_INTERVAL,
+      "The maximum delay did not speed up the pacing (%" GST_TIME_FORMAT ")",
+      GST_TIME_ARGS (arrival[PACKETS - 1]));
+
+  teardown_pacer (pacer, srcpad, sinkpad);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtppacer_max_size)
+{
+  GstElement *pacer;
+  GstPad *srcpad, *sinkpad;
+
+  pacer = setup_pacer (&srcpad, &sinkpad);
+  g_object_set (pacer, "bitrate", BITRATE, "max-delay", (guint64) 0,
+      "max-size-bytes", 3 * PACKET_SIZE, NULL);
+
+  /*
+   * The clock doesn't move while pushing, so at most the two packets of the
+   * initial burst leave the queue, and three more fit in it.
+   */
+  push_packets (srcpad);
+  run_clock (pacer);
+
+  fail_unless (received >= 3 && received <= 5,
+      "%u packets were sent with room for 3 queued", received);
+
+  teardown_pacer (pacer, srcpad, sinkpad);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rtppacer_no_bitrate)
+{
+  GstElement *pacer;
+  GstPad *srcpad, *sinkpad;
+
+  pacer = setup_pacer (&srcpad, &sinkpad);
+
+  /* Without a bitrate, the packets are pushed from the calling thread */
+  push_packets (srcpad);
+  fail_unless (received == PACKETS, "Only %u of the %u packets were sent"
+      " right away", received, PACKETS);
+  fail_unless (GST_PAD_TASK (FS_RTP_PACER (pacer)->srcpad) == NULL,
+      "The task was started without anything to pace");
+
+  teardown_pacer (pacer, srcpad, sinkpad);
+}
+GST_END_TEST;
+
+#define UNPACED_SSRC (0x12345678)
+
+GST_START_TEST (test_rtppacer_unpaced)
+{
+  GstElement *pacer;
+  GstPad *srcpad, *sinkpad;
+  GHashTable *unpaced = g_hash_table_new (g_direct_hash, g_direct_equal);
+  guint i;
+
+  pacer = setup_pacer (&srcpad, &sinkpad);
+  g_object_set (pacer, "bitrate", BITRATE, "max-delay", (guint64) 0, NULL);
+  g_hash_table_add (unpaced, GUINT_TO_POINTER (UNPACED_SSRC));
+  fs_rtp_pacer_set_unpaced_ssrcs (FS_RTP_PACER (pacer), unpaced);
+
+  /* The third one waits for the bucket to refill */
+  for (i = 0; i < 3; i++)
+    fail_unless (gst_pad_push (srcpad,
+            gst_buffer_new_allocate (NULL, PACKET_SIZE, NULL)) ==
+        GST_FLOW_OK);
+
+  /* These are not held back behind it */
+  for (i = 3; i < PACKETS; i++)
+  {
+    GstBuffer *buffer = gst_rtp_buffer_new_allocate (PACKET_SIZE - 12, 0, 0);
+    GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+    fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtpbuffer));
+    gst_rtp_buffer_set_ssrc (&rtpbuffer, UNPACED_SSRC);
+    gst_rtp_buffer_unmap (&rtpbuffer);
+
+    fail_unless (gst_pad_push (srcpad, buffer) == GST_FLOW_OK);
+  }
+
+  run_clock (pacer);
+
+  fail_unless (received == PACKETS, "Only %u of the %u packets were sent",
+      received, PACKETS);
+  for (i = 0; i < PACKETS - 1; i++)
+    fail_unless (arrival[i] == 0, "Packet %u was sent at %" GST_TIME_FORMAT,
+        i, GST_TIME_ARGS (arrival[i]));
+  fail_unless (arrival[PACKETS - 1] == PACKET_INTERVAL / 2,
+      "The paced packet was sent at %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (arrival[PACKETS - 1]));
+
+  teardown_pacer (pacer, srcpad, sinkpad);
+}
+GST_END_TEST;
+
+static void
+check_latency (GstPad *sinkpad, GstClockTime added)
+{
+  GstQuery *query = gst_query_new_latency ();
+  gboolean live;
+  GstClockTime min, max;
+
+  fail_unless (gst_pad_peer_query (sinkpad, query),
+      "The latency query failed");
+  gst_query_parse_latency (query, &live, &min, &max);
+  gst_query_unref (query);
+
+  fail_unless (live, "The upstream liveness was lost");
+  fail_unless (min == UPSTREAM_MIN_LATENCY + added,
+      "Minimum latency is %" GST_TIME_FORMAT, GST_TIME_ARGS (min));
+  fail_unless (max == UPSTREAM_MAX_LATENCY + added,
+      "Maximum latency is %" GST_TIME_FORMAT, GST_TIME_ARGS (max));
+}
+
+GST_START_TEST (test_rtppacer_latency)
+{
+  GstElement *pacer;
+  GstPad *srcpad, *sinkpad;
+
+  pacer = setup_pacer (&srcpad, &sinkpad);
+  g_object_set (pacer, "max-delay", (guint64) (50 * GST_MSECOND), NULL);
+
+  /* Nothing is held back without a bitrate */
+  check_latency (sinkpad, 0);
+
+  g_object_set (pacer, "bitrate", BITRATE, NULL);
+  check_latency (sinkpad, 50 * GST_MSECOND);
+
+  teardown_pacer (pacer, srcpad, sinkpad);
+}
+GST_END_TEST;
+
+
+static Suite *
+fsrtppacer_suite (void)
+{
+  Suite *s = suite_create ("fsrtppacer");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("fsrtppacer_interval");
+  tcase_add_test (tc_chain, test_rtppacer_interval);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtppacer_max_delay");
+  tcase_add_test (tc_chain, test_rtppacer_max_delay);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtppacer_max_size");
+  tcase_add_test (tc_chain, test_rtppacer_max_size);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtppacer_no_bitrate");
+  tcase_add_test (tc_chain, test_rtppacer_no_bitrate);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtppacer_unpaced");
+  tcase_add_test (tc_chain, test_rtppacer_unpaced);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtppacer_latency");
+  tcase_add_test (tc_chain, test_rtppacer_latency);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtppacer);
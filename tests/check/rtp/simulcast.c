@@ -0,0 +1,324 @@
+/* Farstream unit tests for the simulcast layers of FsRtpSession
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+
+#include <gst/check/gstcheck.h>
+#include <farstream/fs-conference.h>
+
+#include "check-threadsafe.h"
+
+#include "generic.h"
+
+/* Conference 0 sends to the two others, which each select another layer */
+#define CONFERENCES (3)
+
+static struct SimpleTestConference *dats[CONFERENCES];
+static GMainLoop *loop;
+
+static GMutex testlock;
+static guint32 received_ssrc[CONFERENCES];
+static gboolean quitting;
+
+#define TEST_LOCK()   g_mutex_lock (&testlock)
+#define TEST_UNLOCK() g_mutex_unlock (&testlock)
+
+static struct SimpleTestStream *
+find_pointback_stream (struct SimpleTestConference *dat,
+    struct SimpleTestConference *target)
+{
+  GList *item;
+
+  for (item = dat->streams; item; item = g_list_next (item))
+  {
+    struct SimpleTestStream *st = item->data;
+
+    if (st->target == target)
+      return st;
+  }
+
+  ts_fail ("We did not find a return stream for %d in %d", target->id,
+      dat->id);
+  return NULL;
+}
+
+static void
+_new_local_candidate (FsStream *stream, FsCandidate *candidate)
+{
+  struct SimpleTestStream *st = g_object_get_data (G_OBJECT (stream),
+      "SimpleTestStream");
+  struct SimpleTestStream *other_st;
+  GList *candidates;
+  GError *error = NULL;
+
+  TEST_LOCK ();
+  other_st = find_pointback_stream (st->target, st->dat);
+  candidates = g_list_prepend (NULL, candidate);
+  ts_fail_unless (fs_stream_add_remote_candidates (other_st->stream,
+          candidates, &error), "Could not add the remote candidate: %s",
+      error ? error->message : "No GError");
+  g_list_free (candidates);
+  TEST_UNLOCK ();
+}
+
+static gboolean
+_bus_callback (GstBus *bus, GstMessage *message, gpointer user_data)
+{
+  const GstStructure *s;
+
+  switch (GST_MESSAGE_TYPE (message))
+  {
+    case GST_MESSAGE_ELEMENT:
+      s = gst_message_get_structure (message);
+      if (gst_structure_has_name (s, "farstream-error"))
+      {
+        ts_fail ("Error on the bus: %s",
+            gst_structure_get_string (s, "error-msg"));
+      }
+      else if (gst_structure_has_name (s, "farstream-new-local-candidate"))
+      {
+        FsStream *stream;
+        FsCandidate *candidate;
+
+        gst_structure_get (s, "stream", FS_TYPE_STREAM, &stream,
+            "candidate", FS_TYPE_CANDIDATE, &candidate, NULL);
+        _new_local_candidate (stream, candidate);
+        g_object_unref (stream);
+        fs_candidate_destroy (candidate);
+      }
+      break;
+    case GST_MESSAGE_ERROR:
+      {
+        GError *error = NULL;
+        gchar *debug = NULL;
+
+        gst_message_parse_error (message, &error, &debug);
+        ts_fail ("Got an error on the bus (%d): %s (%s)", error->code,
+            error->message, debug);
+        g_error_free (error);
+        g_free (debug);
+      }
+      break;
+    default:
+      break;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+_quit_loop (gpointer user_data)
+{
+  g_main_loop_quit (loop);
+
+  return FALSE;
+}
+
+static void
+_src_pad_added (FsStream *stream, GstPad *pad, FsCodec *codec,
+    gpointer user_data)
+{
+  struct SimpleTestStream *st = user_data;
+  GstElement *fakesink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *fakesink_pad;
+  guint session_id, ssrc, pt;
+  gchar *name;
+
+  name = gst_pad_get_name (pad);
+  ts_fail_unless (sscanf (name, "src_%u_%u_%u", &session_id, &ssrc,
+          &pt) == 3, "Invalid src pad name %s", name);
+  g_free (name);
+
+  TEST_LOCK ();
+  GST_DEBUG ("%d: Receiving SSRC %x", st->dat->id, ssrc);
+  ts_fail_unless (received_ssrc[st->dat->id] == 0,
+      "Conference %d got SSRC %x after SSRC %x, it should only get the layer"
+      " it selected", st->dat->id, ssrc, received_ssrc[st->dat->id]);
+  received_ssrc[st->dat->id] = ssrc;
+
+  /* Give the other layers some time to leak before checking */
+  if (!quitting && received_ssrc[1] && received_ssrc[2])
+  {
+    quitting = TRUE;
+    g_timeout_add (500, _quit_loop, NULL);
+  }
+  TEST_UNLOCK ();
+
+  g_object_set (fakesink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add (GST_BIN (st->dat->pipeline), fakesink);
+  fakesink_pad = gst_element_get_static_pad (fakesink, "sink");
+  ts_fail_if (GST_PAD_LINK_FAILED (gst_pad_link (pad, fakesink_pad)),
+      "Could not link the fakesink");
+  gst_object_unref (fakesink_pad);
+  gst_element_sync_state_with_parent (fakesink);
+}
+
+static void
+setup_videosrc (struct SimpleTestConference *dat)
+{
+  GstElement *src, *capsfilter;
+  GstPad *sinkpad, *srcpad;
+  GstCaps *caps;
+
+  src = gst_element_factory_make ("videotestsrc", NULL);
+  fail_if (src == NULL, "Could not make videotestsrc");
+  g_object_set (src, "is-live", TRUE, NULL);
+  capsfilter = gst_element_factory_make ("capsfilter", NULL);
+  caps = gst_caps_new_simple ("video/x-raw",
+      "width", G_TYPE_INT, 320,
+      "height", G_TYPE_INT, 240,
+      "framerate", GST_TYPE_FRACTION, 15, 1,
+      NULL);
+  g_object_set (capsfilter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  gst_bin_add_many (GST_BIN (dat->pipeline), src, capsfilter, NULL);
+  fail_unless (gst_element_link (src, capsfilter));
+
+  g_object_get (dat->session, "sink-pad", &sinkpad, NULL);
+  srcpad = gst_element_get_static_pad (capsfilter, "src");
+  fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK,
+      "Could not link the video source to the session");
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+}
+
+static void
+set_remote_codec (struct SimpleTestStream *st, FsCodec *codec)
+{
+  GList *codecs = g_list_prepend (NULL, codec);
+  GError *error = NULL;
+
+  fail_unless (fs_stream_set_remote_codecs (st->stream, codecs, &error),
+      "Could not set the remote codecs: %s",
+      error ? error->message : "No GError");
+  g_list_free (codecs);
+}
+
+GST_START_TEST (test_rtpsimulcast_layer_ssrcs)
+{
+  struct SimpleTestStream *sts[CONFERENCES][CONFERENCES] = {{NULL}};
+  GParameter params[2];
+  GList *codecs = NULL;
+  GstBus *bus;
+  guint layers;
+  guint i, j;
+
+  memset (params, 0, sizeof (params));
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  params[1].name = "upnp-mapping";
+  g_value_init (&params[1].value, G_TYPE_BOOLEAN);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  memset (received_ssrc, 0, sizeof (received_ssrc));
+  quitting = FALSE;
+
+  for (i = 0; i < CONFERENCES; i++)
+  {
+    gchar *cname = g_strdup_printf ("tester%u@hostname", i);
+
+    dats[i] = setup_simple_conference_full (i, "fsrtpconference", cname,
+        FS_MEDIA_TYPE_VIDEO);
+    g_free (cname);
+    g_object_set (dats[i]->session, "no-rtcp-timeout", -1, NULL);
+
+    bus = gst_element_get_bus (dats[i]->pipeline);
+    gst_bus_add_watch (bus, _bus_callback, dats[i]);
+    gst_object_unref (bus);
+  }
+
+  /* Must be set before the streams are created to route them */
+  g_object_set (dats[0]->session, "simulcast-layers", 2, NULL);
+  setup_videosrc (dats[0]);
+
+  g_object_get (dats[0]->session, "codecs", &codecs, NULL);
+  fail_if (codecs == NULL, "There are no video codecs");
+
+  TEST_LOCK ();
+  for (i = 1; i < CONFERENCES; i++)
+  {
+    sts[0][i] = simple_conference_add_stream (dats[0], dats[i], "rawudp", 2,
+        params);
+    sts[i][0] = simple_conference_add_stream (dats[i], dats[0], "rawudp", 2,
+        params);
+    g_signal_connect (sts[i][0]->stream, "src-pad-added",
+        G_CALLBACK (_src_pad_added), sts[i][0]);
+  }
+
+  g_object_set (sts[0][1]->stream, "simulcast-layer", 0, NULL);
+  g_object_set (sts[0][2]->stream, "simulcast-layer", 1, NULL);
+
+  /* The streams already share a transmitter, which would send every layer
+   * to all of them */
+  g_object_set (dats[1]->session, "simulcast-layers", 2, NULL);
+  g_object_get (dats[1]->session, "simulcast-layers", &layers, NULL);
+  fail_unless (layers == 1, "Simulcast was enabled after adding streams");
+
+  for (i = 0; i < CONFERENCES; i++)
+    for (j = 0; j < CONFERENCES; j++)
+      if (sts[i][j])
+        set_remote_codec (sts[i][j], codecs->data);
+  TEST_UNLOCK ();
+
+  fs_codec_list_destroy (codecs);
+
+  for (i = 0; i < CONFERENCES; i++)
+    fail_if (gst_element_set_state (dats[i]->pipeline, GST_STATE_PLAYING) ==
+        GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+
+  g_main_loop_run (loop);
+
+  fail_unless (received_ssrc[1] != received_ssrc[2],
+      "The two layers were sent with the same SSRC %x", received_ssrc[1]);
+
+  for (i = 0; i < CONFERENCES; i++)
+    gst_element_set_state (dats[i]->pipeline, GST_STATE_NULL);
+  for (i = 0; i < CONFERENCES; i++)
+    cleanup_simple_conference (dats[i]);
+
+  g_main_loop_unref (loop);
+}
+GST_END_TEST;
+
+
+static Suite *
+fsrtpsimulcast_suite (void)
+{
+  Suite *s = suite_create ("fsrtpsimulcast");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("fsrtpsimulcast_layer_ssrcs");
+  tcase_add_test (tc_chain, test_rtpsimulcast_layer_ssrcs);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtpsimulcast);
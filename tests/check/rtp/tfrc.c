@@ -0,0 +1,183 @@
+/* Farstream unit tests for the TFRC receiver history
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <gst/check/gstcheck.h>
+
+#include "tfrc.h"
+
+/* All times in microseconds, like tfrc.c */
+#define PACKET_INTERVAL (10 * 1000)
+#define PACKET_SIZE (1200)
+
+static gdouble loss_event_rate;
+
+/* Receives one packet and sends feedback like fs-rtp-tfrc.c does */
+static void
+receive_packet (TfrcReceiver *receiver, guint seq, guint64 now, guint rtt)
+{
+  gboolean send_feedback;
+  guint receive_rate;
+
+  send_feedback = tfrc_receiver_got_packet (receiver, seq * PACKET_INTERVAL,
+      now, seq, rtt, PACKET_SIZE);
+
+  if (now >= tfrc_receiver_get_feedback_timer_expiry (receiver))
+    send_feedback |= tfrc_receiver_feedback_timer_expired (receiver, now);
+
+  if (send_feedback)
+    tfrc_receiver_send_feedback (receiver, now, &loss_event_rate,
+        &receive_rate);
+}
+
+static gdouble
+get_loss_event_rate (TfrcReceiver *receiver, guint64 now)
+{
+  guint receive_rate;
+
+  fail_unless (tfrc_receiver_send_feedback (receiver, now, &loss_event_rate,
+          &receive_rate), "Could not send feedback");
+
+  return loss_event_rate;
+}
+
+/*
+ * One loss every LOSS_PERIOD packets, spaced by more than one RTT, so every
+ * loss is its own loss event. The history is trimmed to a few intervals,
+ * which makes it go around the ring buffer many times.
+ */
+
+#define WRAP_RTT (100 * 1000)
+#define LOSS_PERIOD (50)
+
+GST_START_TEST (test_tfrc_receiver_wrap)
+{
+  TfrcReceiver *receiver = tfrc_receiver_new (0);
+  guint seq;
+  gdouble p;
+
+  for (seq = 0; seq < 100 * LOSS_PERIOD; seq++)
+  {
+    switch (seq % LOSS_PERIOD)
+    {
+      case LOSS_PERIOD / 2:
+        /* Lost */
+        break;
+      case LOSS_PERIOD - 10:
+        /* Reordered: the gap it leaves is closed by the next packet, which
+         * removes an interval from the middle of the history */
+        receive_packet (receiver, seq + 1, (seq + 1) * PACKET_INTERVAL,
+            WRAP_RTT);
+        receive_packet (receiver, seq, (seq + 1) * PACKET_INTERVAL, WRAP_RTT);
+        seq++;
+        break;
+      default:
+        receive_packet (receiver, seq, seq * PACKET_INTERVAL, WRAP_RTT);
+        break;
+    }
+  }
+
+  p = get_loss_event_rate (receiver, seq * PACKET_INTERVAL);
+  fail_unless (fabs (p - 1.0 / LOSS_PERIOD) < 0.0001,
+      "Loss event rate is %f instead of %f", p, 1.0 / LOSS_PERIOD);
+
+  tfrc_receiver_free (receiver);
+}
+GST_END_TEST;
+
+/*
+ * With a long RTT, less than MIN_HISTORY_DURATION RTTs of history are
+ * received so nothing is trimmed and the ring buffer has to grow. Then all
+ * the gaps are filled, which only leaves one interval if the history
+ * survived the growth intact.
+ */
+
+#define GROWTH_RTT (1000 * 1000)
+#define GROWTH_PACKETS (900)
+
+GST_START_TEST (test_tfrc_receiver_growth)
+{
+  TfrcReceiver *receiver = tfrc_receiver_new (0);
+  guint64 now;
+  guint seq;
+  gdouble p;
+
+  /* Start with two intervals, the second one added in front of the first,
+   * so the ring buffer is already wrapped when it first has to grow */
+  receive_packet (receiver, 10, 10 * PACKET_INTERVAL, GROWTH_RTT);
+  receive_packet (receiver, 8, 10 * PACKET_INTERVAL, GROWTH_RTT);
+
+  for (seq = 11; seq < GROWTH_PACKETS; seq++)
+    if (seq % 4 != 2)
+      receive_packet (receiver, seq, seq * PACKET_INTERVAL, GROWTH_RTT);
+
+  now = GROWTH_PACKETS * PACKET_INTERVAL;
+  p = get_loss_event_rate (receiver, now);
+  fail_unless (p > 0, "No loss seen with %u gaps", GROWTH_PACKETS / 4);
+
+  /* Retransmissions of everything that was lost, the oldest gap last */
+  for (seq = 11; seq < GROWTH_PACKETS; seq++)
+  {
+    if (seq % 4 == 2)
+    {
+      now += PACKET_INTERVAL;
+      receive_packet (receiver, seq, now, GROWTH_RTT);
+    }
+  }
+  now += PACKET_INTERVAL;
+  receive_packet (receiver, 9, now, GROWTH_RTT);
+
+  now += PACKET_INTERVAL;
+  p = get_loss_event_rate (receiver, now);
+  fail_unless (p == 0, "Loss event rate is %f after filling every gap", p);
+
+  tfrc_receiver_free (receiver);
+}
+GST_END_TEST;
+
+
+static Suite *
+fsrtptfrc_suite (void)
+{
+  Suite *s = suite_create ("fsrtptfrc");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("fsrtptfrc_receiver_wrap");
+  tcase_add_test (tc_chain, test_tfrc_receiver_wrap);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtptfrc_receiver_growth");
+  tcase_add_test (tc_chain, test_tfrc_receiver_growth);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtptfrc);
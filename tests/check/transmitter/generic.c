@@ -93,6 +93,78 @@ setup_fakesrc (FsTransmitter *trans, GstElement *pipeline, guint component_id)
   gst_object_unref (trans_sink);
 }
 
+/*
+ * Unlike the fakesrc, this sends real RTP packets, so the transmitters
+ * can look at their SSRC. The packets are pushed by the caller, from its
+ * own thread.
+ */
+GstPad *
+setup_rtp_src (FsTransmitter *trans, guint component_id)
+{
+  GstElement *trans_sink;
+  GstPad *srcpad, *sinkpad;
+  GstSegment segment;
+  gchar *padname;
+
+  g_object_get (trans, "gst-sink", &trans_sink, NULL);
+
+  padname = g_strdup_printf ("sink_%u", component_id);
+  sinkpad = gst_element_get_static_pad (trans_sink, padname);
+  ts_fail_if (sinkpad == NULL, "Could not get the transmitter pad %s",
+      padname);
+  g_free (padname);
+
+  srcpad = gst_pad_new ("rtpsrc", GST_PAD_SRC);
+  ts_fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK,
+      "Could not link the RTP source to the transmitter");
+  gst_pad_set_active (srcpad, TRUE);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("rtpsrc"));
+  gst_pad_push_event (srcpad, gst_event_new_caps (
+          gst_caps_new_empty_simple ("application/x-rtp")));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  gst_object_unref (sinkpad);
+  gst_object_unref (trans_sink);
+
+  return srcpad;
+}
+
+void
+push_rtp_packet (GstPad *srcpad, guint32 ssrc, guint16 seq)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+
+  buffer = gst_buffer_new_allocate (NULL, 12 + 10, NULL);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  memset (map.data, 0, map.size);
+  /* Version 2, payload type 96 */
+  map.data[0] = 0x80;
+  map.data[1] = 96;
+  GST_WRITE_UINT16_BE (map.data + 2, seq);
+  GST_WRITE_UINT32_BE (map.data + 4, seq * 160);
+  GST_WRITE_UINT32_BE (map.data + 8, ssrc);
+  gst_buffer_unmap (buffer, &map);
+
+  gst_pad_push (srcpad, buffer);
+}
+
+void
+teardown_rtp_src (GstPad *srcpad)
+{
+  GstPad *peer = gst_pad_get_peer (srcpad);
+
+  gst_pad_set_active (srcpad, FALSE);
+  if (peer)
+  {
+    gst_pad_unlink (srcpad, peer);
+    gst_object_unref (peer);
+  }
+  gst_object_unref (srcpad);
+}
+
 GstElement *
 setup_pipeline (FsTransmitter *trans, GCallback cb)
 {
@@ -30,6 +30,10 @@ GstElement *setup_pipeline (FsTransmitter *trans, GCallback cb);
 void setup_fakesrc (FsTransmitter *trans, GstElement *pipeline,
   guint component_id);
 
+GstPad *setup_rtp_src (FsTransmitter *trans, guint component_id);
+void push_rtp_packet (GstPad *srcpad, guint32 ssrc, guint16 seq);
+void teardown_rtp_src (GstPad *srcpad);
+
 void stream_transmitter_error (FsStreamTransmitter *streamtransmitter,
   gint errorno, gchar *error_msg, gpointer user_data);
 
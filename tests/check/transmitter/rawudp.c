@@ -58,7 +58,8 @@ enum {
   FLAG_HAS_STUN  = 1 << 0,
   FLAG_IS_LOCAL  = 1 << 1,
   FLAG_NO_SOURCE = 1 << 2,
-  FLAG_NOT_SENDING = 1 << 3
+  FLAG_NOT_SENDING = 1 << 3,
+  FLAG_BATCHED = 1 << 4
 };
 
 #define RTP_PORT 9828
@@ -263,6 +264,51 @@ sync_error_handler (GstBus *bus, GstMessage *message, gpointer blob)
 }
 
 
+/*
+ * Checks that the batched elements really sent and received more than one
+ * packet with a single system call, not only that the data went through
+ */
+
+static void
+check_batches (GstElement *pipeline)
+{
+  GstIterator *iter = gst_bin_iterate_recurse (GST_BIN (pipeline));
+  GValue item = G_VALUE_INIT;
+  guint srcs = 0, sinks = 0;
+  guint largest_recv = 0;
+
+  while (gst_iterator_next (iter, &item) == GST_ITERATOR_OK)
+  {
+    GstElement *element = g_value_get_object (&item);
+    const gchar *type_name = G_OBJECT_TYPE_NAME (element);
+    guint largest_batch;
+
+    if (!strcmp (type_name, "FsRawUdpBatchSink"))
+    {
+      g_object_get (element, "largest-batch", &largest_batch, NULL);
+      ts_fail_unless (largest_batch > 1,
+          "The batched sink %s sent at most %u packet per sendmmsg()",
+          GST_OBJECT_NAME (element), largest_batch);
+      sinks++;
+    }
+    else if (!strcmp (type_name, "FsRawUdpBatchSrc"))
+    {
+      g_object_get (element, "largest-batch", &largest_batch, NULL);
+      largest_recv = MAX (largest_recv, largest_batch);
+      srcs++;
+    }
+
+    g_value_reset (&item);
+  }
+  g_value_unset (&item);
+  gst_iterator_free (iter);
+
+  ts_fail_unless (sinks > 0, "No batched sink was used");
+  ts_fail_unless (srcs > 0, "No batched source was used");
+  ts_fail_unless (largest_recv > 1,
+      "No batched source received more than one packet per recvmmsg()");
+}
+
 static void
 run_rawudp_transmitter_test (gint n_parameters, GParameter *params,
   gint flags)
@@ -368,6 +414,9 @@ run_rawudp_transmitter_test (gint n_parameters, GParameter *params,
 
   g_main_loop_run (loop);
 
+  if (flags & FLAG_BATCHED)
+    check_batches (pipeline);
+
  skip:
 
   g_mutex_lock (&pipeline_mod_mutex);
@@ -421,6 +470,214 @@ GST_START_TEST (test_rawudptransmitter_run_nostun_nosource)
 }
 GST_END_TEST;
 
+GST_START_TEST (test_rawudptransmitter_run_batched)
+{
+  GParameter params[3];
+
+  memset (params, 0, sizeof (GParameter) * 3);
+
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[0].value, FALSE);
+
+  params[1].name = "batch-size";
+  g_value_init (&params[1].value, G_TYPE_UINT);
+  g_value_set_uint (&params[1].value, 8);
+
+  params[2].name = "batch-flush-timeout";
+  g_value_init (&params[2].value, G_TYPE_UINT);
+  g_value_set_uint (&params[2].value, 2000);
+
+  run_rawudp_transmitter_test (3, params, FLAG_BATCHED);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rawudptransmitter_run_socket_reactor)
+{
+  GParameter params[2];
+
+  memset (params, 0, sizeof (GParameter) * 2);
+
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[0].value, FALSE);
+
+  params[1].name = "socket-reactor";
+  g_value_init (&params[1].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[1].value, TRUE);
+
+  run_rawudp_transmitter_test (2, params, 0);
+}
+GST_END_TEST;
+
+/*
+ * With real RTP packets, the known-source-packet-received signal is only
+ * emitted for the first packet of each SSRC and then once every 256 packets,
+ * even when the packets of two SSRCs are interleaved
+ */
+
+#define RTP_SSRC_A (0x11111111)
+#define RTP_SSRC_B (0x22222222)
+#define RTP_PACKETS_A (300)
+/* Then one packet of B and one of A this many times */
+#define RTP_PACKETS_B (10)
+#define RTP_PACKETS (RTP_PACKETS_A + 2 * RTP_PACKETS_B)
+
+static GThread *rtp_send_thread = NULL;
+
+static gpointer
+_send_rtp_packets (gpointer user_data)
+{
+  FsTransmitter *trans = user_data;
+  GstPad *srcpad;
+  guint16 seq = 0;
+  guint i;
+
+  srcpad = setup_rtp_src (trans, 1);
+
+  /* Don't overflow the socket buffer, a lost packet would skew the count */
+  for (i = 0; i < RTP_PACKETS_A; i++)
+  {
+    push_rtp_packet (srcpad, RTP_SSRC_A, seq++);
+    g_usleep (500);
+  }
+  for (i = 0; i < RTP_PACKETS_B; i++)
+  {
+    push_rtp_packet (srcpad, RTP_SSRC_B, seq++);
+    g_usleep (500);
+    push_rtp_packet (srcpad, RTP_SSRC_A, seq++);
+    g_usleep (500);
+  }
+
+  teardown_rtp_src (srcpad);
+
+  return NULL;
+}
+
+static void
+_rtp_new_active_candidate_pair (FsStreamTransmitter *st, FsCandidate *local,
+  FsCandidate *remote, gpointer user_data)
+{
+  if (local->component_id != 1)
+    return;
+
+  g_mutex_lock (&pipeline_mod_mutex);
+  if (!pipeline_done && !src_setup[0])
+    rtp_send_thread = g_thread_new ("rtpsend", _send_rtp_packets, user_data);
+  src_setup[0] = TRUE;
+  g_mutex_unlock (&pipeline_mod_mutex);
+}
+
+static void
+_rtp_handoff_handler (GstElement *element, GstBuffer *buffer, GstPad *pad,
+  gpointer user_data)
+{
+  gint component_id = GPOINTER_TO_INT (user_data);
+
+  ts_fail_unless (component_id == 1, "Received a buffer on component %d",
+      component_id);
+
+  buffer_count[0]++;
+
+  if (buffer_count[0] == RTP_PACKETS)
+  {
+    g_atomic_int_set (&running, FALSE);
+    g_main_loop_quit (loop);
+  }
+}
+
+GST_START_TEST (test_rawudptransmitter_known_source_coalescing)
+{
+  GError *error = NULL;
+  FsTransmitter *trans;
+  FsStreamTransmitter *st;
+  GParameter params[1];
+  guint known_source_packets = 0;
+
+  memset (params, 0, sizeof (GParameter));
+
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[0].value, FALSE);
+
+  buffer_count[0] = 0;
+  buffer_count[1] = 0;
+  received_known[0] = 0;
+  received_known[1] = 0;
+  src_setup[0] = FALSE;
+  src_setup[1] = FALSE;
+  pipeline_done = FALSE;
+  has_stun = FALSE;
+  associate_on_source = TRUE;
+  g_atomic_int_set (&running, TRUE);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  trans = fs_transmitter_new ("rawudp", 2, 0, &error);
+
+  if (error)
+    ts_fail ("Error creating transmitter: (%s:%d) %s",
+        g_quark_to_string (error->domain), error->code, error->message);
+
+  pipeline = setup_pipeline (trans, G_CALLBACK (_rtp_handoff_handler));
+
+  st = fs_transmitter_new_stream_transmitter (trans, NULL, 1, params, &error);
+
+  if (error)
+    ts_fail ("Error creating stream transmitter: (%s:%d) %s",
+        g_quark_to_string (error->domain), error->code, error->message);
+
+  ts_fail_unless (g_signal_connect (st, "new-local-candidate",
+      G_CALLBACK (_new_local_candidate), NULL),
+    "Could not connect new-local-candidate signal");
+  ts_fail_unless (g_signal_connect (st, "new-active-candidate-pair",
+      G_CALLBACK (_rtp_new_active_candidate_pair), trans),
+    "Could not connect new-active-candidate-pair signal");
+  ts_fail_unless (g_signal_connect (st, "error",
+      G_CALLBACK (stream_transmitter_error), NULL),
+    "Could not connect error signal");
+  ts_fail_unless (g_signal_connect (st, "known-source-packet-received",
+      G_CALLBACK (_known_source_packet_received), NULL),
+    "Could not connect known-source-packet-received signal");
+
+  ts_fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+    GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+
+  ts_fail_unless (fs_stream_transmitter_gather_local_candidates (st, &error),
+      "Could not start gathering local candidates");
+
+  g_main_loop_run (loop);
+
+  g_mutex_lock (&pipeline_mod_mutex);
+  pipeline_done = TRUE;
+  g_mutex_unlock (&pipeline_mod_mutex);
+
+  if (rtp_send_thread)
+    g_thread_join (rtp_send_thread);
+  rtp_send_thread = NULL;
+
+  /* SSRC A on its first and its 256th packet, SSRC B on its first */
+  ts_fail_unless (received_known[0] == 3,
+      "Got %u known-source-packet-received signals for %d packets,"
+      " expected 3", received_known[0], buffer_count[0]);
+  ts_fail_unless (received_known[1] == 0,
+      "Got %u known-source-packet-received signals on the RTCP component",
+      received_known[1]);
+
+  g_object_get (st, "known-source-packets", &known_source_packets, NULL);
+  ts_fail_unless (known_source_packets == RTP_PACKETS,
+      "known-source-packets is %u, expected %u", known_source_packets,
+      RTP_PACKETS);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  fs_stream_transmitter_stop (st);
+  g_object_unref (st);
+  g_object_unref (trans);
+  gst_object_unref (pipeline);
+  g_main_loop_unref (loop);
+}
+GST_END_TEST;
+
 GST_START_TEST (test_rawudptransmitter_run_invalid_stun)
 {
   GParameter params[4];
@@ -948,6 +1205,18 @@ rawudptransmitter_suite (void)
   tcase_add_test (tc_chain, test_rawudptransmitter_run_nostun_nosource);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("rawudptransmitter_batched");
+  tcase_add_test (tc_chain, test_rawudptransmitter_run_batched);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudptransmitter_socket_reactor");
+  tcase_add_test (tc_chain, test_rawudptransmitter_run_socket_reactor);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudptransmitter-known-source-coalescing");
+  tcase_add_test (tc_chain, test_rawudptransmitter_known_source_coalescing);
+  suite_add_tcase (s, tc_chain);
+
   tc_chain = tcase_create ("rawudptransmitter-stun-timeout");
   tcase_set_timeout (tc_chain, 10);
   tcase_add_test (tc_chain, test_rawudptransmitter_run_invalid_stun);
@@ -52,9 +52,23 @@ guint connected_count;
 enum {
   FLAG_NO_SOURCE = 1 << 2,
   FLAG_NOT_SENDING = 1 << 3,
-  FLAG_LOCAL_CANDIDATES = 1 << 5
+  FLAG_LOCAL_CANDIDATES = 1 << 5,
+  FLAG_RTP = 1 << 6
 };
 
+/*
+ * With real RTP packets, the known-source-packet-received signal is only
+ * emitted for the first packet of each SSRC and then once every 256 packets,
+ * even when the packets of two SSRCs are interleaved
+ */
+#define RTP_SSRC_A (0x11111111)
+#define RTP_SSRC_B (0x22222222)
+#define RTP_PACKETS_A (300)
+/* Then one packet of B and one of A this many times */
+#define RTP_PACKETS_B (10)
+#define RTP_PACKETS (RTP_PACKETS_A + 2 * RTP_PACKETS_B)
+#define RTP_SHM_SIZE (128 * 1024)
+
 #define RTP_PORT 9828
 #define RTCP_PORT 9829
 
@@ -163,6 +177,89 @@ _handoff_handler (GstElement *element, GstBuffer *buffer, GstPad *pad,
   }
 }
 
+static void
+_rtp_handoff_handler (GstElement *element, GstBuffer *buffer, GstPad *pad,
+  gpointer user_data)
+{
+  gint component_id = GPOINTER_TO_INT (user_data);
+
+  ts_fail_unless (component_id == 1, "Received a buffer on component %d",
+      component_id);
+
+  buffer_count[0]++;
+
+  if (buffer_count[0] == RTP_PACKETS)
+  {
+    GST_DEBUG ("Test complete, got all the RTP packets");
+    g_mutex_lock (&test_mutex);
+    done = TRUE;
+    g_mutex_unlock (&test_mutex);
+    g_cond_signal (&cond);
+  }
+}
+
+static gpointer
+_send_rtp_packets (gpointer user_data)
+{
+  FsTransmitter *trans = user_data;
+  GstPad *srcpad;
+  guint16 seq = 0;
+  guint i;
+
+  srcpad = setup_rtp_src (trans, 1);
+
+  for (i = 0; i < RTP_PACKETS_A; i++)
+  {
+    push_rtp_packet (srcpad, RTP_SSRC_A, seq++);
+    g_usleep (500);
+  }
+  for (i = 0; i < RTP_PACKETS_B; i++)
+  {
+    push_rtp_packet (srcpad, RTP_SSRC_B, seq++);
+    g_usleep (500);
+    push_rtp_packet (srcpad, RTP_SSRC_A, seq++);
+    g_usleep (500);
+  }
+
+  teardown_rtp_src (srcpad);
+
+  return NULL;
+}
+
+static gint
+_find_shmsink (const GValue *item, gconstpointer user_data)
+{
+  GstElement *element = g_value_get_object (item);
+  GstElementFactory *factory = gst_element_get_factory (element);
+
+  if (factory &&
+      !strcmp (GST_OBJECT_NAME (factory), "shmsink"))
+    return 0;
+
+  return 1;
+}
+
+static void
+check_shm_size (FsTransmitter *trans, guint expected)
+{
+  GstElement *trans_sink;
+  GstIterator *iter;
+  GValue item = G_VALUE_INIT;
+  guint shm_size = 0;
+
+  g_object_get (trans, "gst-sink", &trans_sink, NULL);
+  iter = gst_bin_iterate_recurse (GST_BIN (trans_sink));
+  ts_fail_unless (gst_iterator_find_custom (iter, _find_shmsink, &item, NULL),
+      "Could not find the shmsink");
+  g_object_get (g_value_get_object (&item), "shm-size", &shm_size, NULL);
+  g_value_unset (&item);
+  gst_iterator_free (iter);
+  gst_object_unref (trans_sink);
+
+  ts_fail_unless (shm_size == expected, "The shmsink has shm-size %u,"
+      " expected %u", shm_size, expected);
+}
+
 static void
 _known_source_packet_received (FsStreamTransmitter *st, guint component_id,
     GstBuffer *buffer, gpointer user_data)
@@ -200,13 +297,15 @@ run_shm_transmitter_test (gint flags)
   FsTransmitter *trans;
   FsStreamTransmitter *st;
   GstBus *bus = NULL;
-  GParameter params[1];
+  GParameter params[2];
   GList *local_cands = NULL;
   GstStateChangeReturn ret;
   FsCandidate *cand;
   GList *remote_cands = NULL;
   int param_count = 0;
   gint bus_source;
+  GThread *rtp_send_thread = NULL;
+  guint shm_size = 0;
 
   done = FALSE;
   connected_count = 0;
@@ -245,6 +344,17 @@ run_shm_transmitter_test (gint flags)
     param_count = 1;
   }
 
+  if (flags & FLAG_RTP)
+  {
+    memset (&params[param_count], 0, sizeof (GParameter));
+
+    params[param_count].name = "shm-size";
+    g_value_init (&params[param_count].value, G_TYPE_UINT);
+    g_value_set_uint (&params[param_count].value, RTP_SHM_SIZE);
+
+    param_count++;
+  }
+
 
   associate_on_source = !(flags & FLAG_NO_SOURCE);
 
@@ -262,7 +372,10 @@ run_shm_transmitter_test (gint flags)
   ts_fail_if (trans == NULL, "No transmitter create, yet error is still NULL");
   g_clear_error (&error);
 
-  pipeline = setup_pipeline (trans, G_CALLBACK (_handoff_handler));
+  if (flags & FLAG_RTP)
+    pipeline = setup_pipeline (trans, G_CALLBACK (_rtp_handoff_handler));
+  else
+    pipeline = setup_pipeline (trans, G_CALLBACK (_handoff_handler));
 
   bus = gst_element_get_bus (pipeline);
   bus_source = gst_bus_add_watch (bus, bus_error_callback, NULL);
@@ -276,8 +389,8 @@ run_shm_transmitter_test (gint flags)
   st = fs_transmitter_new_stream_transmitter (trans, NULL,
       param_count, params, &error);
 
-  if (param_count)
-    g_value_unset (&params[0].value);
+  while (param_count)
+    g_value_unset (&params[--param_count].value);
 
   if (error)
     ts_fail ("Error creating stream transmitter: (%s:%d) %s",
@@ -359,14 +472,39 @@ run_shm_transmitter_test (gint flags)
     g_cond_wait (&cond, &test_mutex);
   g_mutex_unlock (&test_mutex);
 
-  setup_fakesrc (trans, pipeline, 1);
-  setup_fakesrc (trans, pipeline, 2);
+  if (flags & FLAG_RTP)
+  {
+    rtp_send_thread = g_thread_new ("rtpsend", _send_rtp_packets, trans);
+  }
+  else
+  {
+    setup_fakesrc (trans, pipeline, 1);
+    setup_fakesrc (trans, pipeline, 2);
+  }
 
   g_mutex_lock (&test_mutex);
   while (!done)
     g_cond_wait (&cond, &test_mutex);
   g_mutex_unlock (&test_mutex);
 
+  if (flags & FLAG_RTP)
+  {
+    g_thread_join (rtp_send_thread);
+
+    /* SSRC A on its first and its 256th packet, SSRC B on its first */
+    ts_fail_unless (received_known[0] == 3,
+        "Got %u known-source-packet-received signals for %d packets,"
+        " expected 3", received_known[0], buffer_count[0]);
+    ts_fail_unless (received_known[1] == 0,
+        "Got %u known-source-packet-received signals on the RTCP component",
+        received_known[1]);
+
+    g_object_get (st, "shm-size", &shm_size, NULL);
+    ts_fail_unless (shm_size == RTP_SHM_SIZE, "shm-size is %u, expected %u",
+        shm_size, RTP_SHM_SIZE);
+    check_shm_size (trans, RTP_SHM_SIZE);
+  }
+
   fail_unless (got_prepared[0] == TRUE);
   fail_unless (got_prepared[1] == TRUE);
   fail_unless (got_candidates[0] == TRUE);
@@ -407,6 +545,12 @@ GST_START_TEST (test_shmtransmitter_local_cands)
 }
 GST_END_TEST;
 
+GST_START_TEST (test_shmtransmitter_rtp)
+{
+  run_shm_transmitter_test (FLAG_RTP);
+}
+GST_END_TEST;
+
 
 static Suite *
 shmtransmitter_suite (void)
@@ -435,6 +579,10 @@ shmtransmitter_suite (void)
   tcase_add_test (tc_chain, test_shmtransmitter_local_cands);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("shmtransmitter-rtp");
+  tcase_add_test (tc_chain, test_shmtransmitter_rtp);
+  suite_add_tcase (s, tc_chain);
+
   return s;
 }
 
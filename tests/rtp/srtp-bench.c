@@ -0,0 +1,289 @@
+/* Farstream ad-hoc benchmark for the SRTP elements
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Pushes RTP packets through srtpenc ! srtpdec, the same elements
+ * FsRtpSession uses, for each of the cipher suites it accepts in its
+ * "FarstreamSRTP" encryption parameters, and prints the cost of a round
+ * trip per packet. The null suite is what the streams without encryption
+ * get. Packets are pushed one by one
+ * and as buffer lists, like the RTP payloaders may do.
+ *
+ * Usage: srtp-bench [packets]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gst/gst.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#define PACKET_SIZE (1200)
+#define BATCH_SIZE (1000)
+#define LIST_SIZE (32)
+#define SSRC (0x12345678)
+#define DEFAULT_PACKETS (100 * 1000)
+
+static const struct {
+  const gchar *name;
+  const gchar *cipher;
+  const gchar *auth;
+  guint key_size;
+} suites[] = {
+  { "null", "null", "null", 30 },
+  { "aes-128-icm sha1-32", "aes-128-icm", "hmac-sha1-32", 30 },
+  { "aes-128-icm sha1-80", "aes-128-icm", "hmac-sha1-80", 30 },
+  { "aes-256-icm sha1-80", "aes-256-icm", "hmac-sha1-80", 46 },
+  { NULL, NULL, NULL, 0 }
+};
+
+typedef struct {
+  GstBuffer *key;
+  const gchar *cipher;
+  const gchar *auth;
+  guint received;
+} BenchData;
+
+static GstCaps *
+_request_key (GstElement *srtpdec, guint ssrc, gpointer user_data)
+{
+  BenchData *data = user_data;
+
+  return gst_caps_new_simple ("application/x-srtp",
+      "srtp-key", GST_TYPE_BUFFER, data->key,
+      "srtp-cipher", G_TYPE_STRING, data->cipher,
+      "srtp-auth", G_TYPE_STRING, data->auth,
+      "srtcp-cipher", G_TYPE_STRING, data->cipher,
+      "srtcp-auth", G_TYPE_STRING, data->auth,
+      NULL);
+}
+
+static GstFlowReturn
+_sink_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  BenchData *data = g_object_get_data (G_OBJECT (pad), "bench-data");
+
+  data->received++;
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+_sink_chain_list (GstPad *pad, GstObject *parent, GstBufferList *list)
+{
+  BenchData *data = g_object_get_data (G_OBJECT (pad), "bench-data");
+
+  data->received += gst_buffer_list_length (list);
+  gst_buffer_list_unref (list);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+cipher_is_supported (GstElement *srtpenc, const gchar *cipher)
+{
+  GParamSpec *pspec;
+
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (srtpenc),
+      "rtp-cipher");
+  if (!pspec || !G_IS_PARAM_SPEC_ENUM (pspec))
+    return FALSE;
+
+  return g_enum_get_value_by_nick (G_PARAM_SPEC_ENUM (pspec)->enum_class,
+      cipher) != NULL;
+}
+
+static GstBuffer *
+make_packet (guint16 seq)
+{
+  GstBuffer *buffer;
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+  buffer = gst_rtp_buffer_new_allocate (PACKET_SIZE, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtpbuffer);
+  gst_rtp_buffer_set_payload_type (&rtpbuffer, 96);
+  gst_rtp_buffer_set_ssrc (&rtpbuffer, SSRC);
+  gst_rtp_buffer_set_seq (&rtpbuffer, seq);
+  gst_rtp_buffer_set_timestamp (&rtpbuffer, seq * 3000);
+  memset (gst_rtp_buffer_get_payload (&rtpbuffer), seq & 0xFF, PACKET_SIZE);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  return buffer;
+}
+
+static void
+run_suite (guint packets, gboolean use_lists, const gchar *name,
+    const gchar *cipher, const gchar *auth, guint key_size)
+{
+  GstElement *srtpenc, *srtpdec;
+  GstPad *srcpad, *sinkpad, *encsink, *encsrc, *decsink, *decsrc;
+  GstBuffer *batch[BATCH_SIZE];
+  BenchData data = { NULL, cipher, auth, 0 };
+  GstSegment segment;
+  guint8 *key;
+  guint sent = 0;
+  guint16 seq = 0;
+  guint i;
+  gint64 elapsed = 0;
+
+  srtpenc = gst_element_factory_make ("srtpenc", NULL);
+  srtpdec = gst_element_factory_make ("srtpdec", NULL);
+  if (!srtpenc || !srtpdec)
+  {
+    g_printerr ("The srtpenc and srtpdec elements are not available\n");
+    exit (1);
+  }
+
+  if (!cipher_is_supported (srtpenc, cipher))
+  {
+    g_print ("%-24s not supported\n", name);
+    gst_object_unref (srtpenc);
+    gst_object_unref (srtpdec);
+    return;
+  }
+
+  key = g_malloc (key_size);
+  for (i = 0; i < key_size; i++)
+    key[i] = g_random_int_range (0, 256);
+  data.key = gst_buffer_new_wrapped (key, key_size);
+
+  g_object_set (srtpenc, "key", data.key, NULL);
+  gst_util_set_object_arg (G_OBJECT (srtpenc), "rtp-cipher", cipher);
+  gst_util_set_object_arg (G_OBJECT (srtpenc), "rtcp-cipher", cipher);
+  gst_util_set_object_arg (G_OBJECT (srtpenc), "rtp-auth", auth);
+  gst_util_set_object_arg (G_OBJECT (srtpenc), "rtcp-auth", auth);
+  g_signal_connect (srtpdec, "request-key", G_CALLBACK (_request_key), &data);
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  g_object_set_data (G_OBJECT (sinkpad), "bench-data", &data);
+  gst_pad_set_chain_function (sinkpad, _sink_chain);
+  gst_pad_set_chain_list_function (sinkpad, _sink_chain_list);
+
+  encsink = gst_element_get_request_pad (srtpenc, "rtp_sink_%u");
+  encsrc = gst_element_get_static_pad (srtpenc, "rtp_src_0");
+  decsink = gst_element_get_static_pad (srtpdec, "rtp_sink");
+  decsrc = gst_element_get_static_pad (srtpdec, "rtp_src");
+  gst_pad_link (srcpad, encsink);
+  gst_pad_link (encsrc, decsink);
+  gst_pad_link (decsrc, sinkpad);
+
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  gst_element_set_state (srtpenc, GST_STATE_PLAYING);
+  gst_element_set_state (srtpdec, GST_STATE_PLAYING);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("srtp-bench"));
+  gst_pad_push_event (srcpad, gst_event_new_caps (
+          gst_caps_new_simple ("application/x-rtp",
+              "media", G_TYPE_STRING, "video",
+              "clock-rate", G_TYPE_INT, 90000,
+              "encoding-name", G_TYPE_STRING, "H264",
+              "payload", G_TYPE_INT, 96,
+              NULL)));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  while (sent < packets)
+  {
+    guint count = MIN (BATCH_SIZE, packets - sent);
+    gint64 start;
+
+    /* Only time the encryption and decryption, not the packet creation */
+    for (i = 0; i < count; i++)
+      batch[i] = make_packet (seq++);
+
+    start = g_get_monotonic_time ();
+    if (use_lists)
+    {
+      for (i = 0; i < count; i += LIST_SIZE)
+      {
+        GstBufferList *list = gst_buffer_list_new_sized (LIST_SIZE);
+        guint j;
+
+        for (j = i; j < MIN (i + LIST_SIZE, count); j++)
+          gst_buffer_list_add (list, batch[j]);
+        gst_pad_push_list (srcpad, list);
+      }
+    }
+    else
+    {
+      for (i = 0; i < count; i++)
+        gst_pad_push (srcpad, batch[i]);
+    }
+    elapsed += g_get_monotonic_time () - start;
+
+    sent += count;
+  }
+
+  g_print ("%-24s %-7s %10u packets %8.1f ns/packet %8.1f Mbit/s\n", name,
+      use_lists ? "lists" : "buffers", data.received,
+      sent ? (elapsed * 1000.0) / sent : 0.0,
+      elapsed ? (8.0 * PACKET_SIZE * data.received) / elapsed : 0.0);
+
+  if (data.received != sent)
+    g_printerr ("%s: only %u of %u packets were decrypted\n", name,
+        data.received, sent);
+
+  gst_element_set_state (srtpenc, GST_STATE_NULL);
+  gst_element_set_state (srtpdec, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+
+  gst_element_release_request_pad (srtpenc, encsink);
+  gst_object_unref (encsink);
+  gst_object_unref (encsrc);
+  gst_object_unref (decsink);
+  gst_object_unref (decsrc);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srtpenc);
+  gst_object_unref (srtpdec);
+  gst_buffer_unref (data.key);
+}
+
+int
+main (int argc, char **argv)
+{
+  guint packets = DEFAULT_PACKETS;
+  guint i;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    packets = g_ascii_strtoull (argv[1], NULL, 10);
+
+  if (packets == 0)
+  {
+    g_printerr ("Usage: %s [packets]\n", argv[0]);
+    return 1;
+  }
+
+  for (i = 0; suites[i].name; i++)
+  {
+    run_suite (packets, FALSE, suites[i].name, suites[i].cipher,
+        suites[i].auth, suites[i].key_size);
+    run_suite (packets, TRUE, suites[i].name, suites[i].cipher,
+        suites[i].auth, suites[i].key_size);
+  }
+
+  return 0;
+}
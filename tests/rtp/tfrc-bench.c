@@ -0,0 +1,163 @@
+/* Farstream ad-hoc benchmark for the TFRC receiver
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Feeds a TfrcReceiver with a synthetic packet stream under various loss
+ * patterns and prints the average cost of tfrc_receiver_got_packet() per
+ * packet. Run it before and after changing the receiver history code.
+ *
+ * Usage: tfrc-bench [packets]
+ */
+
+#include <glib.h>
+
+#include "tfrc.h"
+
+/* All times in microseconds, like tfrc.c */
+#define PACKET_INTERVAL (20 * 1000)
+#define RTT (100 * 1000)
+#define PACKET_SIZE (1200)
+#define DEFAULT_PACKETS (1000 * 1000)
+
+typedef enum {
+  LOSS_NONE,
+  LOSS_RANDOM,
+  LOSS_BURST,
+  LOSS_REORDER
+} LossPattern;
+
+static const struct {
+  const gchar *name;
+  LossPattern pattern;
+  gdouble rate;
+} patterns[] = {
+  { "no loss", LOSS_NONE, 0 },
+  { "random 1%", LOSS_RANDOM, 0.01 },
+  { "random 10%", LOSS_RANDOM, 0.10 },
+  { "random 30%", LOSS_RANDOM, 0.30 },
+  { "bursts of 5, 10%", LOSS_BURST, 0.10 },
+  { "reorder 10%", LOSS_REORDER, 0.10 },
+  { NULL, 0, 0 }
+};
+
+static void
+run_pattern (guint packets, LossPattern pattern, gdouble rate,
+    const gchar *name)
+{
+  GRand *rand = g_rand_new_with_seed (42);
+  TfrcReceiver *receiver;
+  guint64 now = 0;
+  guint seq;
+  guint received = 0;
+  guint burst = 0;
+  guint held = 0;
+  gboolean holding = FALSE;
+  gboolean send_feedback;
+  gdouble loss_event_rate;
+  guint receive_rate;
+  gint64 start, elapsed;
+
+  receiver = tfrc_receiver_new (now);
+
+  start = g_get_monotonic_time ();
+
+  for (seq = 1; seq <= packets; seq++)
+  {
+    now += PACKET_INTERVAL;
+
+    switch (pattern)
+    {
+      case LOSS_NONE:
+        break;
+      case LOSS_RANDOM:
+        if (g_rand_double (rand) < rate)
+          continue;
+        break;
+      case LOSS_BURST:
+        if (burst == 0 && g_rand_double (rand) < rate / 5)
+          burst = 5;
+        if (burst > 0)
+        {
+          burst--;
+          continue;
+        }
+        break;
+      case LOSS_REORDER:
+        /* Delay one packet until after the next one */
+        if (!holding && g_rand_double (rand) < rate)
+        {
+          held = seq;
+          holding = TRUE;
+          continue;
+        }
+        break;
+    }
+
+    send_feedback = tfrc_receiver_got_packet (receiver, now, now, seq, RTT,
+        PACKET_SIZE);
+    received++;
+
+    if (holding)
+    {
+      send_feedback |= tfrc_receiver_got_packet (receiver,
+          now - PACKET_INTERVAL, now, held, RTT, PACKET_SIZE);
+      received++;
+      holding = FALSE;
+    }
+
+    /* Like fs-rtp-tfrc.c, send feedback when asked to */
+    if (now >= tfrc_receiver_get_feedback_timer_expiry (receiver))
+      send_feedback |= tfrc_receiver_feedback_timer_expired (receiver, now);
+
+    if (send_feedback)
+      tfrc_receiver_send_feedback (receiver, now, &loss_event_rate,
+          &receive_rate);
+  }
+
+  elapsed = g_get_monotonic_time () - start;
+
+  g_print ("%-20s %10u packets %8.1f ns/packet\n", name, received,
+      received ? (elapsed * 1000.0) / received : 0.0);
+
+  tfrc_receiver_free (receiver);
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char **argv)
+{
+  guint packets = DEFAULT_PACKETS;
+  guint i;
+
+  if (argc > 1)
+    packets = g_ascii_strtoull (argv[1], NULL, 10);
+
+  if (packets == 0)
+  {
+    g_printerr ("Usage: %s [packets]\n", argv[0]);
+    return 1;
+  }
+
+  for (i = 0; patterns[i].name; i++)
+    run_pattern (packets, patterns[i].pattern, patterns[i].rate,
+        patterns[i].name);
+
+  return 0;
+}
@@ -0,0 +1,546 @@
+/* Farstream ad-hoc simulation of the TFRC rate control
+ *
+ * Copyright (C) 2026 agent
+ * @author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Runs a TFRC sender and receiver against each other over a simulated link,
+ * without any GStreamer pipeline or real clock. The sender always has data to
+ * send and paces its packets at the rate TFRC gives it. The forward path
+ * has a random loss rate, a bottleneck of a given capacity with a drop-tail
+ * queue, a fixed propagation delay and a random jitter. The feedback packets
+ * travel back with the propagation delay only.
+ *
+ * Time is simulated, so a run is fully deterministic for a given seed and
+ * set of parameters. The feedback is exchanged the same way fs-rtp-tfrc.c
+ * does it.
+ *
+ * Example:
+ *   tfrc-sim --rtt 100 --capacity 1000 --loss 1 --duration 120 --verbose
+ */
+
+#include <time.h>
+
+#include <glib.h>
+
+#include "tfrc.h"
+
+/* All times in microseconds, like tfrc.c */
+#define SECOND (1000 * 1000)
+#define MSECOND (1000)
+
+/* Start the clock later than 0 so nothing in tfrc.c underflows */
+#define START_TIME SECOND
+
+/* How close to its final average the throughput must stay to be
+ * considered converged */
+#define CONVERGENCE_TOLERANCE (0.1)
+
+static gint rtt_ms = 100;
+static gdouble loss_percent = 0;
+static gint jitter_ms = 0;
+static gint capacity_kbps = 1000;
+static gint queue_ms = 100;
+static gint duration_s = 60;
+static gint packet_size = 1200;
+static gint report_ms = 1000;
+static gint seed = 0;
+static gboolean small_packets = FALSE;
+static gboolean verbose = FALSE;
+
+static GOptionEntry entries[] = {
+  { "rtt", 'r', 0, G_OPTION_ARG_INT, &rtt_ms,
+    "Round trip propagation delay in ms (default: 100)", "MS" },
+  { "loss", 'l', 0, G_OPTION_ARG_DOUBLE, &loss_percent,
+    "Random loss rate in percent (default: 0)", "PERCENT" },
+  { "jitter", 'j', 0, G_OPTION_ARG_INT, &jitter_ms,
+    "Maximum random jitter added to each packet in ms (default: 0)", "MS" },
+  { "capacity", 'c', 0, G_OPTION_ARG_INT, &capacity_kbps,
+    "Bottleneck capacity in kbit/s, 0 for unlimited (default: 1000)",
+    "KBPS" },
+  { "queue", 'q', 0, G_OPTION_ARG_INT, &queue_ms,
+    "Bottleneck queue length in ms (default: 100)", "MS" },
+  { "duration", 'd', 0, G_OPTION_ARG_INT, &duration_s,
+    "Simulated duration in seconds (default: 60)", "S" },
+  { "packet-size", 's', 0, G_OPTION_ARG_INT, &packet_size,
+    "Packet size in bytes (default: 1200)", "BYTES" },
+  { "report", 0, 0, G_OPTION_ARG_INT, &report_ms,
+    "Reporting interval in ms (default: 1000)", "MS" },
+  { "seed", 0, 0, G_OPTION_ARG_INT, &seed,
+    "Seed of the random generator (default: 0)", "SEED" },
+  { "small-packets", 'p', 0, G_OPTION_ARG_NONE, &small_packets,
+    "Use the small packet variant (RFC 4828)", NULL },
+  { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+    "Print the state at each reporting interval", NULL },
+  { NULL }
+};
+
+typedef enum {
+  CALL_SENDING_PACKET,
+  CALL_GOT_PACKET,
+  CALL_SEND_FEEDBACK,
+  CALL_RECEIVER_TIMER,
+  CALL_ON_FEEDBACK_PACKET,
+  CALL_SENDER_TIMER,
+  CALL_LAST
+} Call;
+
+static struct {
+  const gchar *name;
+  guint64 count;
+  guint64 ns;
+} calls[CALL_LAST] = {
+  { "tfrc_sender_sending_packet" },
+  { "tfrc_receiver_got_packet" },
+  { "tfrc_receiver_send_feedback" },
+  { "tfrc_receiver_feedback_timer_expired" },
+  { "tfrc_sender_on_feedback_packet" },
+  { "tfrc_sender_no_feedback_timer_expired" }
+};
+
+static guint64
+get_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (guint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Measures the CPU cost of one call into tfrc.c */
+#define TIMED_CALL(call, expr)                  \
+  G_STMT_START {                                \
+    guint64 _start = get_ns ();                 \
+    expr;                                       \
+    calls[call].ns += get_ns () - _start;       \
+    calls[call].count++;                        \
+  } G_STMT_END
+
+typedef enum {
+  EVENT_PACKET,
+  EVENT_FEEDBACK
+} EventType;
+
+typedef struct {
+  guint64 time;
+  /* Keeps events with the same time in the order they were created */
+  guint64 order;
+  EventType type;
+
+  /* For packets */
+  guint seqnum;
+  guint64 timestamp;
+  guint sender_rtt;
+
+  /* For feedback */
+  guint64 ts_echo;
+  guint delay;
+  guint receive_rate;
+  gdouble loss_event_rate;
+} Event;
+
+typedef struct {
+  GRand *rand;
+  /* Packets and feedback in flight, sorted by arrival time */
+  GSequence *events;
+  guint64 event_order;
+
+  guint64 rtt;
+  guint64 jitter;
+  guint64 queue;
+  guint capacity;
+
+  TfrcSender *sender;
+  TfrcIsDataLimited *idl;
+  guint64 next_send;
+  guint seqnum;
+  guint64 link_free_at;
+
+  TfrcReceiver *receiver;
+  guint64 receiver_timer;
+  guint last_rtt;
+  guint64 last_ts;
+  guint64 last_recvtime;
+
+  guint sent;
+  guint lost;
+  guint dropped;
+  guint feedbacks;
+  guint64 received_bytes;
+  guint64 interval_bytes;
+  /* Throughput in bytes/s of each reporting interval */
+  GArray *throughput;
+} Simulation;
+
+static gint
+event_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const Event *event_a = a;
+  const Event *event_b = b;
+
+  if (event_a->time != event_b->time)
+    return event_a->time < event_b->time ? -1 : 1;
+  else
+    return event_a->order < event_b->order ? -1 : 1;
+}
+
+static Event *
+queue_event (Simulation *sim, EventType type, guint64 time)
+{
+  Event *event = g_slice_new0 (Event);
+
+  event->type = type;
+  event->time = time;
+  event->order = sim->event_order++;
+  g_sequence_insert_sorted (sim->events, event, event_compare, NULL);
+
+  return event;
+}
+
+static void
+free_event (gpointer data)
+{
+  g_slice_free (Event, data);
+}
+
+static void
+update_receiver_timer (Simulation *sim, guint64 now)
+{
+  guint64 expiry = tfrc_receiver_get_feedback_timer_expiry (sim->receiver);
+
+  /* Like fs-rtp-tfrc.c, the timer is only re-armed if it is in the future */
+  sim->receiver_timer = expiry > now ? expiry : G_MAXUINT64;
+}
+
+static void
+receiver_send_feedback (Simulation *sim, guint64 now)
+{
+  gboolean sent;
+  gdouble loss_event_rate;
+  guint receive_rate;
+  Event *event;
+
+  TIMED_CALL (CALL_SEND_FEEDBACK,
+      sent = tfrc_receiver_send_feedback (sim->receiver, now,
+          &loss_event_rate, &receive_rate));
+
+  if (sent)
+  {
+    event = queue_event (sim, EVENT_FEEDBACK, now + sim->rtt / 2);
+    event->ts_echo = sim->last_ts;
+    event->delay = now - sim->last_recvtime;
+    event->receive_rate = receive_rate;
+    event->loss_event_rate = loss_event_rate;
+    sim->feedbacks++;
+  }
+
+  update_receiver_timer (sim, now);
+}
+
+static void
+receiver_timer_func (Simulation *sim, guint64 now)
+{
+  gboolean send_feedback = FALSE;
+
+  if (tfrc_receiver_get_feedback_timer_expiry (sim->receiver) <= now)
+    TIMED_CALL (CALL_RECEIVER_TIMER,
+        send_feedback = tfrc_receiver_feedback_timer_expired (sim->receiver,
+            now));
+
+  if (send_feedback)
+    receiver_send_feedback (sim, now);
+  else
+    update_receiver_timer (sim, now);
+}
+
+static void
+receiver_got_packet (Simulation *sim, Event *event, guint64 now)
+{
+  gboolean send_feedback;
+
+  if (sim->receiver == NULL)
+  {
+    sim->receiver = small_packets ?
+        tfrc_receiver_new_sp (now) : tfrc_receiver_new (now);
+    sim->receiver_timer = G_MAXUINT64;
+  }
+
+  TIMED_CALL (CALL_GOT_PACKET,
+      send_feedback = tfrc_receiver_got_packet (sim->receiver,
+          event->timestamp, now, event->seqnum, event->sender_rtt,
+          packet_size));
+
+  sim->last_ts = event->timestamp;
+  sim->last_recvtime = now;
+  sim->received_bytes += packet_size;
+  sim->interval_bytes += packet_size;
+
+  if (send_feedback)
+    receiver_send_feedback (sim, now);
+
+  /* The receiver timer starts with the first packet that carries an RTT */
+  if (event->sender_rtt && sim->last_rtt == 0)
+    receiver_timer_func (sim, now);
+  sim->last_rtt = event->sender_rtt;
+}
+
+static void
+sender_got_feedback (Simulation *sim, Event *event, guint64 now)
+{
+  guint64 rtt = now - event->ts_echo - event->delay;
+  gboolean is_data_limited;
+
+  if (rtt == 0)
+    rtt = 1;
+
+  if (tfrc_sender_get_averaged_rtt (sim->sender) == 0)
+    tfrc_sender_on_first_rtt (sim->sender, now);
+
+  is_data_limited = tfrc_is_data_limited_received_feedback (sim->idl, now,
+      event->ts_echo, tfrc_sender_get_averaged_rtt (sim->sender));
+
+  TIMED_CALL (CALL_ON_FEEDBACK_PACKET,
+      tfrc_sender_on_feedback_packet (sim->sender, now, rtt,
+          event->receive_rate, event->loss_event_rate, is_data_limited));
+}
+
+static void
+sender_send_packet (Simulation *sim, guint64 now)
+{
+  guint rate;
+  guint64 start;
+  Event *event;
+
+  tfrc_is_data_limited_not_limited_now (sim->idl, now);
+  TIMED_CALL (CALL_SENDING_PACKET,
+      tfrc_sender_sending_packet (sim->sender, packet_size));
+
+  sim->seqnum++;
+  sim->sent++;
+
+  rate = tfrc_sender_get_send_rate (sim->sender);
+  sim->next_send = now + ((guint64) packet_size * SECOND) / MAX (rate, 1);
+
+  if (g_rand_double (sim->rand) * 100 < loss_percent)
+  {
+    sim->lost++;
+    return;
+  }
+
+  if (sim->capacity)
+  {
+    start = MAX (now, sim->link_free_at);
+    if (start - now > sim->queue)
+    {
+      sim->dropped++;
+      return;
+    }
+    sim->link_free_at = start +
+        ((guint64) packet_size * SECOND) / sim->capacity;
+    start = sim->link_free_at;
+  }
+  else
+  {
+    start = now;
+  }
+
+  if (sim->jitter)
+    start += g_rand_int_range (sim->rand, 0, sim->jitter + 1);
+
+  event = queue_event (sim, EVENT_PACKET, start + sim->rtt / 2);
+  event->seqnum = sim->seqnum;
+  event->timestamp = now;
+  event->sender_rtt = tfrc_sender_get_averaged_rtt (sim->sender);
+}
+
+static void
+report (Simulation *sim, guint64 now)
+{
+  guint throughput = (sim->interval_bytes * SECOND) / (report_ms * MSECOND);
+
+  g_array_append_val (sim->throughput, throughput);
+  sim->interval_bytes = 0;
+
+  if (verbose)
+    g_print ("%8.2f s  send rate %7u kbit/s  throughput %7u kbit/s"
+        "  rtt %4u ms\n",
+        (gdouble) (now - START_TIME) / SECOND,
+        tfrc_sender_get_send_rate (sim->sender) * 8 / 1000,
+        throughput * 8 / 1000,
+        tfrc_sender_get_averaged_rtt (sim->sender) / MSECOND);
+}
+
+static void
+print_summary (Simulation *sim)
+{
+  guint n = sim->throughput->len;
+  guint64 sum = 0;
+  gdouble average;
+  gint converged = -1;
+  guint i;
+
+  /* Use the second half of the run as the steady state */
+  for (i = n / 2; i < n; i++)
+    sum += g_array_index (sim->throughput, guint, i);
+  average = n - n / 2 ? (gdouble) sum / (n - n / 2) : 0;
+
+  for (i = n; i > 0; i--)
+  {
+    guint value = g_array_index (sim->throughput, guint, i - 1);
+
+    if (value < average * (1 - CONVERGENCE_TOLERANCE) ||
+        value > average * (1 + CONVERGENCE_TOLERANCE))
+      break;
+    converged = i - 1;
+  }
+
+  g_print ("\n");
+  g_print ("Packets sent: %u, lost: %u, dropped by the queue: %u,"
+      " feedback packets: %u\n",
+      sim->sent, sim->lost, sim->dropped, sim->feedbacks);
+  g_print ("Average throughput: %.0f kbit/s overall, %.0f kbit/s"
+      " in the second half",
+      (gdouble) sim->received_bytes * 8 / 1000 / duration_s,
+      average * 8 / 1000);
+  if (capacity_kbps)
+    g_print (" (%.0f%% of capacity)", average * 8 / 10 / capacity_kbps);
+  g_print ("\n");
+
+  if (converged >= 0 && converged < n / 2)
+    g_print ("Converged within %.0f%% of the final throughput after %.2f s\n",
+        CONVERGENCE_TOLERANCE * 100, (gdouble) converged * report_ms / 1000);
+  else
+    g_print ("Did not converge within %.0f%% of the final throughput\n",
+        CONVERGENCE_TOLERANCE * 100);
+
+  g_print ("\nCPU cost per call:\n");
+  for (i = 0; i < CALL_LAST; i++)
+    g_print ("  %-40s %10" G_GUINT64_FORMAT " calls %8.1f ns/call\n",
+        calls[i].name, calls[i].count,
+        calls[i].count ? (gdouble) calls[i].ns / calls[i].count : 0.0);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  Simulation sim = { NULL };
+  guint64 now = START_TIME;
+  guint64 end;
+  guint64 next_report;
+
+  context = g_option_context_new ("- simulate TFRC over a lossy link");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+  {
+    g_printerr ("%s\n", error->message);
+    g_clear_error (&error);
+    g_option_context_free (context);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  if (rtt_ms < 0 || jitter_ms < 0 || capacity_kbps < 0 || queue_ms < 0 ||
+      duration_s <= 0 || packet_size <= 0 || report_ms <= 0 ||
+      loss_percent < 0 || loss_percent > 100)
+  {
+    g_printerr ("Invalid parameters\n");
+    return 1;
+  }
+
+  sim.rand = g_rand_new_with_seed (seed);
+  sim.events = g_sequence_new (free_event);
+  sim.rtt = rtt_ms * MSECOND;
+  sim.jitter = jitter_ms * MSECOND;
+  sim.queue = queue_ms * MSECOND;
+  sim.capacity = capacity_kbps * 1000 / 8;
+  sim.throughput = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  if (small_packets)
+    sim.sender = tfrc_sender_new_sp (now, packet_size);
+  else
+    sim.sender = tfrc_sender_new (packet_size, now, 0);
+  sim.idl = tfrc_is_data_limited_new (now);
+  sim.next_send = now;
+
+  end = START_TIME + (guint64) duration_s * SECOND;
+  next_report = START_TIME + report_ms * MSECOND;
+
+  for (;;)
+  {
+    GSequenceIter *first = g_sequence_get_begin_iter (sim.events);
+    Event *event = NULL;
+    guint64 sender_timer =
+        tfrc_sender_get_no_feedback_timer_expiry (sim.sender);
+
+    /* Pick the earliest thing that happens next */
+    now = MIN (sim.next_send, next_report);
+    if (!g_sequence_iter_is_end (first))
+    {
+      event = g_sequence_get (first);
+      now = MIN (now, event->time);
+    }
+    if (sim.receiver)
+      now = MIN (now, sim.receiver_timer);
+    now = MIN (now, sender_timer);
+
+    if (now > end)
+      break;
+
+    if (now == next_report)
+    {
+      report (&sim, now);
+      next_report += report_ms * MSECOND;
+    }
+    else if (event && now == event->time)
+    {
+      if (event->type == EVENT_PACKET)
+        receiver_got_packet (&sim, event, now);
+      else
+        sender_got_feedback (&sim, event, now);
+      g_sequence_remove (first);
+    }
+    else if (sim.receiver && now == sim.receiver_timer)
+    {
+      receiver_timer_func (&sim, now);
+    }
+    else if (now == sender_timer)
+    {
+      TIMED_CALL (CALL_SENDER_TIMER,
+          tfrc_sender_no_feedback_timer_expired (sim.sender, now));
+    }
+    else
+    {
+      sender_send_packet (&sim, now);
+    }
+  }
+
+  print_summary (&sim);
+
+  g_array_free (sim.throughput, TRUE);
+  if (sim.receiver)
+    tfrc_receiver_free (sim.receiver);
+  tfrc_is_data_limited_free (sim.idl);
+  tfrc_sender_free (sim.sender);
+  g_sequence_free (sim.events);
+  g_rand_free (sim.rand);
+
+  return 0;
+}
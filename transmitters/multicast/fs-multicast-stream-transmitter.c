@@ -50,6 +50,14 @@
  * Packets sent will be looped back (so that other clients on the same session
  * can be on the same machine.
  *
+ * On systems with epoll, setting
+ * #FsMulticastStreamTransmitter:socket-reactor to %TRUE makes the sockets
+ * receive from a small process-wide pool of threads instead of having one
+ * thread per socket. The size of the pool defaults to the number of
+ * processors and can be set with the FS_SOCKET_REACTOR_THREADS environment
+ * variable. Sockets shared between streams keep the setting of the stream
+ * that opened them first.
+ *
  * The name of this transmitter is "multicast".
  */
 
@@ -95,7 +103,8 @@ enum
 {
   PROP_0,
   PROP_SENDING,
-  PROP_PREFERRED_LOCAL_CANDIDATES
+  PROP_PREFERRED_LOCAL_CANDIDATES,
+  PROP_SOCKET_REACTOR
 };
 
 struct _FsMulticastStreamTransmitterPrivate
@@ -124,6 +133,8 @@ struct _FsMulticastStreamTransmitterPrivate
   UdpSock **udpsocks;
 
   GList *preferred_local_candidates;
+
+  gboolean socket_reactor;
 };
 
 #define FS_MULTICAST_STREAM_TRANSMITTER_GET_PRIVATE(o)  \
@@ -205,6 +216,19 @@ fs_multicast_stream_transmitter_class_init (FsMulticastStreamTransmitterClass *k
   g_object_class_override_property (gobject_class,
     PROP_PREFERRED_LOCAL_CANDIDATES, "preferred-local-candidates");
 
+  g_object_class_install_property (gobject_class,
+      PROP_SOCKET_REACTOR,
+      g_param_spec_boolean ("socket-reactor",
+#ifdef HAVE_EPOLL
+          "Use the shared socket reactor",
+#else
+          "Use the shared socket reactor (NOT COMPILED IN)",
+#endif
+          "Whether to receive from the shared pool of epoll threads instead"
+          " of a dedicated thread per socket",
+          FALSE,
+          G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->dispose = fs_multicast_stream_transmitter_dispose;
   gobject_class->finalize = fs_multicast_stream_transmitter_finalize;
 
@@ -313,6 +337,9 @@ fs_multicast_stream_transmitter_get_property (GObject *object,
     case PROP_PREFERRED_LOCAL_CANDIDATES:
       g_value_set_boxed (value, self->priv->preferred_local_candidates);
       break;
+    case PROP_SOCKET_REACTOR:
+      g_value_set_boolean (value, self->priv->socket_reactor);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -360,6 +387,9 @@ fs_multicast_stream_transmitter_set_property (GObject *object,
     case PROP_PREFERRED_LOCAL_CANDIDATES:
       self->priv->preferred_local_candidates = g_value_dup_boxed (value);
       break;
+    case PROP_SOCKET_REACTOR:
+      self->priv->socket_reactor = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -484,6 +514,7 @@ fs_multicast_stream_transmitter_add_remote_candidate (
       candidate->port,
       candidate->ttl,
       candidate->component_id == 1 ? self->priv->sending : TRUE,
+      self->priv->socket_reactor,
       error);
 
   if (!newudpsock)
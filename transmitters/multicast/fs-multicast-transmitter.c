@@ -40,6 +40,10 @@
 #include <farstream/fs-conference.h>
 #include <farstream/fs-plugin.h>
 
+#ifdef HAVE_EPOLL
+#include <farstream/fs-socket-reactor.h>
+#endif
+
 #include <string.h>
 #include <sys/types.h>
 
@@ -513,6 +517,10 @@ fs_multicast_transmitter_new_stream_transmitter (FsTransmitter *transmitter,
  * one local_ip:port:multicast_ip trio on which we listen and send,
  * so it includes a udpsrc and a multiudpsink. It represents one BSD socket.
  * The TTL used is the max TTL requested by any stream.
+ *
+ * If the first stream to use it asks for the socket reactor, the udpsrc
+ * is replaced by a FsSocketReactorSrc serviced by the process-wide pool of
+ * epoll threads.
  */
 
 struct _UdpSock {
@@ -541,6 +549,9 @@ struct _UdpSock {
 
   guint component_id;
 
+  /* Set by the first user */
+  gboolean socket_reactor;
+
   volatile gint sendcount;
 };
 
@@ -715,7 +726,8 @@ _bind_port (
 static GstElement *
 _create_sinksource (gchar *elementname, GstBin *bin,
     GstElement *teefunnel, GSocket *socket,
-    GstPadDirection direction, GstPad **requested_pad, GError **error)
+    GstPadDirection direction, gboolean socket_reactor,
+    GstPad **requested_pad, GError **error)
 {
   GstElement *elem;
   GstPadLinkReturn ret = GST_PAD_LINK_OK;
@@ -724,18 +736,27 @@ _create_sinksource (gchar *elementname, GstBin *bin,
 
   g_assert (direction == GST_PAD_SINK || direction == GST_PAD_SRC);
 
-  elem = gst_element_factory_make (elementname, NULL);
-  if (!elem) {
-    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
-      "Could not create the %s element", elementname);
-    return NULL;
+#ifdef HAVE_EPOLL
+  if (socket_reactor && direction == GST_PAD_SRC)
+  {
+    elem = _fs_socket_reactor_src_new (socket, TRUE);
   }
+  else
+#endif
+  {
+    elem = gst_element_factory_make (elementname, NULL);
+    if (!elem) {
+      g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not create the %s element", elementname);
+      return NULL;
+    }
 
-  g_object_set (elem,
-    "close-socket", FALSE,
-    "socket", socket,
-    "auto-multicast", FALSE,
-    NULL);
+    g_object_set (elem,
+      "close-socket", FALSE,
+      "socket", socket,
+      "auto-multicast", FALSE,
+      NULL);
+  }
 
   if (!gst_bin_add (bin, elem)) {
     g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
@@ -864,6 +885,7 @@ fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
     guint16 port,
     guint8 ttl,
     gboolean sending,
+    gboolean socket_reactor,
     GError **error)
 {
   UdpSock *udpsock;
@@ -908,6 +930,12 @@ fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
   udpsock->current_ttl = ttl;
   udpsock->ttls = g_byte_array_new ();
   g_byte_array_append (udpsock->ttls, &ttl, 1);
+#ifdef HAVE_EPOLL
+  udpsock->socket_reactor = socket_reactor;
+#else
+  if (socket_reactor)
+    GST_WARNING ("Socket reactor requested, but epoll is not available");
+#endif
 
   /* Now lets bind both ports */
 
@@ -926,13 +954,15 @@ fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
 
   udpsock->udpsrc = _create_sinksource ("udpsrc",
       GST_BIN (trans->priv->gst_src), udpsock->funnel, udpsock->socket,
-      GST_PAD_SRC, &udpsock->udpsrc_requested_pad, error);
+      GST_PAD_SRC, udpsock->socket_reactor, &udpsock->udpsrc_requested_pad,
+      error);
   if (!udpsock->udpsrc)
     goto error;
 
   udpsock->udpsink = _create_sinksource ("multiudpsink",
       GST_BIN (trans->priv->gst_sink), udpsock->tee,
-      udpsock->socket, GST_PAD_SINK, &udpsock->udpsink_requested_pad, error);
+      udpsock->socket, GST_PAD_SINK, udpsock->socket_reactor,
+      &udpsock->udpsink_requested_pad, error);
   if (!udpsock->udpsink)
     goto error;
 
@@ -94,6 +94,7 @@ UdpSock *fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
     guint16 port,
     guint8 ttl,
     gboolean sending,
+    gboolean socket_reactor,
     GError **error);
 
 void fs_multicast_transmitter_put_udpsock (FsMulticastTransmitter *trans,
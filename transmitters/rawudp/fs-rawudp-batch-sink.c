@@ -0,0 +1,697 @@
+/*
+ * Farstream - Farstream RAW UDP batched sink
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-rawudp-batch-sink.c - A sink that sends UDP packets with sendmmsg()
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * This element replaces multiudpsink for a UdpPort in batched mode. It
+ * queues up to batch-size buffers and sends them to every destination with
+ * a single sendmmsg() call. The first queued buffer is never held for more
+ * than flush-timeout, so the added latency stays bounded for audio.
+ *
+ * It has the same "add" and "remove" action signals as multiudpsink, so the
+ * UdpPort code can manage the destinations the same way for both.
+ */
+
+/* For sendmmsg() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rawudp-batch-sink.h"
+#include "fs-rawudp-transmitter.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#define GST_CAT_DEFAULT fs_rawudp_transmitter_debug
+
+struct Dest {
+  gchar *host;
+  gint port;
+  guint refcount;
+
+  struct sockaddr_storage addr;
+  socklen_t addrlen;
+};
+
+enum
+{
+  PROP_0,
+  PROP_LARGEST_BATCH
+};
+
+struct _FsRawUdpBatchSinkPrivate
+{
+  GstPad *sinkpad;
+
+  /* Set at construction time */
+  GSocket *socket;
+  guint batch_size;
+  GstClockTime flush_timeout;
+  GstClock *clock;
+
+  GMutex mutex;
+
+  /* Protected by the mutex */
+  GArray *dests;
+
+  GstBuffer **pending;
+  GstMapInfo *pending_maps;
+  guint n_pending;
+  GstClockTime first_pending_time;
+  GstClockID flush_id;
+
+  struct mmsghdr *msgs;
+  struct iovec *iovecs;
+  guint msgs_allocated;
+
+  guint largest_batch;
+};
+
+static GstStaticPadTemplate fs_rawudp_batch_sink_template =
+    GST_STATIC_PAD_TEMPLATE ("sink",
+        GST_PAD_SINK,
+        GST_PAD_ALWAYS,
+        GST_STATIC_CAPS_ANY);
+
+#define FS_RAWUDP_BATCH_SINK_LOCK(self) \
+  g_mutex_lock (&(self)->priv->mutex)
+#define FS_RAWUDP_BATCH_SINK_UNLOCK(self) \
+  g_mutex_unlock (&(self)->priv->mutex)
+
+static GstElementClass *parent_class = NULL;
+
+static GType type = 0;
+
+static void fs_rawudp_batch_sink_class_init (FsRawUdpBatchSinkClass *klass);
+static void fs_rawudp_batch_sink_init (FsRawUdpBatchSink *self);
+static void fs_rawudp_batch_sink_dispose (GObject *object);
+static void fs_rawudp_batch_sink_finalize (GObject *object);
+static void fs_rawudp_batch_sink_get_property (GObject *object,
+    guint prop_id, GValue *value, GParamSpec *pspec);
+static GstStateChangeReturn fs_rawudp_batch_sink_change_state (
+    GstElement *element, GstStateChange transition);
+
+static GstFlowReturn fs_rawudp_batch_sink_chain (GstPad *pad,
+    GstObject *parent, GstBuffer *buffer);
+static GstFlowReturn fs_rawudp_batch_sink_chain_list (GstPad *pad,
+    GstObject *parent, GstBufferList *list);
+static gboolean fs_rawudp_batch_sink_event (GstPad *pad, GstObject *parent,
+    GstEvent *event);
+static gboolean fs_rawudp_batch_sink_query (GstPad *pad, GstObject *parent,
+    GstQuery *query);
+
+static void fs_rawudp_batch_sink_add (FsRawUdpBatchSink *self,
+    const gchar *host, gint port);
+static void fs_rawudp_batch_sink_remove (FsRawUdpBatchSink *self,
+    const gchar *host, gint port);
+
+static void fs_rawudp_batch_sink_flush_locked (FsRawUdpBatchSink *self);
+static void fs_rawudp_batch_sink_drop_pending_locked (FsRawUdpBatchSink *self);
+
+GType
+fs_rawudp_batch_sink_get_type (void)
+{
+  return type;
+}
+
+GType
+fs_rawudp_batch_sink_register_type (FsPlugin *module G_GNUC_UNUSED)
+{
+  static const GTypeInfo info = {
+    sizeof (FsRawUdpBatchSinkClass),
+    NULL,
+    NULL,
+    (GClassInitFunc) fs_rawudp_batch_sink_class_init,
+    NULL,
+    NULL,
+    sizeof (FsRawUdpBatchSink),
+    0,
+    (GInstanceInitFunc) fs_rawudp_batch_sink_init
+  };
+
+  type = g_type_register_static (GST_TYPE_ELEMENT, "FsRawUdpBatchSink",
+      &info, 0);
+
+  return type;
+}
+
+static void
+fs_rawudp_batch_sink_class_init (FsRawUdpBatchSinkClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  parent_class = g_type_class_peek_parent (klass);
+
+  gobject_class->dispose = fs_rawudp_batch_sink_dispose;
+  gobject_class->finalize = fs_rawudp_batch_sink_finalize;
+  gobject_class->get_property = fs_rawudp_batch_sink_get_property;
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Farstream batched UDP sink",
+      "Sink/Network",
+      "Sends UDP packets to multiple destinations in batches with sendmmsg()",
+      "agent <agent@local>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rawudp_batch_sink_template));
+
+  gstelement_class->change_state = fs_rawudp_batch_sink_change_state;
+
+  g_object_class_install_property (gobject_class,
+      PROP_LARGEST_BATCH,
+      g_param_spec_uint ("largest-batch",
+          "Largest batch",
+          "The largest number of packets sent with one system call",
+          0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * FsRawUdpBatchSink::add:
+   * @self: the #FsRawUdpBatchSink
+   * @host: the destination IP address
+   * @port: the destination port
+   *
+   * Adds a destination, works like the multiudpsink signal of the same name
+   */
+  g_signal_new_class_handler ("add",
+      G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_CALLBACK (fs_rawudp_batch_sink_add),
+      NULL, NULL, NULL,
+      G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_INT);
+
+  /**
+   * FsRawUdpBatchSink::remove:
+   * @self: the #FsRawUdpBatchSink
+   * @host: the destination IP address
+   * @port: the destination port
+   *
+   * Removes a destination, works like the multiudpsink signal of the same name
+   */
+  g_signal_new_class_handler ("remove",
+      G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_CALLBACK (fs_rawudp_batch_sink_remove),
+      NULL, NULL, NULL,
+      G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_INT);
+
+  g_type_class_add_private (klass, sizeof (FsRawUdpBatchSinkPrivate));
+}
+
+static void
+fs_rawudp_batch_sink_init (FsRawUdpBatchSink *self)
+{
+  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, FS_TYPE_RAWUDP_BATCH_SINK,
+      FsRawUdpBatchSinkPrivate);
+
+  g_mutex_init (&self->priv->mutex);
+  self->priv->dests = g_array_new (FALSE, TRUE, sizeof (struct Dest));
+  self->priv->clock = gst_system_clock_obtain ();
+
+  self->priv->sinkpad = gst_pad_new_from_static_template (
+      &fs_rawudp_batch_sink_template, "sink");
+  gst_pad_set_chain_function (self->priv->sinkpad,
+      fs_rawudp_batch_sink_chain);
+  gst_pad_set_chain_list_function (self->priv->sinkpad,
+      fs_rawudp_batch_sink_chain_list);
+  gst_pad_set_event_function (self->priv->sinkpad,
+      fs_rawudp_batch_sink_event);
+  gst_pad_set_query_function (self->priv->sinkpad,
+      fs_rawudp_batch_sink_query);
+  gst_element_add_pad (GST_ELEMENT (self), self->priv->sinkpad);
+
+  GST_OBJECT_FLAG_SET (self, GST_ELEMENT_FLAG_SINK);
+}
+
+static void
+fs_rawudp_batch_sink_dispose (GObject *object)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (object);
+
+  FS_RAWUDP_BATCH_SINK_LOCK (self);
+  fs_rawudp_batch_sink_drop_pending_locked (self);
+  FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+static void
+fs_rawudp_batch_sink_finalize (GObject *object)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (object);
+  guint i;
+
+  for (i = 0; i < self->priv->dests->len; i++)
+    g_free (g_array_index (self->priv->dests, struct Dest, i).host);
+  g_array_free (self->priv->dests, TRUE);
+
+  g_free (self->priv->pending);
+  g_free (self->priv->pending_maps);
+  g_free (self->priv->msgs);
+  g_free (self->priv->iovecs);
+
+  gst_object_unref (self->priv->clock);
+  g_clear_object (&self->priv->socket);
+
+  g_mutex_clear (&self->priv->mutex);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+fs_rawudp_batch_sink_get_property (GObject *object, guint prop_id,
+    GValue *value, GParamSpec *pspec)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (object);
+
+  switch (prop_id)
+  {
+    case PROP_LARGEST_BATCH:
+      FS_RAWUDP_BATCH_SINK_LOCK (self);
+      g_value_set_uint (value, self->priv->largest_batch);
+      FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/**
+ * fs_rawudp_batch_sink_new:
+ * @socket: The bound #GSocket to send from, the caller keeps ownership of the
+ *   file descriptor
+ * @batch_size: The maximum number of buffers sent per system call
+ * @flush_timeout: The maximum time a buffer can be held before being sent
+ *
+ * Creates a sink element that sends on @socket with sendmmsg().
+ *
+ * Returns: a new #GstElement
+ */
+
+GstElement *
+fs_rawudp_batch_sink_new (GSocket *socket, guint batch_size,
+    GstClockTime flush_timeout)
+{
+  FsRawUdpBatchSink *self;
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), NULL);
+  g_return_val_if_fail (batch_size > 0, NULL);
+
+  self = g_object_new (FS_TYPE_RAWUDP_BATCH_SINK, NULL);
+
+  self->priv->socket = g_object_ref (socket);
+  self->priv->batch_size = batch_size;
+  self->priv->flush_timeout = flush_timeout;
+
+  self->priv->pending = g_new0 (GstBuffer *, batch_size);
+  self->priv->pending_maps = g_new0 (GstMapInfo, batch_size);
+
+  return GST_ELEMENT (self);
+}
+
+static gint
+fs_rawudp_batch_sink_find_dest_locked (FsRawUdpBatchSink *self,
+    const gchar *host, gint port)
+{
+  guint i;
+
+  for (i = 0; i < self->priv->dests->len; i++)
+  {
+    struct Dest *dest = &g_array_index (self->priv->dests, struct Dest, i);
+
+    if (dest->port == port && !strcmp (dest->host, host))
+      return i;
+  }
+
+  return -1;
+}
+
+static void
+fs_rawudp_batch_sink_add (FsRawUdpBatchSink *self, const gchar *host,
+    gint port)
+{
+  GInetAddress *inetaddr;
+  GSocketAddress *addr;
+  struct Dest dest = {0};
+  gint i;
+
+  FS_RAWUDP_BATCH_SINK_LOCK (self);
+  i = fs_rawudp_batch_sink_find_dest_locked (self, host, port);
+  if (i >= 0)
+  {
+    g_array_index (self->priv->dests, struct Dest, i).refcount++;
+    FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+    return;
+  }
+  FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+
+  inetaddr = g_inet_address_new_from_string (host);
+  if (!inetaddr)
+  {
+    GST_WARNING_OBJECT (self, "Invalid destination address %s", host);
+    return;
+  }
+
+  addr = g_inet_socket_address_new (inetaddr, port);
+  g_object_unref (inetaddr);
+
+  dest.addrlen = g_socket_address_get_native_size (addr);
+  if (!g_socket_address_to_native (addr, &dest.addr, sizeof (dest.addr),
+          NULL))
+  {
+    GST_WARNING_OBJECT (self, "Could not convert %s:%d to a native address",
+        host, port);
+    g_object_unref (addr);
+    return;
+  }
+  g_object_unref (addr);
+
+  dest.host = g_strdup (host);
+  dest.port = port;
+  dest.refcount = 1;
+
+  FS_RAWUDP_BATCH_SINK_LOCK (self);
+  i = fs_rawudp_batch_sink_find_dest_locked (self, host, port);
+  if (i >= 0)
+  {
+    g_array_index (self->priv->dests, struct Dest, i).refcount++;
+    g_free (dest.host);
+  }
+  else
+  {
+    GST_DEBUG_OBJECT (self, "Adding destination %s:%d", host, port);
+    g_array_append_val (self->priv->dests, dest);
+  }
+  FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+}
+
+static void
+fs_rawudp_batch_sink_remove (FsRawUdpBatchSink *self, const gchar *host,
+    gint port)
+{
+  struct Dest *dest;
+  gint i;
+
+  FS_RAWUDP_BATCH_SINK_LOCK (self);
+  i = fs_rawudp_batch_sink_find_dest_locked (self, host, port);
+  if (i < 0)
+  {
+    GST_WARNING_OBJECT (self, "Tried to remove unknown destination %s:%d",
+        host, port);
+    goto out;
+  }
+
+  dest = &g_array_index (self->priv->dests, struct Dest, i);
+  dest->refcount--;
+  if (dest->refcount == 0)
+  {
+    GST_DEBUG_OBJECT (self, "Removing destination %s:%d", host, port);
+
+    /* What is queued was received while the address was still a
+     * destination, multiudpsink would already have sent it there, so the
+     * batch is sent before the address is removed */
+    fs_rawudp_batch_sink_flush_locked (self);
+
+    dest = &g_array_index (self->priv->dests, struct Dest, i);
+    g_free (dest->host);
+    g_array_remove_index_fast (self->priv->dests, i);
+  }
+
+ out:
+  FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+}
+
+static void
+fs_rawudp_batch_sink_unschedule_locked (FsRawUdpBatchSink *self)
+{
+  if (self->priv->flush_id)
+  {
+    gst_clock_id_unschedule (self->priv->flush_id);
+    gst_clock_id_unref (self->priv->flush_id);
+    self->priv->flush_id = NULL;
+  }
+}
+
+static void
+fs_rawudp_batch_sink_drop_pending_locked (FsRawUdpBatchSink *self)
+{
+  guint i;
+
+  fs_rawudp_batch_sink_unschedule_locked (self);
+
+  for (i = 0; i < self->priv->n_pending; i++)
+  {
+    gst_buffer_unmap (self->priv->pending[i], &self->priv->pending_maps[i]);
+    gst_buffer_unref (self->priv->pending[i]);
+    self->priv->pending[i] = NULL;
+  }
+
+  self->priv->n_pending = 0;
+}
+
+static void
+fs_rawudp_batch_sink_flush_locked (FsRawUdpBatchSink *self)
+{
+  guint n_msgs = self->priv->n_pending * self->priv->dests->len;
+  guint sent = 0;
+  guint d, b, i;
+  int fd;
+
+  if (n_msgs == 0)
+    goto done;
+
+  if (n_msgs > self->priv->msgs_allocated)
+  {
+    self->priv->msgs = g_renew (struct mmsghdr, self->priv->msgs, n_msgs);
+    self->priv->iovecs = g_renew (struct iovec, self->priv->iovecs, n_msgs);
+    self->priv->msgs_allocated = n_msgs;
+  }
+
+  i = 0;
+  for (d = 0; d < self->priv->dests->len; d++)
+  {
+    struct Dest *dest = &g_array_index (self->priv->dests, struct Dest, d);
+
+    for (b = 0; b < self->priv->n_pending; b++)
+    {
+      struct msghdr *hdr = &self->priv->msgs[i].msg_hdr;
+
+      self->priv->iovecs[i].iov_base = self->priv->pending_maps[b].data;
+      self->priv->iovecs[i].iov_len = self->priv->pending_maps[b].size;
+
+      memset (hdr, 0, sizeof (struct msghdr));
+      hdr->msg_name = &dest->addr;
+      hdr->msg_namelen = dest->addrlen;
+      hdr->msg_iov = &self->priv->iovecs[i];
+      hdr->msg_iovlen = 1;
+      self->priv->msgs[i].msg_len = 0;
+      i++;
+    }
+  }
+
+  fd = g_socket_get_fd (self->priv->socket);
+
+  while (sent < n_msgs)
+  {
+    int ret = sendmmsg (fd, self->priv->msgs + sent, n_msgs - sent, 0);
+
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      /* sendmmsg() only fails if the first message could not be sent, so
+       * like multiudpsink, only that one is dropped and the send error is
+       * not fatal for the stream */
+      GST_WARNING_OBJECT (self, "sendmmsg failed, dropping one packet: %s",
+          g_strerror (errno));
+      sent++;
+      continue;
+    }
+
+    sent += ret;
+    self->priv->largest_batch = MAX (self->priv->largest_batch, (guint) ret);
+  }
+
+  GST_LOG_OBJECT (self, "Sent %u buffers to %u destinations in one batch",
+      self->priv->n_pending, self->priv->dests->len);
+
+ done:
+  fs_rawudp_batch_sink_drop_pending_locked (self);
+}
+
+static gboolean
+fs_rawudp_batch_sink_flush_timeout_cb (GstClock *clock, GstClockTime time,
+    GstClockID id, gpointer user_data)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (user_data);
+
+  FS_RAWUDP_BATCH_SINK_LOCK (self);
+  /* If the id is not the current one, the batch has already been sent */
+  if (self->priv->flush_id == id)
+    fs_rawudp_batch_sink_flush_locked (self);
+  FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+
+  return TRUE;
+}
+
+static void
+fs_rawudp_batch_sink_queue_locked (FsRawUdpBatchSink *self, GstBuffer *buffer)
+{
+  GstClockTime now;
+
+  if (self->priv->dests->len == 0)
+  {
+    gst_buffer_unref (buffer);
+    return;
+  }
+
+  now = gst_clock_get_time (self->priv->clock);
+
+  if (self->priv->n_pending == 0)
+    self->priv->first_pending_time = now;
+
+  self->priv->pending[self->priv->n_pending] = buffer;
+  gst_buffer_map (buffer, &self->priv->pending_maps[self->priv->n_pending],
+      GST_MAP_READ);
+  self->priv->n_pending++;
+
+  if (self->priv->n_pending >= self->priv->batch_size ||
+      now - self->priv->first_pending_time >= self->priv->flush_timeout)
+  {
+    fs_rawudp_batch_sink_flush_locked (self);
+  }
+  else if (!self->priv->flush_id)
+  {
+    self->priv->flush_id = gst_clock_new_single_shot_id (self->priv->clock,
+        self->priv->first_pending_time + self->priv->flush_timeout);
+    gst_clock_id_wait_async (self->priv->flush_id,
+        fs_rawudp_batch_sink_flush_timeout_cb, gst_object_ref (self),
+        (GDestroyNotify) gst_object_unref);
+  }
+}
+
+static GstFlowReturn
+fs_rawudp_batch_sink_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (parent);
+
+  FS_RAWUDP_BATCH_SINK_LOCK (self);
+  fs_rawudp_batch_sink_queue_locked (self, buffer);
+  FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+fs_rawudp_batch_sink_chain_list (GstPad *pad, GstObject *parent,
+    GstBufferList *list)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (parent);
+  guint i, len;
+
+  len = gst_buffer_list_length (list);
+
+  FS_RAWUDP_BATCH_SINK_LOCK (self);
+  for (i = 0; i < len; i++)
+    fs_rawudp_batch_sink_queue_locked (self,
+        gst_buffer_ref (gst_buffer_list_get (list, i)));
+  FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+
+  gst_buffer_list_unref (list);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+fs_rawudp_batch_sink_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (parent);
+
+  switch (GST_EVENT_TYPE (event))
+  {
+    case GST_EVENT_EOS:
+      FS_RAWUDP_BATCH_SINK_LOCK (self);
+      fs_rawudp_batch_sink_flush_locked (self);
+      FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+      gst_element_post_message (GST_ELEMENT (self),
+          gst_message_new_eos (GST_OBJECT (self)));
+      break;
+    case GST_EVENT_FLUSH_START:
+      FS_RAWUDP_BATCH_SINK_LOCK (self);
+      fs_rawudp_batch_sink_drop_pending_locked (self);
+      FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+      break;
+    default:
+      break;
+  }
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static gboolean
+fs_rawudp_batch_sink_query (GstPad *pad, GstObject *parent, GstQuery *query)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (parent);
+
+  switch (GST_QUERY_TYPE (query))
+  {
+    case GST_QUERY_LATENCY:
+      /* Like multiudpsink with sync=FALSE, we just report upstream latency */
+      return gst_pad_peer_query (self->priv->sinkpad, query);
+    default:
+      return gst_pad_query_default (pad, parent, query);
+  }
+}
+
+static GstStateChangeReturn
+fs_rawudp_batch_sink_change_state (GstElement *element,
+    GstStateChange transition)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (element);
+  GstStateChangeReturn ret;
+
+  ret = parent_class->change_state (element, transition);
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      FS_RAWUDP_BATCH_SINK_LOCK (self);
+      fs_rawudp_batch_sink_drop_pending_locked (self);
+      FS_RAWUDP_BATCH_SINK_UNLOCK (self);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
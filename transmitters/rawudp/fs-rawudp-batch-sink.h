@@ -0,0 +1,79 @@
+/*
+ * Farstream - Farstream RAW UDP batched sink
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-rawudp-batch-sink.h - A sink that sends UDP packets with sendmmsg()
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RAWUDP_BATCH_SINK_H__
+#define __FS_RAWUDP_BATCH_SINK_H__
+
+#include <gst/gst.h>
+#include <gio/gio.h>
+
+#include <farstream/fs-plugin.h>
+
+G_BEGIN_DECLS
+
+#define FS_TYPE_RAWUDP_BATCH_SINK \
+  (fs_rawudp_batch_sink_get_type ())
+#define FS_RAWUDP_BATCH_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_RAWUDP_BATCH_SINK, \
+      FsRawUdpBatchSink))
+#define FS_RAWUDP_BATCH_SINK_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_RAWUDP_BATCH_SINK, \
+      FsRawUdpBatchSinkClass))
+#define FS_IS_RAWUDP_BATCH_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_RAWUDP_BATCH_SINK))
+#define FS_IS_RAWUDP_BATCH_SINK_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_RAWUDP_BATCH_SINK))
+
+typedef struct _FsRawUdpBatchSink FsRawUdpBatchSink;
+typedef struct _FsRawUdpBatchSinkClass FsRawUdpBatchSinkClass;
+typedef struct _FsRawUdpBatchSinkPrivate FsRawUdpBatchSinkPrivate;
+
+/**
+ * FsRawUdpBatchSink:
+ *
+ * All members are private
+ */
+struct _FsRawUdpBatchSink
+{
+  GstElement parent;
+
+  /*< private >*/
+  FsRawUdpBatchSinkPrivate *priv;
+};
+
+struct _FsRawUdpBatchSinkClass
+{
+  GstElementClass parent_class;
+};
+
+GType fs_rawudp_batch_sink_register_type (FsPlugin *module);
+
+GType fs_rawudp_batch_sink_get_type (void);
+
+GstElement *fs_rawudp_batch_sink_new (GSocket *socket,
+    guint batch_size,
+    GstClockTime flush_timeout);
+
+G_END_DECLS
+
+#endif /* __FS_RAWUDP_BATCH_SINK_H__ */
@@ -0,0 +1,510 @@
+/*
+ * Farstream - Farstream RAW UDP batched source
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-rawudp-batch-src.c - A source that drains a UDP socket with recvmmsg()
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * This element replaces udpsrc for a UdpPort in batched mode. Every time
+ * the socket becomes readable, it drains up to batch-size datagrams with a
+ * single recvmmsg() call. The buffers are then pushed one by one, so the
+ * pad probes installed with fs_rawudp_transmitter_udpport_connect_recv()
+ * still see every packet.
+ */
+
+/* For recvmmsg() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rawudp-batch-src.h"
+#include "fs-rawudp-transmitter.h"
+
+#include <gst/net/gstnetaddressmeta.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#define GST_CAT_DEFAULT fs_rawudp_transmitter_debug
+
+/*
+ * Like udpsrc, each datagram is received in a buffer that fits most packets,
+ * which is pushed without any copy, and the rest of the bigger ones in an
+ * overflow area of the slot, which is copied into a second memory.
+ */
+#define PACKET_SIZE (4096)
+#define MAX_PACKET_SIZE (65535)
+#define OVERFLOW_SIZE (MAX_PACKET_SIZE - PACKET_SIZE)
+
+enum
+{
+  PROP_0,
+  PROP_LARGEST_BATCH
+};
+
+struct _FsRawUdpBatchSrcPrivate
+{
+  GstPad *srcpad;
+
+  /* Set at construction time */
+  GSocket *socket;
+  guint batch_size;
+  gboolean do_timestamp;
+
+  GCancellable *cancellable;
+
+  /* Only touched from the streaming thread */
+  gboolean need_segment;
+  struct mmsghdr *msgs;
+  struct iovec *iovecs;
+  struct sockaddr_storage *addrs;
+  GstBuffer **buffers;
+  GstMapInfo *maps;
+  guint8 *overflow;
+
+  /* Atomic */
+  guint largest_batch;
+};
+
+static GstStaticPadTemplate fs_rawudp_batch_src_template =
+    GST_STATIC_PAD_TEMPLATE ("src",
+        GST_PAD_SRC,
+        GST_PAD_ALWAYS,
+        GST_STATIC_CAPS_ANY);
+
+static GstElementClass *parent_class = NULL;
+
+static GType type = 0;
+
+static void fs_rawudp_batch_src_class_init (FsRawUdpBatchSrcClass *klass);
+static void fs_rawudp_batch_src_init (FsRawUdpBatchSrc *self);
+static void fs_rawudp_batch_src_finalize (GObject *object);
+static void fs_rawudp_batch_src_get_property (GObject *object, guint prop_id,
+    GValue *value, GParamSpec *pspec);
+static GstStateChangeReturn fs_rawudp_batch_src_change_state (
+    GstElement *element, GstStateChange transition);
+
+static void fs_rawudp_batch_src_loop (gpointer user_data);
+
+GType
+fs_rawudp_batch_src_get_type (void)
+{
+  return type;
+}
+
+GType
+fs_rawudp_batch_src_register_type (FsPlugin *module G_GNUC_UNUSED)
+{
+  static const GTypeInfo info = {
+    sizeof (FsRawUdpBatchSrcClass),
+    NULL,
+    NULL,
+    (GClassInitFunc) fs_rawudp_batch_src_class_init,
+    NULL,
+    NULL,
+    sizeof (FsRawUdpBatchSrc),
+    0,
+    (GInstanceInitFunc) fs_rawudp_batch_src_init
+  };
+
+  type = g_type_register_static (GST_TYPE_ELEMENT, "FsRawUdpBatchSrc",
+      &info, 0);
+
+  return type;
+}
+
+static void
+fs_rawudp_batch_src_class_init (FsRawUdpBatchSrcClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  parent_class = g_type_class_peek_parent (klass);
+
+  gobject_class->finalize = fs_rawudp_batch_src_finalize;
+  gobject_class->get_property = fs_rawudp_batch_src_get_property;
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Farstream batched UDP source",
+      "Source/Network",
+      "Receives UDP packets in batches with recvmmsg()",
+      "agent <agent@local>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rawudp_batch_src_template));
+
+  gstelement_class->change_state = fs_rawudp_batch_src_change_state;
+
+  g_object_class_install_property (gobject_class,
+      PROP_LARGEST_BATCH,
+      g_param_spec_uint ("largest-batch",
+          "Largest batch",
+          "The largest number of packets received with one system call",
+          0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_type_class_add_private (klass, sizeof (FsRawUdpBatchSrcPrivate));
+}
+
+static void
+fs_rawudp_batch_src_init (FsRawUdpBatchSrc *self)
+{
+  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, FS_TYPE_RAWUDP_BATCH_SRC,
+      FsRawUdpBatchSrcPrivate);
+
+  self->priv->cancellable = g_cancellable_new ();
+
+  self->priv->srcpad = gst_pad_new_from_static_template (
+      &fs_rawudp_batch_src_template, "src");
+  gst_pad_use_fixed_caps (self->priv->srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->priv->srcpad);
+
+  GST_OBJECT_FLAG_SET (self, GST_ELEMENT_FLAG_SOURCE);
+}
+
+static void
+fs_rawudp_batch_src_free_slots (FsRawUdpBatchSrc *self)
+{
+  guint i;
+
+  if (self->priv->buffers)
+  {
+    for (i = 0; i < self->priv->batch_size; i++)
+    {
+      if (self->priv->buffers[i])
+      {
+        gst_buffer_unmap (self->priv->buffers[i], &self->priv->maps[i]);
+        gst_buffer_unref (self->priv->buffers[i]);
+        self->priv->buffers[i] = NULL;
+      }
+    }
+  }
+}
+
+static void
+fs_rawudp_batch_src_finalize (GObject *object)
+{
+  FsRawUdpBatchSrc *self = FS_RAWUDP_BATCH_SRC (object);
+
+  fs_rawudp_batch_src_free_slots (self);
+
+  g_free (self->priv->msgs);
+  g_free (self->priv->iovecs);
+  g_free (self->priv->addrs);
+  g_free (self->priv->buffers);
+  g_free (self->priv->maps);
+  g_free (self->priv->overflow);
+
+  g_clear_object (&self->priv->socket);
+  g_clear_object (&self->priv->cancellable);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+fs_rawudp_batch_src_get_property (GObject *object, guint prop_id,
+    GValue *value, GParamSpec *pspec)
+{
+  FsRawUdpBatchSrc *self = FS_RAWUDP_BATCH_SRC (object);
+
+  switch (prop_id)
+  {
+    case PROP_LARGEST_BATCH:
+      g_value_set_uint (value,
+          g_atomic_int_get (&self->priv->largest_batch));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/**
+ * fs_rawudp_batch_src_new:
+ * @socket: The bound #GSocket to read from, the caller keeps ownership of the
+ *   file descriptor
+ * @batch_size: The maximum number of datagrams read per system call
+ * @do_timestamp: Whether to timestamp the buffers with the running time
+ *
+ * Creates a source element that reads from @socket with recvmmsg().
+ *
+ * Returns: a new #GstElement
+ */
+
+GstElement *
+fs_rawudp_batch_src_new (GSocket *socket, guint batch_size,
+    gboolean do_timestamp)
+{
+  FsRawUdpBatchSrc *self;
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), NULL);
+  g_return_val_if_fail (batch_size > 0, NULL);
+
+  self = g_object_new (FS_TYPE_RAWUDP_BATCH_SRC, NULL);
+
+  self->priv->socket = g_object_ref (socket);
+  self->priv->batch_size = batch_size;
+  self->priv->do_timestamp = do_timestamp;
+
+  self->priv->msgs = g_new0 (struct mmsghdr, batch_size);
+  self->priv->iovecs = g_new0 (struct iovec, 2 * batch_size);
+  self->priv->overflow = g_malloc (batch_size * OVERFLOW_SIZE);
+  self->priv->addrs = g_new0 (struct sockaddr_storage, batch_size);
+  self->priv->buffers = g_new0 (GstBuffer *, batch_size);
+  self->priv->maps = g_new0 (GstMapInfo, batch_size);
+
+  return GST_ELEMENT (self);
+}
+
+static void
+fs_rawudp_batch_src_prepare_slots (FsRawUdpBatchSrc *self)
+{
+  guint i;
+
+  for (i = 0; i < self->priv->batch_size; i++)
+  {
+    struct msghdr *hdr = &self->priv->msgs[i].msg_hdr;
+    struct iovec *iov = &self->priv->iovecs[2 * i];
+
+    if (!self->priv->buffers[i])
+    {
+      self->priv->buffers[i] = gst_buffer_new_allocate (NULL, PACKET_SIZE,
+          NULL);
+      gst_buffer_map (self->priv->buffers[i], &self->priv->maps[i],
+          GST_MAP_WRITE);
+    }
+
+    iov[0].iov_base = self->priv->maps[i].data;
+    iov[0].iov_len = self->priv->maps[i].size;
+    iov[1].iov_base = self->priv->overflow + i * OVERFLOW_SIZE;
+    iov[1].iov_len = OVERFLOW_SIZE;
+
+    memset (hdr, 0, sizeof (struct msghdr));
+    hdr->msg_name = &self->priv->addrs[i];
+    hdr->msg_namelen = sizeof (struct sockaddr_storage);
+    hdr->msg_iov = iov;
+    hdr->msg_iovlen = 2;
+    self->priv->msgs[i].msg_len = 0;
+  }
+}
+
+static GstClockTime
+fs_rawudp_batch_src_get_running_time (FsRawUdpBatchSrc *self)
+{
+  GstClock *clock;
+  GstClockTime now = GST_CLOCK_TIME_NONE;
+
+  if (!self->priv->do_timestamp)
+    return GST_CLOCK_TIME_NONE;
+
+  GST_OBJECT_LOCK (self);
+  clock = GST_ELEMENT_CLOCK (self);
+  if (clock)
+  {
+    GstClockTime base_time = GST_ELEMENT_CAST (self)->base_time;
+
+    gst_object_ref (clock);
+    GST_OBJECT_UNLOCK (self);
+    now = gst_clock_get_time (clock);
+    gst_object_unref (clock);
+
+    if (now >= base_time)
+      now -= base_time;
+    else
+      now = 0;
+  }
+  else
+  {
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  return now;
+}
+
+static void
+fs_rawudp_batch_src_push_segment (FsRawUdpBatchSrc *self)
+{
+  GstSegment segment;
+  gchar *stream_id;
+
+  stream_id = gst_pad_create_stream_id (self->priv->srcpad,
+      GST_ELEMENT (self), NULL);
+  gst_pad_push_event (self->priv->srcpad,
+      gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (self->priv->srcpad, gst_event_new_segment (&segment));
+
+  self->priv->need_segment = FALSE;
+}
+
+static void
+fs_rawudp_batch_src_loop (gpointer user_data)
+{
+  FsRawUdpBatchSrc *self = FS_RAWUDP_BATCH_SRC (user_data);
+  GError *error = NULL;
+  GstClockTime timestamp;
+  int n, i;
+
+  if (self->priv->need_segment)
+    fs_rawudp_batch_src_push_segment (self);
+
+  if (!g_socket_condition_wait (self->priv->socket, G_IO_IN,
+          self->priv->cancellable, &error))
+  {
+    if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      GST_WARNING_OBJECT (self, "Error waiting on the socket: %s",
+          error->message);
+    g_clear_error (&error);
+    gst_pad_pause_task (self->priv->srcpad);
+    return;
+  }
+
+  fs_rawudp_batch_src_prepare_slots (self);
+
+  do {
+    n = recvmmsg (g_socket_get_fd (self->priv->socket), self->priv->msgs,
+        self->priv->batch_size, MSG_DONTWAIT, NULL);
+  } while (n < 0 && errno == EINTR);
+
+  if (n < 0)
+  {
+    /* ICMP errors from previous sends are reported here, ignore them */
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNREFUSED)
+      GST_WARNING_OBJECT (self, "recvmmsg failed: %s", g_strerror (errno));
+    return;
+  }
+
+  GST_LOG_OBJECT (self, "Received %d packets in one batch", n);
+
+  if (n > g_atomic_int_get (&self->priv->largest_batch))
+    g_atomic_int_set (&self->priv->largest_batch, n);
+
+  timestamp = fs_rawudp_batch_src_get_running_time (self);
+
+  for (i = 0; i < n; i++)
+  {
+    struct msghdr *hdr = &self->priv->msgs[i].msg_hdr;
+    GstBuffer *buffer;
+    GSocketAddress *addr;
+    GstFlowReturn ret;
+
+    if (hdr->msg_flags & MSG_TRUNC)
+    {
+      GST_WARNING_OBJECT (self, "Dropping packet bigger than %d bytes",
+          MAX_PACKET_SIZE);
+      continue;
+    }
+
+    buffer = self->priv->buffers[i];
+    gst_buffer_unmap (buffer, &self->priv->maps[i]);
+    self->priv->buffers[i] = NULL;
+
+    if (self->priv->msgs[i].msg_len > PACKET_SIZE)
+    {
+      gsize extra = self->priv->msgs[i].msg_len - PACKET_SIZE;
+      gpointer data = g_memdup (self->priv->overflow + i * OVERFLOW_SIZE,
+          extra);
+
+      gst_buffer_append_memory (buffer,
+          gst_memory_new_wrapped (0, data, extra, 0, extra, data, g_free));
+    }
+    else
+    {
+      gst_buffer_set_size (buffer, self->priv->msgs[i].msg_len);
+    }
+    GST_BUFFER_PTS (buffer) = timestamp;
+    GST_BUFFER_DTS (buffer) = timestamp;
+
+    addr = g_socket_address_new_from_native (hdr->msg_name,
+        hdr->msg_namelen);
+    if (addr)
+    {
+      gst_buffer_add_net_address_meta (buffer, addr);
+      g_object_unref (addr);
+    }
+
+    ret = gst_pad_push (self->priv->srcpad, buffer);
+
+    if (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED)
+    {
+      GST_DEBUG_OBJECT (self, "Pausing task, reason %s",
+          gst_flow_get_name (ret));
+      gst_pad_pause_task (self->priv->srcpad);
+      return;
+    }
+  }
+}
+
+static GstStateChangeReturn
+fs_rawudp_batch_src_change_state (GstElement *element,
+    GstStateChange transition)
+{
+  FsRawUdpBatchSrc *self = FS_RAWUDP_BATCH_SRC (element);
+  GstStateChangeReturn ret;
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      self->priv->need_segment = TRUE;
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+      g_cancellable_reset (self->priv->cancellable);
+      gst_pad_start_task (self->priv->srcpad, fs_rawudp_batch_src_loop, self,
+          NULL);
+      break;
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+      g_cancellable_cancel (self->priv->cancellable);
+      gst_pad_pause_task (self->priv->srcpad);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      g_cancellable_cancel (self->priv->cancellable);
+      gst_pad_stop_task (self->priv->srcpad);
+      break;
+    default:
+      break;
+  }
+
+  ret = parent_class->change_state (element, transition);
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+      /* We are a live source */
+      if (ret != GST_STATE_CHANGE_FAILURE)
+        ret = GST_STATE_CHANGE_NO_PREROLL;
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      fs_rawudp_batch_src_free_slots (self);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
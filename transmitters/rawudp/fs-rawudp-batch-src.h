@@ -0,0 +1,79 @@
+/*
+ * Farstream - Farstream RAW UDP batched source
+ *
+ * Copyright 2026 agent
+ *  @author: agent <agent@local>
+ *
+ * fs-rawudp-batch-src.h - A source that drains a UDP socket with recvmmsg()
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RAWUDP_BATCH_SRC_H__
+#define __FS_RAWUDP_BATCH_SRC_H__
+
+#include <gst/gst.h>
+#include <gio/gio.h>
+
+#include <farstream/fs-plugin.h>
+
+G_BEGIN_DECLS
+
+#define FS_TYPE_RAWUDP_BATCH_SRC \
+  (fs_rawudp_batch_src_get_type ())
+#define FS_RAWUDP_BATCH_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_RAWUDP_BATCH_SRC, \
+      FsRawUdpBatchSrc))
+#define FS_RAWUDP_BATCH_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_RAWUDP_BATCH_SRC, \
+      FsRawUdpBatchSrcClass))
+#define FS_IS_RAWUDP_BATCH_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_RAWUDP_BATCH_SRC))
+#define FS_IS_RAWUDP_BATCH_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_RAWUDP_BATCH_SRC))
+
+typedef struct _FsRawUdpBatchSrc FsRawUdpBatchSrc;
+typedef struct _FsRawUdpBatchSrcClass FsRawUdpBatchSrcClass;
+typedef struct _FsRawUdpBatchSrcPrivate FsRawUdpBatchSrcPrivate;
+
+/**
+ * FsRawUdpBatchSrc:
+ *
+ * All members are private
+ */
+struct _FsRawUdpBatchSrc
+{
+  GstElement parent;
+
+  /*< private >*/
+  FsRawUdpBatchSrcPrivate *priv;
+};
+
+struct _FsRawUdpBatchSrcClass
+{
+  GstElementClass parent_class;
+};
+
+GType fs_rawudp_batch_src_register_type (FsPlugin *module);
+
+GType fs_rawudp_batch_src_get_type (void);
+
+GstElement *fs_rawudp_batch_src_new (GSocket *socket,
+    guint batch_size,
+    gboolean do_timestamp);
+
+G_END_DECLS
+
+#endif /* __FS_RAWUDP_BATCH_SRC_H__ */
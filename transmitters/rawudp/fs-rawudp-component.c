@@ -36,6 +36,7 @@
 #include <nice/interfaces.h>
 
 #include <farstream/fs-conference.h>
+#include <farstream/fs-timer.h>
 
 #include <gst/net/gstnetaddressmeta.h>
 
@@ -57,13 +58,21 @@
 #define DEFAULT_UPNP_MAPPING_TIMEOUT (600)
 #define DEFAULT_UPNP_DISCOVERY_TIMEOUT (2)
 
+/* Once a SSRC from the known source has been reported, only one packet out
+ * of this many is reported again, the others are just counted */
+#define KNOWN_SOURCE_REPORT_INTERVAL (256)
+
+/* How many SSRCs from the known source are remembered as already reported,
+ * so interleaved ones (simulcast, audio and video on one component) are
+ * not all reported, the oldest one is forgotten first */
+#define KNOWN_SOURCE_MAX_SSRCS (8)
+
 /* Signals */
 enum
 {
   NEW_LOCAL_CANDIDATE,
   LOCAL_CANDIDATES_PREPARED,
   NEW_ACTIVE_CANDIDATE_PAIR,
-  KNOWN_SOURCE_PACKET_RECEIVED,
   ERROR_SIGNAL,
   LAST_SIGNAL
 };
@@ -82,6 +91,9 @@ enum
   PROP_TRANSMITTER,
   PROP_FORCED_CANDIDATE,
   PROP_ASSOCIATE_ON_SOURCE,
+  PROP_BATCH_SIZE,
+  PROP_BATCH_FLUSH_TIMEOUT,
+  PROP_SOCKET_REACTOR,
 #ifdef HAVE_GUPNP
   PROP_UPNP_MAPPING,
   PROP_UPNP_DISCOVERY,
@@ -119,6 +131,10 @@ struct _FsRawUdpComponentPrivate
 
   gboolean associate_on_source;
 
+  guint batch_size;
+  guint batch_flush_timeout;
+  gboolean socket_reactor;
+
 #ifdef HAVE_GUPNP
   gboolean upnp_discovery;
   gboolean upnp_mapping;
@@ -145,13 +161,39 @@ struct _FsRawUdpComponentPrivate
 
   gulong buffer_recv_id;
 
-  GstClockID stun_timeout_id;
-  GThread *stun_timeout_thread;
-  gboolean stun_stop;
+  /* The STUN retransmissions and timeout are driven by this shared timer,
+   * stun_running is TRUE from the first request until the process is
+   * finished or stopped */
+  FsTimer *stun_timeout_timer;
+  gboolean stun_running;
+  StunTimer stun_timer;
+  guint stun_timeout_accum_ms;
+  guint stun_timeout_remainder;
 
   gboolean sending;
 
-  gboolean remote_is_unique;
+  /* Copy of the remote address for the receive probe, which reads it
+   * without the mutex. It is written with the mutex held and the sequence
+   * number is odd while a write is in progress, readers retry until they
+   * get a consistent copy. remote_addr_len is 0 if there is no remote
+   * address or if it is shared with another stream on the same port. */
+  volatile gint remote_seq;
+  guint16 remote_port;
+  guint8 remote_addr[16];
+  gsize remote_addr_len;
+
+  /* Set before the remote candidate, then read-only */
+  FsRawUdpKnownSourceFunc known_source_func;
+  gpointer known_source_data;
+
+  /* Only touched from the receive probe */
+  gint known_source_seq;
+  guint32 known_source_ssrcs[KNOWN_SOURCE_MAX_SSRCS];
+  guint known_source_n_ssrcs;
+  guint known_source_next_ssrc;
+
+  /* Incremented atomically from the receive probe, wraps around */
+  volatile gint known_source_packets;
 
 #ifdef HAVE_GUPNP
   GSource *upnp_discovery_timeout_src;
@@ -209,7 +251,7 @@ fs_rawudp_component_emit_candidate (FsRawUdpComponent *self,
 
 static GstPadProbeReturn
 stun_recv_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
-static gpointer
+static void
 stun_timeout_func (gpointer user_data);
 static GstPadProbeReturn
 buffer_recv_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
@@ -217,6 +259,9 @@ buffer_recv_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
 static void
 remote_is_unique_cb (gboolean unique, GSocketAddress *address,
     gpointer user_data);
+static void
+fs_rawudp_component_update_remote_snapshot_locked (FsRawUdpComponent *self,
+    gboolean unique);
 
 static gboolean
 fs_rawudp_component_start_stun (FsRawUdpComponent *self, GError **error);
@@ -354,6 +399,33 @@ fs_rawudp_component_class_init (FsRawUdpComponentClass *klass)
           TRUE,
           G_PARAM_CONSTRUCT_ONLY | G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class,
+      PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size",
+          "Packets per system call",
+          "The maximum number of packets received or sent with one system"
+          " call, 1 disables batching",
+          1, MAX_BATCH_SIZE, 1,
+          G_PARAM_CONSTRUCT_ONLY | G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_BATCH_FLUSH_TIMEOUT,
+      g_param_spec_uint ("batch-flush-timeout",
+          "Maximum time a packet is held for batching",
+          "The maximum time an outgoing packet waits for the batch to fill"
+          " (in microseconds)",
+          0, MAX_BATCH_FLUSH_TIMEOUT, DEFAULT_BATCH_FLUSH_TIMEOUT,
+          G_PARAM_CONSTRUCT_ONLY | G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SOCKET_REACTOR,
+      g_param_spec_boolean ("socket-reactor",
+          "Use the shared socket reactor",
+          "Whether to receive from the shared pool of epoll threads instead"
+          " of a dedicated thread per port",
+          FALSE,
+          G_PARAM_CONSTRUCT_ONLY | G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+
 #ifdef HAVE_GUPNP
     g_object_class_install_property (gobject_class,
       PROP_UPNP_MAPPING,
@@ -449,23 +521,6 @@ fs_rawudp_component_class_init (FsRawUdpComponentClass *klass)
         0, NULL, NULL, NULL,
         G_TYPE_NONE, 2, FS_TYPE_CANDIDATE, FS_TYPE_CANDIDATE);
 
- /**
-   * FsRawUdpComponent::known-source-packet-received:
-   * @self: #FsRawUdpComponent that emitted the signal
-   * @component: The ID of this component
-   * @buffer: the #GstBuffer coming from the known source
-   *
-   * This signal is emitted when a buffer coming from a confirmed known source
-   * is received.
-   *
-   */
-  signals[KNOWN_SOURCE_PACKET_RECEIVED] = g_signal_new
-    ("known-source-packet-received",
-      G_TYPE_FROM_CLASS (klass),
-      G_SIGNAL_RUN_LAST,
-      0, NULL, NULL, NULL,
-      G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_POINTER);
-
   /**
    * FsRawUdpComponent::error:
    * @self: #FsStreamTransmitter that emitted the signal
@@ -507,6 +562,11 @@ fs_rawudp_component_init (FsRawUdpComponent *self)
 
   self->priv->associate_on_source = TRUE;
 
+  self->priv->known_source_seq = -1;
+
+  self->priv->batch_size = 1;
+  self->priv->batch_flush_timeout = DEFAULT_BATCH_FLUSH_TIMEOUT;
+
   stun_agent_init (&self->priv->stun_agent,
       STUN_ALL_KNOWN_ATTRIBUTES, STUN_COMPATIBILITY_RFC3489, 0);
 
@@ -538,6 +598,9 @@ fs_rawudp_constructed (GObject *object)
         self->priv->component,
         self->priv->ip,
         self->priv->port,
+        self->priv->batch_size,
+        self->priv->batch_flush_timeout * GST_USECOND,
+        self->priv->socket_reactor,
         &self->priv->construction_error);
   if (!self->priv->udpport)
   {
@@ -601,14 +664,13 @@ fs_rawudp_component_stop (FsRawUdpComponent *self)
   UdpPort *udpport = NULL;
 
   FS_RAWUDP_COMPONENT_LOCK (self);
-  if (self->priv->stun_timeout_thread != NULL)
+  if (self->priv->stun_timeout_timer != NULL)
   {
     fs_rawudp_component_stop_stun_locked (self);
     FS_RAWUDP_COMPONENT_UNLOCK (self);
-    g_thread_join (self->priv->stun_timeout_thread);
+    /* Wait for a callback that may be running */
+    _fs_timer_cancel (self->priv->stun_timeout_timer);
     FS_RAWUDP_COMPONENT_LOCK (self);
-
-    self->priv->stun_timeout_thread = NULL;
   }
 
   udpport = self->priv->udpport;
@@ -645,6 +707,7 @@ fs_rawudp_component_stop (FsRawUdpComponent *self)
 
       fs_rawudp_transmitter_udpport_remove_known_address (udpport,
           self->priv->remote_address, remote_is_unique_cb, self);
+      fs_rawudp_component_update_remote_snapshot_locked (self, FALSE);
     }
 
     FS_RAWUDP_COMPONENT_UNLOCK (self);
@@ -674,6 +737,9 @@ fs_rawudp_component_finalize (GObject *object)
   g_free (self->priv->ip);
   g_free (self->priv->stun_ip);
 
+  if (self->priv->stun_timeout_timer)
+    _fs_timer_free (self->priv->stun_timeout_timer);
+
   g_mutex_clear (&self->priv->mutex);
 
   parent_class->finalize (object);
@@ -799,6 +865,15 @@ fs_rawudp_component_set_property (GObject *object,
     case PROP_ASSOCIATE_ON_SOURCE:
       self->priv->associate_on_source = g_value_get_boolean (value);
       break;
+    case PROP_BATCH_SIZE:
+      self->priv->batch_size = g_value_get_uint (value);
+      break;
+    case PROP_BATCH_FLUSH_TIMEOUT:
+      self->priv->batch_flush_timeout = g_value_get_uint (value);
+      break;
+    case PROP_SOCKET_REACTOR:
+      self->priv->socket_reactor = g_value_get_boolean (value);
+      break;
 #ifdef HAVE_GUPNP
     case PROP_UPNP_MAPPING:
       self->priv->upnp_mapping = g_value_get_boolean (value);
@@ -838,6 +913,9 @@ fs_rawudp_component_new (
     guint upnp_mapping_timeout,
     guint upnp_discovery_timeout,
     gpointer upnp_igd,
+    guint batch_size,
+    guint batch_flush_timeout,
+    gboolean socket_reactor,
     guint *used_port,
     GError **error)
 {
@@ -852,6 +930,9 @@ fs_rawudp_component_new (
       "stun-ip", stun_ip,
       "stun-port", stun_port,
       "stun-timeout", stun_timeout,
+      "batch-size", batch_size,
+      "batch-flush-timeout", batch_flush_timeout,
+      "socket-reactor", socket_reactor,
 #ifdef HAVE_GUPNP
       "upnp-mapping", upnp_mapping,
       "upnp-discovery", upnp_discovery,
@@ -881,6 +962,31 @@ fs_rawudp_component_new (
   return self;
 }
 
+static void
+fs_rawudp_component_update_remote_snapshot_locked (FsRawUdpComponent *self,
+    gboolean unique)
+{
+  g_atomic_int_inc (&self->priv->remote_seq);
+
+  if (unique && self->priv->remote_address)
+  {
+    GInetSocketAddress *inet = G_INET_SOCKET_ADDRESS (
+        self->priv->remote_address);
+    GInetAddress *addr = g_inet_socket_address_get_address (inet);
+
+    self->priv->remote_port = g_inet_socket_address_get_port (inet);
+    self->priv->remote_addr_len = g_inet_address_get_native_size (addr);
+    memcpy (self->priv->remote_addr, g_inet_address_to_bytes (addr),
+        self->priv->remote_addr_len);
+  }
+  else
+  {
+    self->priv->remote_addr_len = 0;
+  }
+
+  g_atomic_int_inc (&self->priv->remote_seq);
+}
+
 static void
 remote_is_unique_cb (gboolean unique, GSocketAddress *address,
     gpointer user_data)
@@ -895,7 +1001,10 @@ remote_is_unique_cb (gboolean unique, GSocketAddress *address,
     goto out;
   }
 
-  self->priv->remote_is_unique = unique;
+  GST_DEBUG ("Remote address of component %u is %s unique",
+      self->priv->component, unique ? "now" : "no longer");
+
+  fs_rawudp_component_update_remote_snapshot_locked (self, unique);
 
  out:
   FS_RAWUDP_COMPONENT_UNLOCK (self);
@@ -953,9 +1062,9 @@ fs_rawudp_component_set_remote_candidate (FsRawUdpComponent *self,
       candidate->port);
   g_object_unref (addr);
 
-  self->priv->remote_is_unique =
-    fs_rawudp_transmitter_udpport_add_known_address (self->priv->udpport,
-        self->priv->remote_address, remote_is_unique_cb, self);
+  fs_rawudp_component_update_remote_snapshot_locked (self,
+      fs_rawudp_transmitter_udpport_add_known_address (self->priv->udpport,
+          self->priv->remote_address, remote_is_unique_cb, self));
 
   FS_RAWUDP_COMPONENT_UNLOCK (self);
 
@@ -989,8 +1098,7 @@ fs_rawudp_component_maybe_emit_local_candidates (FsRawUdpComponent *self)
     return;
   }
 
-  if (self->priv->stun_timeout_thread &&
-      self->priv->stun_timeout_thread != g_thread_self ())
+  if (self->priv->stun_running)
   {
     FS_RAWUDP_COMPONENT_UNLOCK (self);
     return;
@@ -1250,7 +1358,6 @@ static gboolean
 fs_rawudp_component_start_stun (FsRawUdpComponent *self, GError **error)
 {
   NiceAddress niceaddr;
-  gboolean res = TRUE;
 
   GST_DEBUG ("C:%d starting the STUN process with server %s:%u",
       self->priv->component, self->priv->stun_ip, self->priv->stun_port);
@@ -1280,9 +1387,9 @@ fs_rawudp_component_start_stun (FsRawUdpComponent *self, GError **error)
       sizeof(self->priv->stun_buffer));
 
 
-  /* only create a new thread if the old one was stopped. Otherwise we can
-   * just reuse the currently running one. */
-  if (self->priv->stun_timeout_thread == NULL)
+  /* only start the timer if the previous process was stopped. Otherwise
+   * the running one will retransmit the new request. */
+  if (!self->priv->stun_running)
   {
     if (!fs_rawudp_component_send_stun_locked (self, error))
     {
@@ -1290,17 +1397,27 @@ fs_rawudp_component_start_stun (FsRawUdpComponent *self, GError **error)
       return FALSE;
     }
 
-    self->priv->stun_timeout_thread = g_thread_try_new ("stun timeout thread",
-        stun_timeout_func, self, error);
-  }
+    if (self->priv->stun_timeout_timer == NULL)
+      self->priv->stun_timeout_timer = _fs_timer_new (stun_timeout_func, self);
+
+    self->priv->stun_running = TRUE;
+    self->priv->stun_server_changed = FALSE;
+    self->priv->stun_timeout_accum_ms = 0;
+    stun_timer_start (&self->priv->stun_timer, STUN_TIMER_DEFAULT_TIMEOUT,
+        STUN_TIMER_DEFAULT_MAX_RETRANSMISSIONS);
+    self->priv->stun_timeout_remainder =
+      stun_timer_remainder (&self->priv->stun_timer);
 
-  res = (self->priv->stun_timeout_thread != NULL);
+    GST_LOG ("C:%u Waiting for STUN reply for %u ms",
+        self->priv->component, self->priv->stun_timeout_remainder);
 
-  g_assert (error == NULL || res || *error);
+    _fs_timer_schedule (self->priv->stun_timeout_timer,
+        self->priv->stun_timeout_remainder * GST_MSECOND);
+  }
 
   FS_RAWUDP_COMPONENT_UNLOCK (self);
 
-  return res;
+  return TRUE;
 }
 
 /*
@@ -1318,9 +1435,18 @@ fs_rawudp_component_stop_stun_locked (FsRawUdpComponent *self)
     self->priv->stun_recv_id = 0;
   }
 
-  self->priv->stun_stop = TRUE;
-  if (self->priv->stun_timeout_id)
-    gst_clock_id_unschedule (self->priv->stun_timeout_id);
+  if (self->priv->stun_running)
+  {
+    StunTransactionId stunid;
+
+    stun_message_id (&self->priv->stun_message, stunid);
+    stun_agent_forget_transaction (&self->priv->stun_agent, stunid);
+    self->priv->stun_running = FALSE;
+  }
+
+  /* Never waits, a running callback will see that stun_running is FALSE */
+  if (self->priv->stun_timeout_timer)
+    _fs_timer_unschedule (self->priv->stun_timeout_timer);
 }
 
 
@@ -1394,8 +1520,8 @@ stun_recv_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
       nice_address_to_string (&niceaddr, addr_str);
       GST_DEBUG ("Stun server redirected us to alternate server %s:%d",
           addr_str, nice_address_get_port (&niceaddr));
-      if (self->priv->stun_timeout_id)
-        gst_clock_id_unschedule (self->priv->stun_timeout_id);
+      if (self->priv->stun_running)
+        _fs_timer_schedule (self->priv->stun_timeout_timer, 0);
       FS_RAWUDP_COMPONENT_UNLOCK(self);
       return FALSE;
     default:
@@ -1446,104 +1572,65 @@ passthrough:
   return GST_PAD_PROBE_OK;
 }
 
-static gpointer
+static void
 stun_timeout_func (gpointer user_data)
 {
   FsRawUdpComponent *self = FS_RAWUDP_COMPONENT (user_data);
-  GstClock *sysclock = NULL;
-  GstClockID id;
-  gboolean emit = TRUE;
-  GstClockTime next_stun_timeout;
   GError *error = NULL;
-  guint timeout_accum_ms = 0;
-  guint remainder;
-  StunUsageTimerReturn timer_ret = STUN_USAGE_TIMER_RETURN_SUCCESS;
-  StunTransactionId stunid;
-  StunTimer stun_timer;
+  StunUsageTimerReturn timer_ret;
 
-  sysclock = gst_system_clock_obtain ();
-  if (sysclock == NULL)
+  FS_RAWUDP_COMPONENT_LOCK(self);
+
+  if (!self->priv->stun_running)
   {
-    fs_rawudp_component_emit_error (self, FS_ERROR_INTERNAL,
-        "Could not obtain gst system clock");
-    FS_RAWUDP_COMPONENT_LOCK(self);
-    goto interrupt;
+    GST_DEBUG ("C:%u STUN process interrupted", self->priv->component);
+    FS_RAWUDP_COMPONENT_UNLOCK(self);
+    return;
   }
 
-  FS_RAWUDP_COMPONENT_LOCK(self);
-  stun_timer_start (&stun_timer, STUN_TIMER_DEFAULT_TIMEOUT,
-      STUN_TIMER_DEFAULT_MAX_RETRANSMISSIONS);
-
-  while (!self->priv->stun_stop &&
-      timeout_accum_ms < self->priv->stun_timeout * 1000)
+  if (self->priv->stun_server_changed)
   {
-    if (self->priv->stun_server_changed)
-    {
-      stun_timer_start (&stun_timer, STUN_TIMER_DEFAULT_TIMEOUT,
-          STUN_TIMER_DEFAULT_MAX_RETRANSMISSIONS);
-      self->priv->stun_server_changed = FALSE;
-      timer_ret = STUN_USAGE_TIMER_RETURN_RETRANSMIT;
-    }
+    stun_timer_start (&self->priv->stun_timer, STUN_TIMER_DEFAULT_TIMEOUT,
+        STUN_TIMER_DEFAULT_MAX_RETRANSMISSIONS);
+    self->priv->stun_server_changed = FALSE;
+    timer_ret = STUN_USAGE_TIMER_RETURN_RETRANSMIT;
+  }
+  else
+  {
+    timer_ret = stun_timer_refresh (&self->priv->stun_timer);
+    self->priv->stun_timeout_accum_ms += self->priv->stun_timeout_remainder;
 
-    if (timer_ret == STUN_USAGE_TIMER_RETURN_RETRANSMIT &&
-        !fs_rawudp_component_send_stun_locked (self, &error))
+    if (timer_ret == STUN_USAGE_TIMER_RETURN_TIMEOUT ||
+        self->priv->stun_timeout_accum_ms >= self->priv->stun_timeout * 1000)
     {
-      FS_RAWUDP_COMPONENT_UNLOCK(self);
-      fs_rawudp_component_emit_error (self, error->code, error->message);
-      g_clear_error (&error);
-      FS_RAWUDP_COMPONENT_LOCK (self);
       fs_rawudp_component_stop_stun_locked (self);
-      goto interrupt;
+      FS_RAWUDP_COMPONENT_UNLOCK(self);
+      fs_rawudp_component_maybe_emit_local_candidates (self);
+      return;
     }
-
-    if (self->priv->stun_stop)
-      goto interrupt;
-
-    remainder = stun_timer_remainder (&stun_timer);
-
-    next_stun_timeout = gst_clock_get_time (sysclock) +
-      remainder * GST_MSECOND;
-
-    id = self->priv->stun_timeout_id = gst_clock_new_single_shot_id (sysclock,
-        next_stun_timeout);
-
-    GST_LOG ("C:%u Waiting for STUN reply for %u ms, next: %u ms",
-        self->priv->component, remainder, timeout_accum_ms);
-
-    FS_RAWUDP_COMPONENT_UNLOCK(self);
-    gst_clock_id_wait (id, NULL);
-    FS_RAWUDP_COMPONENT_LOCK(self);
-
-    gst_clock_id_unref (id);
-    self->priv->stun_timeout_id = NULL;
-
-    timer_ret = stun_timer_refresh (&stun_timer);
-    timeout_accum_ms += remainder;
-
-    if (timer_ret == STUN_USAGE_TIMER_RETURN_TIMEOUT)
-      break;
   }
 
- interrupt:
-  if (self->priv->stun_stop)
+  if (timer_ret == STUN_USAGE_TIMER_RETURN_RETRANSMIT &&
+      !fs_rawudp_component_send_stun_locked (self, &error))
   {
-    GST_DEBUG ("C:%u STUN process interrupted", self->priv->component);
-    emit = FALSE;
+    fs_rawudp_component_stop_stun_locked (self);
+    FS_RAWUDP_COMPONENT_UNLOCK(self);
+    fs_rawudp_component_emit_error (self, error->code, error->message);
+    g_clear_error (&error);
+    return;
   }
 
-  fs_rawudp_component_stop_stun_locked (self);
+  self->priv->stun_timeout_remainder =
+    stun_timer_remainder (&self->priv->stun_timer);
 
-  stun_message_id (&self->priv->stun_message, stunid);
-  stun_agent_forget_transaction (&self->priv->stun_agent, stunid);
+  GST_LOG ("C:%u Waiting for STUN reply for %u ms, next: %u ms",
+      self->priv->component, self->priv->stun_timeout_remainder,
+      self->priv->stun_timeout_accum_ms);
 
-  FS_RAWUDP_COMPONENT_UNLOCK(self);
+  _fs_timer_schedule (self->priv->stun_timeout_timer,
+      self->priv->stun_timeout_remainder * GST_MSECOND);
 
-  gst_object_unref (sysclock);
-
-  if (emit)
-    fs_rawudp_component_maybe_emit_local_candidates (self);
-
-  return NULL;
+  FS_RAWUDP_COMPONENT_UNLOCK(self);
 }
 
 
@@ -1660,37 +1747,184 @@ fs_rawudp_component_emit_candidate (FsRawUdpComponent *self,
     fs_rawudp_component_maybe_new_active_candidate_pair (self);
 }
 
+static gboolean
+fs_rawudp_component_is_known_source (FsRawUdpComponent *self,
+    GSocketAddress *address, gint *seq)
+{
+  GInetSocketAddress *inet;
+  GInetAddress *addr;
+  const guint8 *bytes;
+  guint16 port;
+  gsize len;
+  gboolean known;
+  gint start;
+
+  if (!G_IS_INET_SOCKET_ADDRESS (address))
+    return FALSE;
+
+  inet = G_INET_SOCKET_ADDRESS (address);
+  addr = g_inet_socket_address_get_address (inet);
+  port = g_inet_socket_address_get_port (inet);
+  bytes = g_inet_address_to_bytes (addr);
+  len = g_inet_address_get_native_size (addr);
+
+  for (;;)
+  {
+    start = g_atomic_int_get (&self->priv->remote_seq);
+    if (start & 1)
+      continue;
+
+    known = (self->priv->remote_addr_len == len &&
+        self->priv->remote_port == port &&
+        !memcmp (self->priv->remote_addr, bytes, len));
+
+    if (g_atomic_int_get (&self->priv->remote_seq) == start)
+      break;
+  }
+
+  *seq = start;
+  return known;
+}
+
+/* Reads the SSRC of an RTP packet or of the first packet of an RTCP compound
+ * packet, they are told apart by the packet type like RFC 5761 does */
+static gboolean
+fs_rawudp_component_get_ssrc (GstBuffer *buffer, guint32 *ssrc)
+{
+  guint8 data[12];
+  gsize size;
+
+  size = gst_buffer_extract (buffer, 0, data, sizeof (data));
+
+  if (size < 8 || (data[0] >> 6) != 2)
+    return FALSE;
+
+  if (data[1] >= 192 && data[1] <= 223)
+  {
+    *ssrc = GST_READ_UINT32_BE (data + 4);
+  }
+  else
+  {
+    if (size < 12)
+      return FALSE;
+    *ssrc = GST_READ_UINT32_BE (data + 8);
+  }
+
+  return TRUE;
+}
+
 /*
- * This is a has "have-data" signal handler, so we return %TRUE to not
- * drop the buffer
+ * This is called for every packet received on the port, so it does not
+ * take the mutex. Packets from the known source are only reported when
+ * they carry a SSRC that is not among the last ones reported and then once
+ * every KNOWN_SOURCE_REPORT_INTERVAL packets, the others are only counted.
  */
+
+/* Returns TRUE if the SSRC was already reported, remembers it otherwise */
+
+static gboolean
+fs_rawudp_component_ssrc_was_reported (FsRawUdpComponent *self,
+    guint32 ssrc)
+{
+  guint i;
+
+  for (i = 0; i < self->priv->known_source_n_ssrcs; i++)
+    if (self->priv->known_source_ssrcs[i] == ssrc)
+      return TRUE;
+
+  if (self->priv->known_source_n_ssrcs < KNOWN_SOURCE_MAX_SSRCS)
+  {
+    self->priv->known_source_ssrcs[self->priv->known_source_n_ssrcs++] = ssrc;
+  }
+  else
+  {
+    self->priv->known_source_ssrcs[self->priv->known_source_next_ssrc] = ssrc;
+    self->priv->known_source_next_ssrc =
+        (self->priv->known_source_next_ssrc + 1) % KNOWN_SOURCE_MAX_SSRCS;
+  }
+
+  return FALSE;
+}
+
 static GstPadProbeReturn
 buffer_recv_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
 {
   FsRawUdpComponent *self = FS_RAWUDP_COMPONENT (user_data);
   GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
   GstNetAddressMeta *netmeta = gst_buffer_get_net_address_meta (buffer);
+  guint32 ssrc;
+  guint packets;
+  gint seq;
 
-  if (netmeta)
+  if (!netmeta)
   {
-    FS_RAWUDP_COMPONENT_LOCK (self);
-    if (self->priv->remote_is_unique &&
-        fs_g_inet_socket_address_equal (self->priv->remote_address,
-            netmeta->addr))
-    {
-      FS_RAWUDP_COMPONENT_UNLOCK (self);
-      g_signal_emit (self, signals[KNOWN_SOURCE_PACKET_RECEIVED], 0,
-          self->priv->component, buffer);
-    }
-    else
-    {
-      FS_RAWUDP_COMPONENT_UNLOCK (self);
-    }
+    GST_WARNING ("received buffer that does not contain a GstNetAddressMeta");
+    return GST_PAD_PROBE_OK;
   }
-  else
+
+  if (!fs_rawudp_component_is_known_source (self, netmeta->addr, &seq))
+    return GST_PAD_PROBE_OK;
+
+  /* The remote address changed, forget what we reported for the old one */
+  if (seq != self->priv->known_source_seq)
   {
-    GST_WARNING ("received buffer that does not contain a GstNetAddressMeta");
+    self->priv->known_source_seq = seq;
+    self->priv->known_source_n_ssrcs = 0;
+    self->priv->known_source_next_ssrc = 0;
   }
 
+  packets = g_atomic_int_add (&self->priv->known_source_packets, 1) + 1;
+
+  if (fs_rawudp_component_get_ssrc (buffer, &ssrc) &&
+      fs_rawudp_component_ssrc_was_reported (self, ssrc) &&
+      packets % KNOWN_SOURCE_REPORT_INTERVAL != 0)
+    return GST_PAD_PROBE_OK;
+
+  GST_LOG ("Reporting packet from known source on component %u"
+      " (%u packets so far)", self->priv->component, packets);
+
+  if (self->priv->known_source_func)
+    self->priv->known_source_func (self, self->priv->component, buffer,
+        self->priv->known_source_data);
+
   return GST_PAD_PROBE_OK;
 }
+
+/**
+ * fs_rawudp_component_set_known_source_func:
+ * @self: a #FsRawUdpComponent
+ * @func: the function to call
+ * @user_data: data passed to @func
+ *
+ * Sets the function called from the streaming thread when packets are
+ * received from the remote candidate. This must be called before the remote
+ * candidate is set.
+ */
+
+void
+fs_rawudp_component_set_known_source_func (FsRawUdpComponent *self,
+    FsRawUdpKnownSourceFunc func,
+    gpointer user_data)
+{
+  FS_RAWUDP_COMPONENT_LOCK (self);
+  self->priv->known_source_func = func;
+  self->priv->known_source_data = user_data;
+  FS_RAWUDP_COMPONENT_UNLOCK (self);
+}
+
+/**
+ * fs_rawudp_component_get_known_source_packets:
+ * @self: a #FsRawUdpComponent
+ *
+ * Gets the number of packets received from the remote candidate, including
+ * the ones that were not passed to the #FsRawUdpKnownSourceFunc. It wraps
+ * around at G_MAXUINT.
+ *
+ * Returns: the number of packets
+ */
+
+guint
+fs_rawudp_component_get_known_source_packets (FsRawUdpComponent *self)
+{
+  return g_atomic_int_get (&self->priv->known_source_packets);
+}
@@ -60,6 +60,26 @@ typedef struct _FsRawUdpComponentPrivate FsRawUdpComponentPrivate;
 #define MAX_STUN_TIMEOUT (60)
 #define DEFAULT_STUN_TIMEOUT (30)
 
+#define MAX_BATCH_SIZE (64)
+/* In microseconds */
+#define MAX_BATCH_FLUSH_TIMEOUT (100000)
+#define DEFAULT_BATCH_FLUSH_TIMEOUT (1000)
+
+
+/**
+ * FsRawUdpKnownSourceFunc:
+ * @component: the #FsRawUdpComponent
+ * @component_id: The ID of this component
+ * @buffer: the #GstBuffer coming from the known source
+ * @user_data: the data passed to fs_rawudp_component_set_known_source_func()
+ *
+ * Called from the streaming thread when a buffer coming from a confirmed
+ * known source is received.
+ */
+typedef void (*FsRawUdpKnownSourceFunc) (FsRawUdpComponent *component,
+    guint component_id,
+    GstBuffer *buffer,
+    gpointer user_data);
 
 /**
  * FsRawUdpComponentClass:
@@ -108,6 +128,9 @@ fs_rawudp_component_new (
     guint upnp_mapping_timeout,
     guint upnp_discovery_timeout,
     gpointer upnp_igd,
+    guint batch_size,
+    guint batch_flush_timeout,
+    gboolean socket_reactor,
     guint *used_port,
     GError **error);
 
@@ -123,6 +146,14 @@ fs_rawudp_component_gather_local_candidates (FsRawUdpComponent *self,
 void
 fs_rawudp_component_stop (FsRawUdpComponent *self);
 
+void
+fs_rawudp_component_set_known_source_func (FsRawUdpComponent *self,
+    FsRawUdpKnownSourceFunc func,
+    gpointer user_data);
+
+guint
+fs_rawudp_component_get_known_source_packets (FsRawUdpComponent *self);
+
 G_END_DECLS
 
 #endif /* __FS_RAWUDP_COMPONENT_H__ */
@@ -55,6 +55,19 @@
  * ({component_id=RTP, ip=IP, port=9080},{component_id=RTCP, ip=IP, port=9081}).
  * The default port starts at 7078 for the first component.
  *
+ * On systems with recvmmsg() and sendmmsg(), setting the
+ * #FsRawUdpStreamTransmitter:batch-size property above 1 makes the ports
+ * receive and send packets in batches, which saves system calls when many
+ * streams are handled in the same process. Outgoing packets are held for at
+ * most #FsRawUdpStreamTransmitter:batch-flush-timeout. Ports shared between
+ * streams keep the settings of the stream that opened them first.
+ *
+ * On systems with epoll, setting #FsRawUdpStreamTransmitter:socket-reactor
+ * to %TRUE makes the ports receive from a small process-wide pool of
+ * threads instead of having one thread per port. The size of the pool
+ * defaults to the number of processors and can be set with the
+ * FS_SOCKET_REACTOR_THREADS environment variable.
+ *
  * The name of this transmitter is "rawudp".
  */
 
@@ -102,7 +115,11 @@ enum
   PROP_UPNP_MAPPING,
   PROP_UPNP_DISCOVERY,
   PROP_UPNP_MAPPING_TIMEOUT,
-  PROP_UPNP_DISCOVERY_TIMEOUT
+  PROP_UPNP_DISCOVERY_TIMEOUT,
+  PROP_BATCH_SIZE,
+  PROP_BATCH_FLUSH_TIMEOUT,
+  PROP_SOCKET_REACTOR,
+  PROP_KNOWN_SOURCE_PACKETS
 };
 
 struct _FsRawUdpStreamTransmitterPrivate
@@ -129,6 +146,10 @@ struct _FsRawUdpStreamTransmitterPrivate
 
   gboolean associate_on_source;
 
+  guint batch_size;
+  guint batch_flush_timeout;
+  gboolean socket_reactor;
+
 #ifdef HAVE_GUPNP
   gboolean upnp_discovery;
   gboolean upnp_mapping;
@@ -327,6 +348,51 @@ fs_rawudp_stream_transmitter_class_init (FsRawUdpStreamTransmitterClass *klass)
           0, G_MAXUINT32, DEFAULT_UPNP_DISCOVERY_TIMEOUT,
           G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class,
+      PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size",
+#ifdef HAVE_MMSG
+          "Packets per system call",
+#else
+          "Packets per system call (NOT COMPILED IN)",
+#endif
+          "The maximum number of packets received or sent with one system"
+          " call, 1 disables batching",
+          1, MAX_BATCH_SIZE, 1,
+          G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_BATCH_FLUSH_TIMEOUT,
+      g_param_spec_uint ("batch-flush-timeout",
+          "Maximum time a packet is held for batching",
+          "The maximum time an outgoing packet waits for the batch to fill"
+          " (in microseconds)",
+          0, MAX_BATCH_FLUSH_TIMEOUT, DEFAULT_BATCH_FLUSH_TIMEOUT,
+          G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SOCKET_REACTOR,
+      g_param_spec_boolean ("socket-reactor",
+#ifdef HAVE_EPOLL
+          "Use the shared socket reactor",
+#else
+          "Use the shared socket reactor (NOT COMPILED IN)",
+#endif
+          "Whether to receive from the shared pool of epoll threads instead"
+          " of a dedicated thread per port",
+          FALSE,
+          G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_KNOWN_SOURCE_PACKETS,
+      g_param_spec_uint ("known-source-packets",
+          "Packets received from the remote candidates",
+          "The number of packets received from the remote candidates on all"
+          " the components, including the ones that were not reported with"
+          " the known-source-packet-received signal",
+          0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->dispose = fs_rawudp_stream_transmitter_dispose;
   gobject_class->finalize = fs_rawudp_stream_transmitter_finalize;
 
@@ -343,6 +409,9 @@ fs_rawudp_stream_transmitter_init (FsRawUdpStreamTransmitter *self)
   self->priv->sending = TRUE;
   self->priv->associate_on_source = TRUE;
 
+  self->priv->batch_size = 1;
+  self->priv->batch_flush_timeout = DEFAULT_BATCH_FLUSH_TIMEOUT;
+
 #ifdef HAVE_GUPNP
   self->priv->upnp_mapping = TRUE;
   self->priv->upnp_discovery_timeout = DEFAULT_UPNP_DISCOVERY_TIMEOUT;
@@ -440,6 +509,28 @@ fs_rawudp_stream_transmitter_get_property (GObject *object,
     case PROP_STUN_TIMEOUT:
       g_value_set_uint (value, self->priv->stun_timeout);
       break;
+    case PROP_BATCH_SIZE:
+      g_value_set_uint (value, self->priv->batch_size);
+      break;
+    case PROP_BATCH_FLUSH_TIMEOUT:
+      g_value_set_uint (value, self->priv->batch_flush_timeout);
+      break;
+    case PROP_SOCKET_REACTOR:
+      g_value_set_boolean (value, self->priv->socket_reactor);
+      break;
+    case PROP_KNOWN_SOURCE_PACKETS:
+      {
+        guint packets = 0;
+        gint c;
+
+        for (c = 1; self->priv->component &&
+                 c <= self->priv->transmitter->components; c++)
+          if (self->priv->component[c])
+            packets += fs_rawudp_component_get_known_source_packets (
+                self->priv->component[c]);
+        g_value_set_uint (value, packets);
+      }
+      break;
 #ifdef HAVE_GUPNP
     case PROP_UPNP_MAPPING:
       g_value_set_boolean (value, self->priv->upnp_mapping);
@@ -503,6 +594,15 @@ fs_rawudp_stream_transmitter_set_property (GObject *object,
     case PROP_STUN_TIMEOUT:
       self->priv->stun_timeout = g_value_get_uint (value);
       break;
+    case PROP_BATCH_SIZE:
+      self->priv->batch_size = g_value_get_uint (value);
+      break;
+    case PROP_BATCH_FLUSH_TIMEOUT:
+      self->priv->batch_flush_timeout = g_value_get_uint (value);
+      break;
+    case PROP_SOCKET_REACTOR:
+      self->priv->socket_reactor = g_value_get_boolean (value);
+      break;
 #ifdef HAVE_GUPNP
     case PROP_UPNP_MAPPING:
       self->priv->upnp_mapping = g_value_get_boolean (value);
@@ -631,6 +731,9 @@ fs_rawudp_stream_transmitter_build (FsRawUdpStreamTransmitter *self,
 #else
         FALSE, FALSE, 0, 0, NULL,
 #endif
+        self->priv->batch_size,
+        self->priv->batch_flush_timeout,
+        self->priv->socket_reactor,
         &used_port,
         error);
     if (self->priv->component[c] == NULL)
@@ -644,8 +747,8 @@ fs_rawudp_stream_transmitter_build (FsRawUdpStreamTransmitter *self,
         G_CALLBACK (_component_new_active_candidate_pair), self);
     g_signal_connect (self->priv->component[c], "error",
         G_CALLBACK (_component_error), self);
-    g_signal_connect (self->priv->component[c], "known-source-packet-received",
-        G_CALLBACK (_component_known_source_packet_received), self);
+    fs_rawudp_component_set_known_source_func (self->priv->component[c],
+        _component_known_source_packet_received, self);
 
     /* If we dont get the requested port and it wasnt a forced port,
      * then we rewind up to the last forced port and jump to the next
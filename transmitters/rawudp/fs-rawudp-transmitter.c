@@ -37,6 +37,15 @@
 #include "fs-rawudp-transmitter.h"
 #include "fs-rawudp-stream-transmitter.h"
 
+#ifdef HAVE_MMSG
+#include "fs-rawudp-batch-src.h"
+#include "fs-rawudp-batch-sink.h"
+#endif
+
+#ifdef HAVE_EPOLL
+#include <farstream/fs-socket-reactor.h>
+#endif
+
 #include <farstream/fs-conference.h>
 #include <farstream/fs-plugin.h>
 
@@ -161,6 +170,10 @@ fs_rawudp_transmitter_register_type (FsPlugin *module)
       "Farstream raw UDP transmitter");
 
   fs_rawudp_stream_transmitter_register_type (module);
+#ifdef HAVE_MMSG
+  fs_rawudp_batch_src_register_type (module);
+  fs_rawudp_batch_sink_register_type (module);
+#endif
 
   type = g_type_register_static (FS_TYPE_TRANSMITTER, "FsRawUdpTransmitter",
       &info, 0);
@@ -519,6 +532,14 @@ fs_rawudp_transmitter_new_stream_transmitter (FsTransmitter *transmitter,
  * The UdpPort structure is a ref-counted pseudo-object use to represent
  * one ip:port combo on which we listen and send, so it includes  a udpsrc
  * and a multiudpsink
+ *
+ * In batched mode, the udpsrc and multiudpsink are replaced by a
+ * FsRawUdpBatchSrc and FsRawUdpBatchSink that use recvmmsg()/sendmmsg()
+ *
+ * In socket reactor mode, the udpsrc is replaced by a FsSocketReactorSrc,
+ * which has no streaming thread of its own but is serviced by the
+ * process-wide pool of epoll threads. This takes precedence over batching
+ * on the receive side.
  */
 
 struct _UdpPort {
@@ -536,6 +557,11 @@ struct _UdpPort {
 
   guint port;
 
+  /* Set by the first user, a batch_size of 1 means no batching */
+  guint batch_size;
+  GstClockTime batch_flush_timeout;
+  gboolean socket_reactor;
+
   GSocket *socket;
 
   /* These are just convenience pointers to our parent transmitter */
@@ -544,9 +570,13 @@ struct _UdpPort {
 
   guint component_id;
 
-  /* Everything below is protected by the mutex */
-  GMutex mutex;
-  GArray *known_addresses;
+  /* Maps each known GSocketAddress to the GArray of struct KnownAddress
+   * of the users that expect packets from it, protected by the mutex.
+   * It is only used when the remote candidates change, the receive path
+   * checks the source of each packet against the snapshot of the remote
+   * address kept by each FsRawUdpComponent */
+  GMutex known_addresses_mutex;
+  GHashTable *known_addresses;
 };
 
 struct KnownAddress {
@@ -555,6 +585,17 @@ struct KnownAddress {
   GSocketAddress *addr;
 };
 
+static void
+known_address_array_free (gpointer data)
+{
+  GArray *kas = data;
+  guint i;
+
+  for (i = 0; i < kas->len; i++)
+    g_object_unref (g_array_index (kas, struct KnownAddress, i).addr);
+  g_array_free (kas, TRUE);
+}
+
 static GSocket *
 _bind_port (
     const gchar *ip,
@@ -634,6 +675,9 @@ _create_sinksource (
     GSocket *socket,
     GstPadDirection direction,
     gboolean do_timestamp,
+    guint batch_size,
+    GstClockTime batch_flush_timeout,
+    gboolean socket_reactor,
     GstPad **requested_pad,
     GError **error)
 {
@@ -644,30 +688,48 @@ _create_sinksource (
 
   g_assert (direction == GST_PAD_SINK || direction == GST_PAD_SRC);
 
-  elem = gst_element_factory_make (elementname, NULL);
-  if (!elem)
+#ifdef HAVE_EPOLL
+  if (socket_reactor && direction == GST_PAD_SRC)
+    elem = _fs_socket_reactor_src_new (socket, do_timestamp);
+  else
+#endif
+#ifdef HAVE_MMSG
+  if (batch_size > 1)
   {
-    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
-        "Could not create the %s element", elementname);
-    return NULL;
+    if (direction == GST_PAD_SINK)
+      elem = fs_rawudp_batch_sink_new (socket, batch_size,
+          batch_flush_timeout);
+    else
+      elem = fs_rawudp_batch_src_new (socket, batch_size, do_timestamp);
   }
-
-  g_object_set (elem,
-      "auto-multicast", FALSE,
-      "close-socket", FALSE,
-      "socket", socket,
-      NULL);
-
-  if (direction == GST_PAD_SINK)
-    g_object_set (elem,
-        "async", FALSE,
-        "sync", FALSE,
-        NULL);
   else
+#endif
+  {
+    elem = gst_element_factory_make (elementname, NULL);
+    if (!elem)
+    {
+      g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+          "Could not create the %s element", elementname);
+      return NULL;
+    }
+
     g_object_set (elem,
-        "do-timestamp", do_timestamp,
+        "auto-multicast", FALSE,
+        "close-socket", FALSE,
+        "socket", socket,
         NULL);
 
+    if (direction == GST_PAD_SINK)
+      g_object_set (elem,
+          "async", FALSE,
+          "sync", FALSE,
+          NULL);
+    else
+      g_object_set (elem,
+          "do-timestamp", do_timestamp,
+          NULL);
+  }
+
   if (!gst_bin_add (bin, elem))
   {
     g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
@@ -827,6 +889,9 @@ fs_rawudp_transmitter_get_udpport (FsRawUdpTransmitter *trans,
     guint component_id,
     const gchar *requested_ip,
     guint requested_port,
+    guint batch_size,
+    GstClockTime batch_flush_timeout,
+    gboolean socket_reactor,
     GError **error)
 {
   UdpPort *udpport;
@@ -848,7 +913,18 @@ fs_rawudp_transmitter_get_udpport (FsRawUdpTransmitter *trans,
   g_mutex_unlock (&trans->priv->mutex);
 
   if (udpport)
+  {
+    /* The settings of the first user of a shared port win */
+    if (udpport->batch_size != MAX (batch_size, 1))
+      GST_DEBUG ("Reusing UdpPort for component %u on port %u with a batch"
+          " size of %u instead of %u", component_id, udpport->port,
+          udpport->batch_size, batch_size);
+    if (udpport->socket_reactor != socket_reactor)
+      GST_DEBUG ("Reusing UdpPort for component %u on port %u which %s the"
+          " socket reactor", component_id, udpport->port,
+          udpport->socket_reactor ? "uses" : "does not use");
     return udpport;
+  }
 
   GST_DEBUG ("Make new UdpPort for component %u requesting %s:%u", component_id,
       requested_ip ? requested_ip : "ANY", requested_port);
@@ -859,9 +935,27 @@ fs_rawudp_transmitter_get_udpport (FsRawUdpTransmitter *trans,
   udpport->requested_ip = g_strdup (requested_ip);
   udpport->requested_port = requested_port;
   udpport->component_id = component_id;
-  g_mutex_init (&udpport->mutex);
-  udpport->known_addresses = g_array_new (TRUE, FALSE,
-      sizeof (struct KnownAddress));
+#ifdef HAVE_MMSG
+  udpport->batch_size = MAX (batch_size, 1);
+#else
+  if (batch_size > 1)
+    GST_WARNING ("Batched mode requested, but recvmmsg()/sendmmsg() are not"
+        " available");
+  udpport->batch_size = 1;
+#endif
+  udpport->batch_flush_timeout = batch_flush_timeout;
+#ifdef HAVE_EPOLL
+  udpport->socket_reactor = socket_reactor;
+#else
+  if (socket_reactor)
+    GST_WARNING ("Socket reactor requested, but epoll is not available");
+  udpport->socket_reactor = FALSE;
+#endif
+  g_mutex_init (&udpport->known_addresses_mutex);
+  udpport->known_addresses = g_hash_table_new_full (
+      fs_g_inet_socket_address_hash,
+      (GEqualFunc) fs_g_inet_socket_address_equal,
+      g_object_unref, known_address_array_free);
 
   /* Now lets bind both ports */
 
@@ -878,14 +972,16 @@ fs_rawudp_transmitter_get_udpport (FsRawUdpTransmitter *trans,
   udpport->udpsrc = _create_sinksource ("udpsrc",
       GST_BIN (trans->priv->gst_src), udpport->funnel, NULL,
       udpport->socket, GST_PAD_SRC, trans->priv->do_timestamp,
-      &udpport->udpsrc_requested_pad, error);
+      udpport->batch_size, udpport->batch_flush_timeout,
+      udpport->socket_reactor, &udpport->udpsrc_requested_pad, error);
   if (!udpport->udpsrc)
     goto error;
 
   udpport->udpsink = _create_sinksource ("multiudpsink",
       GST_BIN (trans->priv->gst_sink), udpport->tee, NULL,
-      udpport->socket, GST_PAD_SINK, FALSE, &udpport->udpsink_requested_pad,
-      error);
+      udpport->socket, GST_PAD_SINK, FALSE,
+      udpport->batch_size, udpport->batch_flush_timeout,
+      udpport->socket_reactor, &udpport->udpsink_requested_pad, error);
   if (!udpport->udpsink)
     goto error;
 
@@ -976,16 +1072,10 @@ fs_rawudp_transmitter_put_udpport (FsRawUdpTransmitter *trans,
   g_clear_object (&udpport->socket);
 
   if (udpport->known_addresses)
-  {
-    guint i;
-    for (i = 0; i < udpport->known_addresses->len; i++)
-      g_object_unref (g_array_index (udpport->known_addresses,
-              struct KnownAddress, i).addr);
-    g_array_free (udpport->known_addresses, TRUE);
-  }
+    g_hash_table_unref (udpport->known_addresses);
 
   g_free (udpport->requested_ip);
-  g_mutex_clear (&udpport->mutex);
+  g_mutex_clear (&udpport->known_addresses_mutex);
   g_slice_free (UdpPort, udpport);
 }
 
@@ -1111,36 +1201,35 @@ fs_rawudp_transmitter_udpport_add_known_address (UdpPort *udpport,
     FsRawUdpAddressUniqueCallbackFunc callback,
     gpointer user_data)
 {
-  gint i;
+  guint i;
   gboolean unique = FALSE;
   struct KnownAddress newka = {0};
-  guint counter = 0;
-  struct KnownAddress *prev_ka = NULL;
+  GArray *kas;
+
+  g_mutex_lock (&udpport->known_addresses_mutex);
 
-  g_mutex_lock (&udpport->mutex);
+  kas = g_hash_table_lookup (udpport->known_addresses, address);
 
-  for (i = 0;
-       g_array_index (udpport->known_addresses,
-           struct KnownAddress, i).callback;
-       i++)
+  if (kas == NULL)
   {
-    struct KnownAddress *ka = &g_array_index (udpport->known_addresses,
-        struct KnownAddress, i);
-    if (fs_g_inet_socket_address_equal (address, ka->addr))
-    {
-      g_assert (!(ka->callback == callback && ka->user_data == user_data));
+    kas = g_array_new (FALSE, FALSE, sizeof (struct KnownAddress));
+    g_hash_table_insert (udpport->known_addresses, g_object_ref (address),
+        kas);
+  }
 
-      prev_ka = ka;
-      counter++;
-    }
+  for (i = 0; i < kas->len; i++)
+  {
+    struct KnownAddress *ka = &g_array_index (kas, struct KnownAddress, i);
+    g_assert (!(ka->callback == callback && ka->user_data == user_data));
   }
 
-  if (counter == 0)
+  if (kas->len == 0)
   {
     unique = TRUE;
   }
-  else if (counter == 1)
+  else if (kas->len == 1)
   {
+    struct KnownAddress *prev_ka = &g_array_index (kas, struct KnownAddress, 0);
     if (prev_ka->callback)
       prev_ka->callback (FALSE, prev_ka->addr, prev_ka->user_data);
   }
@@ -1149,9 +1238,9 @@ fs_rawudp_transmitter_udpport_add_known_address (UdpPort *udpport,
   newka.callback = callback;
   newka.user_data = user_data;
 
-  g_array_append_val (udpport->known_addresses, newka);
+  g_array_append_val (kas, newka);
 
-  g_mutex_unlock (&udpport->mutex);
+  g_mutex_unlock (&udpport->known_addresses_mutex);
 
   return unique;
 }
@@ -1175,49 +1264,45 @@ fs_rawudp_transmitter_udpport_remove_known_address (UdpPort *udpport,
     FsRawUdpAddressUniqueCallbackFunc callback,
     gpointer user_data)
 {
-  gint i;
-  gint remove_i = -1;
-  guint counter = 0;
-  struct KnownAddress *prev_ka = NULL;
+  guint i;
+  GArray *kas;
+
+  g_mutex_lock (&udpport->known_addresses_mutex);
 
-  g_mutex_lock (&udpport->mutex);
+  kas = g_hash_table_lookup (udpport->known_addresses, address);
 
-  for (i = 0;
-       g_array_index (udpport->known_addresses, struct KnownAddress, i).callback;
-       i++)
+  if (kas)
   {
-    struct KnownAddress *ka = &g_array_index (udpport->known_addresses,
-        struct KnownAddress, i);
-    if (fs_g_inet_socket_address_equal (address, ka->addr))
+    for (i = 0; i < kas->len; i++)
     {
+      struct KnownAddress *ka = &g_array_index (kas, struct KnownAddress, i);
       if (ka->callback == callback && ka->user_data == user_data)
-      {
-        remove_i = i;
-      }
-      else
-      {
-        counter++;
-        prev_ka = ka;
-      }
+        break;
     }
   }
 
-  if (remove_i == -1)
+  if (kas == NULL || i == kas->len)
   {
     GST_ERROR ("Tried to remove unknown known address");
     goto out;
   }
 
-  if (counter == 1)
-    prev_ka->callback (TRUE, prev_ka->addr, prev_ka->user_data);
+  g_object_unref (g_array_index (kas, struct KnownAddress, i).addr);
+  g_array_remove_index_fast (kas, i);
 
-  g_object_unref (g_array_index (udpport->known_addresses,
-          struct KnownAddress, remove_i).addr);
-  g_array_remove_index_fast (udpport->known_addresses, remove_i);
+  if (kas->len == 1)
+  {
+    struct KnownAddress *ka = &g_array_index (kas, struct KnownAddress, 0);
+    ka->callback (TRUE, ka->addr, ka->user_data);
+  }
+  else if (kas->len == 0)
+  {
+    g_hash_table_remove (udpport->known_addresses, address);
+  }
 
  out:
 
-  g_mutex_unlock (&udpport->mutex);
+  g_mutex_unlock (&udpport->known_addresses_mutex);
 }
 
 static void
@@ -1277,3 +1362,27 @@ fs_g_inet_socket_address_equal (GSocketAddress *addr1, GSocketAddress *addr2)
   else
     return FALSE;
 }
+
+guint
+fs_g_inet_socket_address_hash (gconstpointer key)
+{
+  GInetSocketAddress *inet;
+  GInetAddress *addr;
+  const guint8 *bytes;
+  gsize i, len;
+  guint hash;
+
+  if (!G_IS_INET_SOCKET_ADDRESS (key))
+    return 0;
+
+  inet = G_INET_SOCKET_ADDRESS (key);
+  addr = g_inet_socket_address_get_address (inet);
+  bytes = g_inet_address_to_bytes (addr);
+  len = g_inet_address_get_native_size (addr);
+
+  hash = g_inet_socket_address_get_port (inet);
+  for (i = 0; i < len; i++)
+    hash = (hash << 5) - hash + bytes[i];
+
+  return hash;
+}
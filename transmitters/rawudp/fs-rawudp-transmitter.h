@@ -104,6 +104,9 @@ UdpPort *fs_rawudp_transmitter_get_udpport (FsRawUdpTransmitter *trans,
     guint component_id,
     const gchar *requested_ip,
     guint requested_port,
+    guint batch_size,
+    GstClockTime batch_flush_timeout,
+    gboolean socket_reactor,
     GError **error);
 
 void fs_rawudp_transmitter_put_udpport (FsRawUdpTransmitter *trans,
@@ -147,6 +150,7 @@ void fs_rawudp_transmitter_udpport_remove_known_address (UdpPort *udpport,
 
 gboolean fs_g_inet_socket_address_equal (GSocketAddress *addr1,
     GSocketAddress *addr2);
+guint fs_g_inet_socket_address_hash (gconstpointer key);
 
 G_END_DECLS
 
@@ -57,6 +57,13 @@
  * #FsCandidate with the path of the sender's socket in the "username" field.
  * If the receiver can not connect to the sender,
  * the fs_stream_transmitter_force_remote_candidates() call will fail.
+ *
+ * The sockets only carry the position of each packet. The sender copies
+ * every packet once into its shared memory area, and the receiver's buffers
+ * point into that area until they are released, without a second copy.
+ * When sending high bitrate streams such as raw video, the
+ * #FsShmStreamTransmitter:shm-size parameter must be large enough to hold
+ * everything the receiver has not released yet.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -98,6 +105,7 @@ enum
   PROP_SENDING,
   PROP_PREFERRED_LOCAL_CANDIDATES,
   PROP_CREATE_LOCAL_CANDIDATES,
+  PROP_SHM_SIZE,
 };
 
 struct _FsShmStreamTransmitterPrivate
@@ -122,6 +130,9 @@ struct _FsShmStreamTransmitterPrivate
    * to pass them to us as part of the candidate */
   gboolean create_local_candidates;
 
+  /* Size of the shared memory area of each sender, 0 for the default */
+  guint shm_size;
+
   /* temporary socket directy in case we made one */
   gchar *socket_dir;
 
@@ -227,6 +238,15 @@ fs_shm_stream_transmitter_class_init (FsShmStreamTransmitterClass *klass)
     PROP_CREATE_LOCAL_CANDIDATES,
     pspec);
 
+  g_object_class_install_property (gobject_class,
+      PROP_SHM_SIZE,
+      g_param_spec_uint ("shm-size",
+          "Size of the shared memory area",
+          "The size of the shared memory area used to send each component"
+          " (in bytes), 0 for the default of the shmsink element",
+          0, G_MAXUINT, 0,
+          G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
 
   gobject_class->dispose = fs_shm_stream_transmitter_dispose;
   gobject_class->finalize = fs_shm_stream_transmitter_finalize;
@@ -311,6 +331,9 @@ fs_shm_stream_transmitter_get_property (GObject *object,
     case PROP_CREATE_LOCAL_CANDIDATES:
       g_value_set_boolean (value, self->priv->create_local_candidates);
       break;
+    case PROP_SHM_SIZE:
+      g_value_set_uint (value, self->priv->shm_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -340,6 +363,9 @@ fs_shm_stream_transmitter_set_property (GObject *object,
     case PROP_CREATE_LOCAL_CANDIDATES:
       self->priv->create_local_candidates = g_value_get_boolean (value);
       break;
+    case PROP_SHM_SIZE:
+      self->priv->shm_size = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -410,8 +436,8 @@ fs_shm_stream_transmitter_add_sink (FsShmStreamTransmitter *self,
 
   self->priv->shm_sink[candidate->component_id] =
     fs_shm_transmitter_get_shm_sink (self->priv->transmitter,
-        candidate->component_id, candidate->ip, ready_cb, connected_cb,
-        self, error);
+        candidate->component_id, candidate->ip, self->priv->shm_size,
+        ready_cb, connected_cb, self, error);
 
   if (self->priv->shm_sink[candidate->component_id] == NULL)
     return FALSE;
@@ -568,7 +594,8 @@ fs_shm_stream_transmitter_gather_local_candidates (
 
       self->priv->shm_sink[c] =
         fs_shm_transmitter_get_shm_sink (self->priv->transmitter,
-          c, path, ready_cb, connected_cb, self, error);
+          c, path, self->priv->shm_size, ready_cb, connected_cb, self,
+          error);
       g_free (path);
 
       if (self->priv->shm_sink[c] == NULL)
@@ -45,6 +45,15 @@
 GST_DEBUG_CATEGORY (fs_shm_transmitter_debug);
 #define GST_CAT_DEFAULT fs_shm_transmitter_debug
 
+/* Once a SSRC has been reported, only one packet out of this many is
+ * reported again, the others are just counted */
+#define KNOWN_SOURCE_REPORT_INTERVAL (256)
+
+/* How many SSRCs are remembered as already reported, so interleaved ones
+ * (simulcast, audio and video on one component) are not all reported, the
+ * oldest one is forgotten first */
+#define KNOWN_SOURCE_MAX_SSRCS (8)
+
 /* Signals */
 enum
 {
@@ -567,18 +576,92 @@ struct _ShmSrc {
   connection disconnected_func;
   gpointer cb_data;
   gulong buffer_probe;
+
+  /* Only touched from the streaming thread. There is one ShmSrc per
+   * sender, so a new source starts with an empty set */
+  guint32 reported_ssrcs[KNOWN_SOURCE_MAX_SSRCS];
+  guint n_reported_ssrcs;
+  guint next_reported_ssrc;
+  guint64 packets;
 };
 
 
+/* Reads the SSRC of an RTP packet or of the first packet of an RTCP compound
+ * packet, they are told apart by the packet type like RFC 5761 does */
+static gboolean
+get_ssrc (GstBuffer *buffer, guint32 *ssrc)
+{
+  guint8 data[12];
+  gsize size;
+
+  size = gst_buffer_extract (buffer, 0, data, sizeof (data));
+
+  if (size < 8 || (data[0] >> 6) != 2)
+    return FALSE;
+
+  if (data[1] >= 192 && data[1] <= 223)
+  {
+    *ssrc = GST_READ_UINT32_BE (data + 4);
+  }
+  else
+  {
+    if (size < 12)
+      return FALSE;
+    *ssrc = GST_READ_UINT32_BE (data + 8);
+  }
+
+  return TRUE;
+}
+
+/* Returns TRUE if the SSRC was already reported, remembers it otherwise */
+
+static gboolean
+shm_src_ssrc_was_reported (ShmSrc *shm, guint32 ssrc)
+{
+  guint i;
+
+  for (i = 0; i < shm->n_reported_ssrcs; i++)
+    if (shm->reported_ssrcs[i] == ssrc)
+      return TRUE;
+
+  if (shm->n_reported_ssrcs < KNOWN_SOURCE_MAX_SSRCS)
+  {
+    shm->reported_ssrcs[shm->n_reported_ssrcs++] = ssrc;
+  }
+  else
+  {
+    shm->reported_ssrcs[shm->next_reported_ssrc] = ssrc;
+    shm->next_reported_ssrc =
+        (shm->next_reported_ssrc + 1) % KNOWN_SOURCE_MAX_SSRCS;
+  }
+
+  return FALSE;
+}
+
+/*
+ * Everything that comes out of a shmsrc is from the known source, but
+ * reporting every packet costs a signal emission and a trip through the
+ * session lock. So packets are only reported when they carry a SSRC that is
+ * not among the last ones reported and then once every
+ * KNOWN_SOURCE_REPORT_INTERVAL packets, the others are only counted.
+ */
 static GstPadProbeReturn
 src_buffer_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
 {
   ShmSrc *shm = user_data;
   GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  guint32 ssrc;
+
+  shm->packets++;
+
+  if (get_ssrc (buffer, &ssrc) &&
+      shm_src_ssrc_was_reported (shm, ssrc) &&
+      shm->packets % KNOWN_SOURCE_REPORT_INTERVAL != 0)
+    return GST_PAD_PROBE_OK;
 
   shm->got_buffer_func (buffer, shm->component, shm->cb_data);
 
-  return TRUE;
+  return GST_PAD_PROBE_OK;
 }
 
 
@@ -755,6 +838,7 @@ ShmSink *
 fs_shm_transmitter_get_shm_sink (FsShmTransmitter *self,
     guint component,
     const gchar *path,
+    guint shm_size,
     ready ready_func,
     connection connected_func,
     gpointer cb_data,
@@ -783,12 +867,18 @@ fs_shm_transmitter_get_shm_sink (FsShmTransmitter *self,
         "Could not make shmsink");
     goto error;
   }
+  /* shmsink hands its allocator to upstream in the allocation query, so
+   * buffers allocated from it are sent without being copied. The area must
+   * be large enough to hold every buffer the receivers have not released
+   * yet, which for raw video is many times the default. */
   g_object_set (elem,
       "socket-path", path,
       "wait-for-connection", FALSE,
       "async", FALSE,
       "sync" , FALSE,
       NULL);
+  if (shm_size)
+    g_object_set (elem, "shm-size", shm_size, NULL);
 
   if (ready_func)
     g_signal_connect (self->priv->gst_sink, "ready", G_CALLBACK (ready_cb),
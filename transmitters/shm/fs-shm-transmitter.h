@@ -106,6 +106,7 @@ gboolean fs_shm_transmitter_check_shm_src (FsShmTransmitter *self,
 ShmSink *fs_shm_transmitter_get_shm_sink (FsShmTransmitter *self,
     guint component,
     const gchar *path,
+    guint shm_size,
     ready ready_func,
     connection connected_fubnc,
     gpointer cb_data,